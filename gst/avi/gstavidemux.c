@@ -64,6 +64,14 @@
 GST_DEBUG_CATEGORY_STATIC (avidemux_debug);
 #define GST_CAT_DEFAULT avidemux_debug
 
+#define DEFAULT_MAX_INDEX_MEMORY 0
+
+enum
+{
+  PROP_0,
+  PROP_MAX_INDEX_MEMORY
+};
+
 static GstStaticPadTemplate sink_templ = GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
     GST_PAD_ALWAYS,
@@ -78,6 +86,10 @@ static const char *const snap_types[2][2] = {
 #endif
 
 static void gst_avi_demux_finalize (GObject * object);
+static void gst_avi_demux_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec);
+static void gst_avi_demux_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec);
 
 static void gst_avi_demux_reset (GstAviDemux * avi);
 
@@ -141,6 +153,23 @@ gst_avi_demux_class_init (GstAviDemuxClass * klass)
       0, "Demuxer for AVI streams");
 
   gobject_class->finalize = gst_avi_demux_finalize;
+  gobject_class->set_property = gst_avi_demux_set_property;
+  gobject_class->get_property = gst_avi_demux_get_property;
+
+  /**
+   * GstAviDemux:max-index-memory:
+   *
+   * The same property as on the other demuxers. The AVI index lists every
+   * chunk that is played, so it can not be thinned out: the limit is only
+   * compared with the index size, which is posted in an "index-memory"
+   * element message with "sparse" always FALSE.
+   */
+  g_object_class_install_property (gobject_class, PROP_MAX_INDEX_MEMORY,
+      g_param_spec_uint64 ("max-index-memory", "Max index memory",
+          "Maximum memory for the index in bytes, only reported as the AVI "
+          "index can not be thinned out (0 = unlimited)", 0, G_MAXUINT64,
+          DEFAULT_MAX_INDEX_MEMORY,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   gstelement_class->change_state =
       GST_DEBUG_FUNCPTR (gst_avi_demux_change_state);
@@ -198,6 +227,8 @@ gst_avi_demux_init (GstAviDemux * avi)
   avi->adapter = gst_adapter_new ();
   avi->flowcombiner = gst_flow_combiner_new ();
 
+  avi->max_index_memory = DEFAULT_MAX_INDEX_MEMORY;
+
   gst_avi_demux_reset (avi);
 
   GST_OBJECT_FLAG_SET (avi, GST_ELEMENT_FLAG_INDEXABLE);
@@ -216,6 +247,42 @@ gst_avi_demux_finalize (GObject * object)
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
+static void
+gst_avi_demux_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstAviDemux *avi = GST_AVI_DEMUX (object);
+
+  switch (prop_id) {
+    case PROP_MAX_INDEX_MEMORY:
+      GST_OBJECT_LOCK (avi);
+      avi->max_index_memory = g_value_get_uint64 (value);
+      GST_OBJECT_UNLOCK (avi);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_avi_demux_get_property (GObject * object, guint prop_id, GValue * value,
+    GParamSpec * pspec)
+{
+  GstAviDemux *avi = GST_AVI_DEMUX (object);
+
+  switch (prop_id) {
+    case PROP_MAX_INDEX_MEMORY:
+      GST_OBJECT_LOCK (avi);
+      g_value_set_uint64 (value, avi->max_index_memory);
+      GST_OBJECT_UNLOCK (avi);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
 static void
 gst_avi_demux_reset_stream (GstAviDemux * avi, GstAviStream * stream)
 {
@@ -1328,7 +1395,8 @@ gst_avi_demux_add_index (GstAviDemux * avi, GstAviStream * stream,
        * overshoot with at least 8K */
       idx_max = (num / avi->num_streams) + (8192 / sizeof (GstAviIndexEntry));
     } else {
-      idx_max += 8192 / sizeof (GstAviIndexEntry);
+      /* grow geometrically so that filling a large index stays linear */
+      idx_max += MAX (idx_max / 2, 8192 / sizeof (GstAviIndexEntry));
       GST_DEBUG_OBJECT (avi, "expanded index from %u to %u",
           stream->idx_max, idx_max);
     }
@@ -1464,6 +1532,17 @@ gst_avi_demux_do_index_stats (GstAviDemux * avi)
     gst_avi_demux_get_buffer_info (avi, stream, stream->idx_n - 1,
         NULL, &stream->idx_duration, NULL, NULL);
 
+    /* the index was grown in steps, give back what was allocated too much */
+    if (stream->idx_max > stream->idx_n) {
+      GstAviIndexEntry *new_idx;
+
+      new_idx = g_try_renew (GstAviIndexEntry, stream->index, stream->idx_n);
+      if (new_idx) {
+        stream->index = new_idx;
+        stream->idx_max = stream->idx_n;
+      }
+    }
+
     total_idx += stream->idx_n;
 #ifndef GST_DISABLE_GST_DEBUG
     total_max += stream->idx_max;
@@ -1482,6 +1561,22 @@ gst_avi_demux_do_index_stats (GstAviDemux * avi)
   GST_INFO_OBJECT (avi, "%u bytes for index vs %u ideally, %u wasted",
       total_max, total_idx, total_max - total_idx);
 
+  /* the index lists every chunk that is played, so it can't be made sparse,
+   * but applications can still see how much memory it takes */
+  GST_OBJECT_LOCK (avi);
+  if (avi->max_index_memory && total_idx > avi->max_index_memory)
+    GST_WARNING_OBJECT (avi, "index takes %u bytes, more than the %"
+        G_GUINT64_FORMAT " of max-index-memory, but can't be thinned out",
+        total_idx, avi->max_index_memory);
+  GST_OBJECT_UNLOCK (avi);
+  gst_element_post_message (GST_ELEMENT_CAST (avi),
+      gst_message_new_element (GST_OBJECT_CAST (avi),
+          gst_structure_new ("index-memory",
+              "bytes", G_TYPE_UINT64, (guint64) total_idx,
+              "entries", G_TYPE_UINT,
+              (guint) (total_idx / sizeof (GstAviIndexEntry)),
+              "sparse", G_TYPE_BOOLEAN, FALSE, NULL)));
+
   if (total_idx == 0) {
     GST_WARNING_OBJECT (avi, "Index is empty !");
     return FALSE;
@@ -3000,52 +3095,86 @@ no_index:
   }
 }
 
+/* chunk headers are read from blocks of this size when scanning, unless
+ * they follow a chunk larger than a block */
+#define SCAN_BLOCK_SIZE (1024 * 1024)
+#define SCAN_HEADER_SIZE 8
+
+typedef struct
+{
+  GstBuffer *buffer;
+  GstMapInfo map;
+  guint64 offset;
+} GstAviScanBlock;
+
+static void
+gst_avi_demux_scan_block_clear (GstAviScanBlock * block)
+{
+  if (block->buffer) {
+    gst_buffer_unmap (block->buffer, &block->map);
+    gst_buffer_unref (block->buffer);
+    block->buffer = NULL;
+  }
+}
+
 /*
  * gst_avi_demux_peek_tag:
  *
- * Returns the tag and size of the next chunk
+ * Returns the tag and size of the next chunk, taken from @block, which is
+ * refilled when it does not contain them. That is done with a large read,
+ * unless a chunk of at least a block was skipped to get here: the chunks
+ * that follow are then likely large too, and reading a block for every
+ * header would read the whole file.
  */
 static GstFlowReturn
-gst_avi_demux_peek_tag (GstAviDemux * avi, guint64 offset, guint32 * tag,
-    guint * size)
+gst_avi_demux_peek_tag (GstAviDemux * avi, GstAviScanBlock * block,
+    guint64 offset, guint32 * tag, guint * size)
 {
   GstFlowReturn res;
-  GstBuffer *buf = NULL;
-  GstMapInfo map;
+  const guint8 *data;
 
-  res = gst_pad_pull_range (avi->sinkpad, offset, 8, &buf);
-  if (res != GST_FLOW_OK)
-    goto pull_failed;
+  if (!block->buffer || offset < block->offset ||
+      offset + 8 > block->offset + block->map.size) {
+    guint pull_size = SCAN_BLOCK_SIZE;
 
-  gst_buffer_map (buf, &map, GST_MAP_READ);
-  if (map.size != 8)
-    goto wrong_size;
+    if (block->buffer &&
+        offset >= block->offset + block->map.size + SCAN_BLOCK_SIZE)
+      pull_size = SCAN_HEADER_SIZE;
+
+    gst_avi_demux_scan_block_clear (block);
+
+    res = gst_pad_pull_range (avi->sinkpad, offset, pull_size, &block->buffer);
+    if (res != GST_FLOW_OK)
+      goto pull_failed;
+
+    gst_buffer_map (block->buffer, &block->map, GST_MAP_READ);
+    block->offset = offset;
+    if (block->map.size < 8)
+      goto wrong_size;
+  }
 
-  *tag = GST_READ_UINT32_LE (map.data);
-  *size = GST_READ_UINT32_LE (map.data + 4);
+  data = block->map.data + (offset - block->offset);
+  *tag = GST_READ_UINT32_LE (data);
+  *size = GST_READ_UINT32_LE (data + 4);
 
   GST_LOG_OBJECT (avi, "Tag[%" GST_FOURCC_FORMAT "] (size:%d) %"
       G_GINT64_FORMAT " -- %" G_GINT64_FORMAT, GST_FOURCC_ARGS (*tag),
       *size, offset + 8, offset + 8 + (gint64) * size);
 
-done:
-  gst_buffer_unmap (buf, &map);
-  gst_buffer_unref (buf);
-
-  return res;
+  return GST_FLOW_OK;
 
   /* ERRORS */
 pull_failed:
   {
     GST_DEBUG_OBJECT (avi, "pull_ranged returned %s", gst_flow_get_name (res));
+    block->buffer = NULL;
     return res;
   }
 wrong_size:
   {
-    GST_DEBUG_OBJECT (avi, "got %" G_GSIZE_FORMAT " bytes which is <> 8 bytes",
-        map.size);
-    res = GST_FLOW_ERROR;
-    goto done;
+    GST_DEBUG_OBJECT (avi, "got %" G_GSIZE_FORMAT " bytes which is < 8 bytes",
+        block->map.size);
+    return GST_FLOW_ERROR;
   }
 }
 
@@ -3056,15 +3185,15 @@ wrong_size:
  * Position is the position of the buffer (after tag and size)
  */
 static GstFlowReturn
-gst_avi_demux_next_data_buffer (GstAviDemux * avi, guint64 * offset,
-    guint32 * tag, guint * size)
+gst_avi_demux_next_data_buffer (GstAviDemux * avi, GstAviScanBlock * block,
+    guint64 * offset, guint32 * tag, guint * size)
 {
   guint64 off = *offset;
   guint _size = 0;
   GstFlowReturn res;
 
   do {
-    res = gst_avi_demux_peek_tag (avi, off, tag, &_size);
+    res = gst_avi_demux_peek_tag (avi, block, off, tag, &_size);
     if (res != GST_FLOW_OK)
       break;
     if (*tag == GST_RIFF_TAG_LIST || *tag == GST_RIFF_TAG_RIFF)
@@ -3079,6 +3208,14 @@ gst_avi_demux_next_data_buffer (GstAviDemux * avi, guint64 * offset,
   return res;
 }
 
+static void
+gst_avi_demux_post_scan_progress (GstAviDemux * avi, GstProgressType type,
+    const gchar * text)
+{
+  gst_element_post_message (GST_ELEMENT_CAST (avi),
+      gst_message_new_progress (GST_OBJECT_CAST (avi), type, "scan", text));
+}
+
 /*
  * gst_avi_demux_stream_scan:
  * @avi: calling element (used for debugging/errors).
@@ -3091,11 +3228,12 @@ gst_avi_demux_stream_scan (GstAviDemux * avi)
 {
   GstFlowReturn res;
   GstAviStream *stream;
+  GstAviScanBlock block = { NULL, };
   guint64 pos = 0;
   guint64 length;
   gint64 tmplength;
   guint32 tag = 0;
-  guint num;
+  guint num, percent, last_percent = 0;
 
   /* FIXME:
    * - implement non-seekable source support.
@@ -3110,12 +3248,15 @@ gst_avi_demux_stream_scan (GstAviDemux * avi)
   /* guess the total amount of entries we expect */
   num = 16000;
 
+  gst_avi_demux_post_scan_progress (avi, GST_PROGRESS_TYPE_START,
+      "Scanning file for an index");
+
   while (TRUE) {
     GstAviIndexEntry entry;
     guint size = 0;
 
     /* start reading data buffers to find the id and offset */
-    res = gst_avi_demux_next_data_buffer (avi, &pos, &tag, &size);
+    res = gst_avi_demux_next_data_buffer (avi, &block, &pos, &tag, &size);
     if (G_UNLIKELY (res != GST_FLOW_OK))
       break;
 
@@ -3141,16 +3282,33 @@ gst_avi_demux_stream_scan (GstAviDemux * avi)
           "Stopping index lookup since we are further than EOF");
       break;
     }
+
+    percent = length ? pos * 100 / length : 100;
+    if (percent >= last_percent + 10) {
+      gchar *text = g_strdup_printf ("Scanned %u%% of the file", percent);
+
+      gst_avi_demux_post_scan_progress (avi, GST_PROGRESS_TYPE_CONTINUE, text);
+      g_free (text);
+      last_percent = percent;
+    }
   }
 
+  gst_avi_demux_scan_block_clear (&block);
+
   /* collect stats */
   avi->have_index = gst_avi_demux_do_index_stats (avi);
 
+  gst_avi_demux_post_scan_progress (avi, GST_PROGRESS_TYPE_COMPLETE,
+      avi->have_index ? "Index created" : "No index found");
+
   return TRUE;
 
   /* ERRORS */
 out_of_mem:
   {
+    gst_avi_demux_scan_block_clear (&block);
+    gst_avi_demux_post_scan_progress (avi, GST_PROGRESS_TYPE_ERROR,
+        "Out of memory");
     GST_ELEMENT_ERROR (avi, RESOURCE, NO_SPACE_LEFT, (NULL),
         ("Cannot allocate memory for %u*%u=%u bytes",
             (guint) sizeof (GstAviIndexEntry), num,
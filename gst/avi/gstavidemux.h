@@ -206,6 +206,9 @@ typedef struct _GstAviDemux {
   guint64       *odml_subidxs;
 
   guint64        seek_kf_offset; /* offset of the keyframe to which we want to seek */
+
+  /* only compared with the index size, see the property */
+  guint64        max_index_memory;
 } GstAviDemux;
 
 typedef struct _GstAviDemuxClass {
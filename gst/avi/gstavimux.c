@@ -1512,6 +1512,13 @@ gst_avi_mux_write_avix_index (GstAviMux * avimux, GstAviPad * avipad,
   gst_buffer_unmap (buffer, &map);
   gst_buffer_resize (buffer, 0, size);
 
+  /* nothing of this stream since the last one, don't waste a superindex
+   * entry */
+  if (entry_count == 0) {
+    gst_buffer_unref (buffer);
+    return GST_FLOW_OK;
+  }
+
   /* send */
   if ((res = gst_pad_push (avimux->srcpad, buffer)) != GST_FLOW_OK)
     return res;
@@ -1523,6 +1530,8 @@ gst_avi_mux_write_avix_index (GstAviMux * avimux, GstAviPad * avipad,
     super_index[i].size = GUINT32_TO_LE (size);
     if (is_pcm) {
       super_index[i].duration = GUINT32_TO_LE (pcm_samples);
+      /* the next chunk counts from here */
+      ((GstAviAudioPad *) avipad)->samples = 0;
     } else {
       super_index[i].duration = GUINT32_TO_LE (entry_count);
     }
@@ -1533,6 +1542,7 @@ gst_avi_mux_write_avix_index (GstAviMux * avimux, GstAviPad * avipad,
 
   /* ... and in size */
   avimux->total_data += size;
+  avimux->idx_offset += size;
   if (avimux->is_bigfile)
     avimux->datax_size += size;
   else
@@ -1541,6 +1551,29 @@ gst_avi_mux_write_avix_index (GstAviMux * avimux, GstAviPad * avipad,
   return GST_FLOW_OK;
 }
 
+/* write the odml standard index chunks of all streams for the index entries
+ * collected so far */
+static GstFlowReturn
+gst_avi_mux_write_avix_indexes (GstAviMux * avimux)
+{
+  GstFlowReturn res = GST_FLOW_OK;
+  GSList *node;
+
+  node = avimux->sinkpads;
+  while (node) {
+    GstAviPad *avipad = (GstAviPad *) node->data;
+
+    node = node->next;
+
+    res = gst_avi_mux_write_avix_index (avimux, avipad, avipad->tag,
+        avipad->idx_tag, avipad->idx, &avipad->idx_index);
+    if (res != GST_FLOW_OK)
+      break;
+  }
+
+  return res;
+}
+
 /* some other usable functions (thankyou xawtv ;-) ) */
 
 static void
@@ -1549,7 +1582,7 @@ gst_avi_mux_add_index (GstAviMux * avimux, GstAviPad * avipad, guint32 flags,
 {
   gchar *code = avipad->tag;
   if (avimux->idx_index == avimux->idx_count) {
-    avimux->idx_count += 256;
+    avimux->idx_count += MAX (256, avimux->idx_count / 2);
     avimux->idx =
         g_realloc (avimux->idx,
         avimux->idx_count * sizeof (gst_riff_index_entry));
@@ -1622,17 +1655,9 @@ gst_avi_mux_bigfile (GstAviMux * avimux, gboolean last)
   GSList *node;
 
   /* first some odml standard index chunks in the movi list */
-  node = avimux->sinkpads;
-  while (node) {
-    GstAviPad *avipad = (GstAviPad *) node->data;
-
-    node = node->next;
-
-    res = gst_avi_mux_write_avix_index (avimux, avipad, avipad->tag,
-        avipad->idx_tag, avipad->idx, &avipad->idx_index);
-    if (res != GST_FLOW_OK)
-      return res;
-  }
+  res = gst_avi_mux_write_avix_indexes (avimux);
+  if (res != GST_FLOW_OK)
+    return res;
 
   if (avimux->is_bigfile) {
     GstSegment segment;
@@ -1686,6 +1711,7 @@ gst_avi_mux_bigfile (GstAviMux * avimux, gboolean last)
   avimux->total_data += gst_buffer_get_size (header);
   /* avix_start is used as base offset for the odml index chunk */
   avimux->idx_offset = avimux->total_data - avimux->avix_start;
+  avimux->idx_flush_offset = avimux->idx_offset;
 
   return gst_pad_push (avimux->srcpad, header);
 }
@@ -1712,6 +1738,7 @@ gst_avi_mux_start_file (GstAviMux * avimux)
   avimux->idx_index = 0;
   avimux->idx_offset = 0;       /* see 10 lines below */
   avimux->idx_size = 0;
+  avimux->idx_flush_offset = 0;
   avimux->idx_count = 0;
   avimux->idx = NULL;
 
@@ -2127,6 +2154,19 @@ gst_avi_mux_do_buffer (GstAviMux * avimux, GstAviPad * avipad)
   avimux->total_data += total_size;
   avimux->idx_offset += total_size;
 
+  /* no legacy index is written for AVIX chunks, so only the entries since
+   * the last standard index chunks are needed. Those are written by size
+   * rather than by number of entries, so the superindex does not run out
+   * before the file size it was made for. */
+  if (avimux->is_bigfile &&
+      avimux->idx_offset - avimux->idx_flush_offset >= GST_AVI_IX_FLUSH_SIZE) {
+    GST_LOG_OBJECT (avimux, "writing %d pending index entries",
+        avimux->idx_index);
+    res = gst_avi_mux_write_avix_indexes (avimux);
+    avimux->idx_index = 0;
+    avimux->idx_flush_offset = avimux->idx_offset;
+  }
+
 done:
   gst_buffer_unref (data);
   return res;
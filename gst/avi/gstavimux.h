@@ -43,12 +43,20 @@ G_BEGIN_DECLS
 #define GST_AVI_INDEX_OF_INDEXES     0
 #define GST_AVI_INDEX_OF_CHUNKS      1
 
-/* this allows indexing up to 64GB avi file */
-#define GST_AVI_SUPERINDEX_COUNT    32
-
 /* max size */
 #define GST_AVI_MAX_SIZE    0x40000000
 
+/* in AVIX chunks, pending index entries are written out as standard index
+ * chunks every so many bytes, so they need not all be kept in memory */
+#define GST_AVI_IX_FLUSH_SIZE       (GST_AVI_MAX_SIZE / 4)
+
+/* room for the standard index chunks of each stream, at most one per
+ * GST_AVI_IX_FLUSH_SIZE bytes plus one at the end of every RIFF chunk;
+ * this allows indexing 64 RIFF chunks, about 64GB avi files, whatever
+ * their bitrate */
+#define GST_AVI_SUPERINDEX_COUNT \
+  (64 * (GST_AVI_MAX_SIZE / GST_AVI_IX_FLUSH_SIZE + 1))
+
 typedef struct _gst_avi_superindex_entry {
   guint64 offset;
   guint32 size;
@@ -177,6 +185,8 @@ struct _GstAviMux {
   guint32 idx_offset;
   /* size of idx1 chunk (including! chunk header and size bytes) */
   guint32 idx_size;
+  /* idx_offset when the standard index chunks were last written */
+  guint32 idx_flush_offset;
 
   /* are we a big file already? */
   gboolean is_bigfile;
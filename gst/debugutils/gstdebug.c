@@ -28,6 +28,7 @@ GType gst_break_my_data_get_type (void);
 GType gst_caps_setter_get_type (void);
 GType gst_rnd_buffer_size_get_type (void);
 GType gst_navseek_get_type (void);
+GType gst_net_sim_get_type (void);
 GType gst_progress_report_get_type (void);
 GType gst_tag_inject_get_type (void);
 GType gst_test_get_type (void);
@@ -48,6 +49,8 @@ plugin_init (GstPlugin * plugin)
           gst_rnd_buffer_size_get_type ())
       || !gst_element_register (plugin, "navseek", GST_RANK_NONE,
           gst_navseek_get_type ())
+      || !gst_element_register (plugin, "netsim", GST_RANK_NONE,
+          gst_net_sim_get_type ())
       || !gst_element_register (plugin, "pushfilesrc", GST_RANK_NONE,
           gst_push_file_src_get_type ()) ||
 /*    !gst_element_register (plugin, "negotiation", GST_RANK_NONE, gst_gst_negotiation_get_type ()) || */
@@ -0,0 +1,1072 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+/**
+ * SECTION:element-netsim
+ *
+ * This element simulates an unreliable network on the buffers (typically
+ * RTP packets) passing through it. Packets can be dropped according to a
+ * two-state Gilbert-Elliott model, duplicated, delayed with a uniform or
+ * normal jitter distribution and reordered.
+ *
+ * All random decisions are taken from a #GRand seeded with the #GstNetSim:seed
+ * property and delays are scheduled on the pipeline clock, so a run with a
+ * #GstTestClock is fully reproducible.
+ *
+ * When no delay, jitter or reordering is configured and nothing is waiting
+ * in the queue, buffers and buffer lists are pushed from the streaming thread
+ * of the sinkpad without being queued. Serialized events never overtake the
+ * buffers that are still being delayed.
+ *
+ * <refsect2>
+ * <title>Example launch line</title>
+ * |[
+ * gst-launch-1.0 udpsrc port=5000 caps=application/x-rtp ! netsim loss-probability=0.01 burst-enter-probability=0.005 delay=40 jitter=10 ! rtpjitterbuffer ! fakesink
+ * ]| Receive RTP with 1% random loss, occasional loss bursts and 40±10ms delay.
+ * </refsect2>
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <math.h>
+
+#include <gst/gst.h>
+
+GST_DEBUG_CATEGORY_STATIC (gst_net_sim_debug);
+#define GST_CAT_DEFAULT gst_net_sim_debug
+
+#define GST_TYPE_NET_SIM            (gst_net_sim_get_type())
+#define GST_NET_SIM(obj)            (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_NET_SIM,GstNetSim))
+#define GST_NET_SIM_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST((klass),GST_TYPE_NET_SIM,GstNetSimClass))
+#define GST_IS_NET_SIM(obj)         (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_NET_SIM))
+#define GST_IS_NET_SIM_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE((klass),GST_TYPE_NET_SIM))
+
+typedef struct _GstNetSim GstNetSim;
+typedef struct _GstNetSimClass GstNetSimClass;
+
+typedef enum
+{
+  GST_NET_SIM_DISTRIBUTION_UNIFORM,
+  GST_NET_SIM_DISTRIBUTION_NORMAL
+} GstNetSimDistribution;
+
+/* a buffer or serialized event waiting for its release time */
+typedef struct
+{
+  GstClockTime release;
+  guint64 seqnum;
+  GstMiniObject *obj;
+} GstNetSimPacket;
+
+struct _GstNetSim
+{
+  GstElement parent;
+
+  /*< private > */
+  GstPad *sinkpad, *srcpad;
+
+  /* properties, protected by the object lock */
+  guint seed;
+  gdouble loss_probability;
+  gdouble burst_enter_probability;
+  gdouble burst_exit_probability;
+  gdouble burst_loss_probability;
+  gdouble duplicate_probability;
+  gdouble reorder_probability;
+  gint delay;
+  gint jitter;
+  gint reorder_delay;
+  GstNetSimDistribution delay_distribution;
+
+  /* random state and statistics, protected by the object lock */
+  GRand *rand;
+  gboolean in_burst;
+  guint64 num_in;
+  guint64 num_out;
+  guint64 num_dropped;
+  guint64 num_duplicated;
+  guint64 num_reordered;
+
+  /* release queue, protected by lock */
+  GMutex lock;
+  GCond cond;
+  GQueue queue;
+  guint64 next_seqnum;
+  GstClockTime last_release;
+  /* buffers queued after a serialized event are not released before it */
+  GstClockTime barrier;
+  /* the task popped packets that it did not push yet */
+  gboolean pushing;
+  GstClockID clock_id;
+  gboolean flushing;
+  GstFlowReturn srcresult;
+};
+
+struct _GstNetSimClass
+{
+  GstElementClass parent_class;
+};
+
+enum
+{
+  PROP_0,
+  PROP_SEED,
+  PROP_LOSS_PROBABILITY,
+  PROP_BURST_ENTER_PROBABILITY,
+  PROP_BURST_EXIT_PROBABILITY,
+  PROP_BURST_LOSS_PROBABILITY,
+  PROP_DUPLICATE_PROBABILITY,
+  PROP_REORDER_PROBABILITY,
+  PROP_DELAY,
+  PROP_JITTER,
+  PROP_REORDER_DELAY,
+  PROP_DELAY_DISTRIBUTION,
+  PROP_STATS
+};
+
+#define DEFAULT_SEED                    0
+#define DEFAULT_LOSS_PROBABILITY        0.0
+#define DEFAULT_BURST_ENTER_PROBABILITY 0.0
+#define DEFAULT_BURST_EXIT_PROBABILITY  0.5
+#define DEFAULT_BURST_LOSS_PROBABILITY  1.0
+#define DEFAULT_DUPLICATE_PROBABILITY   0.0
+#define DEFAULT_REORDER_PROBABILITY     0.0
+#define DEFAULT_DELAY                   0
+#define DEFAULT_JITTER                  0
+#define DEFAULT_REORDER_DELAY           20
+#define DEFAULT_DELAY_DISTRIBUTION      GST_NET_SIM_DISTRIBUTION_UNIFORM
+
+#define GST_NET_SIM_LOCK(s)   g_mutex_lock (&(s)->lock)
+#define GST_NET_SIM_UNLOCK(s) g_mutex_unlock (&(s)->lock)
+
+#define GST_TYPE_NET_SIM_DISTRIBUTION (gst_net_sim_distribution_get_type ())
+static GType
+gst_net_sim_distribution_get_type (void)
+{
+  static GType distribution_type = 0;
+  static const GEnumValue distributions[] = {
+    {GST_NET_SIM_DISTRIBUTION_UNIFORM,
+        "Uniform jitter in [delay - jitter, delay + jitter]", "uniform"},
+    {GST_NET_SIM_DISTRIBUTION_NORMAL,
+          "Normal jitter with mean delay and standard deviation jitter",
+        "normal"},
+    {0, NULL, NULL},
+  };
+
+  if (!distribution_type) {
+    distribution_type =
+        g_enum_register_static ("GstNetSimDistribution", distributions);
+  }
+  return distribution_type;
+}
+
+static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+static void gst_net_sim_finalize (GObject * object);
+static void gst_net_sim_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec);
+static void gst_net_sim_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec);
+
+static GstStateChangeReturn gst_net_sim_change_state (GstElement * element,
+    GstStateChange transition);
+static gboolean gst_net_sim_src_activate_mode (GstPad * pad,
+    GstObject * parent, GstPadMode mode, gboolean active);
+static gboolean gst_net_sim_sink_event (GstPad * pad, GstObject * parent,
+    GstEvent * event);
+static GstFlowReturn gst_net_sim_chain (GstPad * pad, GstObject * parent,
+    GstBuffer * buffer);
+static GstFlowReturn gst_net_sim_chain_list (GstPad * pad, GstObject * parent,
+    GstBufferList * list);
+static void gst_net_sim_loop (GstNetSim * self);
+
+GType gst_net_sim_get_type (void);
+#define gst_net_sim_parent_class parent_class
+G_DEFINE_TYPE (GstNetSim, gst_net_sim, GST_TYPE_ELEMENT);
+
+static void
+gst_net_sim_class_init (GstNetSimClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstElementClass *gstelement_class = GST_ELEMENT_CLASS (klass);
+
+  GST_DEBUG_CATEGORY_INIT (gst_net_sim_debug, "netsim", 0,
+      "netsim element");
+
+  gobject_class->set_property = gst_net_sim_set_property;
+  gobject_class->get_property = gst_net_sim_get_property;
+  gobject_class->finalize = gst_net_sim_finalize;
+
+  gst_element_class_add_pad_template (gstelement_class,
+      gst_static_pad_template_get (&sink_template));
+  gst_element_class_add_pad_template (gstelement_class,
+      gst_static_pad_template_get (&src_template));
+
+  gst_element_class_set_static_metadata (gstelement_class,
+      "Network simulator", "Testing",
+      "Drop, duplicate, delay and reorder buffers like a lossy network",
+      "GStreamer maintainers <gstreamer-devel@lists.freedesktop.org>");
+
+  gstelement_class->change_state = GST_DEBUG_FUNCPTR (gst_net_sim_change_state);
+
+  g_object_class_install_property (gobject_class, PROP_SEED,
+      g_param_spec_uint ("seed", "random number seed",
+          "seed for randomness (initialized when going from READY to PAUSED)",
+          0, G_MAXUINT32, DEFAULT_SEED,
+          G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_LOSS_PROBABILITY,
+      g_param_spec_double ("loss-probability", "Loss probability",
+          "Probability for a buffer to be dropped outside of a loss burst",
+          0.0, 1.0, DEFAULT_LOSS_PROBABILITY,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_BURST_ENTER_PROBABILITY,
+      g_param_spec_double ("burst-enter-probability",
+          "Burst enter probability",
+          "Probability to switch from the good to the bad (burst) state after "
+          "each buffer (Gilbert-Elliott p, 0 disables bursts)",
+          0.0, 1.0, DEFAULT_BURST_ENTER_PROBABILITY,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_BURST_EXIT_PROBABILITY,
+      g_param_spec_double ("burst-exit-probability", "Burst exit probability",
+          "Probability to switch from the bad (burst) to the good state after "
+          "each buffer (Gilbert-Elliott r)",
+          0.0, 1.0, DEFAULT_BURST_EXIT_PROBABILITY,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_BURST_LOSS_PROBABILITY,
+      g_param_spec_double ("burst-loss-probability", "Burst loss probability",
+          "Probability for a buffer to be dropped inside of a loss burst",
+          0.0, 1.0, DEFAULT_BURST_LOSS_PROBABILITY,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_DUPLICATE_PROBABILITY,
+      g_param_spec_double ("duplicate-probability", "Duplicate probability",
+          "Probability for a buffer to be sent twice",
+          0.0, 1.0, DEFAULT_DUPLICATE_PROBABILITY,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_REORDER_PROBABILITY,
+      g_param_spec_double ("reorder-probability", "Reorder probability",
+          "Probability for a buffer to be held back by reorder-delay",
+          0.0, 1.0, DEFAULT_REORDER_PROBABILITY,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_DELAY,
+      g_param_spec_int ("delay", "Delay (ms)",
+          "Mean delay applied to every buffer in milliseconds",
+          0, G_MAXINT, DEFAULT_DELAY,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_JITTER,
+      g_param_spec_int ("jitter", "Jitter (ms)",
+          "Delay variation in milliseconds (half range for uniform, "
+          "standard deviation for normal distribution)",
+          0, G_MAXINT, DEFAULT_JITTER,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_REORDER_DELAY,
+      g_param_spec_int ("reorder-delay", "Reorder delay (ms)",
+          "Extra delay in milliseconds for buffers selected for reordering",
+          0, G_MAXINT, DEFAULT_REORDER_DELAY,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_DELAY_DISTRIBUTION,
+      g_param_spec_enum ("delay-distribution", "Delay distribution",
+          "Distribution of the jitter around the mean delay",
+          GST_TYPE_NET_SIM_DISTRIBUTION, DEFAULT_DELAY_DISTRIBUTION,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstNetSim:stats:
+   *
+   * Various netsim statistics. This property returns a GstStructure
+   * with name application/x-netsim-stats with the following fields:
+   *
+   * <itemizedlist>
+   * <listitem>
+   *   <para>
+   *   #guint64
+   *   <classname>&quot;num-in&quot;</classname>:
+   *   the number of buffers received on the sinkpad.
+   *   </para>
+   * </listitem>
+   * <listitem>
+   *   <para>
+   *   #guint64
+   *   <classname>&quot;num-out&quot;</classname>:
+   *   the number of buffers pushed on the srcpad.
+   *   </para>
+   * </listitem>
+   * <listitem>
+   *   <para>
+   *   #guint64
+   *   <classname>&quot;num-dropped&quot;</classname>:
+   *   the number of dropped buffers.
+   *   </para>
+   * </listitem>
+   * <listitem>
+   *   <para>
+   *   #guint64
+   *   <classname>&quot;num-duplicated&quot;</classname>:
+   *   the number of extra copies that were sent.
+   *   </para>
+   * </listitem>
+   * <listitem>
+   *   <para>
+   *   #guint64
+   *   <classname>&quot;num-reordered&quot;</classname>:
+   *   the number of buffers held back for reordering.
+   *   </para>
+   * </listitem>
+   * </itemizedlist>
+   */
+  g_object_class_install_property (gobject_class, PROP_STATS,
+      g_param_spec_boxed ("stats", "Statistics",
+          "Various statistics", GST_TYPE_STRUCTURE,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+}
+
+static void
+gst_net_sim_init (GstNetSim * self)
+{
+  self->sinkpad = gst_pad_new_from_static_template (&sink_template, "sink");
+  gst_pad_set_event_function (self->sinkpad,
+      GST_DEBUG_FUNCPTR (gst_net_sim_sink_event));
+  gst_pad_set_chain_function (self->sinkpad,
+      GST_DEBUG_FUNCPTR (gst_net_sim_chain));
+  gst_pad_set_chain_list_function (self->sinkpad,
+      GST_DEBUG_FUNCPTR (gst_net_sim_chain_list));
+  GST_OBJECT_FLAG_SET (self->sinkpad, GST_PAD_FLAG_PROXY_CAPS);
+  GST_OBJECT_FLAG_SET (self->sinkpad, GST_PAD_FLAG_PROXY_ALLOCATION);
+  gst_element_add_pad (GST_ELEMENT (self), self->sinkpad);
+
+  self->srcpad = gst_pad_new_from_static_template (&src_template, "src");
+  gst_pad_set_activatemode_function (self->srcpad,
+      GST_DEBUG_FUNCPTR (gst_net_sim_src_activate_mode));
+  GST_OBJECT_FLAG_SET (self->srcpad, GST_PAD_FLAG_PROXY_CAPS);
+  GST_OBJECT_FLAG_SET (self->srcpad, GST_PAD_FLAG_PROXY_ALLOCATION);
+  gst_element_add_pad (GST_ELEMENT (self), self->srcpad);
+
+  g_mutex_init (&self->lock);
+  g_cond_init (&self->cond);
+  g_queue_init (&self->queue);
+  self->flushing = TRUE;
+  self->srcresult = GST_FLOW_FLUSHING;
+
+  self->loss_probability = DEFAULT_LOSS_PROBABILITY;
+  self->burst_enter_probability = DEFAULT_BURST_ENTER_PROBABILITY;
+  self->burst_exit_probability = DEFAULT_BURST_EXIT_PROBABILITY;
+  self->burst_loss_probability = DEFAULT_BURST_LOSS_PROBABILITY;
+  self->duplicate_probability = DEFAULT_DUPLICATE_PROBABILITY;
+  self->reorder_probability = DEFAULT_REORDER_PROBABILITY;
+  self->delay = DEFAULT_DELAY;
+  self->jitter = DEFAULT_JITTER;
+  self->reorder_delay = DEFAULT_REORDER_DELAY;
+  self->delay_distribution = DEFAULT_DELAY_DISTRIBUTION;
+}
+
+static void
+gst_net_sim_packet_free (GstNetSimPacket * pkt)
+{
+  gst_mini_object_unref (pkt->obj);
+  g_slice_free (GstNetSimPacket, pkt);
+}
+
+static gint
+gst_net_sim_packet_compare (const GstNetSimPacket * a,
+    const GstNetSimPacket * b, gpointer user_data)
+{
+  if (a->release < b->release)
+    return -1;
+  if (a->release > b->release)
+    return 1;
+  return (a->seqnum < b->seqnum) ? -1 : (a->seqnum > b->seqnum);
+}
+
+static void
+gst_net_sim_flush_queue (GstNetSim * self)
+{
+  GstNetSimPacket *pkt;
+
+  while ((pkt = g_queue_pop_head (&self->queue)))
+    gst_net_sim_packet_free (pkt);
+  self->last_release = 0;
+  self->barrier = 0;
+  self->pushing = FALSE;
+}
+
+static void
+gst_net_sim_finalize (GObject * object)
+{
+  GstNetSim *self = GST_NET_SIM (object);
+
+  gst_net_sim_flush_queue (self);
+  if (self->rand) {
+    g_rand_free (self->rand);
+    self->rand = NULL;
+  }
+  g_mutex_clear (&self->lock);
+  g_cond_clear (&self->cond);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static GstStructure *
+gst_net_sim_create_stats (GstNetSim * self)
+{
+  GstStructure *s;
+
+  GST_OBJECT_LOCK (self);
+  s = gst_structure_new ("application/x-netsim-stats",
+      "num-in", G_TYPE_UINT64, self->num_in,
+      "num-out", G_TYPE_UINT64, self->num_out,
+      "num-dropped", G_TYPE_UINT64, self->num_dropped,
+      "num-duplicated", G_TYPE_UINT64, self->num_duplicated,
+      "num-reordered", G_TYPE_UINT64, self->num_reordered, NULL);
+  GST_OBJECT_UNLOCK (self);
+
+  return s;
+}
+
+static void
+gst_net_sim_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstNetSim *self = GST_NET_SIM (object);
+
+  GST_OBJECT_LOCK (self);
+  switch (prop_id) {
+    case PROP_SEED:
+      self->seed = g_value_get_uint (value);
+      break;
+    case PROP_LOSS_PROBABILITY:
+      self->loss_probability = g_value_get_double (value);
+      break;
+    case PROP_BURST_ENTER_PROBABILITY:
+      self->burst_enter_probability = g_value_get_double (value);
+      break;
+    case PROP_BURST_EXIT_PROBABILITY:
+      self->burst_exit_probability = g_value_get_double (value);
+      break;
+    case PROP_BURST_LOSS_PROBABILITY:
+      self->burst_loss_probability = g_value_get_double (value);
+      break;
+    case PROP_DUPLICATE_PROBABILITY:
+      self->duplicate_probability = g_value_get_double (value);
+      break;
+    case PROP_REORDER_PROBABILITY:
+      self->reorder_probability = g_value_get_double (value);
+      break;
+    case PROP_DELAY:
+      self->delay = g_value_get_int (value);
+      break;
+    case PROP_JITTER:
+      self->jitter = g_value_get_int (value);
+      break;
+    case PROP_REORDER_DELAY:
+      self->reorder_delay = g_value_get_int (value);
+      break;
+    case PROP_DELAY_DISTRIBUTION:
+      self->delay_distribution = g_value_get_enum (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (self);
+}
+
+static void
+gst_net_sim_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstNetSim *self = GST_NET_SIM (object);
+
+  if (prop_id == PROP_STATS) {
+    g_value_take_boxed (value, gst_net_sim_create_stats (self));
+    return;
+  }
+
+  GST_OBJECT_LOCK (self);
+  switch (prop_id) {
+    case PROP_SEED:
+      g_value_set_uint (value, self->seed);
+      break;
+    case PROP_LOSS_PROBABILITY:
+      g_value_set_double (value, self->loss_probability);
+      break;
+    case PROP_BURST_ENTER_PROBABILITY:
+      g_value_set_double (value, self->burst_enter_probability);
+      break;
+    case PROP_BURST_EXIT_PROBABILITY:
+      g_value_set_double (value, self->burst_exit_probability);
+      break;
+    case PROP_BURST_LOSS_PROBABILITY:
+      g_value_set_double (value, self->burst_loss_probability);
+      break;
+    case PROP_DUPLICATE_PROBABILITY:
+      g_value_set_double (value, self->duplicate_probability);
+      break;
+    case PROP_REORDER_PROBABILITY:
+      g_value_set_double (value, self->reorder_probability);
+      break;
+    case PROP_DELAY:
+      g_value_set_int (value, self->delay);
+      break;
+    case PROP_JITTER:
+      g_value_set_int (value, self->jitter);
+      break;
+    case PROP_REORDER_DELAY:
+      g_value_set_int (value, self->reorder_delay);
+      break;
+    case PROP_DELAY_DISTRIBUTION:
+      g_value_set_enum (value, self->delay_distribution);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (self);
+}
+
+/* must be called with the object lock */
+static gboolean
+gst_net_sim_is_passthrough (GstNetSim * self)
+{
+  return self->delay == 0 && self->jitter == 0
+      && self->reorder_probability == 0.0;
+}
+
+/* Gilbert-Elliott loss model, must be called with the object lock.
+ * The loss decision is taken in the current state, then the state
+ * transition for the next buffer is made. */
+static gboolean
+gst_net_sim_should_drop (GstNetSim * self)
+{
+  gdouble loss;
+  gboolean drop;
+
+  loss = self->in_burst ? self->burst_loss_probability : self->loss_probability;
+  drop = loss > 0.0 && g_rand_double (self->rand) < loss;
+
+  if (self->in_burst) {
+    if (g_rand_double (self->rand) < self->burst_exit_probability)
+      self->in_burst = FALSE;
+  } else if (self->burst_enter_probability > 0.0) {
+    if (g_rand_double (self->rand) < self->burst_enter_probability)
+      self->in_burst = TRUE;
+  }
+
+  return drop;
+}
+
+/* must be called with the object lock */
+static GstClockTime
+gst_net_sim_get_delay (GstNetSim * self)
+{
+  gdouble delay_ms = self->delay;
+
+  if (self->jitter > 0) {
+    switch (self->delay_distribution) {
+      case GST_NET_SIM_DISTRIBUTION_NORMAL:
+      {
+        gdouble u1, u2;
+
+        /* Box-Muller transform */
+        u1 = g_rand_double_range (self->rand, G_MINDOUBLE, 1.0);
+        u2 = g_rand_double (self->rand);
+        delay_ms += self->jitter * sqrt (-2.0 * log (u1)) * cos (2 * G_PI * u2);
+        break;
+      }
+      case GST_NET_SIM_DISTRIBUTION_UNIFORM:
+      default:
+        delay_ms += g_rand_double_range (self->rand, -self->jitter,
+            self->jitter);
+        break;
+    }
+  }
+
+  if (self->reorder_probability > 0.0
+      && g_rand_double (self->rand) < self->reorder_probability) {
+    delay_ms += self->reorder_delay;
+    self->num_reordered++;
+  }
+
+  if (delay_ms <= 0.0)
+    return 0;
+
+  return (GstClockTime) (delay_ms * GST_MSECOND);
+}
+
+static GstClockTime
+gst_net_sim_get_running_time (GstNetSim * self)
+{
+  GstClock *clock;
+  GstClockTime base_time, now;
+
+  GST_OBJECT_LOCK (self);
+  clock = GST_ELEMENT_CLOCK (self);
+  if (clock == NULL) {
+    GST_OBJECT_UNLOCK (self);
+    return GST_CLOCK_TIME_NONE;
+  }
+  gst_object_ref (clock);
+  base_time = GST_ELEMENT_CAST (self)->base_time;
+  GST_OBJECT_UNLOCK (self);
+
+  now = gst_clock_get_time (clock);
+  gst_object_unref (clock);
+
+  if (now < base_time)
+    return 0;
+  return now - base_time;
+}
+
+/* takes ownership of @obj, must be called with the netsim lock */
+static void
+gst_net_sim_enqueue (GstNetSim * self, GstMiniObject * obj,
+    GstClockTime release)
+{
+  GstNetSimPacket *pkt, *head;
+
+  pkt = g_slice_new (GstNetSimPacket);
+  pkt->release = release;
+  pkt->seqnum = self->next_seqnum++;
+  pkt->obj = obj;
+
+  head = g_queue_peek_head (&self->queue);
+  g_queue_insert_sorted (&self->queue, pkt,
+      (GCompareDataFunc) gst_net_sim_packet_compare, NULL);
+
+  if (release > self->last_release)
+    self->last_release = release;
+
+  /* a new earliest packet, make the task wait for it instead */
+  if (head != NULL && pkt == g_queue_peek_head (&self->queue)
+      && self->clock_id != NULL)
+    gst_clock_id_unschedule (self->clock_id);
+
+  g_cond_signal (&self->cond);
+}
+
+/* Apply loss and duplication to all buffers of @list and either push the
+ * survivors directly or queue them with their release time. Takes ownership
+ * of @list. */
+static GstFlowReturn
+gst_net_sim_process_list (GstNetSim * self, GstBufferList * list)
+{
+  GstBufferList *out = NULL;
+  GstClockTime now, *delays;
+  gboolean passthrough;
+  guint i, len, n_out = 0;
+  guint8 *copies;
+  GstFlowReturn ret;
+
+  len = gst_buffer_list_length (list);
+  copies = g_new (guint8, len);
+  delays = g_new (GstClockTime, len * 2);
+
+  /* take all random decisions for the list at once */
+  GST_OBJECT_LOCK (self);
+  passthrough = gst_net_sim_is_passthrough (self);
+  for (i = 0; i < len; i++) {
+    self->num_in++;
+    if (gst_net_sim_should_drop (self)) {
+      copies[i] = 0;
+      self->num_dropped++;
+      continue;
+    }
+    copies[i] = 1;
+    if (self->duplicate_probability > 0.0
+        && g_rand_double (self->rand) < self->duplicate_probability) {
+      copies[i] = 2;
+      self->num_duplicated++;
+    }
+    n_out += copies[i];
+    if (!passthrough) {
+      delays[2 * i] = gst_net_sim_get_delay (self);
+      if (copies[i] == 2)
+        delays[2 * i + 1] = gst_net_sim_get_delay (self);
+    }
+  }
+  GST_OBJECT_UNLOCK (self);
+
+  GST_LOG_OBJECT (self, "%u of %u buffers survive", n_out, len);
+
+  if (n_out == 0) {
+    g_free (copies);
+    g_free (delays);
+    gst_buffer_list_unref (list);
+    GST_NET_SIM_LOCK (self);
+    ret = self->srcresult;
+    GST_NET_SIM_UNLOCK (self);
+    return ret;
+  }
+
+  now = passthrough ? GST_CLOCK_TIME_NONE : gst_net_sim_get_running_time (self);
+
+  GST_NET_SIM_LOCK (self);
+  /* nothing more is queued once downstream returned an error or EOS, which
+   * upstream gets back instead */
+  if (self->flushing || self->srcresult != GST_FLOW_OK)
+    goto flushing;
+
+  /* without delays and nothing pending we can push from this thread, as long
+   * as the task is not still pushing what it took from the queue */
+  if (passthrough && g_queue_is_empty (&self->queue) && !self->pushing)
+    out = gst_buffer_list_new_sized (n_out);
+
+  for (i = 0; i < len; i++) {
+    GstBuffer *buf = gst_buffer_list_get (list, i);
+    guint c;
+
+    for (c = 0; c < copies[i]; c++) {
+      if (out) {
+        gst_buffer_list_add (out, gst_buffer_ref (buf));
+      } else {
+        GstClockTime release;
+
+        if (passthrough || now == GST_CLOCK_TIME_NONE)
+          release = self->last_release;
+        else
+          release = MAX (now + delays[2 * i + c], self->barrier);
+        gst_net_sim_enqueue (self, GST_MINI_OBJECT_CAST (gst_buffer_ref (buf)),
+            release);
+      }
+    }
+  }
+  ret = self->srcresult;
+  GST_NET_SIM_UNLOCK (self);
+
+  g_free (copies);
+  g_free (delays);
+  gst_buffer_list_unref (list);
+
+  if (out) {
+    GST_OBJECT_LOCK (self);
+    self->num_out += n_out;
+    GST_OBJECT_UNLOCK (self);
+
+    if (n_out == 1) {
+      GstBuffer *buf = gst_buffer_ref (gst_buffer_list_get (out, 0));
+
+      gst_buffer_list_unref (out);
+      ret = gst_pad_push (self->srcpad, buf);
+    } else {
+      ret = gst_pad_push_list (self->srcpad, out);
+    }
+  }
+
+  return ret;
+
+flushing:
+  {
+    ret = self->srcresult;
+    GST_NET_SIM_UNLOCK (self);
+    g_free (copies);
+    g_free (delays);
+    gst_buffer_list_unref (list);
+    return ret;
+  }
+}
+
+static GstFlowReturn
+gst_net_sim_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+{
+  GstNetSim *self = GST_NET_SIM (parent);
+  GstBufferList *list;
+
+  list = gst_buffer_list_new_sized (1);
+  gst_buffer_list_add (list, buffer);
+
+  return gst_net_sim_process_list (self, list);
+}
+
+static GstFlowReturn
+gst_net_sim_chain_list (GstPad * pad, GstObject * parent, GstBufferList * list)
+{
+  GstNetSim *self = GST_NET_SIM (parent);
+
+  return gst_net_sim_process_list (self, list);
+}
+
+static gboolean
+gst_net_sim_sink_event (GstPad * pad, GstObject * parent, GstEvent * event)
+{
+  GstNetSim *self = GST_NET_SIM (parent);
+  gboolean ret = TRUE;
+
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_FLUSH_START:
+      GST_NET_SIM_LOCK (self);
+      self->flushing = TRUE;
+      self->srcresult = GST_FLOW_FLUSHING;
+      if (self->clock_id)
+        gst_clock_id_unschedule (self->clock_id);
+      g_cond_signal (&self->cond);
+      GST_NET_SIM_UNLOCK (self);
+
+      ret = gst_pad_push_event (self->srcpad, event);
+      gst_pad_pause_task (self->srcpad);
+      break;
+    case GST_EVENT_FLUSH_STOP:
+      ret = gst_pad_push_event (self->srcpad, event);
+
+      GST_NET_SIM_LOCK (self);
+      gst_net_sim_flush_queue (self);
+      self->flushing = FALSE;
+      self->srcresult = GST_FLOW_OK;
+      GST_NET_SIM_UNLOCK (self);
+
+      gst_pad_start_task (self->srcpad, (GstTaskFunction) gst_net_sim_loop,
+          self, NULL);
+      break;
+    default:
+      /* serialized events go out after everything that is still being
+       * delayed, and the buffers that follow may not overtake them */
+      if (GST_EVENT_IS_SERIALIZED (event)) {
+        GST_NET_SIM_LOCK (self);
+        if (!g_queue_is_empty (&self->queue) || self->pushing) {
+          self->barrier = self->last_release;
+          gst_net_sim_enqueue (self, GST_MINI_OBJECT_CAST (event),
+              self->last_release);
+          event = NULL;
+        }
+        GST_NET_SIM_UNLOCK (self);
+      }
+      if (event)
+        ret = gst_pad_event_default (pad, parent, event);
+      break;
+  }
+
+  return ret;
+}
+
+static void
+gst_net_sim_loop (GstNetSim * self)
+{
+  GstNetSimPacket *pkt;
+  GstBufferList *list = NULL;
+  GstBuffer *buf = NULL;
+  GstEvent *event = NULL;
+  GstClock *clock;
+  GstClockTime release, base_time;
+  GstFlowReturn ret = GST_FLOW_OK;
+  guint n_out = 0;
+
+  GST_NET_SIM_LOCK (self);
+  while (!self->flushing && g_queue_is_empty (&self->queue))
+    g_cond_wait (&self->cond, &self->lock);
+  if (self->flushing)
+    goto flushing;
+
+  pkt = g_queue_peek_head (&self->queue);
+  release = pkt->release;
+
+  GST_OBJECT_LOCK (self);
+  clock = GST_ELEMENT_CLOCK (self);
+  if (clock)
+    gst_object_ref (clock);
+  base_time = GST_ELEMENT_CAST (self)->base_time;
+  GST_OBJECT_UNLOCK (self);
+
+  if (clock) {
+    GstClockID id;
+    GstClockReturn cret;
+
+    id = gst_clock_new_single_shot_id (clock, release + base_time);
+    gst_object_unref (clock);
+    self->clock_id = id;
+
+    GST_LOG_OBJECT (self, "waiting for release at %" GST_TIME_FORMAT,
+        GST_TIME_ARGS (release));
+    GST_NET_SIM_UNLOCK (self);
+    cret = gst_clock_id_wait (id, NULL);
+    GST_NET_SIM_LOCK (self);
+
+    self->clock_id = NULL;
+    gst_clock_id_unref (id);
+
+    if (self->flushing)
+      goto flushing;
+
+    /* an earlier packet was queued, start over */
+    if (cret == GST_CLOCK_UNSCHEDULED) {
+      GST_NET_SIM_UNLOCK (self);
+      return;
+    }
+  }
+
+  /* release everything that is due, batching buffers into one list */
+  while ((pkt = g_queue_peek_head (&self->queue)) && pkt->release <= release) {
+    if (GST_IS_EVENT (pkt->obj)) {
+      if (n_out > 0)
+        break;
+      event = GST_EVENT_CAST (gst_mini_object_ref (pkt->obj));
+      gst_net_sim_packet_free (g_queue_pop_head (&self->queue));
+      break;
+    }
+    if (buf == NULL && list == NULL) {
+      buf = GST_BUFFER_CAST (gst_mini_object_ref (pkt->obj));
+    } else {
+      if (list == NULL) {
+        list = gst_buffer_list_new ();
+        gst_buffer_list_add (list, buf);
+        buf = NULL;
+      }
+      gst_buffer_list_add (list,
+          GST_BUFFER_CAST (gst_mini_object_ref (pkt->obj)));
+    }
+    n_out++;
+    gst_net_sim_packet_free (g_queue_pop_head (&self->queue));
+  }
+  self->pushing = (n_out > 0 || event != NULL);
+  GST_NET_SIM_UNLOCK (self);
+
+  if (n_out > 0) {
+    GST_OBJECT_LOCK (self);
+    self->num_out += n_out;
+    GST_OBJECT_UNLOCK (self);
+  }
+
+  if (list)
+    ret = gst_pad_push_list (self->srcpad, list);
+  else if (buf)
+    ret = gst_pad_push (self->srcpad, buf);
+  else if (event)
+    gst_pad_push_event (self->srcpad, event);
+
+  GST_NET_SIM_LOCK (self);
+  self->pushing = FALSE;
+  if (!self->flushing)
+    self->srcresult = ret;
+  if (ret != GST_FLOW_OK)
+    goto push_failed;
+  GST_NET_SIM_UNLOCK (self);
+
+  return;
+
+flushing:
+  {
+    GST_DEBUG_OBJECT (self, "we are flushing");
+    GST_NET_SIM_UNLOCK (self);
+    gst_pad_pause_task (self->srcpad);
+    return;
+  }
+push_failed:
+  {
+    GST_DEBUG_OBJECT (self, "push flow: %s", gst_flow_get_name (ret));
+    GST_NET_SIM_UNLOCK (self);
+    /* on EOS downstream already has one and upstream's own is queued, the
+     * flow return stored above goes back upstream from the chain function */
+    if (ret < GST_FLOW_EOS || ret == GST_FLOW_NOT_LINKED) {
+      GST_ELEMENT_ERROR (self, STREAM, FAILED,
+          ("Internal data stream error."),
+          ("streaming stopped, reason: %s", gst_flow_get_name (ret)));
+    }
+    gst_pad_pause_task (self->srcpad);
+    return;
+  }
+}
+
+static gboolean
+gst_net_sim_src_activate_mode (GstPad * pad, GstObject * parent,
+    GstPadMode mode, gboolean active)
+{
+  GstNetSim *self = GST_NET_SIM (parent);
+  gboolean res;
+
+  switch (mode) {
+    case GST_PAD_MODE_PUSH:
+      if (active) {
+        GST_NET_SIM_LOCK (self);
+        self->flushing = FALSE;
+        self->srcresult = GST_FLOW_OK;
+        GST_NET_SIM_UNLOCK (self);
+        res = gst_pad_start_task (pad, (GstTaskFunction) gst_net_sim_loop,
+            self, NULL);
+      } else {
+        GST_NET_SIM_LOCK (self);
+        self->flushing = TRUE;
+        self->srcresult = GST_FLOW_FLUSHING;
+        if (self->clock_id)
+          gst_clock_id_unschedule (self->clock_id);
+        g_cond_signal (&self->cond);
+        GST_NET_SIM_UNLOCK (self);
+
+        res = gst_pad_stop_task (pad);
+
+        GST_NET_SIM_LOCK (self);
+        gst_net_sim_flush_queue (self);
+        GST_NET_SIM_UNLOCK (self);
+      }
+      break;
+    default:
+      res = FALSE;
+      break;
+  }
+  return res;
+}
+
+static GstStateChangeReturn
+gst_net_sim_change_state (GstElement * element, GstStateChange transition)
+{
+  GstNetSim *self = GST_NET_SIM (element);
+  GstStateChangeReturn ret;
+
+  switch (transition) {
+    case GST_STATE_CHANGE_READY_TO_PAUSED:
+      GST_OBJECT_LOCK (self);
+      if (self->rand)
+        g_rand_free (self->rand);
+      self->rand = g_rand_new_with_seed (self->seed);
+      self->in_burst = FALSE;
+      self->num_in = 0;
+      self->num_out = 0;
+      self->num_dropped = 0;
+      self->num_duplicated = 0;
+      self->num_reordered = 0;
+      GST_OBJECT_UNLOCK (self);
+      GST_NET_SIM_LOCK (self);
+      self->next_seqnum = 0;
+      self->last_release = 0;
+      GST_NET_SIM_UNLOCK (self);
+      break;
+    default:
+      break;
+  }
+
+  ret = GST_ELEMENT_CLASS (parent_class)->change_state (element, transition);
+
+  switch (transition) {
+    case GST_STATE_CHANGE_PAUSED_TO_READY:
+      GST_OBJECT_LOCK (self);
+      if (self->rand) {
+        g_rand_free (self->rand);
+        self->rand = NULL;
+      }
+      GST_OBJECT_UNLOCK (self);
+      break;
+    default:
+      break;
+  }
+
+  return ret;
+}
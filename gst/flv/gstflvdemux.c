@@ -45,13 +45,6 @@
 #include <gst/audio/audio.h>
 #include <gst/video/video.h>
 
-/* FIXME: don't rely on own GstIndex */
-#include "gstindex.c"
-#include "gstmemindex.c"
-#define GST_ASSOCIATION_FLAG_NONE GST_INDEX_ASSOCIATION_FLAG_NONE
-#define GST_ASSOCIATION_FLAG_KEY_UNIT GST_INDEX_ASSOCIATION_FLAG_KEY_UNIT
-#define GST_ASSOCIATION_FLAG_DELTA_UNIT GST_INDEX_ASSOCIATION_FLAG_DELTA_UNIT
-
 static GstStaticPadTemplate flv_sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
     GST_PAD_ALWAYS,
@@ -100,6 +93,19 @@ G_DEFINE_TYPE (GstFlvDemux, gst_flv_demux, GST_TYPE_ELEMENT);
 /* how much stream time to wait for audio tags to appear after we have video, or vice versa */
 #define NO_MORE_PADS_THRESHOLD (6 * GST_SECOND)
 
+/* how much is read at once when scanning tags to build the index, unless
+ * the tags are larger than that */
+#define INDEX_SCAN_BLOCK_SIZE (64 * 1024)
+#define INDEX_SCAN_HEADER_SIZE 12
+
+#define DEFAULT_MAX_INDEX_MEMORY 0
+
+enum
+{
+  PROP_0,
+  PROP_MAX_INDEX_MEMORY
+};
+
 static gboolean flv_demux_handle_seek_push (GstFlvDemux * demux,
     GstEvent * event);
 static gboolean gst_flv_demux_handle_seek_pull (GstFlvDemux * demux,
@@ -110,15 +116,101 @@ static gboolean gst_flv_demux_query (GstPad * pad, GstObject * parent,
 static gboolean gst_flv_demux_src_event (GstPad * pad, GstObject * parent,
     GstEvent * event);
 
-static GstIndex *gst_flv_demux_get_index (GstElement * element);
+static gint
+gst_flv_index_entry_compare_pos (GstFlvIndexEntry * entry, guint64 * pos,
+    gpointer user_data)
+{
+  if (entry->pos < *pos)
+    return -1;
+  else if (entry->pos > *pos)
+    return 1;
+  else
+    return 0;
+}
+
+static gint
+gst_flv_index_entry_compare_time (GstFlvIndexEntry * entry,
+    GstClockTime * time, gpointer user_data)
+{
+  if (entry->time < *time)
+    return -1;
+  else if (entry->time > *time)
+    return 1;
+  else
+    return 0;
+}
+
+/* returns the last entry at or before @value, which is a position for
+ * GST_FORMAT_BYTES and a time for GST_FORMAT_TIME. Timestamps increase with
+ * the position in any sane file, so the index is searched by time as well.
+ * Must be called with the object lock. */
+static GstFlvIndexEntry *
+gst_flv_demux_index_lookup (GstFlvDemux * demux, GstFormat format,
+    guint64 value)
+{
+  GCompareDataFunc compare;
+
+  if (format == GST_FORMAT_BYTES)
+    compare = (GCompareDataFunc) gst_flv_index_entry_compare_pos;
+  else
+    compare = (GCompareDataFunc) gst_flv_index_entry_compare_time;
+
+  return gst_util_array_binary_search (demux->index->data, demux->index->len,
+      sizeof (GstFlvIndexEntry), compare, GST_SEARCH_MODE_BEFORE, &value,
+      NULL);
+}
+
+/* posts the memory used by the index in an element message */
+static void
+gst_flv_demux_post_index_memory (GstFlvDemux * demux)
+{
+  GstStructure *s;
+  guint entries;
+  gboolean sparse;
+
+  GST_OBJECT_LOCK (demux);
+  entries = demux->index->len;
+  sparse = demux->index_stride > 1;
+  GST_OBJECT_UNLOCK (demux);
+
+  s = gst_structure_new ("index-memory",
+      "bytes", G_TYPE_UINT64, (guint64) entries * sizeof (GstFlvIndexEntry),
+      "entries", G_TYPE_UINT, entries, "sparse", G_TYPE_BOOLEAN, sparse, NULL);
+  gst_element_post_message (GST_ELEMENT_CAST (demux),
+      gst_message_new_element (GST_OBJECT_CAST (demux), s));
+}
+
+/* drops every other entry and from then on only adds half as many, when the
+ * index grew beyond max-index-memory. Must be called with the object lock. */
+static gboolean
+gst_flv_demux_index_limit (GstFlvDemux * demux)
+{
+  guint i, len = demux->index->len;
+
+  if (!demux->max_index_memory ||
+      len * sizeof (GstFlvIndexEntry) <= demux->max_index_memory || len < 2)
+    return FALSE;
+
+  for (i = 0; 2 * i < len; i++)
+    g_array_index (demux->index, GstFlvIndexEntry, i) =
+        g_array_index (demux->index, GstFlvIndexEntry, 2 * i);
+  g_array_set_size (demux->index, i);
+  demux->index_stride *= 2;
+
+  GST_DEBUG_OBJECT (demux, "index reached %" G_GUINT64_FORMAT " bytes, "
+      "keeping every %u-th keyframe", demux->max_index_memory,
+      demux->index_stride);
+
+  return TRUE;
+}
 
 static void
 gst_flv_demux_parse_and_add_index_entry (GstFlvDemux * demux, GstClockTime ts,
     guint64 pos, gboolean keyframe)
 {
-  GstIndexAssociation associations[2];
-  GstIndex *index;
-  GstIndexEntry *entry;
+  GstFlvIndexEntry *entry, new_entry;
+  guint idx, len;
+  gboolean limited = FALSE;
 
   GST_LOG_OBJECT (demux,
       "adding key=%d association %" GST_TIME_FORMAT "-> %" G_GUINT64_FORMAT,
@@ -128,48 +220,63 @@ gst_flv_demux_parse_and_add_index_entry (GstFlvDemux * demux, GstClockTime ts,
   if (!demux->upstream_seekable)
     return;
 
-  index = gst_flv_demux_get_index (GST_ELEMENT (demux));
-
-  if (!index)
-    return;
-
-  /* entry may already have been added before, avoid adding indefinitely */
-  entry = gst_index_get_assoc_entry (index, demux->index_id,
-      GST_INDEX_LOOKUP_EXACT, GST_ASSOCIATION_FLAG_NONE, GST_FORMAT_BYTES, pos);
-
-  if (entry) {
-#ifndef GST_DISABLE_GST_DEBUG
-    gint64 time = 0;
-    gboolean key;
-
-    gst_index_entry_assoc_map (entry, GST_FORMAT_TIME, &time);
-    key = ! !(GST_INDEX_ASSOC_FLAGS (entry) & GST_ASSOCIATION_FLAG_KEY_UNIT);
-    GST_LOG_OBJECT (demux, "position already mapped to time %" GST_TIME_FORMAT
-        ", keyframe %d", GST_TIME_ARGS (time), key);
-    /* there is not really a way to delete the existing one */
-    if (time != ts || key != ! !keyframe)
-      GST_DEBUG_OBJECT (demux, "metadata mismatch");
-#endif
-    gst_object_unref (index);
-    return;
-  }
-
-  associations[0].format = GST_FORMAT_TIME;
-  associations[0].value = ts;
-  associations[1].format = GST_FORMAT_BYTES;
-  associations[1].value = pos;
-
-  gst_index_add_associationv (index, demux->index_id,
-      (keyframe) ? GST_ASSOCIATION_FLAG_KEY_UNIT :
-      GST_ASSOCIATION_FLAG_DELTA_UNIT, 2,
-      (const GstIndexAssociation *) &associations);
+  GST_OBJECT_LOCK (demux);
 
   if (pos > demux->index_max_pos)
     demux->index_max_pos = pos;
   if (ts > demux->index_max_time)
     demux->index_max_time = ts;
 
-  gst_object_unref (index);
+  /* seeking always ends up on a keyframe */
+  if (!keyframe)
+    goto done;
+
+  /* entries are mostly appended, while playing or scanning */
+  len = demux->index->len;
+  if (len == 0 || g_array_index (demux->index, GstFlvIndexEntry,
+          len - 1).pos < pos) {
+    /* a sparse index only gets every index_stride-th keyframe */
+    if (demux->index_stride > 1 && ++demux->index_skipped < demux->index_stride)
+      goto done;
+    demux->index_skipped = 0;
+    idx = len;
+  } else {
+    /* entry may already have been added before, avoid adding indefinitely */
+    entry = gst_util_array_binary_search (demux->index->data, len,
+        sizeof (GstFlvIndexEntry),
+        (GCompareDataFunc) gst_flv_index_entry_compare_pos,
+        GST_SEARCH_MODE_AFTER, &pos, NULL);
+    if (entry->pos == pos) {
+      GST_LOG_OBJECT (demux, "position already mapped to time %"
+          GST_TIME_FORMAT, GST_TIME_ARGS (entry->time));
+      if (entry->time != ts)
+        GST_DEBUG_OBJECT (demux, "metadata mismatch");
+      goto done;
+    }
+    /* keyframes left out of a sparse index come by again when playing a part
+     * again, they are filled in at the same stride and only while there is
+     * room, as thinning the index for them would only thin it further */
+    if (demux->index_stride > 1 &&
+        ++demux->index_skipped_before < demux->index_stride)
+      goto done;
+    demux->index_skipped_before = 0;
+    if (demux->max_index_memory && (len + 1) * sizeof (GstFlvIndexEntry) >
+        demux->max_index_memory)
+      goto done;
+    idx = entry - (GstFlvIndexEntry *) demux->index->data;
+  }
+
+  new_entry.time = ts;
+  new_entry.pos = pos;
+  g_array_insert_val (demux->index, idx, new_entry);
+  if (idx == len)
+    limited = gst_flv_demux_index_limit (demux);
+
+done:
+  GST_OBJECT_UNLOCK (demux);
+
+  if (limited)
+    gst_flv_demux_post_index_memory (demux);
 }
 
 static gchar *
@@ -630,6 +737,7 @@ gst_flv_demux_parse_tag_script (GstFlvDemux * demux, GstBuffer * buffer)
             TRUE);
       }
       demux->indexed = TRUE;
+      gst_flv_demux_post_index_memory (demux);
     }
   }
 
@@ -1889,8 +1997,15 @@ gst_flv_demux_cleanup (GstFlvDemux * demux)
   demux->upstream_seekable = FALSE;
   demux->file_size = 0;
 
+  /* the old entries might be wrong for the new stream */
+  GST_OBJECT_LOCK (demux);
+  g_array_set_size (demux->index, 0);
   demux->index_max_pos = 0;
   demux->index_max_time = 0;
+  demux->index_stride = 1;
+  demux->index_skipped = 0;
+  demux->index_skipped_before = 0;
+  GST_OBJECT_UNLOCK (demux);
 
   demux->audio_start = demux->video_start = GST_CLOCK_TIME_NONE;
   demux->last_audio_pts = demux->last_video_dts = 0;
@@ -2365,8 +2480,9 @@ static GstFlowReturn
 gst_flv_demux_seek_to_prev_keyframe (GstFlvDemux * demux)
 {
   GstFlowReturn ret = GST_FLOW_EOS;
-  GstIndex *index;
-  GstIndexEntry *entry = NULL;
+  GstFlvIndexEntry *entry;
+  guint64 bytes = 0;
+  GstClockTime time = 0;
 
   GST_DEBUG_OBJECT (demux,
       "terminated section started at offset %" G_GINT64_FORMAT,
@@ -2384,31 +2500,25 @@ gst_flv_demux_seek_to_prev_keyframe (GstFlvDemux * demux)
 
   GST_DEBUG_OBJECT (demux, "locating previous position");
 
-  index = gst_flv_demux_get_index (GST_ELEMENT (demux));
-
   /* locate index entry before previous start position */
-  if (index) {
-    entry = gst_index_get_assoc_entry (index, demux->index_id,
-        GST_INDEX_LOOKUP_BEFORE, GST_ASSOCIATION_FLAG_KEY_UNIT,
-        GST_FORMAT_BYTES, demux->from_offset - 1);
-
-    if (entry) {
-      gint64 bytes = 0, time = 0;
-
-      gst_index_entry_assoc_map (entry, GST_FORMAT_BYTES, &bytes);
-      gst_index_entry_assoc_map (entry, GST_FORMAT_TIME, &time);
-
-      GST_DEBUG_OBJECT (demux, "found index entry for %" G_GINT64_FORMAT
-          " at %" GST_TIME_FORMAT ", seeking to %" G_GINT64_FORMAT,
-          demux->offset - 1, GST_TIME_ARGS (time), bytes);
+  GST_OBJECT_LOCK (demux);
+  entry = gst_flv_demux_index_lookup (demux, GST_FORMAT_BYTES,
+      demux->from_offset - 1);
+  if (entry) {
+    bytes = entry->pos;
+    time = entry->time;
+  }
+  GST_OBJECT_UNLOCK (demux);
 
-      /* setup for next section */
-      demux->to_offset = demux->from_offset;
-      gst_flv_demux_move_to_offset (demux, bytes, FALSE);
-      ret = GST_FLOW_OK;
-    }
+  if (entry) {
+    GST_DEBUG_OBJECT (demux, "found index entry for %" G_GINT64_FORMAT
+        " at %" GST_TIME_FORMAT ", seeking to %" G_GUINT64_FORMAT,
+        demux->offset - 1, GST_TIME_ARGS (time), bytes);
 
-    gst_object_unref (index);
+    /* setup for next section */
+    demux->to_offset = demux->from_offset;
+    gst_flv_demux_move_to_offset (demux, bytes, FALSE);
+    ret = GST_FLOW_OK;
   }
 
 done:
@@ -2420,8 +2530,9 @@ gst_flv_demux_create_index (GstFlvDemux * demux, gint64 pos, GstClockTime ts)
 {
   gint64 size;
   size_t tag_size;
-  guint64 old_offset;
-  GstBuffer *buffer;
+  guint64 old_offset, block_offset = 0;
+  GstBuffer *buffer, *block = NULL;
+  gsize block_size = 0;
   GstClockTime tag_time;
   GstFlowReturn ret = GST_FLOW_OK;
 
@@ -2434,14 +2545,40 @@ gst_flv_demux_create_index (GstFlvDemux * demux, gint64 pos, GstClockTime ts)
   old_offset = demux->offset;
   demux->offset = pos;
 
-  buffer = NULL;
-  while ((ret = gst_flv_demux_pull_range (demux, demux->sinkpad, demux->offset,
-              12, &buffer)) == GST_FLOW_OK) {
+  /* only the tag headers are needed, which are read from larger blocks
+   * rather than pulling each of them separately. After a tag of at least a
+   * block, the ones that follow are likely large too, so only the header is
+   * read instead of a block per tag. */
+  while (TRUE) {
+    if (!block || demux->offset + INDEX_SCAN_HEADER_SIZE >
+        block_offset + block_size) {
+      guint pull_size = INDEX_SCAN_BLOCK_SIZE;
+
+      if (block && demux->offset >=
+          block_offset + block_size + INDEX_SCAN_BLOCK_SIZE)
+        pull_size = INDEX_SCAN_HEADER_SIZE;
+      if (block)
+        gst_buffer_unref (block);
+      block = NULL;
+      ret = gst_pad_pull_range (demux->sinkpad, demux->offset, pull_size,
+          &block);
+      if (ret != GST_FLOW_OK) {
+        block = NULL;
+        break;
+      }
+      block_offset = demux->offset;
+      block_size = gst_buffer_get_size (block);
+      if (block_size < 12) {
+        ret = GST_FLOW_EOS;
+        break;
+      }
+    }
+
+    buffer = gst_buffer_copy_region (block, GST_BUFFER_COPY_MEMORY,
+        demux->offset - block_offset, 12);
     tag_time =
         gst_flv_demux_parse_tag_timestamp (demux, TRUE, buffer, &tag_size);
-
     gst_buffer_unref (buffer);
-    buffer = NULL;
 
     if (G_UNLIKELY (tag_time == GST_CLOCK_TIME_NONE || tag_time > ts))
       goto exit;
@@ -2452,10 +2589,13 @@ gst_flv_demux_create_index (GstFlvDemux * demux, gint64 pos, GstClockTime ts)
   if (ret == GST_FLOW_EOS) {
     /* file ran out, so mark we have complete index */
     demux->indexed = TRUE;
+    gst_flv_demux_post_index_memory (demux);
     ret = GST_FLOW_OK;
   }
 
 exit:
+  if (block)
+    gst_buffer_unref (block);
   demux->offset = old_offset;
 
   return ret;
@@ -2672,45 +2812,38 @@ pause:
 static guint64
 gst_flv_demux_find_offset (GstFlvDemux * demux, GstSegment * segment)
 {
-  gint64 bytes = 0;
-  gint64 time = 0;
-  GstIndex *index;
-  GstIndexEntry *entry;
+  guint64 bytes = 0;
+  GstClockTime time = 0;
+  GstFlvIndexEntry *entry;
 
   g_return_val_if_fail (segment != NULL, 0);
 
-  time = segment->position;
-
-  index = gst_flv_demux_get_index (GST_ELEMENT (demux));
-
-  if (index) {
-    /* Let's check if we have an index entry for that seek time */
-    entry = gst_index_get_assoc_entry (index, demux->index_id,
-        GST_INDEX_LOOKUP_BEFORE, GST_ASSOCIATION_FLAG_KEY_UNIT,
-        GST_FORMAT_TIME, time);
-
-    if (entry) {
-      gst_index_entry_assoc_map (entry, GST_FORMAT_BYTES, &bytes);
-      gst_index_entry_assoc_map (entry, GST_FORMAT_TIME, &time);
-
-      GST_DEBUG_OBJECT (demux, "found index entry for %" GST_TIME_FORMAT
-          " at %" GST_TIME_FORMAT ", seeking to %" G_GINT64_FORMAT,
-          GST_TIME_ARGS (segment->position), GST_TIME_ARGS (time), bytes);
+  /* Let's check if we have an index entry for that seek time */
+  GST_OBJECT_LOCK (demux);
+  entry = gst_flv_demux_index_lookup (demux, GST_FORMAT_TIME,
+      segment->position);
+  if (entry) {
+    bytes = entry->pos;
+    time = entry->time;
+  }
+  GST_OBJECT_UNLOCK (demux);
 
-      /* Key frame seeking */
-      if (segment->flags & GST_SEEK_FLAG_KEY_UNIT) {
-        /* Adjust the segment so that the keyframe fits in */
-        if (time < segment->start) {
-          segment->start = segment->time = time;
-        }
-        segment->position = time;
+  if (entry) {
+    GST_DEBUG_OBJECT (demux, "found index entry for %" GST_TIME_FORMAT
+        " at %" GST_TIME_FORMAT ", seeking to %" G_GUINT64_FORMAT,
+        GST_TIME_ARGS (segment->position), GST_TIME_ARGS (time), bytes);
+
+    /* Key frame seeking */
+    if (segment->flags & GST_SEEK_FLAG_KEY_UNIT) {
+      /* Adjust the segment so that the keyframe fits in */
+      if (time < segment->start) {
+        segment->start = segment->time = time;
       }
-    } else {
-      GST_DEBUG_OBJECT (demux, "no index entry found for %" GST_TIME_FORMAT,
-          GST_TIME_ARGS (segment->start));
+      segment->position = time;
     }
-
-    gst_object_unref (index);
+  } else {
+    GST_DEBUG_OBJECT (demux, "no index entry found for %" GST_TIME_FORMAT,
+        GST_TIME_ARGS (segment->start));
   }
 
   return bytes;
@@ -3111,18 +3244,8 @@ gst_flv_demux_sink_event (GstPad * pad, GstObject * parent, GstEvent * event)
       break;
     case GST_EVENT_EOS:
     {
-      GstIndex *index;
-
       GST_DEBUG_OBJECT (demux, "received EOS");
 
-      index = gst_flv_demux_get_index (GST_ELEMENT (demux));
-
-      if (index) {
-        GST_DEBUG_OBJECT (demux, "committing index");
-        gst_index_commit (index, demux->index_id);
-        gst_object_unref (index);
-      }
-
       if (!demux->audio_pad && !demux->video_pad)
         GST_ELEMENT_ERROR (demux, STREAM, FAILED,
             ("Internal data stream error."), ("Got EOS before any data"));
@@ -3283,8 +3406,7 @@ gst_flv_demux_query (GstPad * pad, GstObject * parent, GstQuery * query)
         }
       }
       res = TRUE;
-      /* FIXME, check index this way is not thread safe */
-      if (fmt != GST_FORMAT_TIME || !demux->index) {
+      if (fmt != GST_FORMAT_TIME) {
         gst_query_set_seeking (query, fmt, FALSE, -1, -1);
       } else if (demux->random_access) {
         gst_query_set_seeking (query, GST_FORMAT_TIME, TRUE, 0,
@@ -3345,24 +3467,6 @@ gst_flv_demux_change_state (GstElement * element, GstStateChange transition)
 
   switch (transition) {
     case GST_STATE_CHANGE_READY_TO_PAUSED:
-      /* If this is our own index destroy it as the
-       * old entries might be wrong for the new stream */
-      if (demux->own_index) {
-        gst_object_unref (demux->index);
-        demux->index = NULL;
-        demux->own_index = FALSE;
-      }
-
-      /* If no index was created, generate one */
-      if (G_UNLIKELY (!demux->index)) {
-        GST_DEBUG_OBJECT (demux, "no index provided creating our own");
-
-        demux->index = g_object_new (gst_mem_index_get_type (), NULL);
-
-        gst_index_get_writer_id (demux->index, GST_OBJECT (demux),
-            &demux->index_id);
-        demux->own_index = TRUE;
-      }
       gst_flv_demux_cleanup (demux);
       break;
     default:
@@ -3384,55 +3488,6 @@ gst_flv_demux_change_state (GstElement * element, GstStateChange transition)
   return ret;
 }
 
-#if 0
-static void
-gst_flv_demux_set_index (GstElement * element, GstIndex * index)
-{
-  GstFlvDemux *demux = GST_FLV_DEMUX (element);
-  GstIndex *old_index;
-
-  GST_OBJECT_LOCK (demux);
-
-  old_index = demux->index;
-
-  if (index) {
-    demux->index = gst_object_ref (index);
-    demux->own_index = FALSE;
-  } else
-    demux->index = NULL;
-
-  if (old_index)
-    gst_object_unref (demux->index);
-
-  gst_object_ref (index);
-
-  GST_OBJECT_UNLOCK (demux);
-
-  /* object lock might be taken again */
-  if (index)
-    gst_index_get_writer_id (index, GST_OBJECT (element), &demux->index_id);
-
-  GST_DEBUG_OBJECT (demux, "Set index %" GST_PTR_FORMAT, demux->index);
-
-  gst_object_unref (index);
-}
-#endif
-
-static GstIndex *
-gst_flv_demux_get_index (GstElement * element)
-{
-  GstIndex *result = NULL;
-
-  GstFlvDemux *demux = GST_FLV_DEMUX (element);
-
-  GST_OBJECT_LOCK (demux);
-  if (demux->index)
-    result = gst_object_ref (demux->index);
-  GST_OBJECT_UNLOCK (demux);
-
-  return result;
-}
-
 static void
 gst_flv_demux_dispose (GObject * object)
 {
@@ -3482,7 +3537,7 @@ gst_flv_demux_dispose (GObject * object)
   }
 
   if (demux->index) {
-    gst_object_unref (demux->index);
+    g_array_free (demux->index, TRUE);
     demux->index = NULL;
   }
 
@@ -3499,6 +3554,42 @@ gst_flv_demux_dispose (GObject * object)
   GST_CALL_PARENT (G_OBJECT_CLASS, dispose, (object));
 }
 
+static void
+gst_flv_demux_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstFlvDemux *demux = GST_FLV_DEMUX (object);
+
+  switch (prop_id) {
+    case PROP_MAX_INDEX_MEMORY:
+      GST_OBJECT_LOCK (demux);
+      demux->max_index_memory = g_value_get_uint64 (value);
+      GST_OBJECT_UNLOCK (demux);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_flv_demux_get_property (GObject * object, guint prop_id, GValue * value,
+    GParamSpec * pspec)
+{
+  GstFlvDemux *demux = GST_FLV_DEMUX (object);
+
+  switch (prop_id) {
+    case PROP_MAX_INDEX_MEMORY:
+      GST_OBJECT_LOCK (demux);
+      g_value_set_uint64 (value, demux->max_index_memory);
+      GST_OBJECT_UNLOCK (demux);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
 static void
 gst_flv_demux_class_init (GstFlvDemuxClass * klass)
 {
@@ -3506,15 +3597,27 @@ gst_flv_demux_class_init (GstFlvDemuxClass * klass)
   GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
 
   gobject_class->dispose = gst_flv_demux_dispose;
+  gobject_class->set_property = gst_flv_demux_set_property;
+  gobject_class->get_property = gst_flv_demux_get_property;
+
+  /**
+   * GstFlvDemux:max-index-memory:
+   *
+   * Maximum size of the seek index in bytes. When it grows beyond this,
+   * only every other keyframe is kept, and so on, which makes seeking
+   * less precise. The memory used is posted in an "index-memory" element
+   * message when the index is complete and whenever it is thinned out.
+   */
+  g_object_class_install_property (gobject_class, PROP_MAX_INDEX_MEMORY,
+      g_param_spec_uint64 ("max-index-memory", "Max index memory",
+          "Maximum memory for the seek index in bytes, beyond which only "
+          "some keyframes are kept (0 = unlimited)", 0, G_MAXUINT64,
+          DEFAULT_MAX_INDEX_MEMORY,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   gstelement_class->change_state =
       GST_DEBUG_FUNCPTR (gst_flv_demux_change_state);
 
-#if 0
-  gstelement_class->set_index = GST_DEBUG_FUNCPTR (gst_flv_demux_set_index);
-  gstelement_class->get_index = GST_DEBUG_FUNCPTR (gst_flv_demux_get_index);
-#endif
-
   gst_element_class_add_pad_template (gstelement_class,
       gst_static_pad_template_get (&flv_sink_template));
   gst_element_class_add_pad_template (gstelement_class,
@@ -3549,9 +3652,8 @@ gst_flv_demux_init (GstFlvDemux * demux)
   demux->flowcombiner = gst_flow_combiner_new ();
   gst_segment_init (&demux->segment, GST_FORMAT_TIME);
 
-  demux->own_index = FALSE;
-
-  GST_OBJECT_FLAG_SET (demux, GST_ELEMENT_FLAG_INDEXABLE);
+  demux->index = g_array_new (FALSE, FALSE, sizeof (GstFlvIndexEntry));
+  demux->max_index_memory = DEFAULT_MAX_INDEX_MEMORY;
 
   gst_flv_demux_cleanup (demux);
 }
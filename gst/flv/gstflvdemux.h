@@ -23,7 +23,6 @@
 #include <gst/gst.h>
 #include <gst/base/gstadapter.h>
 #include <gst/base/gstflowcombiner.h>
-#include "gstindex.h"
 
 G_BEGIN_DECLS
 #define GST_TYPE_FLV_DEMUX \
@@ -39,6 +38,13 @@ G_BEGIN_DECLS
 typedef struct _GstFlvDemux GstFlvDemux;
 typedef struct _GstFlvDemuxClass GstFlvDemuxClass;
 
+/* a keyframe (or an audio frame in audio only files) to seek to */
+typedef struct
+{
+  GstClockTime time;
+  guint64 pos;
+} GstFlvIndexEntry;
+
 typedef enum
 {
   FLV_STATE_HEADER,
@@ -65,11 +71,10 @@ struct _GstFlvDemux
   guint group_id;
 
   /* <private> */
-  
-  GstIndex *index;
-  gint index_id;
-  gboolean own_index;
-  
+
+  /* GstFlvIndexEntry, sorted by position, protected by the object lock */
+  GArray *index;
+
   GArray * times;
   GArray * filepositions;
 
@@ -148,6 +153,14 @@ struct _GstFlvDemux
   GstClockTime index_max_time;
   gint64 index_max_pos;
 
+  /* once the index reached max-index-memory, only every index_stride-th
+   * keyframe is added; index_skipped counts those left out since the last,
+   * index_skipped_before the same for keyframes before the end of the index */
+  guint64 max_index_memory;
+  guint index_stride;
+  guint index_skipped;
+  guint index_skipped_before;
+
   /* reverse playback */
   GstClockTime video_first_ts;
   GstClockTime audio_first_ts;
@@ -999,11 +999,10 @@ static GstBuffer *
 gst_flv_mux_buffer_to_tag_internal (GstFlvMux * mux, GstBuffer * buffer,
     GstFlvPad * cpad, gboolean is_codec_data)
 {
-  GstBuffer *tag;
-  GstMapInfo map;
-  guint size;
+  GstBuffer *tag, *trailer;
+  guint size, header_size;
   guint32 pts, dts, cts;
-  guint8 *data, *bdata;
+  guint8 *data;
   gsize bsize;
 
   if (GST_BUFFER_DTS_IS_VALID (buffer))
@@ -1031,28 +1030,22 @@ gst_flv_mux_buffer_to_tag_internal (GstFlvMux * mux, GstBuffer * buffer,
 
   GST_LOG_OBJECT (mux, "got pts %i dts %i cts %i\n", pts, dts, cts);
 
-  gst_buffer_map (buffer, &map, GST_MAP_READ);
-  bdata = map.data;
-  bsize = map.size;
+  bsize = gst_buffer_get_size (buffer);
 
-  size = 11;
+  header_size = 11;
   if (cpad->video) {
-    size += 1;
+    header_size += 1;
     if (cpad->video_codec == 7)
-      size += 4 + bsize;
-    else
-      size += bsize;
+      header_size += 4;
   } else {
-    size += 1;
+    header_size += 1;
     if (cpad->audio_codec == 10)
-      size += 1 + bsize;
-    else
-      size += bsize;
+      header_size += 1;
   }
-  size += 4;
+  size = header_size + bsize + 4;
 
-  _gst_buffer_new_and_alloc (size, &tag, &data);
-  memset (data, 0, size);
+  _gst_buffer_new_and_alloc (header_size, &tag, &data);
+  memset (data, 0, header_size);
 
   data[0] = (cpad->video) ? 9 : 8;
 
@@ -1082,9 +1075,6 @@ gst_flv_mux_buffer_to_tag_internal (GstFlvMux * mux, GstBuffer * buffer,
         data[12] = 1;
         GST_WRITE_UINT24_BE (data + 13, cts);
       }
-      memcpy (data + 11 + 1 + 4, bdata, bsize);
-    } else {
-      memcpy (data + 11 + 1, bdata, bsize);
     }
   } else {
     data[11] |= (cpad->audio_codec << 4) & 0xf0;
@@ -1092,18 +1082,30 @@ gst_flv_mux_buffer_to_tag_internal (GstFlvMux * mux, GstBuffer * buffer,
     data[11] |= (cpad->width << 1) & 0x02;
     data[11] |= (cpad->channels << 0) & 0x01;
 
-    if (cpad->audio_codec == 10) {
+    if (cpad->audio_codec == 10)
       data[12] = is_codec_data ? 0 : 1;
-
-      memcpy (data + 11 + 1 + 1, bdata, bsize);
-    } else {
-      memcpy (data + 11 + 1, bdata, bsize);
-    }
   }
 
-  gst_buffer_unmap (buffer, &map);
+  /* the payload memory is shared with the input buffer, only the tag header
+   * and the previous tag size are new, unless the tag would then have more
+   * memory blocks than a buffer can hold, in which case it is copied */
+  if (gst_buffer_n_memory (buffer) + 2 <= gst_buffer_get_max_memory ()) {
+    gst_buffer_copy_into (tag, buffer, GST_BUFFER_COPY_MEMORY, 0, bsize);
+  } else {
+    GstMapInfo map;
+    GstBuffer *payload;
+    guint8 *pdata;
+
+    gst_buffer_map (buffer, &map, GST_MAP_READ);
+    _gst_buffer_new_and_alloc (bsize, &payload, &pdata);
+    memcpy (pdata, map.data, bsize);
+    gst_buffer_unmap (buffer, &map);
+    tag = gst_buffer_append (tag, payload);
+  }
 
-  GST_WRITE_UINT32_BE (data + size - 4, size - 4);
+  _gst_buffer_new_and_alloc (4, &trailer, &data);
+  GST_WRITE_UINT32_BE (data, size - 4);
+  tag = gst_buffer_append (tag, trailer);
 
   GST_BUFFER_PTS (tag) = GST_CLOCK_TIME_NONE;
   GST_BUFFER_DTS (tag) = GST_CLOCK_TIME_NONE;
@@ -270,6 +270,17 @@ atom_ftyp_new (AtomsContext * context, guint32 major, guint32 version,
   return ftyp;
 }
 
+/* styp has the layout of ftyp, it starts a segment instead of a file */
+AtomFTYP *
+atom_styp_new (AtomsContext * context, guint32 major, guint32 version,
+    GList * brands)
+{
+  AtomFTYP *styp = atom_ftyp_new (context, major, version, brands);
+
+  styp->header.type = FOURCC_styp;
+  return styp;
+}
+
 void
 atom_ftyp_free (AtomFTYP * ftyp)
 {
@@ -652,6 +663,7 @@ atom_co64_init (AtomSTCO64 * co64)
   guint8 flags[3] = { 0, 0, 0 };
 
   atom_full_init (&co64->header, FOURCC_stco, 0, 0, 0, flags);
+  co64->chunk_offset = 0;
   atom_array_init (&co64->entries, 256);
 }
 
@@ -1386,6 +1398,37 @@ atom_copy_data (Atom * atom, guint8 ** buffer, guint64 * size, guint64 * offset)
   return *offset - original_offset;
 }
 
+/*
+ * Serializes @atom with @copy_func into a newly allocated *@buffer.
+ * A first pass only computes the size, so that the buffer is allocated once
+ * with the exact size rather than grown repeatedly while writing a large
+ * tree (e.g. a moov with big sample tables).
+ * Returns the number of bytes written, 0 on error.
+ */
+guint64
+atom_copy_data_sized (Atom * atom, AtomCopyDataFunc copy_func,
+    guint8 ** buffer)
+{
+  guint64 size = 0, offset = 0;
+
+  *buffer = NULL;
+  if (!copy_func (atom, NULL, &size, &offset))
+    return 0;
+
+  size = offset;
+  offset = 0;
+  *buffer = g_malloc (size);
+  if (!copy_func (atom, buffer, &size, &offset)) {
+    g_free (*buffer);
+    *buffer = NULL;
+    return 0;
+  }
+  /* both passes must agree, otherwise the buffer got reallocated anyway */
+  g_warn_if_fail (offset == size);
+
+  return offset;
+}
+
 static guint64
 atom_full_copy_data (AtomFull * atom, guint8 ** buffer, guint64 * size,
     guint64 * offset)
@@ -1978,14 +2021,15 @@ atom_stco64_copy_data (AtomSTCO64 * stco64, guint8 ** buffer, guint64 * size,
 
   /* minimize realloc */
   prop_copy_ensure_buffer (buffer, size, offset,
-      8 * atom_array_get_len (&stco64->entries));
+      (trunc_to_32 ? 4 : 8) * atom_array_get_len (&stco64->entries));
   for (i = 0; i < atom_array_get_len (&stco64->entries); i++) {
-    guint64 *value = &atom_array_index (&stco64->entries, i);
+    guint64 value =
+        atom_array_index (&stco64->entries, i) + stco64->chunk_offset;
 
     if (trunc_to_32) {
-      prop_copy_uint32 ((guint32) * value, buffer, size, offset);
+      prop_copy_uint32 ((guint32) value, buffer, size, offset);
     } else {
-      prop_copy_uint64 (*value, buffer, size, offset);
+      prop_copy_uint64 (value, buffer, size, offset);
     }
   }
 
@@ -2845,6 +2889,27 @@ atom_moov_chunks_add_offset (AtomMOOV * moov, guint32 offset)
   }
 }
 
+/* unlike atom_moov_chunks_add_offset, the entries are left untouched and
+ * @offset is only applied when serializing, so it can be set repeatedly */
+void
+atom_moov_chunks_set_offset (AtomMOOV * moov, guint32 offset)
+{
+  GList *traks = moov->traks;
+
+  while (traks) {
+    AtomTRAK *trak = (AtomTRAK *) traks->data;
+    AtomSTCO64 *stco64 = &trak->mdia.minf.stbl.stco64;
+    guint len = atom_array_get_len (&stco64->entries);
+
+    stco64->chunk_offset = offset;
+    /* entries are increasing, the last one tells if 32 bits still do */
+    if (len > 0 && atom_array_index (&stco64->entries, len - 1) + offset >
+        G_MAXUINT32)
+      stco64->header.header.type = FOURCC_co64;
+    traks = g_list_next (traks);
+  }
+}
+
 void
 atom_trak_update_bitrates (AtomTRAK * trak, guint32 avg_bitrate,
     guint32 max_bitrate)
@@ -3613,6 +3678,8 @@ atom_traf_free (AtomTRAF * traf)
   g_list_free (traf->sdtps);
   traf->sdtps = NULL;
 
+  g_free (traf->tfdt);
+
   g_free (traf);
 }
 
@@ -3678,6 +3745,26 @@ atom_tfhd_copy_data (AtomTFHD * tfhd, guint8 ** buffer, guint64 * size,
   return *offset - original_offset;
 }
 
+static guint64
+atom_tfdt_copy_data (AtomTFDT * tfdt, guint8 ** buffer, guint64 * size,
+    guint64 * offset)
+{
+  guint64 original_offset = *offset;
+
+  if (!atom_full_copy_data (&tfdt->header, buffer, size, offset)) {
+    return 0;
+  }
+
+  /* 64-bit time if version is set */
+  if (tfdt->header.version)
+    prop_copy_uint64 (tfdt->base_media_decode_time, buffer, size, offset);
+  else
+    prop_copy_uint32 (tfdt->base_media_decode_time, buffer, size, offset);
+
+  atom_write_size (buffer, size, offset, original_offset);
+  return *offset - original_offset;
+}
+
 static guint64
 atom_trun_copy_data (AtomTRUN * trun, guint8 ** buffer, guint64 * size,
     guint64 * offset, guint32 * data_offset)
@@ -3759,6 +3846,9 @@ atom_traf_copy_data (AtomTRAF * traf, guint8 ** buffer, guint64 * size,
   if (!atom_tfhd_copy_data (&traf->tfhd, buffer, size, offset)) {
     return 0;
   }
+  if (traf->tfdt && !atom_tfdt_copy_data (traf->tfdt, buffer, size, offset)) {
+    return 0;
+  }
 
   walker = g_list_first (traf->truns);
   while (walker != NULL) {
@@ -3921,6 +4011,21 @@ atom_traf_new (AtomsContext * context, guint32 track_ID)
   return traf;
 }
 
+/* adds a tfdt carrying the decode time of the first sample in @traf */
+void
+atom_traf_set_base_decode_time (AtomTRAF * traf,
+    guint64 base_media_decode_time)
+{
+  guint8 flags[3] = { 0, 0, 0 };
+
+  if (!traf->tfdt)
+    traf->tfdt = g_new0 (AtomTFDT, 1);
+
+  atom_full_init (&traf->tfdt->header, FOURCC_tfdt, 0, 0,
+      base_media_decode_time > G_MAXUINT32 ? 1 : 0, flags);
+  traf->tfdt->base_media_decode_time = base_media_decode_time;
+}
+
 static void
 atom_traf_add_trun (AtomTRAF * traf, AtomTRUN * trun)
 {
@@ -4689,6 +4794,29 @@ build_ima_adpcm_extension (gint channels, gint rate, gint blocksize)
       atom_wave_free);
 }
 
+/* producer reference time, version 1 */
+AtomInfo *
+build_prft_atom (guint32 track_ID, guint64 ntp_timestamp, guint64 media_time,
+    guint32 flags)
+{
+  AtomData *atom_data;
+  GstBuffer *buf;
+  guint8 *data;
+
+  data = g_malloc (24);
+  GST_WRITE_UINT32_BE (data, (1 << 24) | (flags & 0xffffff));
+  GST_WRITE_UINT32_BE (data + 4, track_ID);
+  GST_WRITE_UINT64_BE (data + 8, ntp_timestamp);
+  GST_WRITE_UINT64_BE (data + 16, media_time);
+
+  buf = _gst_buffer_new_wrapped (data, 24, g_free);
+  atom_data = atom_data_new_from_gst_buffer (FOURCC_prft, buf);
+  gst_buffer_unref (buf);
+
+  return build_atom_info_wrapper ((Atom *) atom_data, atom_data_copy_data,
+      atom_data_free);
+}
+
 AtomInfo *
 build_uuid_xmp_atom (GstBuffer * xmp_data)
 {
@@ -478,6 +478,8 @@ typedef struct _AtomSTSC
 typedef struct _AtomSTCO64
 {
   AtomFull header;
+  /* Global offset to add to entries when serializing */
+  guint32 chunk_offset;
 
   ATOM_ARRAY (guint64) entries;
 } AtomSTCO64;
@@ -685,6 +687,13 @@ typedef struct _AtomTFHD
   guint32 default_sample_flags;
 } AtomTFHD;
 
+typedef struct _AtomTFDT
+{
+  AtomFull header;
+
+  guint64 base_media_decode_time;
+} AtomTFDT;
+
 typedef struct _TRUNSampleEntry
 {
   guint32 sample_duration;
@@ -721,6 +730,8 @@ typedef struct _AtomTRAF
   Atom header;
 
   AtomTFHD tfhd;
+  /* optional */
+  AtomTFDT *tfdt;
 
   /* list of AtomTRUN */
   GList *truns;
@@ -817,12 +828,16 @@ typedef struct _AtomInfo
 
 guint64    atom_copy_data              (Atom *atom, guint8 **buffer,
                                         guint64 *size, guint64* offset);
+guint64    atom_copy_data_sized        (Atom *atom, AtomCopyDataFunc copy_func,
+                                        guint8 **buffer);
 
 AtomFTYP*  atom_ftyp_new               (AtomsContext *context, guint32 major,
                                         guint32 version, GList *brands);
 guint64    atom_ftyp_copy_data         (AtomFTYP *ftyp, guint8 **buffer,
                                         guint64 *size, guint64 *offset);
 void       atom_ftyp_free              (AtomFTYP *ftyp);
+AtomFTYP*  atom_styp_new               (AtomsContext *context, guint32 major,
+                                        guint32 version, GList *brands);
 
 AtomTRAK*  atom_trak_new               (AtomsContext *context);
 void       atom_trak_add_samples       (AtomTRAK * trak, guint32 nsamples, guint32 delta,
@@ -844,6 +859,7 @@ void       atom_moov_update_timescale  (AtomMOOV *moov, guint32 timescale);
 void       atom_moov_update_duration   (AtomMOOV *moov);
 void       atom_moov_set_fragmented    (AtomMOOV *moov, gboolean fragmented);
 void       atom_moov_chunks_add_offset (AtomMOOV *moov, guint32 offset);
+void       atom_moov_chunks_set_offset (AtomMOOV *moov, guint32 offset);
 void       atom_moov_add_trak          (AtomMOOV *moov, AtomTRAK *trak);
 
 guint64    atom_mvhd_copy_data         (AtomMVHD * atom, guint8 ** buffer,
@@ -874,6 +890,8 @@ void       atom_traf_add_samples       (AtomTRAF * traf, guint32 delta,
                                         guint32 size, gboolean sync, gint64 pts_offset,
                                         gboolean sdtp_sync);
 guint32    atom_traf_get_sample_num    (AtomTRAF * traf);
+void       atom_traf_set_base_decode_time (AtomTRAF * traf,
+                                        guint64 base_media_decode_time);
 void       atom_moof_add_traf          (AtomMOOF *moof, AtomTRAF *traf);
 
 AtomMFRA*  atom_mfra_new               (AtomsContext *context);
@@ -969,6 +987,8 @@ AtomInfo *   build_SMI_atom              (const GstBuffer *seqh);
 AtomInfo *   build_ima_adpcm_extension   (gint channels, gint rate,
                                           gint blocksize);
 AtomInfo *   build_uuid_xmp_atom         (GstBuffer * xmp);
+AtomInfo *   build_prft_atom             (guint32 track_ID, guint64 ntp_timestamp,
+                                          guint64 media_time, guint32 flags);
 
 
 /*
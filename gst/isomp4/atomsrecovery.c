@@ -194,7 +194,7 @@ atoms_recov_write_trak_info (FILE * f, AtomTRAK * trak)
   data = g_malloc (size);
   atom_size = atom_trak_copy_data (trak, &data, &size, &offset);
   if (atom_size > 0)
-    writen = fwrite (data, atom_size, 1, f);
+    writen = fwrite (data, 1, atom_size, f);
   g_free (data);
   return atom_size > 0 && writen == atom_size;
 }
@@ -295,6 +295,13 @@ G_BEGIN_DECLS
 
 /* MPEG DASH */
 #define FOURCC_tfdt     GST_MAKE_FOURCC('t','f','d','t')
+#define FOURCC_styp     GST_MAKE_FOURCC('s','t','y','p')
+#define FOURCC_prft     GST_MAKE_FOURCC('p','r','f','t')
+#define FOURCC_msdh     GST_MAKE_FOURCC('m','s','d','h')
+#define FOURCC_msix     GST_MAKE_FOURCC('m','s','i','x')
+
+/* CMAF */
+#define FOURCC_cmfs     GST_MAKE_FOURCC('c','m','f','s')
 
 /* Xiph fourcc */
 #define FOURCC_XdxT     GST_MAKE_FOURCC('X','d','x','T')
@@ -78,7 +78,17 @@
  * data can be spread out into fragments of #GstQTMux:fragment-duration.
  * If such fragmented layout is intended for streaming purposes, then
  * #GstQTMux:streamable allows foregoing to add index metadata (at the end of
- * file).
+ * file). For low-latency streaming, #GstQTMux:chunk-duration additionally
+ * writes each fragment out in CMAF chunks as it goes, so that a packager can
+ * publish a fragment before it is complete.
+ *
+ * Finally, #GstQTMux:reserved-max-duration reserves space for the metadata at
+ * the start of the file, so that it can be written there without buffering
+ * all media data in a temporary file as faststart does. With
+ * #GstQTMux:reserved-moov-update-period it is also updated periodically while
+ * recording, keeping the file playable should recording be interrupted.
+ * The metadata only ends up at the end of the file if it outgrows the
+ * reserved space.
  *
  * <refsect2>
  * <title>Example pipelines</title>
@@ -225,9 +235,17 @@ enum
   PROP_TRAK_TIMESCALE,
   PROP_FAST_START,
   PROP_FAST_START_TEMP_FILE,
+  PROP_FAST_START_BUFFER_SIZE,
   PROP_MOOV_RECOV_FILE,
+  PROP_MOOV_RECOV_BUFFER_SIZE,
+  PROP_MOOV_RECOV_FLUSH_INTERVAL,
+  PROP_MOOV_RECOV_SYNC,
   PROP_FRAGMENT_DURATION,
+  PROP_CHUNK_DURATION,
   PROP_STREAMABLE,
+  PROP_RESERVED_MAX_DURATION,
+  PROP_RESERVED_BYTES_PER_SEC,
+  PROP_RESERVED_MOOV_UPDATE_PERIOD,
 #ifndef GST_REMOVE_DEPRECATED
   PROP_DTS_METHOD,
 #endif
@@ -242,9 +260,23 @@ enum
 #define DEFAULT_DO_CTTS                 TRUE
 #define DEFAULT_FAST_START              FALSE
 #define DEFAULT_FAST_START_TEMP_FILE    NULL
+#define DEFAULT_FAST_START_BUFFER_SIZE  (1024 * 1024)
 #define DEFAULT_MOOV_RECOV_FILE         NULL
+#define DEFAULT_MOOV_RECOV_BUFFER_SIZE  (64 * 1024)
+#define DEFAULT_MOOV_RECOV_FLUSH_INTERVAL GST_SECOND
+#define DEFAULT_MOOV_RECOV_SYNC         FALSE
 #define DEFAULT_FRAGMENT_DURATION       0
+#define DEFAULT_CHUNK_DURATION          0
 #define DEFAULT_STREAMABLE              TRUE
+#define DEFAULT_RESERVED_MAX_DURATION   GST_CLOCK_TIME_NONE
+#define DEFAULT_RESERVED_BYTES_PER_SEC_PER_TRAK 550
+#define DEFAULT_RESERVED_MOOV_UPDATE_PERIOD GST_CLOCK_TIME_NONE
+
+/* room on top of the estimate for tags, edit lists and extra atoms */
+#define RESERVED_MOOV_SLACK             4096
+/* largest buffer a free atom is written out in */
+#define FREE_ATOM_BLOCK_SIZE            (64 * 1024)
+
 #ifndef GST_REMOVE_DEPRECATED
 #define DEFAULT_DTS_METHOD              DTS_METHOD_REORDER
 #endif
@@ -393,6 +425,13 @@ gst_qt_mux_class_init (GstQTMuxClass * klass)
           "when creating a faststart file. If null a filepath will be "
           "created automatically", DEFAULT_FAST_START_TEMP_FILE,
           G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_FAST_START_BUFFER_SIZE,
+      g_param_spec_uint ("faststart-buffer-size",
+          "Faststart buffer size",
+          "Size in bytes of the buffers in which the temporary file is "
+          "read back and pushed when finishing a faststart file",
+          4096, G_MAXINT32, DEFAULT_FAST_START_BUFFER_SIZE,
+          G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS));
   g_object_class_install_property (gobject_class, PROP_MOOV_RECOV_FILE,
       g_param_spec_string ("moov-recovery-file",
           "File to store data for posterior moov atom recovery",
@@ -401,15 +440,72 @@ gst_qt_mux_class_init (GstQTMuxClass * klass)
           "of a crash during muxing. Null for disabled. (Experimental)",
           DEFAULT_MOOV_RECOV_FILE,
           G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_MOOV_RECOV_BUFFER_SIZE,
+      g_param_spec_uint ("moov-recovery-buffer-size",
+          "Moov recovery buffer size",
+          "Size in bytes of the buffer in which sample records are collected "
+          "before being written to the moov recovery file. 0 writes every "
+          "record immediately",
+          0, G_MAXINT32, DEFAULT_MOOV_RECOV_BUFFER_SIZE,
+          G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class,
+      PROP_MOOV_RECOV_FLUSH_INTERVAL,
+      g_param_spec_uint64 ("moov-recovery-flush-interval",
+          "Moov recovery flush interval (ns)",
+          "Maximum amount of media (in ns) whose sample records may be "
+          "pending in the buffer before it is written to the moov recovery "
+          "file. 0 flushes after every sample, GST_CLOCK_TIME_NONE only "
+          "when the buffer is full",
+          0, G_MAXUINT64, DEFAULT_MOOV_RECOV_FLUSH_INTERVAL,
+          G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_MOOV_RECOV_SYNC,
+      g_param_spec_boolean ("moov-recovery-sync",
+          "Sync moov recovery file",
+          "Also sync the moov recovery file to disk on every flush, so that "
+          "the records survive a system crash and not only a crash of the "
+          "application", DEFAULT_MOOV_RECOV_SYNC,
+          G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS));
   g_object_class_install_property (gobject_class, PROP_FRAGMENT_DURATION,
       g_param_spec_uint ("fragment-duration", "Fragment duration",
           "Fragment durations in ms (produce a fragmented file if > 0)",
           0, G_MAXUINT32, klass->format == GST_QT_MUX_FORMAT_ISML ?
           2000 : DEFAULT_FRAGMENT_DURATION,
           G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_CHUNK_DURATION,
+      g_param_spec_uint ("chunk-duration", "Chunk duration",
+          "Chunk durations in ms. If > 0 in fragmented mode, every fragment "
+          "is written out as CMAF chunks (prft, moof and mdat) of this "
+          "duration, the first one preceded by a styp",
+          0, G_MAXUINT32, DEFAULT_CHUNK_DURATION,
+          G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS));
   g_object_class_install_property (gobject_class, PROP_STREAMABLE,
       g_param_spec_boolean ("streamable", "Streamable", streamable_desc,
           streamable, streamable_flags | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_RESERVED_MAX_DURATION,
+      g_param_spec_uint64 ("reserved-max-duration",
+          "Reserved maximum file duration (ns)",
+          "When set, space for the moov atom is reserved at the start of the "
+          "file, sized for recordings up to this duration (in ns), and the "
+          "moov is written into it instead of at the end",
+          0, G_MAXUINT64, DEFAULT_RESERVED_MAX_DURATION,
+          G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_RESERVED_BYTES_PER_SEC,
+      g_param_spec_uint ("reserved-bytes-per-sec",
+          "Reserved MOOV bytes per second, per track",
+          "Multiplier for converting reserved-max-duration into bytes of "
+          "header to reserve, per second, per track",
+          0, 10000, DEFAULT_RESERVED_BYTES_PER_SEC_PER_TRAK,
+          G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class,
+      PROP_RESERVED_MOOV_UPDATE_PERIOD,
+      g_param_spec_uint64 ("reserved-moov-update-period",
+          "Interval to update moov atom (ns)",
+          "When reserved-max-duration is set, rewrite the moov atom in its "
+          "reserved space at this interval (in ns) while recording, so the "
+          "file stays playable if recording is interrupted. "
+          "GST_CLOCK_TIME_NONE only writes it when finishing",
+          0, G_MAXUINT64, DEFAULT_RESERVED_MOOV_UPDATE_PERIOD,
+          G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS));
 
   gstelement_class->request_new_pad =
       GST_DEBUG_FUNCPTR (gst_qt_mux_request_new_pad);
@@ -425,6 +521,8 @@ gst_qt_mux_pad_reset (GstQTPad * qtpad)
   qtpad->sample_size = 0;
   qtpad->sync = FALSE;
   qtpad->last_dts = 0;
+  qtpad->scaled_timescale = 0;
+  qtpad->scaled_ts_next = 0;
   qtpad->first_ts = GST_CLOCK_TIME_NONE;
   qtpad->prepare_buf_func = NULL;
   qtpad->create_empty_buffer = NULL;
@@ -457,6 +555,39 @@ gst_qt_mux_pad_reset (GstQTPad * qtpad)
   qtpad->tfra = NULL;
 }
 
+static void
+gst_qt_mux_close_moov_recovery (GstQTMux * qtmux)
+{
+  if (qtmux->moov_recov_file) {
+    fclose (qtmux->moov_recov_file);
+    qtmux->moov_recov_file = NULL;
+  }
+  /* only after fclose, stdio may still be using it until then */
+  g_free (qtmux->moov_recov_buffer);
+  qtmux->moov_recov_buffer = NULL;
+}
+
+/* writes out the buffered recovery records, and syncs them to disk if
+ * requested */
+static gboolean
+gst_qt_mux_flush_moov_recovery (GstQTMux * qtmux)
+{
+  if (fflush (qtmux->moov_recov_file))
+    return FALSE;
+
+  if (qtmux->moov_recov_sync) {
+#ifdef G_OS_WIN32
+    if (_commit (fileno (qtmux->moov_recov_file)))
+      return FALSE;
+#else
+    if (fsync (fileno (qtmux->moov_recov_file)))
+      return FALSE;
+#endif
+  }
+
+  return TRUE;
+}
+
 /*
  * Takes GstQTMux back to its initial state
  */
@@ -469,6 +600,11 @@ gst_qt_mux_reset (GstQTMux * qtmux, gboolean alloc)
   qtmux->header_size = 0;
   qtmux->mdat_size = 0;
   qtmux->mdat_pos = 0;
+  qtmux->reserved_moov_pos = 0;
+  qtmux->reserved_moov_size = 0;
+  qtmux->last_moov_update = GST_CLOCK_TIME_NONE;
+  qtmux->last_moov_recov_flush = GST_CLOCK_TIME_NONE;
+  qtmux->reserved_moov_overflow = FALSE;
   qtmux->longest_chunk = GST_CLOCK_TIME_NONE;
   qtmux->video_pads = 0;
   qtmux->audio_pads = 0;
@@ -491,10 +627,7 @@ gst_qt_mux_reset (GstQTMux * qtmux, gboolean alloc)
     g_remove (qtmux->fast_start_file_path);
     qtmux->fast_start_file = NULL;
   }
-  if (qtmux->moov_recov_file) {
-    fclose (qtmux->moov_recov_file);
-    qtmux->moov_recov_file = NULL;
-  }
+  gst_qt_mux_close_moov_recovery (qtmux);
   for (walk = qtmux->extra_atoms; walk; walk = g_slist_next (walk)) {
     AtomInfo *ainfo = (AtomInfo *) walk->data;
     ainfo->free_func (ainfo->atom);
@@ -1384,7 +1517,11 @@ static GstFlowReturn
 gst_qt_mux_send_buffered_data (GstQTMux * qtmux, guint64 * offset)
 {
   GstFlowReturn ret = GST_FLOW_OK;
+  GstBufferPool *pool;
+  GstStructure *config;
   GstBuffer *buf = NULL;
+  guint64 total = 0;
+  guint bufsize;
 
   if (fflush (qtmux->fast_start_file))
     goto flush_failed;
@@ -1392,32 +1529,59 @@ gst_qt_mux_send_buffered_data (GstQTMux * qtmux, guint64 * offset)
   if (!gst_qt_mux_seek_to_beginning (qtmux->fast_start_file))
     goto seek_failed;
 
-  /* hm, this could all take a really really long time,
-   * but there may not be another way to get moov atom first
-   * (somehow optimize copy?) */
-  GST_DEBUG_OBJECT (qtmux, "Sending buffered data");
+  GST_OBJECT_LOCK (qtmux);
+  bufsize = qtmux->fast_start_buffer_size;
+  GST_OBJECT_UNLOCK (qtmux);
+
+  /* the buffered data can be huge, so read it back in large blocks and
+   * recycle those once downstream is done with them, rather than
+   * allocating and pushing a small buffer for every few kB */
+  pool = gst_buffer_pool_new ();
+  config = gst_buffer_pool_get_config (pool);
+  gst_buffer_pool_config_set_params (config, NULL, bufsize, 0, 0);
+  if (!gst_buffer_pool_set_config (pool, config)
+      || !gst_buffer_pool_set_active (pool, TRUE)) {
+    gst_object_unref (pool);
+    goto pool_failed;
+  }
+
+  GST_DEBUG_OBJECT (qtmux, "Sending buffered data in blocks of %u bytes",
+      bufsize);
   while (ret == GST_FLOW_OK) {
-    const int bufsize = 4096;
     GstMapInfo map;
     gsize size;
 
-    buf = gst_buffer_new_and_alloc (bufsize);
+    ret = gst_buffer_pool_acquire_buffer (pool, &buf, NULL);
+    if (ret != GST_FLOW_OK)
+      break;
+
+    /* a recycled buffer may have been shrunk by a previous short read */
+    gst_buffer_set_size (buf, bufsize);
     gst_buffer_map (buf, &map, GST_MAP_WRITE);
     size = fread (map.data, sizeof (guint8), bufsize, qtmux->fast_start_file);
-    if (size == 0) {
-      gst_buffer_unmap (buf, &map);
+    gst_buffer_unmap (buf, &map);
+    if (size == 0)
       break;
-    }
     GST_LOG_OBJECT (qtmux, "Pushing buffered buffer of size %d", (gint) size);
-    gst_buffer_unmap (buf, &map);
     if (size != bufsize)
       gst_buffer_set_size (buf, size);
+    total += size;
     ret = gst_qt_mux_send_buffer (qtmux, buf, offset, FALSE);
     buf = NULL;
   }
   if (buf)
     gst_buffer_unref (buf);
 
+  /* buffers still held downstream are freed when they come back */
+  gst_buffer_pool_set_active (pool, FALSE);
+  gst_object_unref (pool);
+
+  /* the mdat header already announced everything that was written to the
+   * temporary file, getting less back would leave the mdat truncated */
+  if (ferror (qtmux->fast_start_file) ||
+      (ret == GST_FLOW_OK && total != qtmux->mdat_size))
+    goto read_failed;
+
   if (ftruncate (fileno (qtmux->fast_start_file), 0))
     goto seek_failed;
   if (!gst_qt_mux_seek_to_beginning (qtmux->fast_start_file))
@@ -1440,6 +1604,20 @@ seek_failed:
     ret = GST_FLOW_ERROR;
     goto fail;
   }
+read_failed:
+  {
+    GST_ELEMENT_ERROR (qtmux, RESOURCE, READ,
+        ("Failed to read temporary file"), GST_ERROR_SYSTEM);
+    ret = GST_FLOW_ERROR;
+    goto fail;
+  }
+pool_failed:
+  {
+    GST_ELEMENT_ERROR (qtmux, CORE, FAILED, (NULL),
+        ("Failed to set up buffer pool for temporary file data"));
+    ret = GST_FLOW_ERROR;
+    goto fail;
+  }
 fail:
   {
     /* clear descriptor so we don't remove temp file later on,
@@ -1457,8 +1635,8 @@ fail:
  * we need to record the position of the size field in the stream so we can
  * seek back to it later and update when the streams have finished.
  */
-static GstFlowReturn
-gst_qt_mux_send_mdat_header (GstQTMux * qtmux, guint64 * off, guint64 size,
+static GstBuffer *
+gst_qt_mux_create_mdat_header (GstQTMux * qtmux, guint64 size,
     gboolean extended)
 {
   Atom *node_header;
@@ -1466,9 +1644,6 @@ gst_qt_mux_send_mdat_header (GstQTMux * qtmux, guint64 * off, guint64 size,
   guint8 *data = NULL;
   guint64 offset = 0;
 
-  GST_DEBUG_OBJECT (qtmux, "Sending mdat's atom header, "
-      "size %" G_GUINT64_FORMAT, size);
-
   node_header = g_malloc0 (sizeof (Atom));
   node_header->type = FOURCC_mdat;
   if (extended) {
@@ -1488,8 +1663,7 @@ gst_qt_mux_send_mdat_header (GstQTMux * qtmux, guint64 * off, guint64 size,
   buf = _gst_buffer_new_take_data (data, offset);
   g_free (node_header);
 
-  GST_LOG_OBJECT (qtmux, "Pushing mdat start");
-  return gst_qt_mux_send_buffer (qtmux, buf, off, FALSE);
+  return buf;
 
   /* ERRORS */
 serialize_error:
@@ -1497,10 +1671,27 @@ serialize_error:
     GST_ELEMENT_ERROR (qtmux, STREAM, MUX, (NULL),
         ("Failed to serialize mdat"));
     g_free (node_header);
-    return GST_FLOW_ERROR;
+    return NULL;
   }
 }
 
+static GstFlowReturn
+gst_qt_mux_send_mdat_header (GstQTMux * qtmux, guint64 * off, guint64 size,
+    gboolean extended)
+{
+  GstBuffer *buf;
+
+  GST_DEBUG_OBJECT (qtmux, "Sending mdat's atom header, "
+      "size %" G_GUINT64_FORMAT, size);
+
+  buf = gst_qt_mux_create_mdat_header (qtmux, size, extended);
+  if (!buf)
+    return GST_FLOW_ERROR;
+
+  GST_LOG_OBJECT (qtmux, "Pushing mdat start");
+  return gst_qt_mux_send_buffer (qtmux, buf, off, FALSE);
+}
+
 /*
  * We get the position of the mdat size field, seek back to it
  * and overwrite with the real value
@@ -1516,18 +1707,19 @@ gst_qt_mux_update_mdat_size (GstQTMux * qtmux, guint64 mdat_pos,
 
   large_file = (mdat_size > MDAT_LARGE_FILE_LIMIT);
 
-  if (large_file)
-    mdat_pos += 8;
-
   /* seek and rewrite the header */
   gst_segment_init (&segment, GST_FORMAT_BYTES);
   segment.start = mdat_pos;
   gst_pad_push_event (qtmux->srcpad, gst_event_new_segment (&segment));
 
+  /* always write the complete header, as it may be rewritten repeatedly
+   * while the mdat grows past the large file limit */
   if (large_file) {
-    buf = gst_buffer_new_and_alloc (sizeof (guint64));
+    buf = gst_buffer_new_and_alloc (16);
     gst_buffer_map (buf, &map, GST_MAP_WRITE);
-    GST_WRITE_UINT64_BE (map.data, mdat_size + 16);
+    GST_WRITE_UINT32_BE (map.data, 1);
+    GST_WRITE_UINT32_LE (map.data + 4, FOURCC_mdat);
+    GST_WRITE_UINT64_BE (map.data + 8, mdat_size + 16);
   } else {
     buf = gst_buffer_new_and_alloc (16);
     gst_buffer_map (buf, &map, GST_MAP_WRITE);
@@ -1541,6 +1733,44 @@ gst_qt_mux_update_mdat_size (GstQTMux * qtmux, guint64 mdat_pos,
   return gst_qt_mux_send_buffer (qtmux, buf, offset, FALSE);
 }
 
+/*
+ * Sends a free atom of @size bytes, or only its header when @partial,
+ * turning whatever follows into padding. The padding goes out in pieces
+ * of at most FREE_ATOM_BLOCK_SIZE, the reserved moov space can be large.
+ */
+static GstFlowReturn
+gst_qt_mux_send_free_atom (GstQTMux * qtmux, guint64 * off, guint32 size,
+    gboolean partial)
+{
+  GstFlowReturn ret;
+  GstBuffer *buf;
+  GstMapInfo map;
+  guint32 chunk, left;
+
+  GST_DEBUG_OBJECT (qtmux, "Sending free atom header of size %u", size);
+
+  chunk = partial ? 8 : MIN (size, FREE_ATOM_BLOCK_SIZE);
+  buf = gst_buffer_new_and_alloc (chunk);
+  gst_buffer_map (buf, &map, GST_MAP_WRITE);
+  memset (map.data + 8, 0, chunk - 8);
+  GST_WRITE_UINT32_BE (map.data, size);
+  GST_WRITE_UINT32_LE (map.data + 4, FOURCC_free);
+  gst_buffer_unmap (buf, &map);
+
+  ret = gst_qt_mux_send_buffer (qtmux, buf, off, FALSE);
+
+  left = partial ? 0 : size - chunk;
+  while (ret == GST_FLOW_OK && left > 0) {
+    chunk = MIN (left, FREE_ATOM_BLOCK_SIZE);
+    buf = gst_buffer_new_and_alloc (chunk);
+    gst_buffer_memset (buf, 0, 0, chunk);
+    ret = gst_qt_mux_send_buffer (qtmux, buf, off, FALSE);
+    left -= chunk;
+  }
+
+  return ret;
+}
+
 static GstFlowReturn
 gst_qt_mux_send_ftyp (GstQTMux * qtmux, guint64 * off)
 {
@@ -1673,30 +1903,24 @@ gst_qt_mux_configure_moov (GstQTMux * qtmux, guint32 * _timescale)
 static GstFlowReturn
 gst_qt_mux_send_moov (GstQTMux * qtmux, guint64 * _offset, gboolean mind_fast)
 {
-  guint64 offset = 0, size = 0;
+  guint64 size;
   guint8 *data;
   GstBuffer *buf;
   GstFlowReturn ret = GST_FLOW_OK;
 
   /* serialize moov */
-  offset = size = 0;
-  data = NULL;
   GST_LOG_OBJECT (qtmux, "Copying movie header into buffer");
-  if (!atom_moov_copy_data (qtmux->moov, &data, &size, &offset))
-    goto serialize_error;
+  size = atom_copy_data_sized ((Atom *) qtmux->moov,
+      (AtomCopyDataFunc) atom_moov_copy_data, &data);
+  if (!size)
+    return GST_FLOW_ERROR;
 
-  buf = _gst_buffer_new_take_data (data, offset);
+  buf = _gst_buffer_new_take_data (data, size);
   GST_DEBUG_OBJECT (qtmux, "Pushing moov atoms");
   gst_qt_mux_set_header_on_caps (qtmux, buf);
   ret = gst_qt_mux_send_buffer (qtmux, buf, _offset, mind_fast);
 
   return ret;
-
-serialize_error:
-  {
-    g_free (data);
-    return GST_FLOW_ERROR;
-  }
 }
 
 /* either calculates size of extra atoms or pushes them */
@@ -1780,6 +2004,16 @@ gst_qt_mux_prepare_moov_recovery (GstQTMux * qtmux)
     return;
   }
 
+  /* sample records are small and come with every buffer, so batch them in
+   * a buffer of our own size, flushed at least every flush interval */
+  if (qtmux->moov_recov_buffer_size > 0) {
+    qtmux->moov_recov_buffer = g_malloc (qtmux->moov_recov_buffer_size);
+    setvbuf (qtmux->moov_recov_file, (char *) qtmux->moov_recov_buffer,
+        _IOFBF, qtmux->moov_recov_buffer_size);
+  } else {
+    setvbuf (qtmux->moov_recov_file, NULL, _IONBF, 0);
+  }
+
   gst_qt_mux_prepare_ftyp (qtmux, &ftyp, &prefix);
 
   if (!atoms_recov_write_headers (qtmux->moov_recov_file, ftyp, prefix,
@@ -1796,22 +2030,173 @@ gst_qt_mux_prepare_moov_recovery (GstQTMux * qtmux)
     GstCollectData *cdata = (GstCollectData *) walk->data;
     GstQTPad *qpad = (GstQTPad *) cdata;
     /* write info for each stream */
-    fail = atoms_recov_write_trak_info (qtmux->moov_recov_file, qpad->trak);
-    if (fail) {
+    if (!atoms_recov_write_trak_info (qtmux->moov_recov_file, qpad->trak)) {
       GST_WARNING_OBJECT (qtmux, "Failed to write trak info to recovery "
           "file");
-      break;
+      fail = TRUE;
     }
   }
+  if (fail || !gst_qt_mux_flush_moov_recovery (qtmux))
+    goto fail;
+
+  return;
 
 fail:
   /* cleanup */
-  fclose (qtmux->moov_recov_file);
-  qtmux->moov_recov_file = NULL;
+  gst_qt_mux_close_moov_recovery (qtmux);
   GST_WARNING_OBJECT (qtmux, "An error was detected while writing to "
       "recover file, moov recovery won't work");
 }
 
+/*
+ * Reserves space for the moov right after ftyp, sized for the expected
+ * maximum duration of the recording
+ */
+static GstFlowReturn
+gst_qt_mux_send_reserved_moov_space (GstQTMux * qtmux)
+{
+  GstClockTime max_duration;
+  guint64 size = 0, offset = 0, reserved;
+  guint bytes_per_sec;
+  guint n_traks;
+
+  GST_OBJECT_LOCK (qtmux);
+  max_duration = qtmux->reserved_max_duration;
+  bytes_per_sec = qtmux->reserved_bytes_per_sec_per_trak;
+  GST_OBJECT_UNLOCK (qtmux);
+
+  /* the sample tables grow with the duration, the rest is known by now */
+  gst_qt_mux_configure_moov (qtmux, NULL);
+  if (!atom_moov_copy_data (qtmux->moov, NULL, &size, &offset))
+    goto serialize_error;
+
+  n_traks = g_slist_length (qtmux->sinkpads);
+  reserved = offset + RESERVED_MOOV_SLACK +
+      gst_util_uint64_scale (max_duration, (guint64) bytes_per_sec * n_traks,
+      GST_SECOND);
+  if (reserved > G_MAXUINT32) {
+    GST_WARNING_OBJECT (qtmux, "Can not reserve %" G_GUINT64_FORMAT " bytes "
+        "for moov, limiting to 4GB", reserved);
+    reserved = G_MAXUINT32;
+  }
+
+  GST_DEBUG_OBJECT (qtmux, "Reserving %" G_GUINT64_FORMAT " bytes for moov "
+      "of %u traks, %" GST_TIME_FORMAT " long", reserved, n_traks,
+      GST_TIME_ARGS (max_duration));
+
+  qtmux->reserved_moov_pos = qtmux->header_size;
+  qtmux->reserved_moov_size = reserved;
+
+  return gst_qt_mux_send_free_atom (qtmux, &qtmux->header_size, reserved,
+      FALSE);
+
+  /* ERRORS */
+serialize_error:
+  {
+    GST_ELEMENT_ERROR (qtmux, STREAM, MUX, (NULL),
+        ("Failed to serialize moov"));
+    return GST_FLOW_ERROR;
+  }
+}
+
+/*
+ * Writes the moov (and extra atoms, if @final) into the reserved space,
+ * padding the remainder with a free atom, and updates the mdat size so the
+ * file is playable up to the current point.
+ * If it does not fit, nothing is written and @written is set to FALSE.
+ * Unless @final, downstream is positioned at the end of the file again.
+ */
+static GstFlowReturn
+gst_qt_mux_update_reserved_moov (GstQTMux * qtmux, gboolean final,
+    gboolean * written)
+{
+  GstFlowReturn ret;
+  GstSegment segment;
+  GstBuffer *buf;
+  guint8 *data = NULL;
+  guint64 size = 0, offset = 0, used;
+
+  *written = FALSE;
+
+  if (!final)
+    gst_qt_mux_configure_moov (qtmux, NULL);
+  /* chunk offsets are relative to the start of the mdat data */
+  atom_moov_chunks_set_offset (qtmux->moov, qtmux->header_size);
+
+  if (!atom_moov_copy_data (qtmux->moov, NULL, &size, &offset))
+    goto serialize_error;
+  used = offset;
+  if (final) {
+    ret = gst_qt_mux_send_extra_atoms (qtmux, FALSE, &used, FALSE);
+    if (ret != GST_FLOW_OK)
+      return ret;
+  }
+
+  /* what is left has to fit a free atom, unless nothing is left */
+  if (used != qtmux->reserved_moov_size
+      && used + 8 > qtmux->reserved_moov_size) {
+    GST_WARNING_OBJECT (qtmux, "moov of %" G_GUINT64_FORMAT " bytes does not "
+        "fit in the %u bytes reserved", used, qtmux->reserved_moov_size);
+    qtmux->reserved_moov_overflow = TRUE;
+    return GST_FLOW_OK;
+  }
+
+  GST_DEBUG_OBJECT (qtmux, "Writing moov of %" G_GUINT64_FORMAT " bytes into "
+      "reserved space", used);
+
+  /* mdat first, so the moov never refers past its end */
+  ret = gst_qt_mux_update_mdat_size (qtmux, qtmux->mdat_pos,
+      qtmux->mdat_size, NULL);
+  if (ret != GST_FLOW_OK)
+    return ret;
+
+  gst_segment_init (&segment, GST_FORMAT_BYTES);
+  segment.start = qtmux->reserved_moov_pos;
+  gst_pad_push_event (qtmux->srcpad, gst_event_new_segment (&segment));
+
+  if (final) {
+    ret = gst_qt_mux_send_moov (qtmux, NULL, FALSE);
+    if (ret == GST_FLOW_OK)
+      ret = gst_qt_mux_send_extra_atoms (qtmux, TRUE, NULL, FALSE);
+  } else {
+    /* not through send_moov, no need to update caps for every snapshot */
+    size = atom_copy_data_sized ((Atom *) qtmux->moov,
+        (AtomCopyDataFunc) atom_moov_copy_data, &data);
+    if (!size)
+      goto serialize_error;
+    buf = _gst_buffer_new_take_data (data, size);
+    ret = gst_qt_mux_send_buffer (qtmux, buf, NULL, FALSE);
+  }
+  if (ret != GST_FLOW_OK)
+    return ret;
+
+  if (used < qtmux->reserved_moov_size) {
+    ret = gst_qt_mux_send_free_atom (qtmux, NULL,
+        qtmux->reserved_moov_size - used, TRUE);
+    if (ret != GST_FLOW_OK)
+      return ret;
+  }
+
+  if (!final) {
+    /* and back to where the media data continues */
+    gst_segment_init (&segment, GST_FORMAT_BYTES);
+    segment.start = qtmux->header_size + qtmux->mdat_size;
+    gst_pad_push_event (qtmux->srcpad, gst_event_new_segment (&segment));
+  }
+
+  *written = TRUE;
+  return GST_FLOW_OK;
+
+  /* ERRORS */
+serialize_error:
+  {
+    g_free (data);
+    GST_ELEMENT_ERROR (qtmux, STREAM, MUX, (NULL),
+        ("Failed to serialize moov"));
+    return GST_FLOW_ERROR;
+  }
+}
+
 static GstFlowReturn
 gst_qt_mux_start_file (GstQTMux * qtmux)
 {
@@ -1848,12 +2233,15 @@ gst_qt_mux_start_file (GstQTMux * qtmux)
       qtmux->mux_mode = GST_QT_MUX_MODE_FRAGMENTED_STREAMABLE;
     else
       qtmux->mux_mode = GST_QT_MUX_MODE_FRAGMENTED;
+  } else if (GST_CLOCK_TIME_IS_VALID (qtmux->reserved_max_duration)) {
+    qtmux->mux_mode = GST_QT_MUX_MODE_ROBUST_RECORDING;
   } else if (qtmux->fast_start) {
     qtmux->mux_mode = GST_QT_MUX_MODE_FAST_START;
   }
 
   switch (qtmux->mux_mode) {
     case GST_QT_MUX_MODE_MOOV_AT_END:
+    case GST_QT_MUX_MODE_ROBUST_RECORDING:
       /* We have to be able to seek to rewrite the mdat header, or any
        * moov atom we write will not be visible in the file, because an
        * MDAT with 0 as the size covers the rest of the file. A file
@@ -1908,6 +2296,19 @@ gst_qt_mux_start_file (GstQTMux * qtmux)
        * the full 64-bit atom */
       ret = gst_qt_mux_send_mdat_header (qtmux, &qtmux->header_size, 0, TRUE);
       break;
+    case GST_QT_MUX_MODE_ROBUST_RECORDING:
+      ret = gst_qt_mux_prepare_and_send_ftyp (qtmux);
+      if (ret != GST_FLOW_OK)
+        break;
+
+      /* moov goes in between ftyp and mdat, if it fits */
+      ret = gst_qt_mux_send_reserved_moov_space (qtmux);
+      if (ret != GST_FLOW_OK)
+        break;
+
+      qtmux->mdat_pos = qtmux->header_size;
+      ret = gst_qt_mux_send_mdat_header (qtmux, &qtmux->header_size, 0, TRUE);
+      break;
     case GST_QT_MUX_MODE_FAST_START:
       GST_OBJECT_LOCK (qtmux);
       qtmux->fast_start_file = g_fopen (qtmux->fast_start_file_path, "wb+");
@@ -2068,11 +2469,12 @@ gst_qt_mux_stop_file (GstQTMux * qtmux)
       guint8 *data = NULL;
       GstBuffer *buf;
 
-      size = offset = 0;
       GST_DEBUG_OBJECT (qtmux, "adding mfra");
-      if (!atom_mfra_copy_data (qtmux->mfra, &data, &size, &offset))
+      size = atom_copy_data_sized ((Atom *) qtmux->mfra,
+          (AtomCopyDataFunc) atom_mfra_copy_data, &data);
+      if (!size)
         goto serialize_error;
-      buf = _gst_buffer_new_take_data (data, offset);
+      buf = _gst_buffer_new_take_data (data, size);
       ret = gst_qt_mux_send_buffer (qtmux, buf, NULL, FALSE);
       if (ret != GST_FLOW_OK)
         return ret;
@@ -2148,6 +2550,19 @@ gst_qt_mux_stop_file (GstQTMux * qtmux)
   gst_qt_mux_setup_metadata (qtmux);
   large_file = (qtmux->mdat_size > MDAT_LARGE_FILE_LIMIT);
 
+  if (qtmux->mux_mode == GST_QT_MUX_MODE_ROBUST_RECORDING) {
+    gboolean written;
+
+    ret = gst_qt_mux_update_reserved_moov (qtmux, TRUE, &written);
+    if (ret != GST_FLOW_OK || written)
+      return ret;
+
+    /* downstream is still at the end of the file, continue from there
+     * as if no space had been reserved */
+    GST_WARNING_OBJECT (qtmux, "Reserved space too small, writing moov at "
+        "the end of the file");
+  }
+
   /* if faststart, update the offset of the atoms in the movie with the offset
    * that the movie headers before mdat will cause.
    * Also, send the ftyp */
@@ -2176,7 +2591,7 @@ gst_qt_mux_stop_file (GstQTMux * qtmux)
 
   /* Now that we know the size of moov + extra atoms, we can adjust
    * the chunk offsets stored into the moov */
-  atom_moov_chunks_add_offset (qtmux->moov, offset);
+  atom_moov_chunks_set_offset (qtmux->moov, offset);
 
   /* write out moov and extra atoms */
   /* note: as of this point, we no longer care about tracking written data size,
@@ -2201,6 +2616,24 @@ gst_qt_mux_stop_file (GstQTMux * qtmux)
        * since we no longer write anything anyway */
       break;
     }
+    case GST_QT_MUX_MODE_ROBUST_RECORDING:
+    {
+      GstSegment segment;
+
+      ret = gst_qt_mux_update_mdat_size (qtmux, qtmux->mdat_pos,
+          qtmux->mdat_size, NULL);
+      if (ret != GST_FLOW_OK)
+        return ret;
+
+      /* the reserved space may still hold an outdated moov from a
+       * periodic update, make it padding again */
+      gst_segment_init (&segment, GST_FORMAT_BYTES);
+      segment.start = qtmux->reserved_moov_pos;
+      gst_pad_push_event (qtmux->srcpad, gst_event_new_segment (&segment));
+      ret = gst_qt_mux_send_free_atom (qtmux, NULL,
+          qtmux->reserved_moov_size, TRUE);
+      break;
+    }
     case GST_QT_MUX_MODE_FAST_START:
     {
       /* send mdat atom and move buffered data into it */
@@ -2234,12 +2667,120 @@ ftyp_error:
   }
 }
 
+/* serializes @atom and appends it to @list, accounting for it in @offset */
+static void
+gst_qt_mux_buffer_list_add_atom (GstBufferList * list, Atom * atom,
+    AtomCopyDataFunc copy_func, guint64 * offset)
+{
+  guint8 *data;
+  guint64 size;
+
+  size = atom_copy_data_sized (atom, copy_func, &data);
+  gst_buffer_list_add (list, _gst_buffer_new_take_data (data, size));
+  *offset += size;
+}
+
+/* pushes the samples collected in the traf of @pad as moof and mdat, in
+ * chunked mode preceded by prft and, for the first chunk of a fragment,
+ * styp, all in a single buffer list */
+static GstFlowReturn
+gst_qt_mux_pad_send_fragment (GstQTMux * qtmux, GstQTPad * pad)
+{
+  GstBufferList *list;
+  AtomMOOF *moof;
+  GstBuffer *buffer;
+  guint64 offset;
+  guint i, total_size;
+
+  list = gst_buffer_list_new ();
+  offset = qtmux->header_size;
+
+  if (qtmux->chunk_duration) {
+    AtomInfo *prft;
+    gint64 now;
+    guint64 ntp;
+
+    if (pad->fragment_start) {
+      AtomFTYP *styp;
+      GList *brands = NULL;
+
+      brands = g_list_append (brands, GUINT_TO_POINTER (FOURCC_msix));
+      brands = g_list_append (brands, GUINT_TO_POINTER (FOURCC_cmfs));
+      styp = atom_styp_new (qtmux->context, FOURCC_msdh, 0, brands);
+      g_list_free (brands);
+      gst_qt_mux_buffer_list_add_atom (list, (Atom *) styp,
+          (AtomCopyDataFunc) atom_ftyp_copy_data, &offset);
+      atom_ftyp_free (styp);
+    }
+
+    /* map the chunk's first decode time to the wallclock time (in NTP
+     * format) at which its moof is written */
+    now = g_get_real_time ();
+    ntp = ((guint64) (now / G_USEC_PER_SEC) + G_GUINT64_CONSTANT (2208988800))
+        << 32;
+    ntp |= gst_util_uint64_scale (now % G_USEC_PER_SEC,
+        G_GUINT64_CONSTANT (1) << 32, G_USEC_PER_SEC);
+    prft = build_prft_atom (atom_trak_get_id (pad->trak), ntp,
+        pad->traf->tfdt ? pad->traf->tfdt->base_media_decode_time : 0, 4);
+    gst_qt_mux_buffer_list_add_atom (list, prft->atom, prft->copy_data_func,
+        &offset);
+    prft->free_func (prft->atom);
+    g_free (prft);
+  }
+
+  /* now we know where moof ends up, update offset in tfra */
+  if (pad->tfra)
+    atom_tfra_update_offset (pad->tfra, offset);
+
+  moof = atom_moof_new (qtmux->context, qtmux->fragment_sequence);
+  /* takes ownership */
+  atom_moof_add_traf (moof, pad->traf);
+  pad->traf = NULL;
+  gst_qt_mux_buffer_list_add_atom (list, (Atom *) moof,
+      (AtomCopyDataFunc) atom_moof_copy_data, &offset);
+  atom_moof_free (moof);
+  qtmux->fragment_sequence++;
+
+  /* and actual data */
+  total_size = 0;
+  for (i = 0; i < atom_array_get_len (&pad->fragment_buffers); i++) {
+    total_size +=
+        gst_buffer_get_size (atom_array_index (&pad->fragment_buffers, i));
+  }
+
+  GST_LOG_OBJECT (qtmux, "writing %d buffers, total_size %d",
+      atom_array_get_len (&pad->fragment_buffers), total_size);
+  buffer = gst_qt_mux_create_mdat_header (qtmux, total_size, FALSE);
+  if (G_UNLIKELY (!buffer)) {
+    for (i = 0; i < atom_array_get_len (&pad->fragment_buffers); i++)
+      gst_buffer_unref (atom_array_index (&pad->fragment_buffers, i));
+    atom_array_clear (&pad->fragment_buffers);
+    gst_buffer_list_unref (list);
+    return GST_FLOW_ERROR;
+  }
+  offset += gst_buffer_get_size (buffer);
+  gst_buffer_list_add (list, buffer);
+
+  /* list takes ownership */
+  for (i = 0; i < atom_array_get_len (&pad->fragment_buffers); i++)
+    gst_buffer_list_add (list, atom_array_index (&pad->fragment_buffers, i));
+  offset += total_size;
+  atom_array_clear (&pad->fragment_buffers);
+
+  GST_LOG_OBJECT (qtmux, "pushing %u buffers, %" G_GUINT64_FORMAT " bytes",
+      gst_buffer_list_length (list), offset - qtmux->header_size);
+  qtmux->header_size = offset;
+
+  return gst_pad_push_list (qtmux->srcpad, list);
+}
+
 static GstFlowReturn
 gst_qt_mux_pad_fragment_add_buffer (GstQTMux * qtmux, GstQTPad * pad,
     GstBuffer * buf, gboolean force, guint32 nsamples, gint64 dts,
     guint32 delta, guint32 size, gboolean sync, gint64 pts_offset)
 {
   GstFlowReturn ret = GST_FLOW_OK;
+  gboolean new_fragment = TRUE;
 
   /* setup if needed */
   if (G_UNLIKELY (!pad->traf || force))
@@ -2248,62 +2789,35 @@ gst_qt_mux_pad_fragment_add_buffer (GstQTMux * qtmux, GstQTPad * pad,
 flush:
   /* flush pad fragment if threshold reached,
    * or at new keyframe if we should be minding those in the first place */
-  if (G_UNLIKELY (force || (sync && pad->sync) ||
-          pad->fragment_duration < (gint64) delta)) {
-    AtomMOOF *moof;
-    guint64 size = 0, offset = 0;
-    guint8 *data = NULL;
-    GstBuffer *buffer;
-    guint i, total_size;
-
-    /* now we know where moof ends up, update offset in tfra */
-    if (pad->tfra)
-      atom_tfra_update_offset (pad->tfra, qtmux->header_size);
-
-    moof = atom_moof_new (qtmux->context, qtmux->fragment_sequence);
-    /* takes ownership */
-    atom_moof_add_traf (moof, pad->traf);
-    pad->traf = NULL;
-    atom_moof_copy_data (moof, &data, &size, &offset);
-    buffer = _gst_buffer_new_take_data (data, offset);
-    GST_LOG_OBJECT (qtmux, "writing moof size %" G_GSIZE_FORMAT,
-        gst_buffer_get_size (buffer));
-    ret = gst_qt_mux_send_buffer (qtmux, buffer, &qtmux->header_size, FALSE);
-
-    /* and actual data */
-    total_size = 0;
-    for (i = 0; i < atom_array_get_len (&pad->fragment_buffers); i++) {
-      total_size +=
-          gst_buffer_get_size (atom_array_index (&pad->fragment_buffers, i));
-    }
-
-    GST_LOG_OBJECT (qtmux, "writing %d buffers, total_size %d",
-        atom_array_get_len (&pad->fragment_buffers), total_size);
-    if (ret == GST_FLOW_OK)
-      ret = gst_qt_mux_send_mdat_header (qtmux, &qtmux->header_size, total_size,
-          FALSE);
-    for (i = 0; i < atom_array_get_len (&pad->fragment_buffers); i++) {
-      if (G_LIKELY (ret == GST_FLOW_OK))
-        ret = gst_qt_mux_send_buffer (qtmux,
-            atom_array_index (&pad->fragment_buffers, i), &qtmux->header_size,
-            FALSE);
-      else
-        gst_buffer_unref (atom_array_index (&pad->fragment_buffers, i));
-    }
-
-    atom_array_clear (&pad->fragment_buffers);
-    atom_moof_free (moof);
-    qtmux->fragment_sequence++;
-    force = FALSE;
+  new_fragment = force || (sync && pad->sync) ||
+      pad->fragment_duration < (gint64) delta;
+  /* in chunked mode, the fragment so far also goes out as a chunk when the
+   * chunk duration is reached */
+  if (G_UNLIKELY (new_fragment || (qtmux->chunk_duration &&
+              pad->chunk_duration < (gint64) delta))) {
+    ret = gst_qt_mux_pad_send_fragment (qtmux, pad);
+    /* the last buffer is already part of what was just sent */
+    if (force)
+      return ret;
   }
 
 init:
   if (G_UNLIKELY (!pad->traf)) {
-    GST_LOG_OBJECT (qtmux, "setting up new fragment");
+    GST_LOG_OBJECT (qtmux, "setting up new %s",
+        new_fragment ? "fragment" : "chunk");
     pad->traf = atom_traf_new (qtmux->context, atom_trak_get_id (pad->trak));
     atom_array_init (&pad->fragment_buffers, 512);
-    pad->fragment_duration = gst_util_uint64_scale (qtmux->fragment_duration,
-        atom_trak_get_timescale (pad->trak), 1000);
+    if (new_fragment)
+      pad->fragment_duration = gst_util_uint64_scale (qtmux->fragment_duration,
+          atom_trak_get_timescale (pad->trak), 1000);
+    pad->fragment_start = new_fragment;
+
+    /* CMAF requires the decode time of every chunk */
+    if (qtmux->chunk_duration) {
+      pad->chunk_duration = gst_util_uint64_scale (qtmux->chunk_duration,
+          atom_trak_get_timescale (pad->trak), 1000);
+      atom_traf_set_base_decode_time (pad->traf, dts);
+    }
 
     if (G_UNLIKELY (qtmux->mfra && !pad->tfra)) {
       pad->tfra = atom_tfra_new (qtmux->context, atom_trak_get_id (pad->trak));
@@ -2316,6 +2830,7 @@ init:
       pad->sync && sync);
   atom_array_append (&pad->fragment_buffers, buf, 256);
   pad->fragment_duration -= delta;
+  pad->chunk_duration -= delta;
 
   if (pad->tfra) {
     guint32 sn = atom_traf_get_sample_num (pad->traf);
@@ -2345,14 +2860,28 @@ gst_qt_mux_register_and_push_sample (GstQTMux * qtmux, GstQTPad * pad,
             do_pts, pts_offset)) {
       GST_WARNING_OBJECT (qtmux, "Failed to write sample information to "
           "recovery file, disabling recovery");
-      fclose (qtmux->moov_recov_file);
-      qtmux->moov_recov_file = NULL;
+      gst_qt_mux_close_moov_recovery (qtmux);
+    } else if (GST_CLOCK_TIME_IS_VALID (qtmux->moov_recov_flush_interval)
+        && GST_CLOCK_TIME_IS_VALID (pad->last_dts)) {
+      /* bound the amount of media whose records only sit in the buffer */
+      if (!GST_CLOCK_TIME_IS_VALID (qtmux->last_moov_recov_flush))
+        qtmux->last_moov_recov_flush = pad->last_dts;
+      if (pad->last_dts >= qtmux->last_moov_recov_flush +
+          qtmux->moov_recov_flush_interval) {
+        if (!gst_qt_mux_flush_moov_recovery (qtmux)) {
+          GST_WARNING_OBJECT (qtmux, "Failed to flush recovery file, "
+              "disabling recovery");
+          gst_qt_mux_close_moov_recovery (qtmux);
+        }
+        qtmux->last_moov_recov_flush = pad->last_dts;
+      }
     }
   }
 
   switch (qtmux->mux_mode) {
     case GST_QT_MUX_MODE_MOOV_AT_END:
     case GST_QT_MUX_MODE_FAST_START:
+    case GST_QT_MUX_MODE_ROBUST_RECORDING:
 
       atom_trak_add_samples (pad->trak, nsamples, (gint32) scaled_duration,
           sample_size, chunk_offset, sync, pts_offset);
@@ -2367,12 +2896,59 @@ gst_qt_mux_register_and_push_sample (GstQTMux * qtmux, GstQTPad * pad,
       break;
   }
 
+  /* keep the moov in the reserved space reasonably up to date */
+  if (ret == GST_FLOW_OK
+      && qtmux->mux_mode == GST_QT_MUX_MODE_ROBUST_RECORDING
+      && !qtmux->reserved_moov_overflow
+      && GST_CLOCK_TIME_IS_VALID (qtmux->reserved_moov_update_period)
+      && GST_CLOCK_TIME_IS_VALID (pad->last_dts)) {
+    if (!GST_CLOCK_TIME_IS_VALID (qtmux->last_moov_update)) {
+      qtmux->last_moov_update = pad->last_dts;
+    } else if (pad->last_dts >= qtmux->last_moov_update +
+        qtmux->reserved_moov_update_period) {
+      gboolean written;
+
+      ret = gst_qt_mux_update_reserved_moov (qtmux, FALSE, &written);
+      qtmux->last_moov_update = pad->last_dts;
+    }
+  }
+
   return ret;
 }
 
 /*
  * Here we push the buffer and update the tables in the track atoms
  */
+/* converts @ts to the timescale of the trak of @pad, reusing the result
+ * when the same time was converted recently */
+static gint64
+gst_qt_mux_pad_scale_time (GstQTPad * pad, GstClockTime ts)
+{
+  guint32 timescale = atom_trak_get_timescale (pad->trak);
+  guint i;
+
+  if (G_UNLIKELY (!GST_CLOCK_TIME_IS_VALID (ts)))
+    return gst_util_uint64_scale_round (ts, timescale, GST_SECOND);
+
+  if (G_UNLIKELY (timescale != pad->scaled_timescale)) {
+    pad->scaled_timescale = timescale;
+    pad->scaled_ts[0] = pad->scaled_ts[1] = GST_CLOCK_TIME_NONE;
+  }
+
+  for (i = 0; i < 2; i++) {
+    if (pad->scaled_ts[i] == ts)
+      return pad->scaled_ts_value[i];
+  }
+
+  i = pad->scaled_ts_next;
+  pad->scaled_ts_next ^= 1;
+  pad->scaled_ts[i] = ts;
+  pad->scaled_ts_value[i] = gst_util_uint64_scale_round (ts, timescale,
+      GST_SECOND);
+
+  return pad->scaled_ts_value[i];
+}
+
 static GstFlowReturn
 gst_qt_mux_add_buffer (GstQTMux * qtmux, GstQTPad * pad, GstBuffer * buf)
 {
@@ -2493,8 +3069,7 @@ gst_qt_mux_add_buffer (GstQTMux * qtmux, GstQTPad * pad, GstBuffer * buf)
     pad->total_duration += duration;
   }
 
-  last_dts = gst_util_uint64_scale_round (pad->last_dts,
-      atom_trak_get_timescale (pad->trak), GST_SECOND);
+  last_dts = gst_qt_mux_pad_scale_time (pad, pad->last_dts);
 
   /* fragments only deal with 1 buffer == 1 chunk (== 1 sample) */
   if (pad->sample_size && !qtmux->fragment_sequence) {
@@ -2536,8 +3111,7 @@ gst_qt_mux_add_buffer (GstQTMux * qtmux, GstQTPad * pad, GstBuffer * buf)
         scaled_dts = -gst_util_uint64_scale_round (-pad->last_dts,
             atom_trak_get_timescale (pad->trak), GST_SECOND);
       } else {
-        scaled_dts = gst_util_uint64_scale_round (pad->last_dts,
-            atom_trak_get_timescale (pad->trak), GST_SECOND);
+        scaled_dts = gst_qt_mux_pad_scale_time (pad, pad->last_dts);
       }
       scaled_duration = scaled_dts - last_dts;
       last_dts = scaled_dts;
@@ -2570,16 +3144,13 @@ gst_qt_mux_add_buffer (GstQTMux * qtmux, GstQTPad * pad, GstBuffer * buf)
   }
 
   if (GST_CLOCK_TIME_IS_VALID (GST_BUFFER_DTS (last_buf))) {
-    last_dts = gst_util_uint64_scale_round (GST_BUFFER_DTS (last_buf),
-        atom_trak_get_timescale (pad->trak), GST_SECOND);
-    pts_offset =
-        (gint64) (gst_util_uint64_scale_round (GST_BUFFER_PTS (last_buf),
-            atom_trak_get_timescale (pad->trak), GST_SECOND) - last_dts);
+    last_dts = gst_qt_mux_pad_scale_time (pad, GST_BUFFER_DTS (last_buf));
+    pts_offset = gst_qt_mux_pad_scale_time (pad, GST_BUFFER_PTS (last_buf)) -
+        last_dts;
 
   } else {
     pts_offset = 0;
-    last_dts = gst_util_uint64_scale_round (GST_BUFFER_PTS (last_buf),
-        atom_trak_get_timescale (pad->trak), GST_SECOND);
+    last_dts = gst_qt_mux_pad_scale_time (pad, GST_BUFFER_PTS (last_buf));
   }
   GST_DEBUG ("dts: %" GST_TIME_FORMAT " pts: %" GST_TIME_FORMAT
       " timebase_dts: %d pts_offset: %d",
@@ -3691,15 +4262,39 @@ gst_qt_mux_get_property (GObject * object,
     case PROP_FAST_START_TEMP_FILE:
       g_value_set_string (value, qtmux->fast_start_file_path);
       break;
+    case PROP_FAST_START_BUFFER_SIZE:
+      g_value_set_uint (value, qtmux->fast_start_buffer_size);
+      break;
     case PROP_MOOV_RECOV_FILE:
       g_value_set_string (value, qtmux->moov_recov_file_path);
       break;
     case PROP_FRAGMENT_DURATION:
       g_value_set_uint (value, qtmux->fragment_duration);
       break;
+    case PROP_CHUNK_DURATION:
+      g_value_set_uint (value, qtmux->chunk_duration);
+      break;
     case PROP_STREAMABLE:
       g_value_set_boolean (value, qtmux->streamable);
       break;
+    case PROP_RESERVED_MAX_DURATION:
+      g_value_set_uint64 (value, qtmux->reserved_max_duration);
+      break;
+    case PROP_RESERVED_BYTES_PER_SEC:
+      g_value_set_uint (value, qtmux->reserved_bytes_per_sec_per_trak);
+      break;
+    case PROP_RESERVED_MOOV_UPDATE_PERIOD:
+      g_value_set_uint64 (value, qtmux->reserved_moov_update_period);
+      break;
+    case PROP_MOOV_RECOV_BUFFER_SIZE:
+      g_value_set_uint (value, qtmux->moov_recov_buffer_size);
+      break;
+    case PROP_MOOV_RECOV_FLUSH_INTERVAL:
+      g_value_set_uint64 (value, qtmux->moov_recov_flush_interval);
+      break;
+    case PROP_MOOV_RECOV_SYNC:
+      g_value_set_boolean (value, qtmux->moov_recov_sync);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -3753,6 +4348,9 @@ gst_qt_mux_set_property (GObject * object,
         gst_qt_mux_generate_fast_start_file_path (qtmux);
       }
       break;
+    case PROP_FAST_START_BUFFER_SIZE:
+      qtmux->fast_start_buffer_size = g_value_get_uint (value);
+      break;
     case PROP_MOOV_RECOV_FILE:
       g_free (qtmux->moov_recov_file_path);
       qtmux->moov_recov_file_path = g_value_dup_string (value);
@@ -3760,6 +4358,9 @@ gst_qt_mux_set_property (GObject * object,
     case PROP_FRAGMENT_DURATION:
       qtmux->fragment_duration = g_value_get_uint (value);
       break;
+    case PROP_CHUNK_DURATION:
+      qtmux->chunk_duration = g_value_get_uint (value);
+      break;
     case PROP_STREAMABLE:{
       GstQTMuxClass *qtmux_klass =
           (GstQTMuxClass *) (G_OBJECT_GET_CLASS (qtmux));
@@ -3768,6 +4369,24 @@ gst_qt_mux_set_property (GObject * object,
       }
       break;
     }
+    case PROP_RESERVED_MAX_DURATION:
+      qtmux->reserved_max_duration = g_value_get_uint64 (value);
+      break;
+    case PROP_RESERVED_BYTES_PER_SEC:
+      qtmux->reserved_bytes_per_sec_per_trak = g_value_get_uint (value);
+      break;
+    case PROP_RESERVED_MOOV_UPDATE_PERIOD:
+      qtmux->reserved_moov_update_period = g_value_get_uint64 (value);
+      break;
+    case PROP_MOOV_RECOV_BUFFER_SIZE:
+      qtmux->moov_recov_buffer_size = g_value_get_uint (value);
+      break;
+    case PROP_MOOV_RECOV_FLUSH_INTERVAL:
+      qtmux->moov_recov_flush_interval = g_value_get_uint64 (value);
+      break;
+    case PROP_MOOV_RECOV_SYNC:
+      qtmux->moov_recov_sync = g_value_get_boolean (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -108,6 +108,12 @@ struct _GstQTPad
   GstBuffer *last_buf;
   /* dts of last_buf */
   GstClockTime last_dts;
+  /* the last two buffer times converted to the trak timescale, as each
+   * sample converts the times of the previous one again */
+  guint32 scaled_timescale;
+  GstClockTime scaled_ts[2];
+  gint64 scaled_ts_value[2];
+  guint scaled_ts_next;
 
   /* store the first timestamp for comparing with other streams and
    * know if there are late streams */
@@ -125,6 +131,10 @@ struct _GstQTPad
   ATOM_ARRAY (GstBuffer *) fragment_buffers;
   /* running fragment duration */
   gint64 fragment_duration;
+  /* running chunk duration, in chunked mode */
+  gint64 chunk_duration;
+  /* the current traf is the first chunk of a fragment */
+  gboolean fragment_start;
   /* optional fragment index book-keeping */
   AtomTFRA *tfra;
 
@@ -148,7 +158,8 @@ typedef enum _GstQtMuxMode {
     GST_QT_MUX_MODE_MOOV_AT_END,
     GST_QT_MUX_MODE_FRAGMENTED,
     GST_QT_MUX_MODE_FRAGMENTED_STREAMABLE,
-    GST_QT_MUX_MODE_FAST_START
+    GST_QT_MUX_MODE_FAST_START,
+    GST_QT_MUX_MODE_ROBUST_RECORDING
 } GstQtMuxMode;
 
 struct _GstQTMux
@@ -189,8 +200,20 @@ struct _GstQTMux
   /* fast start */
   FILE *fast_start_file;
 
+  /* robust recording: position and size of the space reserved for moov */
+  guint64 reserved_moov_pos;
+  guint32 reserved_moov_size;
+  /* running time of the last in-place moov update */
+  GstClockTime last_moov_update;
+  /* moov outgrew the reserved space, no more in-place updates */
+  gboolean reserved_moov_overflow;
+
   /* moov recovery */
   FILE *moov_recov_file;
+  /* stdio buffer of moov_recov_file, records are batched in it */
+  guint8 *moov_recov_buffer;
+  /* running time of the last recovery file flush */
+  GstClockTime last_moov_recov_flush;
 
   /* fragment sequence */
   guint32 fragment_sequence;
@@ -205,8 +228,16 @@ struct _GstQTMux
   gint dts_method;
 #endif
   gchar *fast_start_file_path;
+  guint fast_start_buffer_size;
   gchar *moov_recov_file_path;
+  guint moov_recov_buffer_size;
+  GstClockTime moov_recov_flush_interval;
+  gboolean moov_recov_sync;
   guint32 fragment_duration;
+  guint32 chunk_duration;
+  GstClockTime reserved_max_duration;
+  guint reserved_bytes_per_sec_per_trak;
+  GstClockTime reserved_moov_update_period;
   /* Whether or not to work in 'streamable' mode and not
    * seek to rewrite headers - only valid for fragmented
    * mode. */
@@ -86,6 +86,9 @@
 /* if the sample index is larger than this, something is likely wrong */
 #define QTDEMUX_MAX_SAMPLE_INDEX_SIZE (50*1024*1024)
 
+/* the sample tables are expanded in chunks of this many samples */
+#define QTDEMUX_SAMPLE_CHUNK_SIZE 4096
+
 /* For converting qt creation times to unix epoch times */
 #define QTDEMUX_SECONDS_PER_DAY (60 * 60 * 24)
 #define QTDEMUX_LEAP_YEARS_FROM_1904_TO_1970 17
@@ -94,11 +97,22 @@
 
 #define STREAM_IS_EOS(s) (s->time_position == GST_CLOCK_TIME_NONE)
 
+#define DEFAULT_PREFETCH_SAMPLES FALSE
+#define DEFAULT_MAX_INDEX_MEMORY 0
+
+enum
+{
+  PROP_0,
+  PROP_PREFETCH_SAMPLES,
+  PROP_MAX_INDEX_MEMORY
+};
+
 GST_DEBUG_CATEGORY (qtdemux_debug);
 
 /*typedef struct _QtNode QtNode; */
 typedef struct _QtDemuxSegment QtDemuxSegment;
 typedef struct _QtDemuxSample QtDemuxSample;
+typedef struct _QtDemuxTimeRun QtDemuxTimeRun;
 
 /*struct _QtNode
 {
@@ -107,14 +121,24 @@ typedef struct _QtDemuxSample QtDemuxSample;
   gint len;
 };*/
 
+/* The per sample table only contains what can't be shared between samples.
+ * Timestamps and durations are stored as runs in QtDemuxTimeRun and the
+ * keyframe flags in a bitmap of the stream. */
 struct _QtDemuxSample
 {
   guint32 size;
   gint32 pts_offset;            /* Add this value to timestamp to get the pts */
   guint64 offset;
-  guint64 timestamp;            /* DTS In mov time */
+};
+
+/* a run of consecutive samples with the same duration, like a stts entry */
+struct _QtDemuxTimeRun
+{
+  guint32 first;                /* index of the first sample of the run */
+  guint32 count;                /* number of samples in the run */
+  guint64 timestamp;            /* DTS of the first sample in mov time */
+  gint64 delta;                 /* DTS increment between two samples */
   guint32 duration;             /* In mov time */
-  gboolean keyframe;            /* TRUE when this packet is a keyframe */
 };
 
 /* Macros for converting to/from timescale */
@@ -124,14 +148,18 @@ struct _QtDemuxSample
 #define QTTIME_TO_GSTTIME(qtdemux, value) (gst_util_uint64_scale((value), GST_SECOND, (qtdemux)->timescale))
 #define GSTTIME_TO_QTTIME(qtdemux, value) (gst_util_uint64_scale((value), (qtdemux)->timescale, GST_SECOND))
 
+#define QTSAMPLE_INDEX(stream,sample) ((guint32) ((sample) - (stream)->samples))
+/* DTS and duration in mov time */
+#define QTSAMPLE_TIMESTAMP(stream,sample) (qtdemux_sample_get_timestamp ((stream), QTSAMPLE_INDEX ((stream), (sample))))
+#define QTSAMPLE_DURATION(stream,sample) (qtdemux_sample_get_duration ((stream), QTSAMPLE_INDEX ((stream), (sample))))
 /* timestamp is the DTS */
-#define QTSAMPLE_DTS(stream,sample) (QTSTREAMTIME_TO_GSTTIME((stream), (sample)->timestamp))
+#define QTSAMPLE_DTS(stream,sample) (QTSTREAMTIME_TO_GSTTIME((stream), QTSAMPLE_TIMESTAMP ((stream), (sample))))
 /* timestamp + offset is the PTS */
-#define QTSAMPLE_PTS(stream,sample) (QTSTREAMTIME_TO_GSTTIME((stream), (sample)->timestamp + (sample)->pts_offset))
+#define QTSAMPLE_PTS(stream,sample) (QTSTREAMTIME_TO_GSTTIME((stream), QTSAMPLE_TIMESTAMP ((stream), (sample)) + (sample)->pts_offset))
 /* timestamp + duration - dts is the duration */
-#define QTSAMPLE_DUR_DTS(stream, sample, dts) (QTSTREAMTIME_TO_GSTTIME ((stream), (sample)->timestamp + (sample)->duration) - (dts))
+#define QTSAMPLE_DUR_DTS(stream, sample, dts) (QTSTREAMTIME_TO_GSTTIME ((stream), QTSAMPLE_TIMESTAMP ((stream), (sample)) + QTSAMPLE_DURATION ((stream), (sample))) - (dts))
 
-#define QTSAMPLE_KEYFRAME(stream,sample) ((stream)->all_keyframe || (sample)->keyframe)
+#define QTSAMPLE_KEYFRAME(stream,sample) ((stream)->all_keyframe || qtdemux_stream_is_keyframe ((stream), QTSAMPLE_INDEX ((stream), (sample))))
 
 /*
  * Quicktime has tracks and segments. A track is a continuous piece of
@@ -207,11 +235,14 @@ struct _QtDemuxSegment
 
 #define QTSEGMENT_IS_EMPTY(s) ((s)->media_start == GST_CLOCK_TIME_NONE)
 
-/* Used with fragmented MP4 files (mfra atom) */
+/* Used with fragmented MP4 files (mfra atom, or collected from moofs
+ * as they are parsed) */
 typedef struct
 {
   GstClockTime ts;
   guint64 moof_offset;
+  /* fragment starts with a sync sample */
+  gboolean keyframe;
 } QtDemuxRandomAccessEntry;
 
 struct _QtDemuxStream
@@ -247,6 +278,12 @@ struct _QtDemuxStream
   /* our samples */
   guint32 n_samples;
   QtDemuxSample *samples;
+  GArray *time_runs;            /* QtDemuxTimeRun of the parsed samples */
+  QtDemuxTimeRun time_run;      /* copy of the last run that was looked up */
+  guint time_run_index;         /* index of that run in time_runs */
+  gboolean time_runs_shared;    /* the prefetch thread can grow time_runs */
+  GMutex time_runs_lock;        /* protects time_runs while they are shared */
+  guint32 *keyframes;           /* bitmap with a bit set for each keyframe */
   gboolean all_keyframe;        /* TRUE when all samples are keyframes (no stss) */
   guint32 first_duration;       /* duration in timescale of first sample, used for figuring out
                                    the framerate, in timescale units */
@@ -363,10 +400,20 @@ struct _QtDemuxStream
   gboolean stps_present;
   guint32 n_sample_partial_syncs;
   guint32 stps_index;
+  /* fragment index, sorted on moof offset */
   QtDemuxRandomAccessEntry *ra_entries;
   guint n_ra_entries;
-
+  guint n_ra_entries_alloc;
+  /* only every ra_stride-th fragment is kept to respect max-index-memory,
+   * ra_skipped counts the ones left out since the last kept one, up to the
+   * fragment at ra_last_offset */
+  guint ra_stride;
+  guint ra_skipped;
+  guint64 ra_last_offset;
+
+  /* points to pending_seek_entry while a fragment seek is in progress */
   const QtDemuxRandomAccessEntry *pending_seek;
+  QtDemuxRandomAccessEntry pending_seek_entry;
 
   /* ctts */
   gboolean ctts_present;
@@ -385,6 +432,356 @@ struct _QtDemuxStream
   gboolean disabled;
 };
 
+/* the prefetch thread sets the bits of new samples while the streaming
+ * thread reads the bits of parsed samples in the same word, so the words
+ * are only accessed atomically */
+static inline guint32
+qtdemux_stream_get_keyframe_word (QtDemuxStream * stream, guint32 index)
+{
+  return (guint32) g_atomic_int_get ((gint *) & stream->keyframes[index >> 5]);
+}
+
+static inline gboolean
+qtdemux_stream_is_keyframe (QtDemuxStream * stream, guint32 index)
+{
+  return (qtdemux_stream_get_keyframe_word (stream, index) >> (index & 31)) & 1;
+}
+
+static inline void
+qtdemux_stream_set_keyframe (QtDemuxStream * stream, guint32 index,
+    gboolean keyframe)
+{
+  if (keyframe)
+    g_atomic_int_or ((guint *) & stream->keyframes[index >> 5],
+        1u << (index & 31));
+  else
+    g_atomic_int_and ((guint *) & stream->keyframes[index >> 5],
+        ~(1u << (index & 31)));
+}
+
+/* index of the last parsed sample, the prefetch thread advances it under the
+ * object lock */
+static inline gint64
+qtdemux_stream_get_stbl_index (GstQTDemux * qtdemux, QtDemuxStream * stream)
+{
+  gint64 stbl_index;
+
+  if (G_LIKELY (qtdemux->prefetch_thread == NULL))
+    return stream->stbl_index;
+
+  GST_OBJECT_LOCK (qtdemux);
+  stbl_index = stream->stbl_index;
+  GST_OBJECT_UNLOCK (qtdemux);
+
+  return stbl_index;
+}
+
+/* append the times of @count samples starting at @first, extending the last
+ * run when the samples continue it */
+static void
+qtdemux_stream_add_time_run (QtDemuxStream * stream, guint32 first,
+    guint32 count, guint64 timestamp, gint64 delta, guint32 duration)
+{
+  QtDemuxTimeRun *run;
+  gboolean shared;
+  guint len;
+
+  if (count == 0)
+    return;
+
+  shared = stream->time_runs_shared;
+  if (shared)
+    g_mutex_lock (&stream->time_runs_lock);
+  if (stream->time_runs == NULL)
+    stream->time_runs = g_array_new (FALSE, FALSE, sizeof (QtDemuxTimeRun));
+
+  len = stream->time_runs->len;
+  if (len > 0) {
+    run = &g_array_index (stream->time_runs, QtDemuxTimeRun, len - 1);
+    if (run->first + run->count == first && run->delta == delta
+        && run->duration == duration
+        && run->timestamp + run->count * run->delta == timestamp) {
+      run->count += count;
+      goto done;
+    }
+  }
+
+  g_array_set_size (stream->time_runs, len + 1);
+  run = &g_array_index (stream->time_runs, QtDemuxTimeRun, len);
+  run->first = first;
+  run->count = count;
+  run->timestamp = timestamp;
+  run->delta = delta;
+  run->duration = duration;
+
+done:
+  if (shared)
+    g_mutex_unlock (&stream->time_runs_lock);
+}
+
+/* make stream->time_run the run containing sample @index. Runs are only ever
+ * appended or extended at the end, so the copy stays valid for the samples
+ * it covers and sequential lookups need neither a search nor the lock. */
+static gboolean
+qtdemux_stream_find_time_run (QtDemuxStream * stream, guint32 index)
+{
+  const QtDemuxTimeRun *runs;
+  gboolean shared, found = FALSE;
+  guint lo, hi;
+
+  if (G_LIKELY (index - stream->time_run.first < stream->time_run.count))
+    return TRUE;
+
+  shared = stream->time_runs_shared;
+  if (shared)
+    g_mutex_lock (&stream->time_runs_lock);
+
+  if (G_UNLIKELY (stream->time_runs == NULL))
+    goto done;
+
+  runs = (const QtDemuxTimeRun *) stream->time_runs->data;
+  hi = stream->time_runs->len;
+
+  /* samples are mostly looked up in order, try the next run first */
+  lo = stream->time_run_index;
+  if (lo < hi && index >= runs[lo].first) {
+    if (index - runs[lo].first < runs[lo].count) {
+      found = TRUE;
+    } else if (lo + 1 < hi && index >= runs[lo + 1].first
+        && index - runs[lo + 1].first < runs[lo + 1].count) {
+      lo++;
+      found = TRUE;
+    }
+  }
+
+  if (!found) {
+    lo = 0;
+    while (lo < hi) {
+      guint mid = lo + (hi - lo) / 2;
+
+      if (index < runs[mid].first) {
+        hi = mid;
+      } else if (index - runs[mid].first >= runs[mid].count) {
+        lo = mid + 1;
+      } else {
+        lo = mid;
+        found = TRUE;
+        break;
+      }
+    }
+  }
+
+  if (found) {
+    stream->time_run = runs[lo];
+    stream->time_run_index = lo;
+  }
+
+done:
+  if (shared)
+    g_mutex_unlock (&stream->time_runs_lock);
+
+  return found;
+}
+
+static guint64
+qtdemux_sample_get_timestamp (QtDemuxStream * stream, guint32 index)
+{
+  /* samples without time entries have a 0 timestamp and duration */
+  if (G_UNLIKELY (!qtdemux_stream_find_time_run (stream, index)))
+    return 0;
+
+  return stream->time_run.timestamp +
+      (index - stream->time_run.first) * stream->time_run.delta;
+}
+
+static guint32
+qtdemux_sample_get_duration (QtDemuxStream * stream, guint32 index)
+{
+  if (G_UNLIKELY (!qtdemux_stream_find_time_run (stream, index)))
+    return 0;
+
+  return stream->time_run.duration;
+}
+
+/* (re)allocate the sample table and keyframe bitmap of @stream for
+ * @n_samples samples, the first @n_old samples are kept */
+static gboolean
+qtdemux_stream_alloc_samples (QtDemuxStream * stream, guint32 n_old,
+    guint32 n_samples)
+{
+  QtDemuxSample *samples;
+  guint32 *keyframes;
+  guint old_words = (n_old + 31) / 32;
+  guint words = (n_samples + 31) / 32;
+
+  samples = g_try_renew (QtDemuxSample, stream->samples, n_samples);
+  if (samples == NULL)
+    return FALSE;
+  stream->samples = samples;
+  if (n_samples > n_old)
+    memset (samples + n_old, 0, (n_samples - n_old) * sizeof (QtDemuxSample));
+
+  keyframes = g_try_renew (guint32, stream->keyframes, words);
+  if (keyframes == NULL)
+    return FALSE;
+  stream->keyframes = keyframes;
+  if (words > old_words)
+    memset (keyframes + old_words, 0, (words - old_words) * sizeof (guint32));
+
+  return TRUE;
+}
+
+static void
+qtdemux_stream_free_samples (QtDemuxStream * stream)
+{
+  g_free (stream->samples);
+  stream->samples = NULL;
+  g_free (stream->keyframes);
+  stream->keyframes = NULL;
+  if (stream->time_runs) {
+    g_array_free (stream->time_runs, TRUE);
+    stream->time_runs = NULL;
+  }
+  memset (&stream->time_run, 0, sizeof (QtDemuxTimeRun));
+  stream->time_run_index = 0;
+}
+
+/* record that the fragment at @moof_offset starts at @ts, keeping the
+ * fragment index sorted on offset and free of duplicates. Once the index was
+ * thinned out, only every ra_stride-th new fragment is added and the ones
+ * before its end are not added back. Returns TRUE if an entry was added. */
+static gboolean
+qtdemux_stream_add_ra_entry (QtDemuxStream * stream, GstClockTime ts,
+    guint64 moof_offset, gboolean keyframe)
+{
+  QtDemuxRandomAccessEntry *entry;
+  guint lo = 0, hi = stream->n_ra_entries;
+
+  /* fragments are mostly seen in file order, try the end first */
+  if (hi > 0 && stream->ra_entries[hi - 1].moof_offset < moof_offset) {
+    /* fragments left out were counted already when they come by again */
+    if (moof_offset <= stream->ra_last_offset)
+      return FALSE;
+    stream->ra_last_offset = moof_offset;
+    if (stream->ra_stride > 1 && ++stream->ra_skipped < stream->ra_stride)
+      return FALSE;
+    stream->ra_skipped = 0;
+    lo = hi;
+  } else {
+    while (lo < hi) {
+      guint mid = lo + (hi - lo) / 2;
+
+      if (stream->ra_entries[mid].moof_offset < moof_offset)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+    if (lo < stream->n_ra_entries
+        && stream->ra_entries[lo].moof_offset == moof_offset)
+      return FALSE;
+    /* likely one of the fragments dropped when thinning out */
+    if (stream->ra_stride > 1 && lo < stream->n_ra_entries)
+      return FALSE;
+  }
+
+  if (stream->n_ra_entries == stream->n_ra_entries_alloc) {
+    stream->n_ra_entries_alloc = MAX (64, stream->n_ra_entries_alloc * 2);
+    stream->ra_entries = g_renew (QtDemuxRandomAccessEntry,
+        stream->ra_entries, stream->n_ra_entries_alloc);
+  }
+
+  entry = &stream->ra_entries[lo];
+  if (lo < stream->n_ra_entries)
+    memmove (entry + 1, entry,
+        (stream->n_ra_entries - lo) * sizeof (QtDemuxRandomAccessEntry));
+  entry->ts = ts;
+  entry->moof_offset = moof_offset;
+  entry->keyframe = keyframe;
+  stream->n_ra_entries++;
+  stream->ra_last_offset = MAX (stream->ra_last_offset, moof_offset);
+
+  return TRUE;
+}
+
+/* posts the memory taken by the sample tables and fragment indexes of all
+ * streams in an element message */
+static void
+gst_qtdemux_post_index_memory (GstQTDemux * qtdemux)
+{
+  GstStructure *s;
+  guint64 size = 0;
+  guint entries = 0, fragments = 0, stride = 1;
+  gint i;
+
+  for (i = 0; i < qtdemux->n_streams; i++) {
+    QtDemuxStream *stream = qtdemux->streams[i];
+
+    size += (guint64) stream->n_samples * sizeof (QtDemuxSample);
+    size += ((guint64) stream->n_samples + 31) / 32 * sizeof (guint32);
+    g_mutex_lock (&stream->time_runs_lock);
+    if (stream->time_runs)
+      size += (guint64) stream->time_runs->len * sizeof (QtDemuxTimeRun);
+    g_mutex_unlock (&stream->time_runs_lock);
+    size += (guint64) stream->n_ra_entries_alloc *
+        sizeof (QtDemuxRandomAccessEntry);
+    entries += stream->n_samples;
+    fragments += stream->n_ra_entries;
+    stride = MAX (stride, stream->ra_stride);
+  }
+
+  s = gst_structure_new ("index-memory",
+      "bytes", G_TYPE_UINT64, size, "entries", G_TYPE_UINT, entries,
+      "sparse", G_TYPE_BOOLEAN, qtdemux->index_sparse,
+      "fragments", G_TYPE_UINT, fragments,
+      "fragment-stride", G_TYPE_UINT, stride, NULL);
+  gst_element_post_message (GST_ELEMENT_CAST (qtdemux),
+      gst_message_new_element (GST_OBJECT_CAST (qtdemux), s));
+}
+
+/* thins out the fragment index of @stream while the fragment indexes of all
+ * streams take more than max-index-memory, by doubling its stride and only
+ * keeping every other entry, the first one included. New fragments are then
+ * only added at the new stride. Returns TRUE if entries were dropped. */
+static gboolean
+gst_qtdemux_limit_ra_entries (GstQTDemux * qtdemux, QtDemuxStream * stream)
+{
+  gboolean limited = FALSE;
+
+  while (qtdemux->max_index_memory && stream->n_ra_entries > 1) {
+    guint64 size = 0;
+    guint i, n;
+
+    for (i = 0; i < qtdemux->n_streams; i++)
+      size += (guint64) qtdemux->streams[i]->n_ra_entries *
+          sizeof (QtDemuxRandomAccessEntry);
+    if (size <= qtdemux->max_index_memory)
+      break;
+
+    for (i = 0, n = 0; i < stream->n_ra_entries; i += 2)
+      stream->ra_entries[n++] = stream->ra_entries[i];
+
+    /* a dropped last entry was followed by the fragments skipped since */
+    if (!(stream->n_ra_entries & 1))
+      stream->ra_skipped += stream->ra_stride;
+    stream->ra_stride *= 2;
+
+    GST_DEBUG_OBJECT (qtdemux, "fragment index of track %u thinned out from "
+        "%u to %u entries, keeping every %u-th fragment", stream->track_id,
+        stream->n_ra_entries, n, stream->ra_stride);
+    stream->n_ra_entries = n;
+    limited = TRUE;
+  }
+
+  if (limited) {
+    stream->n_ra_entries_alloc = stream->n_ra_entries;
+    stream->ra_entries = g_renew (QtDemuxRandomAccessEntry,
+        stream->ra_entries, stream->n_ra_entries_alloc);
+    qtdemux->index_sparse = TRUE;
+  }
+
+  return limited;
+}
+
 enum QtDemuxState
 {
   QTDEMUX_STATE_INITIAL,        /* Initial state (haven't got the header yet) */
@@ -432,6 +829,10 @@ GST_STATIC_PAD_TEMPLATE ("subtitle_%u",
 G_DEFINE_TYPE (GstQTDemux, gst_qtdemux, GST_TYPE_ELEMENT);
 
 static void gst_qtdemux_dispose (GObject * object);
+static void gst_qtdemux_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec);
+static void gst_qtdemux_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec);
 
 static guint32
 gst_qtdemux_find_index_linear (GstQTDemux * qtdemux, QtDemuxStream * str,
@@ -511,6 +912,39 @@ gst_qtdemux_class_init (GstQTDemuxClass * klass)
   parent_class = g_type_class_peek_parent (klass);
 
   gobject_class->dispose = gst_qtdemux_dispose;
+  gobject_class->set_property = gst_qtdemux_set_property;
+  gobject_class->get_property = gst_qtdemux_get_property;
+
+  /**
+   * GstQTDemux:prefetch-samples:
+   *
+   * In pull mode, expand the sample tables from a background thread ahead
+   * of playback instead of only on demand from the streaming thread.
+   */
+  g_object_class_install_property (gobject_class, PROP_PREFETCH_SAMPLES,
+      g_param_spec_boolean ("prefetch-samples", "Prefetch samples",
+          "Expand the sample tables in a background thread (pull mode only)",
+          DEFAULT_PREFETCH_SAMPLES,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstQTDemux:max-index-memory:
+   *
+   * Limit for the fragment indexes of fragmented files. Beyond it, only
+   * every other fragment is kept, then every fourth one, and so on, for
+   * the fragments already indexed and the ones still to come. The "fragments"
+   * and "fragment-stride" fields of the message tell how many are kept and
+   * how far apart. The sample tables are needed for playback and are never thinned,
+   * but the memory they take is included in the "index-memory" element
+   * message posted when the streams are exposed and when an index is
+   * thinned out.
+   */
+  g_object_class_install_property (gobject_class, PROP_MAX_INDEX_MEMORY,
+      g_param_spec_uint64 ("max-index-memory", "Max index memory",
+          "Maximum memory for the fragment index in bytes, beyond which only "
+          "some fragments are kept (0 = unlimited)", 0, G_MAXUINT64,
+          DEFAULT_MAX_INDEX_MEMORY,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   gstelement_class->change_state = GST_DEBUG_FUNCPTR (gst_qtdemux_change_state);
 #if 0
@@ -571,17 +1005,158 @@ gst_qtdemux_init (GstQTDemux * qtdemux)
   qtdemux->upstream_newsegment = FALSE;
   qtdemux->have_group_id = FALSE;
   qtdemux->group_id = G_MAXUINT;
+  qtdemux->prefetch_samples = DEFAULT_PREFETCH_SAMPLES;
+  qtdemux->max_index_memory = DEFAULT_MAX_INDEX_MEMORY;
   gst_segment_init (&qtdemux->segment, GST_FORMAT_TIME);
   qtdemux->flowcombiner = gst_flow_combiner_new ();
 
   GST_OBJECT_FLAG_SET (qtdemux, GST_ELEMENT_FLAG_INDEXABLE);
 }
 
+static void
+gst_qtdemux_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstQTDemux *qtdemux = GST_QTDEMUX (object);
+
+  switch (prop_id) {
+    case PROP_PREFETCH_SAMPLES:
+      GST_OBJECT_LOCK (qtdemux);
+      qtdemux->prefetch_samples = g_value_get_boolean (value);
+      GST_OBJECT_UNLOCK (qtdemux);
+      break;
+    case PROP_MAX_INDEX_MEMORY:
+      GST_OBJECT_LOCK (qtdemux);
+      qtdemux->max_index_memory = g_value_get_uint64 (value);
+      GST_OBJECT_UNLOCK (qtdemux);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_qtdemux_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstQTDemux *qtdemux = GST_QTDEMUX (object);
+
+  switch (prop_id) {
+    case PROP_PREFETCH_SAMPLES:
+      GST_OBJECT_LOCK (qtdemux);
+      g_value_set_boolean (value, qtdemux->prefetch_samples);
+      GST_OBJECT_UNLOCK (qtdemux);
+      break;
+    case PROP_MAX_INDEX_MEMORY:
+      GST_OBJECT_LOCK (qtdemux);
+      g_value_set_uint64 (value, qtdemux->max_index_memory);
+      GST_OBJECT_UNLOCK (qtdemux);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+/* Expands the sample tables of all streams ahead of playback, one chunk of
+ * each stream at a time. The last sample is left to the streaming thread as
+ * completing a table can pull in more fragments. */
+static gpointer
+gst_qtdemux_prefetch_func (GstQTDemux * qtdemux)
+{
+  gboolean more = TRUE;
+
+  GST_DEBUG_OBJECT (qtdemux, "prefetch thread started");
+
+  while (more && !g_atomic_int_get (&qtdemux->prefetch_stop)) {
+    gint i;
+
+    more = FALSE;
+    for (i = 0;; i++) {
+      QtDemuxStream *stream;
+      gint64 n;
+
+      if (g_atomic_int_get (&qtdemux->prefetch_stop))
+        break;
+
+      GST_OBJECT_LOCK (qtdemux);
+      if (i >= qtdemux->n_streams) {
+        GST_OBJECT_UNLOCK (qtdemux);
+        break;
+      }
+      stream = qtdemux->streams[i];
+      n = stream->stbl_index + 1;
+      if (n + 1 >= stream->n_samples)
+        n = -1;
+      GST_OBJECT_UNLOCK (qtdemux);
+
+      if (n >= 0 && qtdemux_parse_samples (qtdemux, stream, n))
+        more = TRUE;
+    }
+    /* let the streaming thread at the sample tables */
+    g_thread_yield ();
+  }
+
+  GST_DEBUG_OBJECT (qtdemux, "prefetch thread stopped");
+
+  return NULL;
+}
+
+/* the time runs only need their lock while the prefetch thread runs */
+static void
+gst_qtdemux_set_time_runs_shared (GstQTDemux * qtdemux, gboolean shared)
+{
+  gint i;
+
+  for (i = 0; i < qtdemux->n_streams; i++)
+    qtdemux->streams[i]->time_runs_shared = shared;
+}
+
+static void
+gst_qtdemux_start_prefetch (GstQTDemux * qtdemux)
+{
+  GError *err = NULL;
+  gboolean prefetch;
+
+  GST_OBJECT_LOCK (qtdemux);
+  prefetch = qtdemux->prefetch_samples;
+  GST_OBJECT_UNLOCK (qtdemux);
+
+  if (!prefetch || !qtdemux->pullbased || qtdemux->prefetch_thread)
+    return;
+
+  gst_qtdemux_set_time_runs_shared (qtdemux, TRUE);
+  g_atomic_int_set (&qtdemux->prefetch_stop, FALSE);
+  qtdemux->prefetch_thread = g_thread_try_new ("qtdemux-prefetch",
+      (GThreadFunc) gst_qtdemux_prefetch_func, qtdemux, &err);
+  if (qtdemux->prefetch_thread == NULL) {
+    GST_WARNING_OBJECT (qtdemux, "could not start prefetch thread: %s",
+        err->message);
+    g_clear_error (&err);
+    gst_qtdemux_set_time_runs_shared (qtdemux, FALSE);
+  }
+}
+
+static void
+gst_qtdemux_stop_prefetch (GstQTDemux * qtdemux)
+{
+  if (qtdemux->prefetch_thread == NULL)
+    return;
+
+  g_atomic_int_set (&qtdemux->prefetch_stop, TRUE);
+  g_thread_join (qtdemux->prefetch_thread);
+  qtdemux->prefetch_thread = NULL;
+  gst_qtdemux_set_time_runs_shared (qtdemux, FALSE);
+}
+
 static void
 gst_qtdemux_dispose (GObject * object)
 {
   GstQTDemux *qtdemux = GST_QTDEMUX (object);
 
+  gst_qtdemux_stop_prefetch (qtdemux);
+
   if (qtdemux->adapter) {
     g_object_unref (G_OBJECT (qtdemux->adapter));
     qtdemux->adapter = NULL;
@@ -717,7 +1292,7 @@ gst_qtdemux_src_convert (GstPad * pad, GstFormat src_format, gint64 src_value,
 
           *dest_value =
               QTSTREAMTIME_TO_GSTTIME (stream,
-              stream->samples[index].timestamp);
+              qtdemux_sample_get_timestamp (stream, index));
           GST_DEBUG_OBJECT (qtdemux,
               "Format Conversion Offset->Time :%" G_GUINT64_FORMAT "->%"
               GST_TIME_FORMAT, src_value, GST_TIME_ARGS (*dest_value));
@@ -949,9 +1524,9 @@ typedef struct
 } FindData;
 
 static gint
-find_func (QtDemuxSample * s1, guint64 * media_time, gpointer user_data)
+find_func (QtDemuxSample * s1, guint64 * media_time, QtDemuxStream * str)
 {
-  if (s1->timestamp + s1->pts_offset > *media_time)
+  if (QTSAMPLE_TIMESTAMP (str, s1) + s1->pts_offset > *media_time)
     return 1;
 
   return -1;
@@ -973,9 +1548,10 @@ gst_qtdemux_find_index (GstQTDemux * qtdemux, QtDemuxStream * str,
   media_time =
       gst_util_uint64_scale_ceil (media_time, str->timescale, GST_SECOND);
 
-  result = gst_util_array_binary_search (str->samples, str->stbl_index + 1,
+  result = gst_util_array_binary_search (str->samples,
+      qtdemux_stream_get_stbl_index (qtdemux, str) + 1,
       sizeof (QtDemuxSample), (GCompareDataFunc) find_func,
-      GST_SEARCH_MODE_BEFORE, &media_time, NULL);
+      GST_SEARCH_MODE_BEFORE, &media_time, str);
 
   if (G_LIKELY (result))
     index = result - str->samples;
@@ -1026,9 +1602,9 @@ parse_failed:
   }
 }
 
-/* find the index of the sample that includes the data for @media_time using a
- * linear search, and keeping in mind that not all samples may have been parsed
- * yet.  If possible, it will delegate to binary search.
+/* find the index of the sample that includes the data for @media_time,
+ * keeping in mind that not all samples may have been parsed yet. The table is
+ * expanded chunk by chunk and searched with a binary search.
  *
  * Returns the index of the sample.
  */
@@ -1045,31 +1621,30 @@ gst_qtdemux_find_index_linear (GstQTDemux * qtdemux, QtDemuxStream * str,
       gst_util_uint64_scale_ceil (media_time, str->timescale, GST_SECOND);
 
   sample = str->samples;
-  if (mov_time == sample->timestamp + sample->pts_offset)
+  if (mov_time == QTSAMPLE_TIMESTAMP (str, sample) + sample->pts_offset)
     return index;
 
-  /* use faster search if requested time in already parsed range */
-  sample = str->samples + str->stbl_index;
-  if (str->stbl_index >= 0 &&
-      mov_time <= (sample->timestamp + sample->pts_offset))
-    return gst_qtdemux_find_index (qtdemux, str, media_time);
-
-  while (index < str->n_samples - 1) {
-    if (!qtdemux_parse_samples (qtdemux, str, index + 1))
-      goto parse_failed;
+  /* expand the table chunk by chunk until it covers the requested time and
+   * then do a binary search in the parsed range */
+  while (TRUE) {
+    gint64 stbl_index = qtdemux_stream_get_stbl_index (qtdemux, str);
 
-    sample = str->samples + index + 1;
-    if (mov_time < (sample->timestamp + sample->pts_offset))
-      break;
+    if (stbl_index >= 0) {
+      sample = str->samples + stbl_index;
+      if (mov_time <= (QTSAMPLE_TIMESTAMP (str, sample) + sample->pts_offset)
+          || stbl_index + 1 >= str->n_samples)
+        return gst_qtdemux_find_index (qtdemux, str, media_time);
+    }
 
-    index++;
+    index = stbl_index + 1;
+    if (!qtdemux_parse_samples (qtdemux, str, index))
+      goto parse_failed;
   }
-  return index;
 
   /* ERRORS */
 parse_failed:
   {
-    GST_LOG_OBJECT (qtdemux, "Parsing of index %u failed!", index + 1);
+    GST_LOG_OBJECT (qtdemux, "Parsing of index %u failed!", index);
     return -1;
   }
 }
@@ -1096,15 +1671,24 @@ gst_qtdemux_find_keyframe (GstQTDemux * qtdemux, QtDemuxStream * str,
     goto beach;
   }
 
-  /* else go back until we have a keyframe */
+  /* else go back until we have a keyframe, this only looks at the keyframe
+   * bitmap so it skips 32 samples at a time */
   while (TRUE) {
-    if (str->samples[new_index].keyframe)
+    guint32 word = qtdemux_stream_get_keyframe_word (str, new_index);
+
+    /* ignore the samples after new_index */
+    word &= G_MAXUINT32 >> (31 - (new_index & 31));
+    if (word) {
+      new_index = (new_index & ~31u) + g_bit_nth_msf (word, -1);
       break;
+    }
 
-    if (new_index == 0)
+    if (new_index < 32) {
+      new_index = 0;
       break;
+    }
 
-    new_index--;
+    new_index = (new_index & ~31u) - 1;
   }
 
 beach:
@@ -1259,6 +1843,104 @@ gst_qtdemux_adjust_seek (GstQTDemux * qtdemux, gint64 desired_time,
     *key_offset = min_byte_offset;
 }
 
+static gint
+qtdemux_ra_entry_compare_ts (const QtDemuxRandomAccessEntry * entry,
+    const GstClockTime * ts, gpointer user_data)
+{
+  if (entry->ts < *ts)
+    return -1;
+  else if (entry->ts > *ts)
+    return 1;
+  return 0;
+}
+
+/* find the fragment of @stream to restart from for @pos: the last fragment
+ * starting with a keyframe at or before @pos, or with @after the first
+ * fragment starting after @pos. The index is sorted on offset, and later
+ * fragments start later, so it can be searched on time. */
+static const QtDemuxRandomAccessEntry *
+gst_qtdemux_stream_seek_fragment (GstQTDemux * qtdemux, QtDemuxStream * stream,
+    GstClockTime pos, gboolean after)
+{
+  const QtDemuxRandomAccessEntry *entries = stream->ra_entries;
+  const QtDemuxRandomAccessEntry *entry;
+  guint i, n = stream->n_ra_entries;
+
+  g_assert (n > 0);
+
+  entry = gst_util_array_binary_search ((gpointer) entries, n,
+      sizeof (QtDemuxRandomAccessEntry),
+      (GCompareDataFunc) qtdemux_ra_entry_compare_ts,
+      after ? GST_SEARCH_MODE_AFTER : GST_SEARCH_MODE_BEFORE, &pos, NULL);
+
+  if (after) {
+    /* nothing after @pos, use the last fragment */
+    if (entry == NULL)
+      return &entries[n - 1];
+    i = entry - entries;
+    while (i < n - 1 && entries[i].ts <= pos)
+      i++;
+  } else {
+    /* nothing before @pos, start from the first one */
+    if (entry == NULL)
+      return &entries[0];
+    /* decoding has to start from a fragment that begins with a keyframe */
+    i = entry - entries;
+    while (i > 0 && !entries[i].keyframe)
+      i--;
+  }
+
+  return &entries[i];
+}
+
+/* find the fragment to restart from when seeking to @desired_time, using
+ * the fragment index collected so far. The entry of every stream is stored
+ * for when parsing restarts at the returned offset */
+static gboolean
+gst_qtdemux_adjust_fragmented_seek (GstQTDemux * qtdemux, gint64 desired_time,
+    gint64 * key_time, gint64 * key_offset)
+{
+  gint64 min_time = -1;
+  gint64 min_byte_offset = -1;
+  gint n;
+
+  for (n = 0; n < qtdemux->n_streams; n++) {
+    QtDemuxStream *str = qtdemux->streams[n];
+    const QtDemuxRandomAccessEntry *entry;
+    gboolean is_audio_or_video;
+
+    if (str->n_ra_entries == 0)
+      continue;
+
+    is_audio_or_video = (str->subtype == FOURCC_vide
+        || str->subtype == FOURCC_soun);
+
+    entry = gst_qtdemux_stream_seek_fragment (qtdemux, str, desired_time,
+        !is_audio_or_video);
+    str->pending_seek_entry = *entry;
+
+    GST_DEBUG_OBJECT (qtdemux, "track %u: fragment at %" GST_TIME_FORMAT
+        " at offset %" G_GUINT64_FORMAT, str->track_id,
+        GST_TIME_ARGS (entry->ts), entry->moof_offset);
+
+    /* only audio and video decide where to restart, not subtitles */
+    if (!is_audio_or_video)
+      continue;
+
+    if (min_byte_offset < 0 || entry->moof_offset < min_byte_offset) {
+      min_byte_offset = entry->moof_offset;
+      min_time = entry->ts;
+    }
+  }
+
+  if (key_time)
+    *key_time = min_time;
+  if (key_offset)
+    *key_offset = min_byte_offset;
+
+  return min_byte_offset >= 0;
+}
+
 static gboolean
 gst_qtdemux_convert_seek (GstPad * pad, GstFormat * format,
     GstSeekType cur_type, gint64 * cur, GstSeekType stop_type, gint64 * stop)
@@ -1324,7 +2006,14 @@ gst_qtdemux_do_push_seek (GstQTDemux * qtdemux, GstPad * pad, GstEvent * event)
   /* find reasonable corresponding BYTE position,
    * also try to mind about keyframes, since we can not go back a bit for them
    * later on */
-  gst_qtdemux_adjust_seek (qtdemux, cur, FALSE, &key_cur, &byte_cur);
+  if (qtdemux->fragmented) {
+    /* restart at the start of a fragment, parsing resumes from its moof */
+    if (!gst_qtdemux_adjust_fragmented_seek (qtdemux, cur, &key_cur,
+            &byte_cur))
+      goto abort_seek;
+  } else {
+    gst_qtdemux_adjust_seek (qtdemux, cur, FALSE, &key_cur, &byte_cur);
+  }
 
   if (byte_cur == -1)
     goto abort_seek;
@@ -1335,6 +2024,7 @@ gst_qtdemux_do_push_seek (GstQTDemux * qtdemux, GstPad * pad, GstEvent * event)
 
   GST_OBJECT_LOCK (qtdemux);
   qtdemux->seek_offset = byte_cur;
+  qtdemux->fragmented_seek_pending = qtdemux->fragmented;
   if (!(flags & GST_SEEK_FLAG_KEY_UNIT)) {
     qtdemux->push_seek_start = cur;
   } else {
@@ -1610,8 +2300,8 @@ gst_qtdemux_handle_src_event (GstPad * pad, GstObject * parent,
       } else if (gst_pad_push_event (qtdemux->sinkpad, gst_event_ref (event))) {
         GST_DEBUG_OBJECT (qtdemux, "Upstream successfully seeked");
         res = TRUE;
-      } else if (qtdemux->state == QTDEMUX_STATE_MOVIE && qtdemux->n_streams
-          && !qtdemux->fragmented) {
+      } else if ((qtdemux->state == QTDEMUX_STATE_MOVIE
+              || qtdemux->fragmented) && qtdemux->n_streams) {
         res = gst_qtdemux_do_push_seek (qtdemux, pad, event);
       } else {
         GST_DEBUG_OBJECT (qtdemux,
@@ -1730,6 +2420,7 @@ _create_stream (void)
   QtDemuxStream *stream;
 
   stream = g_new0 (QtDemuxStream, 1);
+  g_mutex_init (&stream->time_runs_lock);
   /* new streams always need a discont */
   stream->discont = TRUE;
   /* we enable clipping for raw audio/video streams */
@@ -1740,6 +2431,7 @@ _create_stream (void)
   stream->sample_index = -1;
   stream->offset_in_sample = 0;
   stream->new_stream = TRUE;
+  stream->ra_stride = 1;
   return stream;
 }
 
@@ -1829,6 +2521,7 @@ gst_qtdemux_reset (GstQTDemux * qtdemux, gboolean hard)
 
   GST_DEBUG_OBJECT (qtdemux, "Resetting demux");
   gst_pad_stop_task (qtdemux->sinkpad);
+  gst_qtdemux_stop_prefetch (qtdemux);
 
   if (hard || qtdemux->upstream_newsegment) {
     qtdemux->state = QTDEMUX_STATE_INITIAL;
@@ -1878,6 +2571,7 @@ gst_qtdemux_reset (GstQTDemux * qtdemux, gboolean hard)
     qtdemux->chapters_track_id = 0;
     qtdemux->have_group_id = FALSE;
     qtdemux->group_id = G_MAXUINT;
+    qtdemux->index_sparse = FALSE;
   }
   qtdemux->offset = 0;
   gst_adapter_clear (qtdemux->adapter);
@@ -1929,6 +2623,7 @@ gst_qtdemux_handle_sink_event (GstPad * sinkpad, GstObject * parent,
       gint idx;
       GstSegment segment;
       GstEvent *segment_event;
+      gboolean fragment_seek = FALSE, seek_answer;
 
       /* some debug output */
       gst_event_copy_segment (event, &segment);
@@ -1942,12 +2637,6 @@ gst_qtdemux_handle_sink_event (GstPad * sinkpad, GstObject * parent,
       } else {
         GST_DEBUG_OBJECT (demux, "Not storing upstream newsegment, "
             "not in time format");
-
-        /* chain will send initial newsegment after pads have been added */
-        if (demux->state != QTDEMUX_STATE_MOVIE || !demux->n_streams) {
-          GST_DEBUG_OBJECT (demux, "still starting, eating event");
-          goto exit;
-        }
       }
 
       /* check if this matches a time seek we received previously
@@ -1958,14 +2647,28 @@ gst_qtdemux_handle_sink_event (GstPad * sinkpad, GstObject * parent,
       GST_DEBUG_OBJECT (demux, "Stored seek offset: %" G_GINT64_FORMAT
           ", received segment offset %" G_GINT64_FORMAT,
           demux->seek_offset, segment.start);
-      if (segment.format == GST_FORMAT_BYTES
-          && demux->seek_offset == segment.start) {
+      seek_answer = segment.format == GST_FORMAT_BYTES
+          && demux->seek_offset == segment.start;
+
+      /* chain will send initial newsegment after pads have been added. The
+       * answer to a fragmented seek can arrive while parsing a moof, it is
+       * handled whatever the state */
+      if (segment.format != GST_FORMAT_TIME &&
+          !(seek_answer && demux->fragmented_seek_pending) &&
+          (demux->state != QTDEMUX_STATE_MOVIE || !demux->n_streams)) {
+        GST_DEBUG_OBJECT (demux, "still starting, eating event");
+        goto exit;
+      }
+
+      if (seek_answer) {
         GST_OBJECT_LOCK (demux);
         offset = segment.start;
 
         segment.format = GST_FORMAT_TIME;
         segment.start = demux->push_seek_start;
         segment.stop = demux->push_seek_stop;
+        fragment_seek = demux->fragmented_seek_pending;
+        demux->fragmented_seek_pending = FALSE;
         GST_DEBUG_OBJECT (demux, "Replaced segment with stored seek "
             "segment %" GST_TIME_FORMAT " - %" GST_TIME_FORMAT,
             GST_TIME_ARGS (segment.start), GST_TIME_ARGS (segment.stop));
@@ -2020,6 +2723,33 @@ gst_qtdemux_handle_sink_event (GstPad * sinkpad, GstObject * parent,
 
       /* clear leftover in current segment, if any */
       gst_adapter_clear (demux->adapter);
+
+      if (fragment_seek) {
+        gint n;
+
+        /* upstream restarts at a moof, parse the fragments from there
+         * on as if they were the first ones */
+        gst_qtdemux_stop_prefetch (demux);
+        for (n = 0; n < demux->n_streams; n++) {
+          stream = demux->streams[n];
+
+          qtdemux_stream_free_samples (stream);
+          stream->n_samples = 0;
+          stream->stbl_index = -1;
+          stream->sample_index = -1;
+          if (stream->n_ra_entries > 0)
+            stream->pending_seek = &stream->pending_seek_entry;
+        }
+        demux->state = QTDEMUX_STATE_INITIAL;
+        demux->offset = offset;
+        demux->neededbytes = 16;
+        demux->todrop = 0;
+        demux->mdatleft = 0;
+        demux->fragment_start = -1;
+        demux->fragment_start_offset = -1;
+        goto exit;
+      }
+
       /* set up streaming thread */
       gst_qtdemux_find_sample (demux, offset, TRUE, TRUE, &stream, &idx, NULL);
       demux->offset = offset;
@@ -2153,8 +2883,9 @@ static void
 gst_qtdemux_stream_flush_samples_data (GstQTDemux * qtdemux,
     QtDemuxStream * stream)
 {
-  g_free (stream->samples);
-  stream->samples = NULL;
+  gst_qtdemux_stop_prefetch (qtdemux);
+
+  qtdemux_stream_free_samples (stream);
   g_free (stream->segments);
   stream->segments = NULL;
   gst_qtdemux_stbl_free (stream);
@@ -2163,6 +2894,11 @@ gst_qtdemux_stream_flush_samples_data (GstQTDemux * qtdemux,
   g_free (stream->ra_entries);
   stream->ra_entries = NULL;
   stream->n_ra_entries = 0;
+  stream->n_ra_entries_alloc = 0;
+  stream->ra_stride = 1;
+  stream->ra_skipped = 0;
+  stream->ra_last_offset = 0;
+  stream->pending_seek = NULL;
 
   stream->sample_index = -1;
   stream->stbl_index = -1;
@@ -2207,6 +2943,7 @@ gst_qtdemux_stream_free (GstQTDemux * qtdemux, QtDemuxStream * stream)
     gst_element_remove_pad (GST_ELEMENT_CAST (qtdemux), stream->pad);
     gst_flow_combiner_remove_pad (qtdemux->flowcombiner, stream->pad);
   }
+  g_mutex_clear (&stream->time_runs_lock);
   g_free (stream);
 }
 
@@ -2215,6 +2952,8 @@ gst_qtdemux_remove_stream (GstQTDemux * qtdemux, int i)
 {
   g_assert (i >= 0 && i < qtdemux->n_streams && qtdemux->streams[i] != NULL);
 
+  gst_qtdemux_stop_prefetch (qtdemux);
+
   gst_qtdemux_stream_free (qtdemux, qtdemux->streams[i]);
   qtdemux->streams[i] = qtdemux->streams[qtdemux->n_streams - 1];
   qtdemux->streams[qtdemux->n_streams - 1] = NULL;
@@ -2661,14 +3400,10 @@ qtdemux_parse_trun (GstQTDemux * qtdemux, GstByteReader * trun,
       stream->n_samples, (guint) sizeof (QtDemuxSample),
       stream->n_samples * sizeof (QtDemuxSample) / (1024.0 * 1024.0));
 
-  /* create a new array of samples if it's the first sample parsed */
-  if (stream->n_samples == 0)
-    stream->samples = g_try_new0 (QtDemuxSample, samples_count);
-  /* or try to reallocate it with space enough to insert the new samples */
-  else
-    stream->samples = g_try_renew (QtDemuxSample, stream->samples,
-        stream->n_samples + samples_count);
-  if (stream->samples == NULL)
+  /* create a new array of samples if it's the first sample parsed or
+   * try to reallocate it with space enough to insert the new samples */
+  if (!qtdemux_stream_alloc_samples (stream, stream->n_samples,
+          stream->n_samples + samples_count))
     goto out_of_memory;
 
   if (qtdemux->fragment_start != -1) {
@@ -2698,8 +3433,8 @@ qtdemux_parse_trun (GstQTDemux * qtdemux, GstByteReader * trun,
     } else {
       /* subsequent fragments extend stream */
       timestamp =
-          stream->samples[stream->n_samples - 1].timestamp +
-          stream->samples[stream->n_samples - 1].duration;
+          qtdemux_sample_get_timestamp (stream, stream->n_samples - 1) +
+          qtdemux_sample_get_duration (stream, stream->n_samples - 1);
 
       gst_ts = QTSTREAMTIME_TO_GSTTIME (stream, timestamp);
       GST_INFO_OBJECT (qtdemux, "first sample ts %" GST_TIME_FORMAT
@@ -2707,6 +3442,8 @@ qtdemux_parse_trun (GstQTDemux * qtdemux, GstByteReader * trun,
     }
   }
 
+  gst_ts = QTSTREAMTIME_TO_GSTTIME (stream, timestamp);
+
   sample = stream->samples + stream->n_samples;
   for (i = 0; i < samples_count; i++) {
     guint32 dur, size, sflags, ct;
@@ -2744,12 +3481,13 @@ qtdemux_parse_trun (GstQTDemux * qtdemux, GstByteReader * trun,
     sample->offset = *running_offset;
     sample->pts_offset = ct;
     sample->size = size;
-    sample->timestamp = timestamp;
-    sample->duration = dur;
+    qtdemux_stream_add_time_run (stream, stream->n_samples + i, 1, timestamp,
+        dur, dur);
     /* sample-is-difference-sample */
     /* ismv seems to use 0x40 for keyframe, 0xc0 for non-keyframe,
      * now idea how it relates to bitfield other than massive LE/BE confusion */
-    sample->keyframe = ismv ? ((sflags & 0xff) == 0x40) : !(sflags & 0x10000);
+    qtdemux_stream_set_keyframe (stream, stream->n_samples + i,
+        ismv ? ((sflags & 0xff) == 0x40) : !(sflags & 0x10000));
     *running_offset += size;
     timestamp += dur;
     sample++;
@@ -2758,6 +3496,14 @@ qtdemux_parse_trun (GstQTDemux * qtdemux, GstByteReader * trun,
   /* Update total duration if needed */
   check_update_duration (qtdemux, QTSTREAMTIME_TO_GSTTIME (stream, timestamp));
 
+  /* remember where this fragment starts, so later seeks can jump to it */
+  if (samples_count > 0 && qtdemux_stream_add_ra_entry (stream, gst_ts,
+          moof_offset, stream->all_keyframe
+          || qtdemux_stream_is_keyframe (stream, stream->n_samples))) {
+    if (gst_qtdemux_limit_ra_entries (qtdemux, stream))
+      gst_qtdemux_post_index_memory (qtdemux);
+  }
+
   stream->n_samples += samples_count;
 
   if (stream->pending_seek != NULL)
@@ -3098,9 +3844,16 @@ qtdemux_parse_tfra (GstQTDemux * qtdemux, GNode * tfra_node)
           value_size + value_size + traf_size + trun_size + sample_size))
     goto corrupt_file;
 
-  g_free (stream->ra_entries);
-  stream->ra_entries = g_new (QtDemuxRandomAccessEntry, num_entries);
-  stream->n_ra_entries = num_entries;
+  /* the mfra index is authoritative, drop what was collected so far */
+  stream->n_ra_entries = 0;
+  stream->ra_stride = 1;
+  stream->ra_skipped = 0;
+  stream->ra_last_offset = 0;
+  if (stream->n_ra_entries_alloc < num_entries) {
+    g_free (stream->ra_entries);
+    stream->ra_entries = g_new (QtDemuxRandomAccessEntry, num_entries);
+    stream->n_ra_entries_alloc = num_entries;
+  }
 
   for (i = 0; i < num_entries; i++) {
     qt_atom_parser_get_offset (&tfra, value_size, &time);
@@ -3114,8 +3867,8 @@ qtdemux_parse_tfra (GstQTDemux * qtdemux, GNode * tfra_node)
     GST_LOG_OBJECT (qtdemux, "fragment time: %" GST_TIME_FORMAT ", "
         " moof_offset: %" G_GUINT64_FORMAT, GST_TIME_ARGS (time), moof_offset);
 
-    stream->ra_entries[i].ts = time;
-    stream->ra_entries[i].moof_offset = moof_offset;
+    /* tfra only lists random access samples */
+    qtdemux_stream_add_ra_entry (stream, time, moof_offset, TRUE);
 
     /* don't want to go through the entire file and read all moofs at startup */
 #if 0
@@ -3128,6 +3881,9 @@ qtdemux_parse_tfra (GstQTDemux * qtdemux, GNode * tfra_node)
 #endif
   }
 
+  if (gst_qtdemux_limit_ra_entries (qtdemux, stream))
+    gst_qtdemux_post_index_memory (qtdemux);
+
   check_update_duration (qtdemux, time);
 
   return TRUE;
@@ -3448,6 +4204,7 @@ beach:
     /* digested all data, show what we have */
     qtdemux_prepare_streams (qtdemux);
     ret = qtdemux_expose_streams (qtdemux);
+    gst_qtdemux_start_prefetch (qtdemux);
 
     qtdemux->state = QTDEMUX_STATE_MOVIE;
     GST_DEBUG_OBJECT (qtdemux, "switching state to STATE_MOVIE (%d)",
@@ -3516,7 +4273,7 @@ gst_qtdemux_seek_to_previous_keyframe (GstQTDemux * qtdemux)
   }
 
   target_ts =
-      ref_str->samples[k_index].timestamp +
+      qtdemux_sample_get_timestamp (ref_str, k_index) +
       ref_str->samples[k_index].pts_offset;
 
   /* get current segment for that stream */
@@ -3551,7 +4308,7 @@ gst_qtdemux_seek_to_previous_keyframe (GstQTDemux * qtdemux)
       target_ts - seg->trak_media_start) + seg->time;
   last_stop =
       QTSTREAMTIME_TO_GSTTIME (ref_str,
-      ref_str->samples[ref_str->from_sample].timestamp -
+      qtdemux_sample_get_timestamp (ref_str, ref_str->from_sample) -
       seg->trak_media_start) + seg->time;
 
   GST_DEBUG_OBJECT (qtdemux, "preferred stream played from sample %u, "
@@ -3615,7 +4372,8 @@ gst_qtdemux_seek_to_previous_keyframe (GstQTDemux * qtdemux)
     str->to_sample = str->from_sample - 1;
     /* Define our time position */
     target_ts =
-        str->samples[k_index].timestamp + str->samples[k_index].pts_offset;
+        qtdemux_sample_get_timestamp (str, k_index) +
+        str->samples[k_index].pts_offset;
     str->time_position = QTSTREAMTIME_TO_GSTTIME (str, target_ts) + seg->time;
     if (seg->media_start != GST_CLOCK_TIME_NONE)
       str->time_position -= seg->media_start;
@@ -4421,37 +5179,16 @@ exit:
   return ret;
 }
 
-static const QtDemuxRandomAccessEntry *
-gst_qtdemux_stream_seek_fragment (GstQTDemux * qtdemux, QtDemuxStream * stream,
-    GstClockTime pos, gboolean after)
-{
-  QtDemuxRandomAccessEntry *entries = stream->ra_entries;
-  guint n_entries = stream->n_ra_entries;
-  guint i;
-
-  /* we assume the table is sorted */
-  for (i = 0; i < n_entries; ++i) {
-    if (entries[i].ts > pos)
-      break;
-  }
-
-  /* FIXME: maybe save first moof_offset somewhere instead, but for now it's
-   * probably okay to assume that the index lists the very first fragment */
-  if (i == 0)
-    return &entries[0];
-
-  if (after)
-    return &entries[i];
-  else
-    return &entries[i - 1];
-}
-
 static gboolean
 gst_qtdemux_do_fragmented_seek (GstQTDemux * qtdemux)
 {
   const QtDemuxRandomAccessEntry *best_entry = NULL;
   guint i;
 
+  /* the sample tables are thrown away, the prefetch thread must not be
+   * working on them */
+  gst_qtdemux_stop_prefetch (qtdemux);
+
   GST_OBJECT_LOCK (qtdemux);
 
   g_assert (qtdemux->n_streams > 0);
@@ -4463,13 +5200,12 @@ gst_qtdemux_do_fragmented_seek (GstQTDemux * qtdemux)
 
     stream = qtdemux->streams[i];
 
-    g_free (stream->samples);
-    stream->samples = NULL;
+    qtdemux_stream_free_samples (stream);
     stream->n_samples = 0;
     stream->stbl_index = -1;    /* no samples have yet been parsed */
     stream->sample_index = -1;
 
-    if (stream->ra_entries == NULL)
+    if (stream->n_ra_entries == 0)
       continue;
 
     if (stream->subtype == FOURCC_vide || stream->subtype == FOURCC_soun)
@@ -4484,7 +5220,9 @@ gst_qtdemux_do_fragmented_seek (GstQTDemux * qtdemux)
     GST_INFO_OBJECT (stream->pad, "%" GST_TIME_FORMAT " at offset "
         "%" G_GUINT64_FORMAT, GST_TIME_ARGS (entry->ts), entry->moof_offset);
 
-    stream->pending_seek = entry;
+    /* copy, the index may grow while the seek is pending */
+    stream->pending_seek_entry = *entry;
+    stream->pending_seek = &stream->pending_seek_entry;
 
     /* decide position to jump to just based on audio/video tracks, not subs */
     if (!is_audio_or_video)
@@ -4496,6 +5234,7 @@ gst_qtdemux_do_fragmented_seek (GstQTDemux * qtdemux)
 
   if (best_entry == NULL) {
     GST_OBJECT_UNLOCK (qtdemux);
+    gst_qtdemux_start_prefetch (qtdemux);
     return FALSE;
   }
 
@@ -4509,6 +5248,9 @@ gst_qtdemux_do_fragmented_seek (GstQTDemux * qtdemux)
   qtdemux_add_fragmented_samples (qtdemux);
 
   GST_OBJECT_UNLOCK (qtdemux);
+
+  gst_qtdemux_start_prefetch (qtdemux);
+
   return TRUE;
 }
 
@@ -4672,7 +5414,8 @@ gst_qtdemux_loop_state_movie (GstQTDemux * qtdemux)
     QtDemuxSegment *segment = &stream->segments[stream->segment_index];
 
     GstClockTime time_position = QTSTREAMTIME_TO_GSTTIME (stream,
-        sample->timestamp + stream->offset_in_sample / stream->bytes_per_frame);
+        QTSAMPLE_TIMESTAMP (stream, sample) +
+        stream->offset_in_sample / stream->bytes_per_frame);
     if (time_position >= segment->media_start) {
       /* inside the segment, update time_position, looks very familiar to
        * GStreamer segments, doesn't it? */
@@ -6721,8 +7464,7 @@ qtdemux_stbl_init (GstQTDemux * qtdemux, QtDemuxStream * stream, GNode * stbl)
     return FALSE;
   }
 
-  stream->samples = g_try_new0 (QtDemuxSample, stream->n_samples);
-  if (!stream->samples) {
+  if (!qtdemux_stream_alloc_samples (stream, 0, stream->n_samples)) {
     GST_WARNING_OBJECT (qtdemux, "failed to allocate %d samples",
         stream->n_samples);
     return FALSE;
@@ -6788,15 +7530,21 @@ qtdemux_parse_samples (GstQTDemux * qtdemux, QtDemuxStream * stream, guint32 n)
       GST_FOURCC_FORMAT ", pad %s", GST_FOURCC_ARGS (stream->fourcc),
       stream->pad ? GST_PAD_NAME (stream->pad) : "(NULL)");
 
+  /* the prefetch thread parses concurrently, look at the table locked */
+  GST_OBJECT_LOCK (qtdemux);
   n_samples = stream->n_samples;
 
   if (n >= n_samples)
     goto out_of_samples;
 
-  GST_OBJECT_LOCK (qtdemux);
   if (n <= stream->stbl_index)
     goto already_parsed;
 
+  /* expand a whole chunk at once, but only complete the table when asked to
+   * since that may pull in the next fragments */
+  if (n + 1 < n_samples)
+    n = MIN (n | (QTDEMUX_SAMPLE_CHUNK_SIZE - 1), n_samples - 2);
+
   GST_DEBUG_OBJECT (qtdemux, "parsing up to sample %u", n);
 
   if (!stream->stsz.data) {
@@ -6923,9 +7671,9 @@ qtdemux_parse_samples (GstQTDemux * qtdemux, QtDemuxStream * stream, guint32 n)
             j, GST_TIME_ARGS (QTSTREAMTIME_TO_GSTTIME (stream,
                     stream->stco_sample_index)), cur->size);
 
-        cur->timestamp = stream->stco_sample_index;
-        cur->duration = stream->samples_per_chunk;
-        cur->keyframe = TRUE;
+        qtdemux_stream_add_time_run (stream, j, 1, stream->stco_sample_index,
+            stream->samples_per_chunk, stream->samples_per_chunk);
+        qtdemux_stream_set_keyframe (stream, j, TRUE);
         cur++;
 
         stream->stco_sample_index += stream->samples_per_chunk;
@@ -7000,26 +7748,27 @@ done2:
       stts_duration = stream->stts_duration;
       stts_time = stream->stts_time;
 
-      for (j = stream->stts_sample_index; j < stts_samples; j++) {
-        GST_DEBUG_OBJECT (qtdemux,
-            "sample %d: index %d, timestamp %" GST_TIME_FORMAT,
-            (guint) (cur - samples), j,
-            GST_TIME_ARGS (QTSTREAMTIME_TO_GSTTIME (stream, stts_time)));
-
-        cur->timestamp = stts_time;
-        cur->duration = stts_duration;
-
-        /* avoid 32-bit wrap-around,
-         * but still mind possible 'negative' duration */
-        stts_time += (gint64) stts_duration;
-        cur++;
-
-        if (G_UNLIKELY (cur > last)) {
-          /* save values */
-          stream->stts_time = stts_time;
-          stream->stts_sample_index = j + 1;
-          goto done3;
-        }
+      /* the samples of the block up to the last one to fill form a run */
+      j = MIN (stts_samples - stream->stts_sample_index,
+          (guint32) (last - cur + 1));
+      GST_DEBUG_OBJECT (qtdemux,
+          "samples %d-%d: index %d, timestamp %" GST_TIME_FORMAT,
+          (guint) (cur - samples), (guint) (cur - samples) + j - 1,
+          stream->stts_sample_index,
+          GST_TIME_ARGS (QTSTREAMTIME_TO_GSTTIME (stream, stts_time)));
+
+      /* avoid 32-bit wrap-around,
+       * but still mind possible 'negative' duration */
+      qtdemux_stream_add_time_run (stream, cur - samples, j, stts_time,
+          (gint64) stts_duration, stts_duration);
+      stts_time += j * (gint64) stts_duration;
+      cur += j;
+
+      if (G_UNLIKELY (cur > last)) {
+        /* save values */
+        stream->stts_time = stts_time;
+        stream->stts_sample_index += j;
+        goto done3;
       }
       stream->stts_sample_index = 0;
       stream->stts_time = stts_time;
@@ -7029,13 +7778,13 @@ done2:
      * the last samples do not decode and so we don't have timestamps for them.
      * We however look at the last timestamp to estimate the track length so we
      * need something in here. */
-    for (; cur < last; cur++) {
+    if (cur < last) {
       GST_DEBUG_OBJECT (qtdemux,
-          "fill sample %d: timestamp %" GST_TIME_FORMAT,
-          (guint) (cur - samples),
+          "fill samples %d-%d: timestamp %" GST_TIME_FORMAT,
+          (guint) (cur - samples), (guint) (last - samples) - 1,
           GST_TIME_ARGS (QTSTREAMTIME_TO_GSTTIME (stream, stream->stts_time)));
-      cur->timestamp = stream->stts_time;
-      cur->duration = -1;
+      qtdemux_stream_add_time_run (stream, cur - samples, last - cur,
+          stream->stts_time, 0, -1);
     }
   }
 done3:
@@ -7058,7 +7807,7 @@ done3:
 
           if (G_LIKELY (index > 0 && index <= n_samples)) {
             index -= 1;
-            samples[index].keyframe = TRUE;
+            qtdemux_stream_set_keyframe (stream, index, TRUE);
             GST_DEBUG_OBJECT (qtdemux, "samples at %u is keyframe", index);
             /* and exit if we have enough samples */
             if (G_UNLIKELY (index >= n)) {
@@ -7088,7 +7837,7 @@ done3:
 
             if (G_LIKELY (index > 0 && index <= n_samples)) {
               index -= 1;
-              samples[index].keyframe = TRUE;
+              qtdemux_stream_set_keyframe (stream, index, TRUE);
               GST_DEBUG_OBJECT (qtdemux, "samples at %u is keyframe", index);
               /* and exit if we have enough samples */
               if (G_UNLIKELY (index >= n)) {
@@ -7176,6 +7925,7 @@ already_parsed:
   /* ERRORS */
 out_of_samples:
   {
+    GST_OBJECT_UNLOCK (qtdemux);
     GST_LOG_OBJECT (qtdemux,
         "Tried to parse up to sample %u but there are only %u samples", n + 1,
         stream->n_samples);
@@ -9502,7 +10252,7 @@ qtdemux_prepare_streams (GstQTDemux * qtdemux)
       ++sample_num;
     }
     if (stream->n_samples > 0 && stream->stbl_index >= 0) {
-      stream->first_duration = stream->samples[0].duration;
+      stream->first_duration = qtdemux_sample_get_duration (stream, 0);
       GST_LOG_OBJECT (qtdemux, "stream %d first duration %u",
           stream->track_id, stream->first_duration);
     }
@@ -9582,6 +10332,8 @@ qtdemux_expose_streams (GstQTDemux * qtdemux)
   }
 
   qtdemux->exposed = TRUE;
+  gst_qtdemux_post_index_memory (qtdemux);
+
   return ret;
 }
 
@@ -145,6 +145,15 @@ struct _GstQTDemux {
   guint64 fragment_start_offset;
     
   gint64 chapters_track_id;
+
+  /* background expansion of the sample tables */
+  gboolean prefetch_samples;
+  GThread *prefetch_thread;
+  gint prefetch_stop;
+
+  /* limit for the fragment indexes, which are thinned out beyond it */
+  guint64 max_index_memory;
+  gboolean index_sparse;
 };
 
 struct _GstQTDemuxClass {
@@ -160,27 +160,53 @@ invalid_length:
   }
 }
 
-/* setup for parsing @buf at position @offset on behalf of @el.
- * Takes ownership of @buf. */
-void
-gst_ebml_read_init (GstEbmlRead * ebml, GstElement * el, GstBuffer * buf,
-    guint64 offset)
+static void
+gst_ebml_read_init_full (GstEbmlRead * ebml, GstElement * el, GstBuffer * buf,
+    guint skip, guint size, guint64 offset)
 {
   GstEbmlMaster m;
 
-  g_return_if_fail (el);
-  g_return_if_fail (buf);
-
   ebml->el = el;
   ebml->offset = offset;
   ebml->buf = buf;
+  ebml->buf_offset = skip;
   gst_buffer_map (buf, &ebml->map, GST_MAP_READ);
   ebml->readers = g_array_sized_new (FALSE, FALSE, sizeof (GstEbmlMaster), 10);
   m.offset = ebml->offset;
-  gst_byte_reader_init (&m.br, ebml->map.data, ebml->map.size);
+  gst_byte_reader_init (&m.br, ebml->map.data + skip, size);
   g_array_append_val (ebml->readers, m);
 }
 
+/* setup for parsing @buf at position @offset on behalf of @el.
+ * Takes ownership of @buf. */
+void
+gst_ebml_read_init (GstEbmlRead * ebml, GstElement * el, GstBuffer * buf,
+    guint64 offset)
+{
+  g_return_if_fail (el);
+  g_return_if_fail (buf);
+
+  gst_ebml_read_init_full (ebml, el, buf, 0, gst_buffer_get_size (buf),
+      offset);
+}
+
+/* setup for parsing @size bytes of @window, starting @skip bytes into it,
+ * at position @offset on behalf of @el. Elements are parsed from the
+ * mapped window and binary elements are handed out as sub-buffers of it,
+ * so no intermediate buffer is created per element. Takes a ref on
+ * @window, which should consist of a single memory to map cheaply. */
+void
+gst_ebml_read_init_window (GstEbmlRead * ebml, GstElement * el,
+    GstBuffer * window, guint skip, guint size, guint64 offset)
+{
+  g_return_if_fail (el);
+  g_return_if_fail (window);
+  g_return_if_fail (skip + size <= gst_buffer_get_size (window));
+
+  gst_ebml_read_init_full (ebml, el, gst_buffer_ref (window), skip, size,
+      offset);
+}
+
 void
 gst_ebml_read_clear (GstEbmlRead * ebml)
 {
@@ -339,7 +365,7 @@ gst_ebml_read_buffer (GstEbmlRead * ebml, guint32 * id, GstBuffer ** buf)
   if (G_LIKELY (length > 0)) {
     guint offset;
 
-    offset = gst_ebml_read_get_pos (ebml) - ebml->offset;
+    offset = gst_ebml_read_get_pos (ebml) - ebml->offset + ebml->buf_offset;
     if (G_LIKELY (gst_byte_reader_skip (gst_ebml_read_br (ebml), length))) {
       *buf = gst_buffer_copy_region (ebml->buf, GST_BUFFER_COPY_ALL,
           offset, length);
@@ -55,6 +55,8 @@ typedef struct _GstEbmlRead {
 
   GstBuffer *buf;
   guint64 offset;
+  /* where the data at @offset starts in @buf */
+  guint buf_offset;
   GstMapInfo map;
 
   GArray *readers;
@@ -72,6 +74,11 @@ void          gst_ebml_read_init         (GstEbmlRead * ebml,
                                           GstElement * el, GstBuffer * buf,
                                           guint64 offset);
 
+void          gst_ebml_read_init_window  (GstEbmlRead * ebml,
+                                          GstElement * el, GstBuffer * window,
+                                          guint skip, guint size,
+                                          guint64 offset);
+
 void          gst_ebml_read_clear        (GstEbmlRead * ebml);
 
 GstFlowReturn gst_ebml_peek_id           (GstEbmlRead * ebml, guint32 * id);
@@ -61,6 +61,7 @@ gst_ebml_write_init (GstEbmlWrite * ebml)
   ebml->streamheader_pos = 0;
   ebml->writing_streamheader = FALSE;
   ebml->caps = NULL;
+  ebml->batch = NULL;
 }
 
 static void
@@ -80,6 +81,11 @@ gst_ebml_write_finalize (GObject * object)
     ebml->streamheader = NULL;
   }
 
+  if (ebml->batch) {
+    gst_buffer_list_unref (ebml->batch);
+    ebml->batch = NULL;
+  }
+
   if (ebml->caps) {
     gst_caps_unref (ebml->caps);
     ebml->caps = NULL;
@@ -129,6 +135,11 @@ gst_ebml_write_reset (GstEbmlWrite * ebml)
     ebml->cache = NULL;
   }
 
+  if (ebml->batch) {
+    gst_buffer_list_unref (ebml->batch);
+    ebml->batch = NULL;
+  }
+
   if (ebml->caps) {
     gst_caps_unref (ebml->caps);
     ebml->caps = NULL;
@@ -228,6 +239,141 @@ gst_ebml_writer_send_segment_event (GstEbmlWrite * ebml, guint64 new_pos)
   return res;
 }
 
+/* pushes out what has been batched so far and starts a new batch */
+static void
+gst_ebml_write_push_batch (GstEbmlWrite * ebml)
+{
+  GstBufferList *list = ebml->batch;
+  GstBuffer *first;
+
+  ebml->batch = gst_buffer_list_new ();
+
+  if (gst_buffer_list_length (list) == 0) {
+    gst_buffer_list_unref (list);
+    return;
+  }
+
+  GST_DEBUG ("Pushing batch of %u buffers, %" G_GUINT64_FORMAT " bytes",
+      gst_buffer_list_length (list), ebml->batch_end - ebml->batch_pos);
+
+  if (ebml->last_write_result == GST_FLOW_OK) {
+    first = gst_buffer_list_get (list, 0);
+    if (GST_BUFFER_OFFSET (first) != ebml->last_pos) {
+      gst_ebml_writer_send_segment_event (ebml, GST_BUFFER_OFFSET (first));
+      GST_BUFFER_FLAG_SET (first, GST_BUFFER_FLAG_DISCONT);
+    }
+    ebml->last_pos = ebml->batch_end;
+    ebml->last_write_result = gst_pad_push_list (ebml->srcpad, list);
+  } else {
+    gst_buffer_list_unref (list);
+  }
+}
+
+/* Takes @buf if it could be added to the batch. Returns FALSE if there is
+ * no batch, in which case @buf has to be pushed as usual. */
+static gboolean
+gst_ebml_write_batch_add (GstEbmlWrite * ebml, GstBuffer * buf)
+{
+  if (!ebml->batch)
+    return FALSE;
+
+  if (gst_buffer_list_length (ebml->batch) == 0) {
+    ebml->batch_pos = GST_BUFFER_OFFSET (buf);
+  } else if (GST_BUFFER_OFFSET (buf) != ebml->batch_end) {
+    GST_LOG ("Write at %" G_GUINT64_FORMAT " outside batch, pushing it",
+        GST_BUFFER_OFFSET (buf));
+    gst_ebml_write_push_batch (ebml);
+    ebml->batch_pos = GST_BUFFER_OFFSET (buf);
+  }
+
+  ebml->batch_end = GST_BUFFER_OFFSET_END (buf);
+  gst_buffer_list_add (ebml->batch, buf);
+
+  return TRUE;
+}
+
+/* Overwrites batched data at @offset with the contents of @buf. Returns
+ * FALSE if that range is not entirely held back in the batch. */
+static gboolean
+gst_ebml_write_patch_batch (GstEbmlWrite * ebml, guint64 offset,
+    GstBuffer * buf)
+{
+  GstMapInfo map;
+  guint8 *data;
+  gsize size;
+  guint i, len;
+
+  if (!ebml->batch)
+    return FALSE;
+
+  len = gst_buffer_list_length (ebml->batch);
+  size = gst_buffer_get_size (buf);
+  if (len == 0 || offset < ebml->batch_pos || offset + size > ebml->batch_end)
+    return FALSE;
+
+  GST_LOG ("Rewriting %" G_GSIZE_FORMAT " batched bytes at %" G_GUINT64_FORMAT,
+      size, offset);
+
+  gst_buffer_map (buf, &map, GST_MAP_READ);
+  data = map.data;
+  for (i = 0; i < len && size > 0; i++) {
+    GstBuffer *dest = gst_buffer_list_get (ebml->batch, i);
+    gsize n;
+
+    if (offset >= GST_BUFFER_OFFSET_END (dest))
+      continue;
+
+    n = MIN (size, GST_BUFFER_OFFSET_END (dest) - offset);
+    gst_buffer_fill (dest, offset - GST_BUFFER_OFFSET (dest), data, n);
+    offset += n;
+    data += n;
+    size -= n;
+  }
+  gst_buffer_unmap (buf, &map);
+
+  return TRUE;
+}
+
+/**
+ * gst_ebml_write_set_batch:
+ * @ebml: a #GstEbmlWrite.
+ *
+ * Start batching.
+ *
+ * All buffers, including flushed caches and media data,
+ * are collected in a #GstBufferList instead of being pushed,
+ * until gst_ebml_write_flush_batch() is called. Media data
+ * is only referenced. Rewriting data that has been batched,
+ * such as the size of a master element, is done in place
+ * rather than with a seek.
+ */
+void
+gst_ebml_write_set_batch (GstEbmlWrite * ebml)
+{
+  g_return_if_fail (ebml->batch == NULL);
+
+  GST_DEBUG ("Starting batch at %" G_GUINT64_FORMAT, ebml->pos);
+  ebml->batch = gst_buffer_list_new ();
+  ebml->batch_pos = ebml->batch_end = ebml->pos;
+}
+
+/**
+ * gst_ebml_write_flush_batch:
+ * @ebml: a #GstEbmlWrite.
+ *
+ * Push the batched buffers downstream as one list and stop batching.
+ */
+void
+gst_ebml_write_flush_batch (GstEbmlWrite * ebml)
+{
+  if (!ebml->batch)
+    return;
+
+  gst_ebml_write_push_batch (ebml);
+  gst_buffer_list_unref (ebml->batch);
+  ebml->batch = NULL;
+}
+
 /**
  * gst_ebml_write_flush_cache:
  * @ebml:      a #GstEbmlWrite.
@@ -251,17 +397,23 @@ gst_ebml_write_flush_cache (GstEbmlWrite * ebml, gboolean is_keyframe,
   GST_BUFFER_TIMESTAMP (buffer) = timestamp;
   GST_BUFFER_OFFSET (buffer) = ebml->pos - gst_buffer_get_size (buffer);
   GST_BUFFER_OFFSET_END (buffer) = ebml->pos;
+  if (gst_ebml_write_patch_batch (ebml, GST_BUFFER_OFFSET (buffer), buffer)) {
+    gst_buffer_unref (buffer);
+    return;
+  }
   if (ebml->last_write_result == GST_FLOW_OK) {
-    if (GST_BUFFER_OFFSET (buffer) != ebml->last_pos) {
-      gst_ebml_writer_send_segment_event (ebml, GST_BUFFER_OFFSET (buffer));
-      GST_BUFFER_FLAG_SET (buffer, GST_BUFFER_FLAG_DISCONT);
-    }
     if (ebml->writing_streamheader) {
       GST_BUFFER_FLAG_SET (buffer, GST_BUFFER_FLAG_HEADER);
     }
     if (!is_keyframe) {
       GST_BUFFER_FLAG_SET (buffer, GST_BUFFER_FLAG_DELTA_UNIT);
     }
+    if (gst_ebml_write_batch_add (ebml, buffer))
+      return;
+    if (GST_BUFFER_OFFSET (buffer) != ebml->last_pos) {
+      gst_ebml_writer_send_segment_event (ebml, GST_BUFFER_OFFSET (buffer));
+      GST_BUFFER_FLAG_SET (buffer, GST_BUFFER_FLAG_DISCONT);
+    }
     ebml->last_pos = ebml->pos;
     ebml->last_write_result = gst_pad_push (ebml->srcpad, buffer);
   } else {
@@ -451,6 +603,11 @@ gst_ebml_write_element_push (GstEbmlWrite * ebml, GstBuffer * buf,
   if (buf_data && map.data)
     gst_buffer_unmap (buf, &map);
 
+  if (gst_ebml_write_patch_batch (ebml, ebml->pos - data_size, buf)) {
+    gst_buffer_unref (buf);
+    return;
+  }
+
   if (ebml->last_write_result == GST_FLOW_OK) {
     buf = gst_buffer_make_writable (buf);
     GST_BUFFER_OFFSET (buf) = ebml->pos - data_size;
@@ -459,6 +616,8 @@ gst_ebml_write_element_push (GstEbmlWrite * ebml, GstBuffer * buf,
       GST_BUFFER_FLAG_SET (buf, GST_BUFFER_FLAG_HEADER);
     }
     GST_BUFFER_FLAG_SET (buf, GST_BUFFER_FLAG_DELTA_UNIT);
+    if (gst_ebml_write_batch_add (ebml, buf))
+      return;
 
     if (GST_BUFFER_OFFSET (buf) != ebml->last_pos) {
       gst_ebml_writer_send_segment_event (ebml, GST_BUFFER_OFFSET (buf));
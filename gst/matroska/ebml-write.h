@@ -53,6 +53,10 @@ typedef struct _GstEbmlWrite {
   GstByteWriter *cache;
   guint64 cache_pos;
 
+  GstBufferList *batch;
+  guint64 batch_pos;
+  guint64 batch_end;
+
   GstFlowReturn last_write_result;
 
   gboolean writing_streamheader;
@@ -87,6 +91,15 @@ void    gst_ebml_write_flush_cache   (GstEbmlWrite *ebml,
                                       gboolean is_keyframe,
                                       GstClockTime timestamp);
 
+/*
+ * Batching means that buffers are not pushed one by one
+ * but collected in a buffer list that is pushed at once
+ * on flush. Media data is referenced, not copied, and
+ * writes to data still held back are done in place.
+ */
+void    gst_ebml_write_set_batch     (GstEbmlWrite *ebml);
+void    gst_ebml_write_flush_batch   (GstEbmlWrite *ebml);
+
 /*
  * Seeking.
  */
@@ -60,6 +60,7 @@
 #include <gst/riff/riff-media.h>
 
 #include <gst/audio/audio.h>
+#include <gst/base/gstbytewriter.h>
 #include <gst/tag/tag.h>
 #include <gst/pbutils/pbutils.h>
 #include <gst/video/video.h>
@@ -83,10 +84,18 @@ enum
   PROP_0,
   PROP_METADATA,
   PROP_STREAMINFO,
-  PROP_MAX_GAP_TIME
+  PROP_MAX_GAP_TIME,
+  PROP_CLUSTER_INDEX_FILE,
+  PROP_MAX_INDEX_MEMORY
 };
 
 #define  DEFAULT_MAX_GAP_TIME      (2 * GST_SECOND)
+#define  DEFAULT_CLUSTER_INDEX_FILE NULL
+#define  DEFAULT_MAX_INDEX_MEMORY  0
+
+/* sidecar file with the cluster cache */
+#define CLUSTER_INDEX_MAGIC        GST_MAKE_FOURCC ('M', 'K', 'C', 'I')
+#define CLUSTER_INDEX_VERSION      2
 
 static GstStaticPadTemplate sink_templ = GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
@@ -191,6 +200,7 @@ gst_matroska_demux_finalize (GObject * object)
 
   gst_matroska_read_common_finalize (&demux->common);
   gst_flow_combiner_free (demux->flowcombiner);
+  g_free (demux->cluster_index_file);
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -214,6 +224,21 @@ gst_matroska_demux_class_init (GstMatroskaDemuxClass * klass)
           "gaps longer than this (0 = disabled).", 0, G_MAXUINT64,
           DEFAULT_MAX_GAP_TIME, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (gobject_class, PROP_CLUSTER_INDEX_FILE,
+      g_param_spec_string ("cluster-index-file", "Cluster index file",
+          "File in which the cluster positions found while playing or "
+          "seeking a file without (complete) Cues are saved, and from which "
+          "they are restored when the same file is opened again",
+          DEFAULT_CLUSTER_INDEX_FILE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_MAX_INDEX_MEMORY,
+      g_param_spec_uint64 ("max-index-memory", "Max index memory",
+          "Maximum memory for the seek index in bytes, beyond which only "
+          "some keyframes are kept (0 = unlimited)", 0, G_MAXUINT64,
+          DEFAULT_MAX_INDEX_MEMORY,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gstelement_class->change_state =
       GST_DEBUG_FUNCPTR (gst_matroska_demux_change_state);
   gstelement_class->send_event =
@@ -262,6 +287,8 @@ gst_matroska_demux_init (GstMatroskaDemux * demux)
 
   /* property defaults */
   demux->max_gap_time = DEFAULT_MAX_GAP_TIME;
+  demux->cluster_index_file = DEFAULT_CLUSTER_INDEX_FILE;
+  demux->common.max_index_memory = DEFAULT_MAX_INDEX_MEMORY;
 
   GST_OBJECT_FLAG_SET (demux, GST_ELEMENT_FLAG_INDEXABLE);
 
@@ -271,6 +298,233 @@ gst_matroska_demux_init (GstMatroskaDemux * demux)
   gst_matroska_demux_reset (GST_ELEMENT (demux));
 }
 
+static gint
+gst_matroska_cluster_entry_compare (GstMatroskaClusterEntry * entry,
+    GstClockTime * time, gpointer user_data)
+{
+  if (entry->time < *time)
+    return -1;
+  else if (entry->time > *time)
+    return 1;
+  else
+    return 0;
+}
+
+/* remembers the cluster at @pos (relative to the segment start), to speed up
+ * later seeks in files without (complete) Cues */
+static void
+gst_matroska_demux_cache_cluster (GstMatroskaDemux * demux, guint64 pos,
+    GstClockTime time, guint64 next_pos)
+{
+  GstMatroskaClusterEntry *entry, new_entry;
+  guint index;
+
+  if (G_UNLIKELY (!demux->cluster_cache))
+    demux->cluster_cache = g_array_sized_new (FALSE, FALSE,
+        sizeof (GstMatroskaClusterEntry), 128);
+
+  entry = gst_util_array_binary_search (demux->cluster_cache->data,
+      demux->cluster_cache->len, sizeof (GstMatroskaClusterEntry),
+      (GCompareDataFunc) gst_matroska_cluster_entry_compare,
+      GST_SEARCH_MODE_AFTER, &time, NULL);
+
+  if (entry && entry->time == time) {
+    /* seen before, but maybe not what follows it */
+    if (entry->pos == pos && next_pos != G_MAXUINT64)
+      entry->next_pos = next_pos;
+    return;
+  }
+
+  if (entry)
+    index = entry - (GstMatroskaClusterEntry *) demux->cluster_cache->data;
+  else
+    index = demux->cluster_cache->len;
+
+  new_entry.pos = pos;
+  new_entry.time = time;
+  new_entry.next_pos = next_pos;
+  g_array_insert_val (demux->cluster_cache, index, new_entry);
+}
+
+/* adds the keyframe of @stream at @time, in the cluster at @pos (relative to
+ * the segment start), to the Cues of a file that has them, so that seeks in
+ * files with sparse Cues can start closer to their target */
+static void
+gst_matroska_demux_add_index_entry (GstMatroskaDemux * demux,
+    GstMatroskaTrackContext * stream, GstClockTime time, guint64 pos)
+{
+  GstMatroskaReadCommon *common = &demux->common;
+  GstMatroskaIndex *found, entry;
+  guint index;
+
+  GST_OBJECT_LOCK (demux);
+  /* a thinned out index is not filled in again, nor made to grow beyond
+   * max-index-memory */
+  if (!common->index || !stream->index_table || common->index_sparse ||
+      (common->max_index_memory && 2 * (guint64) (common->index->len + 1) *
+          sizeof (GstMatroskaIndex) > common->max_index_memory))
+    goto done;
+
+  found = gst_util_array_binary_search (stream->index_table->data,
+      stream->index_table->len, sizeof (GstMatroskaIndex),
+      (GCompareDataFunc) gst_matroska_index_seek_find, GST_SEARCH_MODE_AFTER,
+      &time, NULL);
+  if (found && found->time == time)
+    goto done;
+
+  entry.pos = pos;
+  entry.time = time;
+  entry.track = stream->num;
+  entry.block = 1;
+
+  GST_LOG_OBJECT (demux, "adding keyframe of track %u at %" GST_TIME_FORMAT
+      " in cluster %" G_GUINT64_FORMAT " to the index", stream->num,
+      GST_TIME_ARGS (time), pos);
+
+  index = found ? found - (GstMatroskaIndex *) stream->index_table->data :
+      stream->index_table->len;
+  g_array_insert_val (stream->index_table, index, entry);
+
+  found = gst_util_array_binary_search (common->index->data,
+      common->index->len, sizeof (GstMatroskaIndex),
+      (GCompareDataFunc) gst_matroska_index_seek_find, GST_SEARCH_MODE_AFTER,
+      &time, NULL);
+  index = found ? found - (GstMatroskaIndex *) common->index->data :
+      common->index->len;
+  g_array_insert_val (common->index, index, entry);
+
+done:
+  GST_OBJECT_UNLOCK (demux);
+}
+
+static void
+gst_matroska_demux_load_cluster_index (GstMatroskaDemux * demux)
+{
+  GstByteReader reader;
+  gchar *location, *contents = NULL;
+  const guint8 *segment_uid = NULL;
+  gsize size;
+  guint32 magic = 0, version = 0, n_entries = 0;
+  guint64 segment_start = 0, first_cluster = 0, length = 0, duration = 0;
+  guint i;
+
+  /* also used as the key when saving it again */
+  demux->cluster_index_length =
+      gst_matroska_read_common_get_length (&demux->common);
+  demux->cluster_index_duration = demux->common.segment.duration;
+
+  GST_OBJECT_LOCK (demux);
+  location = g_strdup (demux->cluster_index_file);
+  GST_OBJECT_UNLOCK (demux);
+
+  if (!location)
+    return;
+
+  if (!g_file_get_contents (location, &contents, &size, NULL)) {
+    GST_DEBUG_OBJECT (demux, "no cluster index in %s yet", location);
+    goto done;
+  }
+
+  gst_byte_reader_init (&reader, (const guint8 *) contents, size);
+  if (!gst_byte_reader_get_uint32_le (&reader, &magic) ||
+      !gst_byte_reader_get_uint32_be (&reader, &version) ||
+      magic != CLUSTER_INDEX_MAGIC || version != CLUSTER_INDEX_VERSION ||
+      !gst_byte_reader_get_data (&reader, sizeof (demux->common.segment_uid),
+          &segment_uid) ||
+      !gst_byte_reader_get_uint64_be (&reader, &length) ||
+      !gst_byte_reader_get_uint64_be (&reader, &duration) ||
+      !gst_byte_reader_get_uint64_be (&reader, &segment_start) ||
+      !gst_byte_reader_get_uint64_be (&reader, &first_cluster) ||
+      !gst_byte_reader_get_uint32_be (&reader, &n_entries)) {
+    GST_WARNING_OBJECT (demux, "%s is not a cluster index", location);
+    goto done;
+  }
+
+  /* make sure it belongs to this file: the SegmentUID alone is not enough,
+   * as it is missing in WebM files and a file may be rewritten or appended
+   * to keeping it */
+  if (memcmp (segment_uid, demux->common.segment_uid,
+          sizeof (demux->common.segment_uid)) != 0 ||
+      (gint64) length != demux->cluster_index_length ||
+      duration != demux->cluster_index_duration ||
+      segment_start != demux->common.ebml_segment_start ||
+      first_cluster != demux->first_cluster_offset) {
+    GST_INFO_OBJECT (demux, "cluster index %s is for another file", location);
+    goto done;
+  }
+
+  for (i = 0; i < n_entries; i++) {
+    guint64 pos, time, next_pos;
+
+    if (!gst_byte_reader_get_uint64_be (&reader, &pos) ||
+        !gst_byte_reader_get_uint64_be (&reader, &time) ||
+        !gst_byte_reader_get_uint64_be (&reader, &next_pos))
+      break;
+    gst_matroska_demux_cache_cluster (demux, pos, time, next_pos);
+  }
+
+  GST_DEBUG_OBJECT (demux, "restored %u of %u clusters from %s", i,
+      n_entries, location);
+
+done:
+  g_free (contents);
+  g_free (location);
+}
+
+static void
+gst_matroska_demux_save_cluster_index (GstMatroskaDemux * demux)
+{
+  GstByteWriter writer;
+  GError *err = NULL;
+  gchar *location;
+  guint8 *data;
+  guint i, size;
+
+  if (!demux->cluster_cache || !demux->cluster_cache->len)
+    return;
+
+  GST_OBJECT_LOCK (demux);
+  location = g_strdup (demux->cluster_index_file);
+  GST_OBJECT_UNLOCK (demux);
+
+  if (!location)
+    return;
+
+  gst_byte_writer_init_with_size (&writer,
+      60 + 24 * demux->cluster_cache->len, FALSE);
+  gst_byte_writer_put_uint32_le (&writer, CLUSTER_INDEX_MAGIC);
+  gst_byte_writer_put_uint32_be (&writer, CLUSTER_INDEX_VERSION);
+  gst_byte_writer_put_data (&writer, demux->common.segment_uid,
+      sizeof (demux->common.segment_uid));
+  gst_byte_writer_put_uint64_be (&writer, demux->cluster_index_length);
+  gst_byte_writer_put_uint64_be (&writer, demux->cluster_index_duration);
+  gst_byte_writer_put_uint64_be (&writer, demux->common.ebml_segment_start);
+  gst_byte_writer_put_uint64_be (&writer, demux->first_cluster_offset);
+  gst_byte_writer_put_uint32_be (&writer, demux->cluster_cache->len);
+  for (i = 0; i < demux->cluster_cache->len; i++) {
+    GstMatroskaClusterEntry *entry =
+        &g_array_index (demux->cluster_cache, GstMatroskaClusterEntry, i);
+
+    gst_byte_writer_put_uint64_be (&writer, entry->pos);
+    gst_byte_writer_put_uint64_be (&writer, entry->time);
+    gst_byte_writer_put_uint64_be (&writer, entry->next_pos);
+  }
+
+  size = gst_byte_writer_get_size (&writer);
+  data = gst_byte_writer_reset_and_get_data (&writer);
+  if (!g_file_set_contents (location, (const gchar *) data, size, &err)) {
+    GST_WARNING_OBJECT (demux, "failed to save cluster index: %s",
+        err->message);
+    g_clear_error (&err);
+  } else {
+    GST_DEBUG_OBJECT (demux, "saved %u clusters to %s",
+        demux->cluster_cache->len, location);
+  }
+
+  g_free (data);
+  g_free (location);
+}
+
 static void
 gst_matroska_demux_reset (GstElement * element)
 {
@@ -278,6 +532,15 @@ gst_matroska_demux_reset (GstElement * element)
 
   GST_DEBUG_OBJECT (demux, "Resetting state");
 
+  /* before the segment start it refers to is reset */
+  gst_matroska_demux_save_cluster_index (demux);
+  if (demux->cluster_cache) {
+    g_array_free (demux->cluster_cache, TRUE);
+    demux->cluster_cache = NULL;
+  }
+  demux->cluster_index_length = -1;
+  demux->cluster_index_duration = GST_CLOCK_TIME_NONE;
+
   gst_matroska_read_common_reset (GST_ELEMENT (demux), &demux->common);
 
   demux->num_a_streams = 0;
@@ -300,6 +563,12 @@ gst_matroska_demux_reset (GstElement * element)
   g_list_free (demux->seek_parsed);
   demux->seek_parsed = NULL;
 
+  if (demux->seekheads) {
+    g_array_free (demux->seekheads, TRUE);
+    demux->seekheads = NULL;
+  }
+  demux->seekheads_parsed = 0;
+
   demux->last_stop_end = GST_CLOCK_TIME_NONE;
   demux->seek_block = 0;
   demux->stream_start_time = GST_CLOCK_TIME_NONE;
@@ -1712,6 +1981,7 @@ gst_matroska_demux_search_pos (GstMatroskaDemux * demux, GstClockTime time)
   GstClockTime otime, prev_cluster_time, current_cluster_time, cluster_time;
   gint64 opos, newpos, startpos = 0, current_offset;
   gint64 prev_cluster_offset = -1, current_cluster_offset, cluster_offset;
+  gint64 before_offset = -1, after_offset = -1;
   const guint chunk = 64 * 1024;
   GstFlowReturn ret;
   guint64 length;
@@ -1747,6 +2017,57 @@ gst_matroska_demux_search_pos (GstMatroskaDemux * demux, GstClockTime time)
   if (otime <= demux->stream_start_time)
     otime = time;
 
+  /* clusters seen before bound the search, and make it unnecessary if the
+   * ones directly before and after the target are known */
+  if (demux->cluster_cache && demux->cluster_cache->len) {
+    GArray *cache = demux->cluster_cache;
+    GstMatroskaClusterEntry *before, *after;
+    guint index;
+
+    before = gst_util_array_binary_search (cache->data, cache->len,
+        sizeof (GstMatroskaClusterEntry),
+        (GCompareDataFunc) gst_matroska_cluster_entry_compare,
+        GST_SEARCH_MODE_BEFORE, &time, NULL);
+    index = before ? before - (GstMatroskaClusterEntry *) cache->data + 1 : 0;
+    after = index < cache->len ?
+        &g_array_index (cache, GstMatroskaClusterEntry, index) : NULL;
+
+    if (before) {
+      /* the file may have changed since, so make sure there still is a
+       * cluster where it is expected before trusting any of the cache */
+      demux->common.offset = before->pos + demux->common.ebml_segment_start;
+      ret = gst_matroska_read_common_peek_id_length_pull (&demux->common,
+          GST_ELEMENT_CAST (demux), &id, &length, &needed);
+      if (ret != GST_FLOW_OK || id != GST_MATROSKA_ID_CLUSTER) {
+        GST_WARNING_OBJECT (demux, "no cluster at cached offset %"
+            G_GUINT64_FORMAT ", discarding cluster cache",
+            demux->common.offset);
+        g_array_set_size (cache, 0);
+        before = after = NULL;
+      }
+      demux->common.offset = current_offset;
+    }
+
+    if (before && after && before->next_pos == after->pos) {
+      entry = g_new0 (GstMatroskaIndex, 1);
+      entry->time = before->time;
+      entry->pos = before->pos;
+      GST_DEBUG_OBJECT (demux, "cached index entry; time %" GST_TIME_FORMAT
+          ", pos %" G_GUINT64_FORMAT, GST_TIME_ARGS (entry->time),
+          entry->pos);
+      goto exit;
+    }
+
+    /* the cache may grow while scanning, so only keep offsets */
+    if (before) {
+      before_offset = before->pos + demux->common.ebml_segment_start;
+      opos = before_offset;
+      otime = before->time;
+    }
+    if (after)
+      after_offset = after->pos + demux->common.ebml_segment_start;
+  }
+
 retry:
   GST_LOG_OBJECT (demux,
       "opos: %" G_GUINT64_FORMAT ", otime: %" GST_TIME_FORMAT ", %"
@@ -1778,6 +2099,11 @@ retry:
   if (startpos && startpos < newpos)
     newpos = startpos;
 
+  /* but stay between the known clusters around the target */
+  if (before_offset >= 0 && (newpos < before_offset ||
+          (after_offset >= 0 && newpos >= after_offset)))
+    newpos = before_offset;
+
   /* read in at newpos and scan for ebml cluster id */
   startpos = newpos;
   while (1) {
@@ -1991,7 +2317,12 @@ gst_matroska_demux_handle_seek_event (GstMatroskaDemux * demux,
   track = gst_matroska_read_common_get_seek_track (&demux->common, track);
   if ((entry = gst_matroska_read_common_do_index_seek (&demux->common, track,
               seeksegment.position, &demux->seek_index, &demux->seek_entry,
-              snap_dir)) == NULL) {
+              snap_dir)) != NULL) {
+    /* keyframes seen while playing are added to the index until the
+     * streaming thread is stopped, keep a copy */
+    scan_entry = *entry;
+    entry = &scan_entry;
+  } else {
     /* pull mode without index can scan later on */
     if (demux->streaming) {
       GST_DEBUG_OBJECT (demux, "No matching seek entry in index");
@@ -3074,6 +3405,10 @@ gst_matroska_demux_align_buffer (GstMatroskaDemux * demux,
 {
   GstMapInfo map;
 
+  /* nothing to do for compressed formats, don't even map */
+  if (alignment <= 1)
+    return buffer;
+
   gst_buffer_map (buffer, &map, GST_MAP_READ);
 
   if (map.size < sizeof (guintptr)) {
@@ -3120,7 +3455,8 @@ gst_matroska_demux_parse_blockgroup_or_simpleblock (GstMatroskaDemux * demux,
   GstMapInfo map;
   gint stream_num = -1, n, laces = 0;
   guint size = 0;
-  gint *lace_size = NULL;
+  /* the lace count is stored in a byte */
+  gint lace_size[256];
   gint64 time = 0;
   gint flags = 0;
   gint64 referenceblock = 0;
@@ -3199,7 +3535,6 @@ gst_matroska_demux_parse_blockgroup_or_simpleblock (GstMatroskaDemux * demux,
         switch ((flags & 0x06) >> 1) {
           case 0x0:            /* no lacing */
             laces = 1;
-            lace_size = g_new (gint, 1);
             lace_size[0] = size;
             break;
 
@@ -3211,7 +3546,7 @@ gst_matroska_demux_parse_blockgroup_or_simpleblock (GstMatroskaDemux * demux,
             laces = GST_READ_UINT8 (data) + 1;
             data += 1;
             size -= 1;
-            lace_size = g_new0 (gint, laces);
+            memset (lace_size, 0, laces * sizeof (gint));
 
             switch ((flags & 0x06) >> 1) {
               case 0x1:        /* xiph lacing */  {
@@ -3437,6 +3772,14 @@ gst_matroska_demux_parse_blockgroup_or_simpleblock (GstMatroskaDemux * demux,
       }
     }
 
+    /* keyframes seen while playing fill in the Cues */
+    if (!demux->streaming && !delta_unit &&
+        stream->type == GST_MATROSKA_TRACK_TYPE_VIDEO &&
+        stream->index_table && GST_CLOCK_TIME_IS_VALID (lace_time) &&
+        demux->common.segment.rate > 0.0)
+      gst_matroska_demux_add_index_entry (demux, stream, lace_time,
+          cluster_offset - demux->common.ebml_segment_start);
+
     for (n = 0; n < laces; n++) {
       GstBuffer *sub;
 
@@ -3696,7 +4039,6 @@ done:
     gst_buffer_unmap (buf, &map);
     gst_buffer_unref (buf);
   }
-  g_free (lace_size);
 
   return ret;
 
@@ -3742,6 +4084,36 @@ gst_matroska_demux_seek_block (GstMatroskaDemux * demux)
   }
 }
 
+/* the number of chained SeekHeads that are followed */
+#define MAX_SEEKHEADS 4096
+
+/* remembers the SeekHead at @offset to be parsed, unless it was seen
+ * before */
+static void
+gst_matroska_demux_add_seekhead (GstMatroskaDemux * demux, guint64 offset)
+{
+  guint i;
+
+  if (G_UNLIKELY (!demux->seekheads))
+    demux->seekheads = g_array_new (FALSE, FALSE, sizeof (guint64));
+
+  for (i = 0; i < demux->seekheads->len; i++) {
+    if (g_array_index (demux->seekheads, guint64, i) == offset) {
+      GST_DEBUG_OBJECT (demux, "SeekHead at %" G_GUINT64_FORMAT
+          " seen before", offset);
+      return;
+    }
+  }
+
+  if (demux->seekheads->len >= MAX_SEEKHEADS) {
+    GST_WARNING_OBJECT (demux, "not following more than %u SeekHeads",
+        MAX_SEEKHEADS);
+    return;
+  }
+
+  g_array_append_val (demux->seekheads, offset);
+}
+
 static GstFlowReturn
 gst_matroska_demux_parse_contents_seekentry (GstMatroskaDemux * demux,
     GstEbmlRead * ebml)
@@ -3811,8 +4183,14 @@ gst_matroska_demux_parse_contents_seekentry (GstMatroskaDemux * demux,
 
   switch (seek_id) {
     case GST_MATROSKA_ID_SEEKHEAD:
-    {
-    }
+      /* chained SeekHeads, as written by matroskamux with incremental Cues,
+       * are only followed while reading the headers, and not from here but
+       * one after the other by parse_contents() */
+      if (demux->common.state == GST_MATROSKA_READ_STATE_HEADER &&
+          !demux->streaming)
+        gst_matroska_demux_add_seekhead (demux,
+            seek_pos + demux->common.ebml_segment_start);
+      break;
     case GST_MATROSKA_ID_CUES:
     case GST_MATROSKA_ID_TAGS:
     case GST_MATROSKA_ID_TRACKS:
@@ -3866,6 +4244,10 @@ gst_matroska_demux_parse_contents_seekentry (GstMatroskaDemux * demux,
             "We looked for ID=0x%x but got ID=0x%x (pos=%" G_GUINT64_FORMAT ")",
             seek_id, id, seek_pos + demux->common.ebml_segment_start);
       } else {
+        /* each Cues referenced while reading the headers adds to the index */
+        if (id == GST_MATROSKA_ID_CUES &&
+            demux->common.state == GST_MATROSKA_READ_STATE_HEADER)
+          demux->common.index_parsed = FALSE;
         /* now parse */
         ret = gst_matroska_demux_parse_id (demux, id, length, needed);
       }
@@ -3896,12 +4278,61 @@ gst_matroska_demux_parse_contents_seekentry (GstMatroskaDemux * demux,
   return ret;
 }
 
+/* parses the chained SeekHeads found so far, which may add more of them */
+static void
+gst_matroska_demux_parse_seekheads (GstMatroskaDemux * demux)
+{
+  guint64 before_pos = demux->common.offset;
+  GstFlowReturn ret;
+  guint64 length;
+  guint32 id;
+  guint needed;
+
+  while (demux->seekheads_parsed < demux->seekheads->len) {
+    demux->common.offset = g_array_index (demux->seekheads, guint64,
+        demux->seekheads_parsed++);
+
+    ret = gst_matroska_read_common_peek_id_length_pull (&demux->common,
+        GST_ELEMENT_CAST (demux), &id, &length, &needed);
+    if (ret != GST_FLOW_OK)
+      continue;
+
+    if (id != GST_MATROSKA_ID_SEEKHEAD) {
+      GST_WARNING_OBJECT (demux, "no SeekHead at %" G_GUINT64_FORMAT
+          ", but ID=0x%x", demux->common.offset, id);
+      continue;
+    }
+
+    ret = gst_matroska_demux_parse_id (demux, id, length, needed);
+    if (ret != GST_FLOW_OK)
+      GST_DEBUG_OBJECT (demux, "Ignoring %s", gst_flow_get_name (ret));
+  }
+
+  /* the index is only sorted once all Cues of the chain are parsed */
+  demux->common.defer_index = FALSE;
+  if (demux->common.index_unfinished)
+    gst_matroska_read_common_finish_index (&demux->common);
+
+  demux->common.offset = before_pos;
+}
+
 static GstFlowReturn
 gst_matroska_demux_parse_contents (GstMatroskaDemux * demux, GstEbmlRead * ebml)
 {
   GstFlowReturn ret = GST_FLOW_OK;
+  gboolean walk_chain = FALSE;
   guint32 id;
 
+  /* the SeekHead read first starts the chain, the others are reached
+   * through it */
+  if (demux->common.state == GST_MATROSKA_READ_STATE_HEADER &&
+      !demux->streaming && !demux->common.defer_index) {
+    gst_matroska_demux_add_seekhead (demux, ebml->offset);
+    demux->seekheads_parsed = demux->seekheads->len;
+    demux->common.defer_index = TRUE;
+    walk_chain = TRUE;
+  }
+
   DEBUG_ELEMENT_START (demux, ebml, "SeekHead");
 
   if ((ret = gst_ebml_read_master (ebml, &id)) != GST_FLOW_OK) {
@@ -3934,6 +4365,9 @@ gst_matroska_demux_parse_contents (GstMatroskaDemux * demux, GstEbmlRead * ebml)
 
   DEBUG_ELEMENT_STOP (demux, ebml, "SeekHead", ret);
 
+  if (walk_chain)
+    gst_matroska_demux_parse_seekheads (demux);
+
   /* Sort clusters by position for easier searching */
   if (demux->clusters)
     g_array_sort (demux->clusters, (GCompareFunc) gst_matroska_cluster_compare);
@@ -4044,18 +4478,19 @@ gst_matroska_demux_take (GstMatroskaDemux * demux, guint64 bytes,
     goto exit;
   }
   if (demux->streaming) {
-    if (gst_adapter_available (demux->common.adapter) >= bytes)
+    if (gst_adapter_available (demux->common.adapter) >= bytes) {
       buffer = gst_adapter_take_buffer (demux->common.adapter, bytes);
-    else
+      gst_ebml_read_init (ebml, GST_ELEMENT_CAST (demux), buffer,
+          demux->common.offset);
+    } else
       ret = GST_FLOW_EOS;
-  } else
-    ret = gst_matroska_read_common_peek_bytes (&demux->common,
-        demux->common.offset, bytes, &buffer, NULL);
-  if (G_LIKELY (buffer)) {
-    gst_ebml_read_init (ebml, GST_ELEMENT_CAST (demux), buffer,
-        demux->common.offset);
-    demux->common.offset += bytes;
+  } else {
+    /* parse straight from the pulled block */
+    ret = gst_matroska_read_common_peek_ebml (&demux->common,
+        GST_ELEMENT_CAST (demux), bytes, ebml);
   }
+  if (G_LIKELY (ret == GST_FLOW_OK))
+    demux->common.offset += bytes;
 exit:
   return ret;
 }
@@ -4254,6 +4689,10 @@ gst_matroska_demux_parse_id (GstMatroskaDemux * demux, guint32 id,
                   == GST_MATROSKA_READ_STATE_HEADER)) {
             demux->common.state = GST_MATROSKA_READ_STATE_DATA;
             demux->first_cluster_offset = demux->common.offset;
+            if (demux->common.index_unfinished)
+              gst_matroska_read_common_finish_index (&demux->common);
+            if (!demux->streaming)
+              gst_matroska_demux_load_cluster_index (demux);
             GST_DEBUG_OBJECT (demux, "signaling no more pads");
             gst_element_no_more_pads (GST_ELEMENT (demux));
             /* send initial segment - we wait till we know the first
@@ -4273,6 +4712,8 @@ gst_matroska_demux_parse_id (GstMatroskaDemux * demux, guint32 id,
           /* record next cluster for recovery */
           if (read != G_MAXUINT64)
             demux->next_cluster_offset = demux->cluster_offset + read;
+          else
+            demux->next_cluster_offset = 0;
           /* eat cluster prefix */
           gst_matroska_demux_flush (demux, needed);
           break;
@@ -4285,6 +4726,16 @@ gst_matroska_demux_parse_id (GstMatroskaDemux * demux, guint32 id,
             goto parse_failed;
           GST_DEBUG_OBJECT (demux, "ClusterTimeCode: %" G_GUINT64_FORMAT, num);
           demux->cluster_time = num;
+          /* whether playing or scanning, keep it for later seeks */
+          if (!demux->streaming) {
+            guint64 segment_start = demux->common.ebml_segment_start;
+
+            gst_matroska_demux_cache_cluster (demux,
+                demux->cluster_offset - segment_start,
+                num * demux->common.time_scale,
+                demux->next_cluster_offset > demux->cluster_offset ?
+                demux->next_cluster_offset - segment_start : G_MAXUINT64);
+          }
 #if 0
           if (demux->common.element_index) {
             if (demux->common.element_index_writer_id == -1)
@@ -5750,6 +6201,17 @@ gst_matroska_demux_set_property (GObject * object,
       demux->max_gap_time = g_value_get_uint64 (value);
       GST_OBJECT_UNLOCK (demux);
       break;
+    case PROP_CLUSTER_INDEX_FILE:
+      GST_OBJECT_LOCK (demux);
+      g_free (demux->cluster_index_file);
+      demux->cluster_index_file = g_value_dup_string (value);
+      GST_OBJECT_UNLOCK (demux);
+      break;
+    case PROP_MAX_INDEX_MEMORY:
+      GST_OBJECT_LOCK (demux);
+      demux->common.max_index_memory = g_value_get_uint64 (value);
+      GST_OBJECT_UNLOCK (demux);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -5771,6 +6233,16 @@ gst_matroska_demux_get_property (GObject * object,
       g_value_set_uint64 (value, demux->max_gap_time);
       GST_OBJECT_UNLOCK (demux);
       break;
+    case PROP_CLUSTER_INDEX_FILE:
+      GST_OBJECT_LOCK (demux);
+      g_value_set_string (value, demux->cluster_index_file);
+      GST_OBJECT_UNLOCK (demux);
+      break;
+    case PROP_MAX_INDEX_MEMORY:
+      GST_OBJECT_LOCK (demux);
+      g_value_set_uint64 (value, demux->common.max_index_memory);
+      GST_OBJECT_UNLOCK (demux);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
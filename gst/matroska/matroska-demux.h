@@ -43,6 +43,15 @@ G_BEGIN_DECLS
 #define GST_IS_MATROSKA_DEMUX_CLASS(klass) \
   (G_TYPE_CHECK_CLASS_TYPE ((klass), GST_TYPE_MATROSKA_DEMUX))
 
+/* a cluster seen while playing or scanning */
+typedef struct _GstMatroskaClusterEntry {
+  /* relative to the segment start, like cue positions */
+  guint64                  pos;
+  GstClockTime             time;
+  /* position of the cluster directly following it, G_MAXUINT64 if unknown */
+  guint64                  next_pos;
+} GstMatroskaClusterEntry;
+
 typedef struct _GstMatroskaDemux {
   GstElement              parent;
 
@@ -71,9 +80,21 @@ typedef struct _GstMatroskaDemux {
   gboolean                 tracks_parsed;
   GList                   *seek_parsed;
 
+  /* offsets of the chained SeekHeads seen while reading the headers, the
+   * ones from seekheads_parsed on are still to be parsed */
+  GArray                  *seekheads;
+  guint                    seekheads_parsed;
+
   /* cluster positions (optional) */
   GArray                  *clusters;
 
+  /* GstMatroskaClusterEntry, sorted by time (pull mode only) */
+  GArray                  *cluster_cache;
+  gchar                   *cluster_index_file;
+  /* identify the file the cluster cache belongs to, besides its SegmentUID */
+  gint64                   cluster_index_length;
+  GstClockTime             cluster_index_duration;
+
   /* keeping track of playback position */
   GstClockTime             last_stop_end;
   GstClockTime             stream_start_time;
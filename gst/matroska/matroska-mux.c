@@ -68,13 +68,21 @@ enum
   PROP_WRITING_APP,
   PROP_DOCTYPE_VERSION,
   PROP_MIN_INDEX_INTERVAL,
-  PROP_STREAMABLE
+  PROP_STREAMABLE,
+  PROP_MAX_CLUSTER_DURATION,
+  PROP_MAX_CLUSTER_SIZE,
+  PROP_CLUSTER_BATCHING,
+  PROP_CUES_INTERVAL
 };
 
 #define  DEFAULT_DOCTYPE_VERSION         2
 #define  DEFAULT_WRITING_APP             "GStreamer Matroska muxer"
 #define  DEFAULT_MIN_INDEX_INTERVAL      0
 #define  DEFAULT_STREAMABLE              FALSE
+#define  DEFAULT_MAX_CLUSTER_DURATION    (G_MAXINT16 * GST_MSECOND)
+#define  DEFAULT_MAX_CLUSTER_SIZE        0
+#define  DEFAULT_CLUSTER_BATCHING        FALSE
+#define  DEFAULT_CUES_INTERVAL           0
 
 /* WAVEFORMATEX is gst_riff_strf_auds + an extra guint16 extension size */
 #define WAVEFORMATEX_SIZE  (2 + sizeof (gst_riff_strf_auds))
@@ -330,6 +338,30 @@ gst_matroska_mux_class_init (GstMatroskaMuxClass * klass)
           "be streamable", "If set to true, the output should be as if it is "
           "to be streamed and hence no indexes written or duration written.",
           DEFAULT_STREAMABLE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_MAX_CLUSTER_DURATION,
+      g_param_spec_int64 ("max-cluster-duration", "Maximum cluster duration",
+          "A new cluster is started once the current one spans this many "
+          "nanoseconds (0 = only limited by the 16 bit block timecodes).",
+          0, G_MAXINT64, DEFAULT_MAX_CLUSTER_DURATION,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_MAX_CLUSTER_SIZE,
+      g_param_spec_uint ("max-cluster-size", "Maximum cluster size",
+          "A new cluster is started once the current one reaches this many "
+          "bytes (0 = no limit).", 0, G_MAXUINT, DEFAULT_MAX_CLUSTER_SIZE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_CLUSTER_BATCHING,
+      g_param_spec_boolean ("cluster-batching", "Cluster batching",
+          "Hold back each cluster and push it downstream as a single buffer "
+          "list once it is complete. Media data is not copied, but output is "
+          "delayed by up to one cluster.", DEFAULT_CLUSTER_BATCHING,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_CUES_INTERVAL,
+      g_param_spec_uint ("cues-interval", "Cues interval",
+          "Write the index entries collected so far every so many clusters, "
+          "so that the file is seekable while it is being recorded "
+          "(0 = write the index when finishing the file). Has no effect "
+          "for streamable output.", 0, G_MAXUINT, DEFAULT_CUES_INTERVAL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   gstelement_class->change_state =
       GST_DEBUG_FUNCPTR (gst_matroska_mux_change_state);
@@ -457,6 +489,10 @@ gst_matroska_mux_init (GstMatroskaMux * mux, gpointer g_class)
   mux->writing_app = g_strdup (DEFAULT_WRITING_APP);
   mux->min_index_interval = DEFAULT_MIN_INDEX_INTERVAL;
   mux->streamable = DEFAULT_STREAMABLE;
+  mux->max_cluster_duration = DEFAULT_MAX_CLUSTER_DURATION;
+  mux->max_cluster_size = DEFAULT_MAX_CLUSTER_SIZE;
+  mux->cluster_batching = DEFAULT_CLUSTER_BATCHING;
+  mux->cues_interval = DEFAULT_CUES_INTERVAL;
 
   /* initialize internal variables */
   mux->index = NULL;
@@ -598,6 +634,7 @@ gst_matroska_pad_reset (GstMatroskaPad * collect_pad, gboolean full)
     collect_pad->track = context;
     collect_pad->start_ts = GST_CLOCK_TIME_NONE;
     collect_pad->end_ts = GST_CLOCK_TIME_NONE;
+    collect_pad->last_cue_ts = GST_CLOCK_TIME_NONE;
     collect_pad->tags = gst_tag_list_new_empty ();
     gst_tag_list_set_scope (collect_pad->tags, GST_TAG_SCOPE_STREAM);
   }
@@ -649,10 +686,13 @@ gst_matroska_mux_reset (GstElement * element)
   mux->num_indexes = 0;
   g_free (mux->index);
   mux->index = NULL;
+  mux->cues_pos = 0;
+  mux->cues_chain_pos = 0;
+  mux->clusters_since_cues = 0;
+  mux->incremental_cues = FALSE;
 
   /* reset timers */
   mux->time_scale = GST_MSECOND;
-  mux->max_cluster_duration = G_MAXINT16 * mux->time_scale;
   mux->duration = 0;
 
   /* reset cluster */
@@ -2594,6 +2634,7 @@ gst_matroska_mux_start (GstMatroskaMux * mux)
     GST_MATROSKA_ID_CHAPTERS,
     GST_MATROSKA_ID_CUES,
     GST_MATROSKA_ID_TAGS,
+    GST_MATROSKA_ID_SEEKHEAD,
     0
   };
   const gchar *media_type;
@@ -2664,8 +2705,12 @@ gst_matroska_mux_start (GstMatroskaMux * mux)
   if (!mux->streamable) {
     /* seekhead (table of contents) - we set the positions later */
     mux->seekhead_pos = ebml->pos;
+    mux->incremental_cues = mux->cues_interval > 0;
     master = gst_ebml_write_master_start (ebml, GST_MATROSKA_ID_SEEKHEAD);
     for (i = 0; seekhead_id[i] != 0; i++) {
+      /* the last entry links to the chain of incrementally written Cues */
+      if (seekhead_id[i] == GST_MATROSKA_ID_SEEKHEAD && !mux->incremental_cues)
+        break;
       child = gst_ebml_write_master_start (ebml, GST_MATROSKA_ID_SEEKENTRY);
       gst_ebml_write_uint (ebml, GST_MATROSKA_ID_SEEKID, seekhead_id[i]);
       gst_ebml_write_uint (ebml, GST_MATROSKA_ID_SEEKPOSITION, -1);
@@ -2770,6 +2815,13 @@ gst_matroska_mux_start (GstMatroskaMux * mux)
       collect_pad->default_duration_scaled =
           gst_util_uint64_scale (collect_pad->track->default_duration,
           1, mux->time_scale);
+      collect_pad->is_dirac = !strcmp (collect_pad->track->codec_id,
+          GST_MATROSKA_CODEC_ID_VIDEO_DIRAC);
+      collect_pad->has_invisible_frames =
+          !strcmp (collect_pad->track->codec_id,
+          GST_MATROSKA_CODEC_ID_VIDEO_VP8)
+          || !strcmp (collect_pad->track->codec_id,
+          GST_MATROSKA_CODEC_ID_VIDEO_VP9);
     }
   }
   gst_ebml_write_master_finish (ebml, master);
@@ -2998,6 +3050,104 @@ gst_matroska_mux_write_toc_entry_tags (GstMatroskaMux * mux,
 }
 #endif
 
+/**
+ * gst_matroska_mux_write_cues:
+ * @mux: #GstMatroskaMux
+ *
+ * Write the pending index entries as a Cues element and drop them.
+ */
+static void
+gst_matroska_mux_write_cues (GstMatroskaMux * mux)
+{
+  GstEbmlWrite *ebml = mux->ebml_write;
+  guint n;
+  guint64 master, pointentry_master, trackpos_master;
+
+  mux->cues_pos = ebml->pos;
+  gst_ebml_write_set_cache (ebml, 12 + 41 * mux->num_indexes);
+  master = gst_ebml_write_master_start (ebml, GST_MATROSKA_ID_CUES);
+
+  for (n = 0; n < mux->num_indexes; n++) {
+    GstMatroskaIndex *idx = &mux->index[n];
+
+    pointentry_master = gst_ebml_write_master_start (ebml,
+        GST_MATROSKA_ID_POINTENTRY);
+    gst_ebml_write_uint (ebml, GST_MATROSKA_ID_CUETIME,
+        idx->time / mux->time_scale);
+    trackpos_master = gst_ebml_write_master_start (ebml,
+        GST_MATROSKA_ID_CUETRACKPOSITIONS);
+    gst_ebml_write_uint (ebml, GST_MATROSKA_ID_CUETRACK, idx->track);
+    gst_ebml_write_uint (ebml, GST_MATROSKA_ID_CUECLUSTERPOSITION,
+        idx->pos - mux->segment_master);
+    gst_ebml_write_master_finish (ebml, trackpos_master);
+    gst_ebml_write_master_finish (ebml, pointentry_master);
+  }
+
+  gst_ebml_write_master_finish (ebml, master);
+  gst_ebml_write_flush_cache (ebml, FALSE, GST_CLOCK_TIME_NONE);
+
+  g_free (mux->index);
+  mux->index = NULL;
+  mux->num_indexes = 0;
+}
+
+/**
+ * gst_matroska_mux_flush_cues:
+ * @mux: #GstMatroskaMux
+ *
+ * Write the index entries collected since the last call as a partial
+ * Cues element, for incremental Cues.
+ *
+ * Partial Cues are chained from the newest to the oldest: each one but the
+ * first is followed by a SeekHead pointing to the previous Cues and the
+ * previous such SeekHead. The SeekHead at the start of the segment only
+ * has to be updated to point to the newest Cues and SeekHead, so the cost
+ * does not grow with the length of the file.
+ */
+static void
+gst_matroska_mux_flush_cues (GstMatroskaMux * mux)
+{
+  GstEbmlWrite *ebml = mux->ebml_write;
+  guint64 prev_cues_pos = mux->cues_pos;
+  guint64 master, child;
+
+  mux->clusters_since_cues = 0;
+  if (mux->index == NULL)
+    return;
+
+  GST_DEBUG_OBJECT (mux, "writing %u index entries", mux->num_indexes);
+  gst_matroska_mux_write_cues (mux);
+
+  if (prev_cues_pos != 0) {
+    guint64 chain_pos = ebml->pos;
+
+    gst_ebml_write_set_cache (ebml, 0x40);
+    master = gst_ebml_write_master_start (ebml, GST_MATROSKA_ID_SEEKHEAD);
+    child = gst_ebml_write_master_start (ebml, GST_MATROSKA_ID_SEEKENTRY);
+    gst_ebml_write_uint (ebml, GST_MATROSKA_ID_SEEKID, GST_MATROSKA_ID_CUES);
+    gst_ebml_write_uint (ebml, GST_MATROSKA_ID_SEEKPOSITION,
+        prev_cues_pos - mux->segment_master);
+    gst_ebml_write_master_finish (ebml, child);
+    if (mux->cues_chain_pos != 0) {
+      child = gst_ebml_write_master_start (ebml, GST_MATROSKA_ID_SEEKENTRY);
+      gst_ebml_write_uint (ebml, GST_MATROSKA_ID_SEEKID,
+          GST_MATROSKA_ID_SEEKHEAD);
+      gst_ebml_write_uint (ebml, GST_MATROSKA_ID_SEEKPOSITION,
+          mux->cues_chain_pos - mux->segment_master);
+      gst_ebml_write_master_finish (ebml, child);
+    }
+    gst_ebml_write_master_finish (ebml, master);
+    gst_ebml_write_flush_cache (ebml, FALSE, GST_CLOCK_TIME_NONE);
+    mux->cues_chain_pos = chain_pos;
+
+    /* see gst_matroska_mux_finish() for the seekhead layout */
+    gst_ebml_replace_uint (ebml, mux->seekhead_pos + 172,
+        mux->cues_chain_pos - mux->segment_master);
+  }
+  gst_ebml_replace_uint (ebml, mux->seekhead_pos + 116,
+      mux->cues_pos - mux->segment_master);
+}
+
 /**
  * gst_matroska_mux_finish:
  * @mux: #GstMatroskaMux
@@ -3018,35 +3168,13 @@ gst_matroska_mux_finish (GstMatroskaMux * mux)
   if (mux->cluster) {
     gst_ebml_write_master_finish (ebml, mux->cluster);
   }
+  gst_ebml_write_flush_batch (ebml);
 
   /* cues */
-  if (mux->index != NULL) {
-    guint n;
-    guint64 master, pointentry_master, trackpos_master;
-
-    mux->cues_pos = ebml->pos;
-    gst_ebml_write_set_cache (ebml, 12 + 41 * mux->num_indexes);
-    master = gst_ebml_write_master_start (ebml, GST_MATROSKA_ID_CUES);
-
-    for (n = 0; n < mux->num_indexes; n++) {
-      GstMatroskaIndex *idx = &mux->index[n];
-
-      pointentry_master = gst_ebml_write_master_start (ebml,
-          GST_MATROSKA_ID_POINTENTRY);
-      gst_ebml_write_uint (ebml, GST_MATROSKA_ID_CUETIME,
-          idx->time / mux->time_scale);
-      trackpos_master = gst_ebml_write_master_start (ebml,
-          GST_MATROSKA_ID_CUETRACKPOSITIONS);
-      gst_ebml_write_uint (ebml, GST_MATROSKA_ID_CUETRACK, idx->track);
-      gst_ebml_write_uint (ebml, GST_MATROSKA_ID_CUECLUSTERPOSITION,
-          idx->pos - mux->segment_master);
-      gst_ebml_write_master_finish (ebml, trackpos_master);
-      gst_ebml_write_master_finish (ebml, pointentry_master);
-    }
-
-    gst_ebml_write_master_finish (ebml, master);
-    gst_ebml_write_flush_cache (ebml, FALSE, GST_CLOCK_TIME_NONE);
-  }
+  if (mux->incremental_cues)
+    gst_matroska_mux_flush_cues (mux);
+  else if (mux->index != NULL)
+    gst_matroska_mux_write_cues (mux);
 
   /* tags */
   tags = gst_tag_setter_get_tag_list (GST_TAG_SETTER (mux));
@@ -3102,7 +3230,7 @@ gst_matroska_mux_finish (GstMatroskaMux * mux)
   }
 
   /* update seekhead. We know that:
-   * - a seekhead contains 5 entries.
+   * - a seekhead contains 5 entries, 6 with incremental Cues.
    * - order of entries is as above.
    * - a seekhead has a 4-byte header + 8-byte length
    * - each entry is 2-byte master, 2-byte ID pointer,
@@ -3127,7 +3255,7 @@ gst_matroska_mux_finish (GstMatroskaMux * mux)
     gst_ebml_write_buffer_header (ebml, GST_EBML_ID_VOID, 26);
     gst_ebml_write_seek (ebml, my_pos);
   }
-  if (mux->index != NULL) {
+  if (mux->cues_pos != 0) {
     gst_ebml_replace_uint (ebml, mux->seekhead_pos + 116,
         mux->cues_pos - mux->segment_master);
   } else {
@@ -3151,6 +3279,16 @@ gst_matroska_mux_finish (GstMatroskaMux * mux)
     gst_ebml_write_seek (ebml, my_pos);
   }
 
+  /* the link to chained Cues was already set if there are any */
+  if (mux->incremental_cues && mux->cues_chain_pos == 0) {
+    /* void'ify */
+    guint64 my_pos = ebml->pos;
+
+    gst_ebml_write_seek (ebml, mux->seekhead_pos + 152);
+    gst_ebml_write_buffer_header (ebml, GST_EBML_ID_VOID, 26);
+    gst_ebml_write_seek (ebml, my_pos);
+  }
+
   /* loop tracks:
    * - first get the overall duration
    *   (a released track may have left a duration in here)
@@ -3389,9 +3527,7 @@ gst_matroska_mux_write_data (GstMatroskaMux * mux, GstMatroskaPad * collect_pad,
   }
 
   /* for dirac we have to queue up everything up to a picture unit */
-  if (collect_pad->track->codec_id != NULL &&
-      strcmp (collect_pad->track->codec_id,
-          GST_MATROSKA_CODEC_ID_VIDEO_DIRAC) == 0) {
+  if (collect_pad->is_dirac) {
     buf = gst_matroska_mux_handle_dirac_packet (mux, collect_pad, buf);
     if (!buf)
       return GST_FLOW_OK;
@@ -3420,9 +3556,7 @@ gst_matroska_mux_write_data (GstMatroskaMux * mux, GstMatroskaPad * collect_pad,
           GST_TIME_ARGS (buffer_timestamp));
       is_video_keyframe = TRUE;
     } else if (GST_BUFFER_FLAG_IS_SET (buf, GST_BUFFER_FLAG_DECODE_ONLY) &&
-        (!strcmp (collect_pad->track->codec_id, GST_MATROSKA_CODEC_ID_VIDEO_VP8)
-            || !strcmp (collect_pad->track->codec_id,
-                GST_MATROSKA_CODEC_ID_VIDEO_VP9))) {
+        collect_pad->has_invisible_frames) {
       GST_LOG_OBJECT (mux,
           "have VP8 video invisible frame, " "ts=%" GST_TIME_FORMAT,
           GST_TIME_ARGS (buffer_timestamp));
@@ -3431,13 +3565,22 @@ gst_matroska_mux_write_data (GstMatroskaMux * mux, GstMatroskaPad * collect_pad,
   }
 
   if (mux->cluster) {
+    guint64 max_cluster_duration = G_MAXINT16 * mux->time_scale;
+
+    if (mux->max_cluster_duration > 0)
+      max_cluster_duration = MIN (max_cluster_duration,
+          (guint64) mux->max_cluster_duration);
+
     /* start a new cluster at every keyframe, at every GstForceKeyUnit event,
-     * or when we may be reaching the limit of the relative timestamp */
-    if (mux->cluster_time +
-        mux->max_cluster_duration < buffer_timestamp
+     * when the cluster reached its maximum size or when we may be reaching
+     * the limit of the relative timestamp */
+    if (mux->cluster_time + max_cluster_duration < buffer_timestamp
+        || (mux->max_cluster_size > 0 &&
+            ebml->pos - mux->cluster_pos >= mux->max_cluster_size)
         || is_video_keyframe || mux->force_key_unit_event) {
       if (!mux->streamable)
         gst_ebml_write_master_finish (ebml, mux->cluster);
+      gst_ebml_write_flush_batch (ebml);
 
       /* Forward the GstForceKeyUnit event after finishing the cluster */
       if (mux->force_key_unit_event) {
@@ -3445,8 +3588,15 @@ gst_matroska_mux_write_data (GstMatroskaMux * mux, GstMatroskaPad * collect_pad,
         mux->force_key_unit_event = NULL;
       }
 
+      if (mux->incremental_cues &&
+          ++mux->clusters_since_cues >= mux->cues_interval)
+        gst_matroska_mux_flush_cues (mux);
+      /* PrevSize is used to step back to the previous cluster, so it
+       * includes partial Cues written in between */
       mux->prev_cluster_size = ebml->pos - mux->cluster_pos;
       mux->cluster_pos = ebml->pos;
+      if (mux->cluster_batching)
+        gst_ebml_write_set_batch (ebml);
       gst_ebml_write_set_cache (ebml, 0x20);
       mux->cluster =
           gst_ebml_write_master_start (ebml, GST_MATROSKA_ID_CLUSTER);
@@ -3463,6 +3613,8 @@ gst_matroska_mux_write_data (GstMatroskaMux * mux, GstMatroskaPad * collect_pad,
     /* first cluster */
 
     mux->cluster_pos = ebml->pos;
+    if (mux->cluster_batching)
+      gst_ebml_write_set_batch (ebml);
     gst_ebml_write_set_cache (ebml, 0x20);
     mux->cluster = gst_ebml_write_master_start (ebml, GST_MATROSKA_ID_CLUSTER);
     gst_ebml_write_uint (ebml, GST_MATROSKA_ID_CLUSTERTIMECODE,
@@ -3483,17 +3635,11 @@ gst_matroska_mux_write_data (GstMatroskaMux * mux, GstMatroskaPad * collect_pad,
       (is_video_keyframe ||
           ((collect_pad->track->type == GST_MATROSKA_TRACK_TYPE_AUDIO) &&
               (mux->num_streams == 1)))) {
-    gint last_idx = -1;
-
-    if (mux->min_index_interval != 0) {
-      for (last_idx = mux->num_indexes - 1; last_idx >= 0; last_idx--) {
-        if (mux->index[last_idx].track == collect_pad->track->num)
-          break;
-      }
-    }
-
-    if (last_idx < 0 || mux->min_index_interval == 0 ||
-        (GST_CLOCK_DIFF (mux->index[last_idx].time, buffer_timestamp)
+    /* the last entry may already have gone out with partial Cues, so it is
+     * remembered per track rather than looked up in the pending ones */
+    if (!GST_CLOCK_TIME_IS_VALID (collect_pad->last_cue_ts) ||
+        mux->min_index_interval == 0 ||
+        (GST_CLOCK_DIFF (collect_pad->last_cue_ts, buffer_timestamp)
             >= mux->min_index_interval)) {
       GstMatroskaIndex *idx;
 
@@ -3506,6 +3652,7 @@ gst_matroska_mux_write_data (GstMatroskaMux * mux, GstMatroskaPad * collect_pad,
       idx->pos = mux->cluster_pos;
       idx->time = buffer_timestamp;
       idx->track = collect_pad->track->num;
+      collect_pad->last_cue_ts = buffer_timestamp;
     }
   }
 
@@ -3513,8 +3660,7 @@ gst_matroska_mux_write_data (GstMatroskaMux * mux, GstMatroskaPad * collect_pad,
   write_duration = FALSE;
   block_duration = 0;
   if (pad->frame_duration && GST_BUFFER_DURATION_IS_VALID (buf)) {
-    block_duration = gst_util_uint64_scale (GST_BUFFER_DURATION (buf),
-        1, mux->time_scale);
+    block_duration = GST_BUFFER_DURATION (buf) / mux->time_scale;
 
     /* small difference should be ok. */
     if (block_duration > collect_pad->default_duration_scaled + 1 ||
@@ -3529,15 +3675,13 @@ gst_matroska_mux_write_data (GstMatroskaMux * mux, GstMatroskaPad * collect_pad,
   relative_timestamp64 = buffer_timestamp - mux->cluster_time;
   if (relative_timestamp64 >= 0) {
     /* round the timestamp */
-    relative_timestamp64 += gst_util_uint64_scale (mux->time_scale, 1, 2);
-    relative_timestamp = gst_util_uint64_scale (relative_timestamp64, 1,
-        mux->time_scale);
+    relative_timestamp64 += mux->time_scale / 2;
+    relative_timestamp = relative_timestamp64 / mux->time_scale;
   } else {
     /* round the timestamp */
-    relative_timestamp64 -= gst_util_uint64_scale (mux->time_scale, 1, 2);
+    relative_timestamp64 -= mux->time_scale / 2;
     relative_timestamp =
-        -((gint16) gst_util_uint64_scale (-relative_timestamp64, 1,
-            mux->time_scale));
+        -((gint16) ((guint64) (-relative_timestamp64) / mux->time_scale));
   }
 
   if (is_video_invisible)
@@ -3741,6 +3885,18 @@ gst_matroska_mux_set_property (GObject * object,
     case PROP_STREAMABLE:
       mux->streamable = g_value_get_boolean (value);
       break;
+    case PROP_MAX_CLUSTER_DURATION:
+      mux->max_cluster_duration = g_value_get_int64 (value);
+      break;
+    case PROP_MAX_CLUSTER_SIZE:
+      mux->max_cluster_size = g_value_get_uint (value);
+      break;
+    case PROP_CLUSTER_BATCHING:
+      mux->cluster_batching = g_value_get_boolean (value);
+      break;
+    case PROP_CUES_INTERVAL:
+      mux->cues_interval = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -3769,6 +3925,18 @@ gst_matroska_mux_get_property (GObject * object,
     case PROP_STREAMABLE:
       g_value_set_boolean (value, mux->streamable);
       break;
+    case PROP_MAX_CLUSTER_DURATION:
+      g_value_set_int64 (value, mux->max_cluster_duration);
+      break;
+    case PROP_MAX_CLUSTER_SIZE:
+      g_value_set_uint (value, mux->max_cluster_size);
+      break;
+    case PROP_CLUSTER_BATCHING:
+      g_value_set_boolean (value, mux->cluster_batching);
+      break;
+    case PROP_CUES_INTERVAL:
+      g_value_set_uint (value, mux->cues_interval);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -70,7 +70,12 @@ typedef struct
 
   GstClockTime start_ts;
   GstClockTime end_ts;    /* last timestamp + (if available) duration */
+  GstClockTime last_cue_ts; /* of the last index entry, even if written */
   guint64 default_duration_scaled;
+
+  /* codec specifics of the data path, worked out once from the codec id */
+  gboolean is_dirac;
+  gboolean has_invisible_frames;
 }
 GstMatroskaPad;
 
@@ -105,11 +110,18 @@ struct _GstMatroskaMux {
   guint          num_indexes;
   GstClockTimeDiff min_index_interval;
   gboolean       streamable;
+  /* write the index every so many clusters, 0 for only at the end */
+  guint          cues_interval;
+  gboolean       incremental_cues;
+  guint          clusters_since_cues;
  
   /* timescale in the file */
   guint64        time_scale;
-  /* based on timescale, limit of nanoseconds you can have in a cluster */ 
-  guint64        max_cluster_duration;
+  /* limits after which a new cluster is started, 0 for none */
+  GstClockTimeDiff max_cluster_duration;
+  guint          max_cluster_size;
+  /* push whole clusters as buffer lists */
+  gboolean       cluster_batching;
 
   /* length, position (time, ns) */
   guint64        duration;
@@ -118,6 +130,7 @@ struct _GstMatroskaMux {
   guint64        segment_pos,
                  seekhead_pos,
                  cues_pos,
+                 cues_chain_pos,
                  chapters_pos,
                  tags_pos,
                  info_pos,
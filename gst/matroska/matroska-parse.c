@@ -2607,6 +2607,8 @@ gst_matroska_parse_parse_id (GstMatroskaParse * parse, guint32 id,
                   == GST_MATROSKA_READ_STATE_HEADER)) {
             parse->common.state = GST_MATROSKA_READ_STATE_DATA;
             parse->first_cluster_offset = parse->common.offset;
+            if (parse->common.index_unfinished)
+              gst_matroska_read_common_finish_index (&parse->common);
             GST_DEBUG_OBJECT (parse, "signaling no more pads");
           }
           parse->cluster_time = GST_CLOCK_TIME_NONE;
@@ -57,6 +57,11 @@ GST_DEBUG_CATEGORY (matroskareadcommon_debug);
     GST_DEBUG_OBJECT (common->sinkpad, "Parsing " element " element " \
         " finished with '%s'", gst_flow_get_name (ret))
 
+/* in pull mode, data is read in blocks of this size, starting at a multiple
+ * of the alignment, so that it is handed out as sub-buffers without copies */
+#define READ_BLOCK_SIZE (1024 * 1024)
+#define READ_BLOCK_ALIGN 4096
+
 #define GST_MATROSKA_TOC_UID_CHAPTER "chapter"
 #define GST_MATROSKA_TOC_UID_EDITION "edition"
 #define GST_MATROSKA_TOC_UID_EMPTY "empty"
@@ -356,6 +361,10 @@ gst_matroska_index_compare (GstMatroskaIndex * i1, GstMatroskaIndex * i2)
     return -1;
   else if (i1->block > i2->block)
     return 1;
+  else if (i1->track != i2->track)
+    return i1->track < i2->track ? -1 : 1;
+  else if (i1->pos != i2->pos)
+    return i1->pos < i2->pos ? -1 : 1;
   else
     return 0;
 }
@@ -1552,18 +1561,85 @@ gst_matroska_read_common_stream_from_num (GstMatroskaReadCommon * common,
   return -1;
 }
 
+/* when the index takes more than max-index-memory, only keeps every n-th
+ * entry of each track, for the smallest n that makes it fit */
+static void
+gst_matroska_read_common_limit_index (GstMatroskaReadCommon * common)
+{
+  guint64 size;
+  guint *counts;
+  guint i, j, n, stride;
+
+  /* the entries are kept in the common index and again per track */
+  size = 2 * (guint64) common->index->len * sizeof (GstMatroskaIndex);
+  if (!common->max_index_memory || size <= common->max_index_memory)
+    return;
+
+  stride = MIN ((size + common->max_index_memory - 1) /
+      common->max_index_memory, G_MAXUINT);
+
+  /* the last counter is for entries of unknown tracks */
+  counts = g_new0 (guint, common->src->len + 1);
+  for (i = 0, n = 0; i < common->index->len; i++) {
+    GstMatroskaIndex *idx = &g_array_index (common->index, GstMatroskaIndex,
+        i);
+
+    for (j = 0; j < common->src->len; j++) {
+      GstMatroskaTrackContext *ctx = g_ptr_array_index (common->src, j);
+
+      if (ctx->num == idx->track)
+        break;
+    }
+    if (counts[j]++ % stride == 0)
+      g_array_index (common->index, GstMatroskaIndex, n++) = *idx;
+  }
+  g_free (counts);
+
+  GST_DEBUG_OBJECT (common->sinkpad, "index of %u entries exceeds %"
+      G_GUINT64_FORMAT " bytes, keeping every %u-th entry (%u)",
+      common->index->len, common->max_index_memory, stride, n);
+  g_array_set_size (common->index, n);
+  common->index_sparse = TRUE;
+}
+
+/* posts the memory used by the index in an element message */
+static void
+gst_matroska_read_common_post_index_memory (GstMatroskaReadCommon * common)
+{
+  GstElement *el = GST_ELEMENT_CAST (GST_PAD_PARENT (common->sinkpad));
+  GstStructure *s;
+  guint64 entries;
+  guint i, points;
+
+  points = common->index ? common->index->len : 0;
+  entries = points;
+  for (i = 0; i < common->src->len; i++) {
+    GstMatroskaTrackContext *ctx = g_ptr_array_index (common->src, i);
+
+    if (ctx->index_table)
+      entries += ctx->index_table->len;
+  }
+
+  s = gst_structure_new ("index-memory",
+      "bytes", G_TYPE_UINT64, entries * sizeof (GstMatroskaIndex),
+      "entries", G_TYPE_UINT, points,
+      "sparse", G_TYPE_BOOLEAN, common->index_sparse, NULL);
+  gst_element_post_message (el, gst_message_new_element (GST_OBJECT_CAST (el),
+          s));
+}
+
 GstFlowReturn
 gst_matroska_read_common_parse_index (GstMatroskaReadCommon * common,
     GstEbmlRead * ebml)
 {
   guint32 id;
   GstFlowReturn ret = GST_FLOW_OK;
-  guint i;
 
-  if (common->index)
-    g_array_free (common->index, TRUE);
-  common->index =
-      g_array_sized_new (FALSE, FALSE, sizeof (GstMatroskaIndex), 128);
+  /* files written with incremental Cues have several of them, each one adds
+   * to what was parsed before */
+  if (!common->index)
+    common->index =
+        g_array_sized_new (FALSE, FALSE, sizeof (GstMatroskaIndex), 128);
 
   DEBUG_ELEMENT_START (common, ebml, "Cues");
 
@@ -1589,9 +1665,52 @@ gst_matroska_read_common_parse_index (GstMatroskaReadCommon * common,
   }
   DEBUG_ELEMENT_STOP (common, ebml, "Cues", ret);
 
+  common->index_parsed = TRUE;
+
+  /* more Cues may follow while the headers are read, the index is only
+   * finished, and thinned out, once it is complete */
+  if (common->defer_index || common->state == GST_MATROSKA_READ_STATE_HEADER)
+    common->index_unfinished = TRUE;
+  else
+    gst_matroska_read_common_finish_index (common);
+
+  return ret;
+}
+
+/* sorts the entries of all Cues parsed so far, drops duplicates and fills
+ * the track specific index tables from them */
+void
+gst_matroska_read_common_finish_index (GstMatroskaReadCommon * common)
+{
+  guint i, n;
+
+  common->index_unfinished = FALSE;
+  if (!common->index)
+    return;
+
   /* Sort index by time, smallest time first, for easier searching */
   g_array_sort (common->index, (GCompareFunc) gst_matroska_index_compare);
 
+  /* drop entries of Cues that were reached more than once */
+  for (i = 1, n = MIN (common->index->len, 1); i < common->index->len; i++) {
+    GstMatroskaIndex *idx = &g_array_index (common->index, GstMatroskaIndex,
+        i);
+
+    if (gst_matroska_index_compare (idx, &g_array_index (common->index,
+                GstMatroskaIndex, n - 1)) != 0)
+      g_array_index (common->index, GstMatroskaIndex, n++) = *idx;
+  }
+  g_array_set_size (common->index, n);
+
+  gst_matroska_read_common_limit_index (common);
+
+  for (i = 0; i < common->src->len; i++) {
+    GstMatroskaTrackContext *ctx = g_ptr_array_index (common->src, i);
+
+    if (ctx->index_table)
+      g_array_set_size (ctx->index_table, 0);
+  }
+
   /* Now sort the track specific index entries into their own arrays */
   for (i = 0; i < common->index->len; i++) {
     GstMatroskaIndex *idx = &g_array_index (common->index, GstMatroskaIndex,
@@ -1645,15 +1764,13 @@ gst_matroska_read_common_parse_index (GstMatroskaReadCommon * common,
     g_array_append_vals (ctx->index_table, idx, 1);
   }
 
-  common->index_parsed = TRUE;
-
   /* sanity check; empty index normalizes to no index */
   if (common->index->len == 0) {
     g_array_free (common->index, TRUE);
     common->index = NULL;
   }
 
-  return ret;
+  gst_matroska_read_common_post_index_memory (common);
 }
 
 GstFlowReturn
@@ -1753,13 +1870,29 @@ gst_matroska_read_common_parse_info (GstMatroskaReadCommon * common,
         break;
       }
 
+      case GST_MATROSKA_ID_SEGMENTUID:{
+        guint8 *data;
+        guint64 size;
+
+        if ((ret = gst_ebml_read_binary (ebml, &id, &data, &size))
+            != GST_FLOW_OK)
+          break;
+
+        if (size == sizeof (common->segment_uid))
+          memcpy (common->segment_uid, data, size);
+        else
+          GST_WARNING_OBJECT (common->sinkpad, "SegmentUID of invalid size %"
+              G_GUINT64_FORMAT, size);
+        g_free (data);
+        break;
+      }
+
       default:
         ret = gst_matroska_read_common_parse_skip (common, ebml,
             "SegmentInfo", id);
         break;
 
         /* fall through */
-      case GST_MATROSKA_ID_SEGMENTUID:
       case GST_MATROSKA_ID_SEGMENTFILENAME:
       case GST_MATROSKA_ID_PREVUID:
       case GST_MATROSKA_ID_PREVFILENAME:
@@ -2490,6 +2623,8 @@ gst_matroska_read_common_peek_bytes (GstMatroskaReadCommon * common, guint64
     offset, guint size, GstBuffer ** p_buf, guint8 ** bytes)
 {
   GstFlowReturn ret;
+  guint64 block_offset;
+  guint skip;
 
   /* Caching here actually makes much less difference than one would expect.
    * We do it mainly to avoid pulling buffers of 1 byte all the time */
@@ -2521,22 +2656,31 @@ gst_matroska_read_common_peek_bytes (GstMatroskaReadCommon * common, guint64
     common->cached_buffer = NULL;
   }
 
-  /* refill the cache */
-  ret = gst_pad_pull_range (common->sinkpad, common->offset,
-      MAX (size, 64 * 1024), &common->cached_buffer);
+  /* refill the cache, with a block big enough for a whole cluster in most
+   * files, so that all blocks in it are sub-buffers of a single read */
+  block_offset = common->offset & ~((guint64) READ_BLOCK_ALIGN - 1);
+  skip = common->offset - block_offset;
+  ret = gst_pad_pull_range (common->sinkpad, block_offset,
+      MAX (skip + size, READ_BLOCK_SIZE), &common->cached_buffer);
   if (ret != GST_FLOW_OK) {
     common->cached_buffer = NULL;
     return ret;
   }
 
-  if (gst_buffer_get_size (common->cached_buffer) >= size) {
+  /* the cache lookup above relies on this */
+  if (GST_BUFFER_OFFSET (common->cached_buffer) != block_offset) {
+    common->cached_buffer = gst_buffer_make_writable (common->cached_buffer);
+    GST_BUFFER_OFFSET (common->cached_buffer) = block_offset;
+  }
+
+  if (gst_buffer_get_size (common->cached_buffer) >= skip + size) {
     if (p_buf)
       *p_buf = gst_buffer_copy_region (common->cached_buffer,
-          GST_BUFFER_COPY_ALL, 0, size);
+          GST_BUFFER_COPY_ALL, skip, size);
     if (bytes) {
       gst_buffer_map (common->cached_buffer, &common->cached_map, GST_MAP_READ);
       common->cached_data = common->cached_map.data;
-      *bytes = common->cached_data;
+      *bytes = common->cached_data + skip;
     }
     return GST_FLOW_OK;
   }
@@ -2584,6 +2728,45 @@ gst_matroska_read_common_peek_bytes (GstMatroskaReadCommon * common, guint64
   return GST_FLOW_OK;
 }
 
+/*
+ * Sets up @ebml for parsing (offset,size) without advancing our offset.
+ * When the read cache holds the range, the element is parsed in place and
+ * its binary children are sub-buffers of the cache.
+ */
+GstFlowReturn
+gst_matroska_read_common_peek_ebml (GstMatroskaReadCommon * common,
+    GstElement * el, guint size, GstEbmlRead * ebml)
+{
+  GstBuffer *buf = NULL;
+  GstFlowReturn ret;
+
+  ret = gst_matroska_read_common_peek_bytes (common, common->offset, size,
+      NULL, NULL);
+  if (ret != GST_FLOW_OK)
+    return ret;
+
+  /* mapping a buffer with several memories would merge them */
+  if (common->cached_buffer &&
+      gst_buffer_n_memory (common->cached_buffer) == 1) {
+    guint64 cache_offset = GST_BUFFER_OFFSET (common->cached_buffer);
+    gsize cache_size = gst_buffer_get_size (common->cached_buffer);
+
+    if (cache_offset <= common->offset &&
+        (common->offset + size) <= (cache_offset + cache_size)) {
+      gst_ebml_read_init_window (ebml, el, common->cached_buffer,
+          common->offset - cache_offset, size, common->offset);
+      return GST_FLOW_OK;
+    }
+  }
+
+  ret = gst_matroska_read_common_peek_bytes (common, common->offset, size,
+      &buf, NULL);
+  if (ret == GST_FLOW_OK)
+    gst_ebml_read_init (ebml, el, buf, common->offset);
+
+  return ret;
+}
+
 static GstFlowReturn
 gst_matroska_read_common_peek_pull (GstMatroskaReadCommon * common, guint peek,
     guint8 ** data)
@@ -2907,9 +3090,14 @@ gst_matroska_read_common_reset (GstElement * element,
   /* reset timers */
   ctx->time_scale = 1000000;
   ctx->created = G_MININT64;
+  memset (ctx->segment_uid, 0, sizeof (ctx->segment_uid));
+
+  ctx->index_sparse = FALSE;
 
   /* cues/tracks/segmentinfo */
   ctx->index_parsed = FALSE;
+  ctx->defer_index = FALSE;
+  ctx->index_unfinished = FALSE;
   ctx->segmentinfo_parsed = FALSE;
   ctx->attachments_parsed = FALSE;
   ctx->chapters_parsed = FALSE;
@@ -57,6 +57,8 @@ typedef struct _GstMatroskaReadCommon {
   gchar                   *muxing_app;
   gchar                   *writing_app;
   gint64                   created;
+  /* all zeroes if the file has none */
+  guint8                   segment_uid[16];
 
   /* state */
   GstMatroskaReadState     state;
@@ -82,6 +84,13 @@ typedef struct _GstMatroskaReadCommon {
 
   /* a cue (index) table */
   GArray                  *index;
+  /* beyond this, only every n-th entry of each track is kept (0 = no limit) */
+  guint64                  max_index_memory;
+  gboolean                 index_sparse;
+  /* while set, parsed Cues are only collected until finish_index(), which
+   * also happens for all Cues parsed before the first Cluster */
+  gboolean                 defer_index;
+  gboolean                 index_unfinished;
 
   /* timescale in the file */
   guint64                  time_scale;
@@ -119,6 +128,7 @@ GstMatroskaTrackContext * gst_matroska_read_common_get_seek_track (
     GstMatroskaReadCommon * common, GstMatroskaTrackContext * track);
 GstFlowReturn gst_matroska_read_common_parse_index (GstMatroskaReadCommon *
     common, GstEbmlRead * ebml);
+void gst_matroska_read_common_finish_index (GstMatroskaReadCommon * common);
 GstFlowReturn gst_matroska_read_common_parse_info (GstMatroskaReadCommon *
     common, GstElement * el, GstEbmlRead * ebml);
 GstFlowReturn gst_matroska_read_common_parse_attachments (
@@ -133,6 +143,8 @@ GstFlowReturn gst_matroska_read_common_parse_skip (GstMatroskaReadCommon *
     common, GstEbmlRead * ebml, const gchar * parent_name, guint id);
 GstFlowReturn gst_matroska_read_common_peek_bytes (GstMatroskaReadCommon *
     common, guint64 offset, guint size, GstBuffer ** p_buf, guint8 ** bytes);
+GstFlowReturn gst_matroska_read_common_peek_ebml (GstMatroskaReadCommon *
+    common, GstElement * el, guint size, GstEbmlRead * ebml);
 GstFlowReturn gst_matroska_read_common_peek_id_length_pull (GstMatroskaReadCommon *
     common, GstElement * el, guint32 * _id, guint64 * _length, guint *
     _needed);
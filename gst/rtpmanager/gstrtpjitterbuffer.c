@@ -413,6 +413,8 @@ static gboolean gst_rtp_jitter_buffer_sink_event (GstPad * pad,
     GstObject * parent, GstEvent * event);
 static GstFlowReturn gst_rtp_jitter_buffer_chain (GstPad * pad,
     GstObject * parent, GstBuffer * buffer);
+static GstFlowReturn gst_rtp_jitter_buffer_chain_list (GstPad * pad,
+    GstObject * parent, GstBufferList * list);
 
 static gboolean gst_rtp_jitter_buffer_sink_rtcp_event (GstPad * pad,
     GstObject * parent, GstEvent * event);
@@ -858,6 +860,8 @@ gst_rtp_jitter_buffer_init (GstRtpJitterBuffer * jitterbuffer)
 
   gst_pad_set_chain_function (priv->sinkpad,
       GST_DEBUG_FUNCPTR (gst_rtp_jitter_buffer_chain));
+  gst_pad_set_chain_list_function (priv->sinkpad,
+      GST_DEBUG_FUNCPTR (gst_rtp_jitter_buffer_chain_list));
   gst_pad_set_event_function (priv->sinkpad,
       GST_DEBUG_FUNCPTR (gst_rtp_jitter_buffer_sink_event));
   gst_pad_set_query_function (priv->sinkpad,
@@ -2321,36 +2325,73 @@ handle_big_gap_buffer (GstRtpJitterBuffer * jitterbuffer, gboolean future,
   return reset;
 }
 
+/* the RTP header fields of a packet, read before taking the lock */
+typedef struct
+{
+  GstBuffer *buffer;
+  guint8 pt;
+  guint16 seqnum;
+  guint32 rtptime;
+} RTPPacketInfo;
+
+/* Reads the RTP header of @buffer into @info. Must be called without
+ * JBUF_LOCK. Invalid packets are dropped and FALSE is returned. */
+static gboolean
+gst_rtp_jitter_buffer_parse_packet (GstRtpJitterBuffer * jitterbuffer,
+    GstBuffer * buffer, RTPPacketInfo * info)
+{
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+
+  if (G_UNLIKELY (!gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtp)))
+    goto invalid_buffer;
+
+  info->buffer = buffer;
+  info->pt = gst_rtp_buffer_get_payload_type (&rtp);
+  info->seqnum = gst_rtp_buffer_get_seq (&rtp);
+  info->rtptime = gst_rtp_buffer_get_timestamp (&rtp);
+  gst_rtp_buffer_unmap (&rtp);
+
+  return TRUE;
+
+  /* ERRORS */
+invalid_buffer:
+  {
+    /* this is not fatal but should be filtered earlier */
+    GST_ELEMENT_WARNING (jitterbuffer, STREAM, DECODE, (NULL),
+        ("Received invalid RTP payload, dropping"));
+    gst_buffer_unref (buffer);
+    info->buffer = NULL;
+    return FALSE;
+  }
+}
+
+/* Inserts the packet described by @info into the jitterbuffer and updates the
+ * timers. Must be called with JBUF_LOCK held, the lock might be released
+ * temporarily to emit signals. @head_changed is set to TRUE when the head of
+ * the queue changed and @percent is updated with the new buffering percentage,
+ * the caller is responsible for waking up the output task and posting the
+ * buffering message once it is done inserting packets. */
 static GstFlowReturn
-gst_rtp_jitter_buffer_chain (GstPad * pad, GstObject * parent,
-    GstBuffer * buffer)
+gst_rtp_jitter_buffer_insert_packet (GstRtpJitterBuffer * jitterbuffer,
+    GstPad * pad, const RTPPacketInfo * info, gboolean * head_changed,
+    gint * percent)
 {
-  GstRtpJitterBuffer *jitterbuffer;
   GstRtpJitterBufferPrivate *priv;
-  guint16 seqnum;
-  guint32 expected, rtptime;
+  GstBuffer *buffer = info->buffer;
+  guint16 seqnum = info->seqnum;
+  guint32 expected, rtptime = info->rtptime;
   GstFlowReturn ret = GST_FLOW_OK;
   GstClockTime dts, pts;
   guint64 latency_ts;
   gboolean head;
-  gint percent = -1;
-  guint8 pt;
-  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  guint8 pt = info->pt;
   gboolean do_next_seqnum = FALSE;
   RTPJitterBufferItem *item;
-  GstMessage *msg = NULL;
-
-  jitterbuffer = GST_RTP_JITTER_BUFFER_CAST (parent);
 
   priv = jitterbuffer->priv;
 
-  if (G_UNLIKELY (!gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtp)))
-    goto invalid_buffer;
-
-  pt = gst_rtp_buffer_get_payload_type (&rtp);
-  seqnum = gst_rtp_buffer_get_seq (&rtp);
-  rtptime = gst_rtp_buffer_get_timestamp (&rtp);
-  gst_rtp_buffer_unmap (&rtp);
+  if (G_UNLIKELY (priv->srcresult != GST_FLOW_OK))
+    goto out_flushing;
 
   /* make sure we have PTS and DTS set */
   pts = GST_BUFFER_PTS (buffer);
@@ -2371,8 +2412,6 @@ gst_rtp_jitter_buffer_chain (GstPad * pad, GstObject * parent,
       "Received packet #%d at time %" GST_TIME_FORMAT ", discont %d", seqnum,
       GST_TIME_ARGS (dts), GST_BUFFER_IS_DISCONT (buffer));
 
-  JBUF_LOCK_CHECK (priv, out_flushing);
-
   if (G_UNLIKELY (priv->last_pt != pt)) {
     GstCaps *caps;
 
@@ -2479,6 +2518,8 @@ gst_rtp_jitter_buffer_chain (GstPad * pad, GstObject * parent,
       if (G_UNLIKELY (reset)) {
         GList *events = NULL, *l;
         GList *buffers;
+        RTPPacketInfo *infos;
+        guint i, n_infos;
 
         GST_DEBUG_OBJECT (jitterbuffer, "flush and reset jitterbuffer");
         rtp_jitter_buffer_flush (priv->jbuf,
@@ -2516,17 +2557,28 @@ gst_rtp_jitter_buffer_chain (GstPad * pad, GstObject * parent,
 
         priv->ips_rtptime = -1;
         priv->ips_dts = GST_CLOCK_TIME_NONE;
-        JBUF_UNLOCK (jitterbuffer->priv);
 
-        for (l = buffers; l; l = l->next) {
-          ret = gst_rtp_jitter_buffer_chain (pad, parent, l->data);
-          l->data = NULL;
+        /* feed the consecutive packets we collected again, their headers
+         * are read without the lock */
+        JBUF_UNLOCK (priv);
+        infos = g_new (RTPPacketInfo, g_list_length (buffers));
+        for (l = buffers, n_infos = 0; l; l = l->next) {
+          if (gst_rtp_jitter_buffer_parse_packet (jitterbuffer, l->data,
+                  &infos[n_infos]))
+            n_infos++;
+        }
+        g_list_free (buffers);
+        JBUF_LOCK (priv);
+
+        for (i = 0; i < n_infos; i++) {
+          ret = gst_rtp_jitter_buffer_insert_packet (jitterbuffer, pad,
+              &infos[i], head_changed, percent);
           if (ret != GST_FLOW_OK)
             break;
         }
-        for (; l; l = l->next)
-          gst_buffer_unref (l->data);
-        g_list_free (buffers);
+        for (i++; i < n_infos; i++)
+          gst_buffer_unref (infos[i].buffer);
+        g_free (infos);
 
         return ret;
       }
@@ -2554,7 +2606,6 @@ gst_rtp_jitter_buffer_chain (GstPad * pad, GstObject * parent,
   } else {
     GST_DEBUG_OBJECT (jitterbuffer,
         "Had big gap, waiting for more consecutive packets");
-    JBUF_UNLOCK (jitterbuffer->priv);
     return GST_FLOW_OK;
   }
 
@@ -2590,7 +2641,7 @@ gst_rtp_jitter_buffer_chain (GstPad * pad, GstObject * parent,
       old_item = rtp_jitter_buffer_peek (priv->jbuf);
 
       if (IS_DROPABLE (old_item)) {
-        old_item = rtp_jitter_buffer_pop (priv->jbuf, &percent);
+        old_item = rtp_jitter_buffer_pop (priv->jbuf, percent);
         GST_DEBUG_OBJECT (jitterbuffer, "Queue full, dropping old packet %p",
             old_item);
         priv->next_seqnum = (old_item->seqnum + 1) & 0xffff;
@@ -2608,7 +2659,7 @@ gst_rtp_jitter_buffer_chain (GstPad * pad, GstObject * parent,
    * FALSE if a packet with the same seqnum was already in the queue, meaning we
    * have a duplicate. */
   if (G_UNLIKELY (!rtp_jitter_buffer_insert (priv->jbuf, item,
-              &head, &percent)))
+              &head, percent)))
     goto duplicate;
 
   /* update timers */
@@ -2618,42 +2669,17 @@ gst_rtp_jitter_buffer_chain (GstPad * pad, GstObject * parent,
   if (priv->last_sr)
     do_handle_sync (jitterbuffer);
 
-  if (G_UNLIKELY (head)) {
-    /* signal addition of new buffer when the _loop is waiting. */
-    if (G_LIKELY (priv->active))
-      JBUF_SIGNAL_EVENT (priv);
-
-    /* let's unschedule and unblock any waiting buffers. We only want to do this
-     * when the head buffer changed */
-    if (G_UNLIKELY (priv->clock_id)) {
-      GST_DEBUG_OBJECT (jitterbuffer, "Unscheduling waiting new buffer");
-      unschedule_current_timer (jitterbuffer);
-    }
-  }
+  if (G_UNLIKELY (head))
+    *head_changed = TRUE;
 
   GST_DEBUG_OBJECT (jitterbuffer,
       "Pushed packet #%d, now %d packets, head: %d, " "percent %d", seqnum,
-      rtp_jitter_buffer_num_packets (priv->jbuf), head, percent);
-
-  msg = check_buffering_percent (jitterbuffer, percent);
+      rtp_jitter_buffer_num_packets (priv->jbuf), head, *percent);
 
 finished:
-  JBUF_UNLOCK (priv);
-
-  if (msg)
-    gst_element_post_message (GST_ELEMENT_CAST (jitterbuffer), msg);
-
   return ret;
 
   /* ERRORS */
-invalid_buffer:
-  {
-    /* this is not fatal but should be filtered earlier */
-    GST_ELEMENT_WARNING (jitterbuffer, STREAM, DECODE, (NULL),
-        ("Received invalid RTP payload, dropping"));
-    gst_buffer_unref (buffer);
-    return GST_FLOW_OK;
-  }
 no_clock_rate:
   {
     GST_WARNING_OBJECT (jitterbuffer,
@@ -2702,6 +2728,120 @@ gap_but_no_dts:
   }
 }
 
+/* Wakes up the output task when the head of the queue changed and returns the
+ * buffering message to post, if any. Must be called with JBUF_LOCK held after
+ * one or more calls to gst_rtp_jitter_buffer_insert_packet(). */
+static GstMessage *
+gst_rtp_jitter_buffer_finish_insert (GstRtpJitterBuffer * jitterbuffer,
+    gboolean head_changed, gint percent)
+{
+  GstRtpJitterBufferPrivate *priv = jitterbuffer->priv;
+
+  if (G_UNLIKELY (head_changed)) {
+    /* signal addition of new buffer when the _loop is waiting. */
+    if (G_LIKELY (priv->active))
+      JBUF_SIGNAL_EVENT (priv);
+
+    /* let's unschedule and unblock any waiting buffers. We only want to do this
+     * when the head buffer changed */
+    if (G_UNLIKELY (priv->clock_id)) {
+      GST_DEBUG_OBJECT (jitterbuffer, "Unscheduling waiting new buffer");
+      unschedule_current_timer (jitterbuffer);
+    }
+  }
+
+  return check_buffering_percent (jitterbuffer, percent);
+}
+
+static GstFlowReturn
+gst_rtp_jitter_buffer_chain (GstPad * pad, GstObject * parent,
+    GstBuffer * buffer)
+{
+  GstRtpJitterBuffer *jitterbuffer;
+  GstRtpJitterBufferPrivate *priv;
+  GstFlowReturn ret;
+  gboolean head_changed = FALSE;
+  gint percent = -1;
+  RTPPacketInfo info;
+  GstMessage *msg;
+
+  jitterbuffer = GST_RTP_JITTER_BUFFER_CAST (parent);
+  priv = jitterbuffer->priv;
+
+  if (G_UNLIKELY (!gst_rtp_jitter_buffer_parse_packet (jitterbuffer, buffer,
+              &info)))
+    return GST_FLOW_OK;
+
+  JBUF_LOCK (priv);
+  ret = gst_rtp_jitter_buffer_insert_packet (jitterbuffer, pad, &info,
+      &head_changed, &percent);
+  msg = gst_rtp_jitter_buffer_finish_insert (jitterbuffer, head_changed,
+      percent);
+  JBUF_UNLOCK (priv);
+
+  if (msg)
+    gst_element_post_message (GST_ELEMENT_CAST (jitterbuffer), msg);
+
+  return ret;
+}
+
+/* Inserts all packets of the list while holding the lock only once, the
+ * output task is woken up and buffering is checked once for the whole list. */
+static GstFlowReturn
+gst_rtp_jitter_buffer_chain_list (GstPad * pad, GstObject * parent,
+    GstBufferList * list)
+{
+  GstRtpJitterBuffer *jitterbuffer;
+  GstRtpJitterBufferPrivate *priv;
+  GstFlowReturn ret = GST_FLOW_OK;
+  gboolean head_changed = FALSE;
+  gint percent = -1;
+  RTPPacketInfo *infos;
+  GstMessage *msg;
+  guint i, len, n_infos = 0;
+
+  jitterbuffer = GST_RTP_JITTER_BUFFER_CAST (parent);
+  priv = jitterbuffer->priv;
+
+  len = gst_buffer_list_length (list);
+
+  GST_LOG_OBJECT (jitterbuffer, "received list of %u packets", len);
+
+  /* read all headers before taking the lock */
+  infos = g_new (RTPPacketInfo, len);
+  for (i = 0; i < len; i++) {
+    GstBuffer *buffer = gst_buffer_ref (gst_buffer_list_get (list, i));
+
+    if (gst_rtp_jitter_buffer_parse_packet (jitterbuffer, buffer,
+            &infos[n_infos]))
+      n_infos++;
+  }
+
+  JBUF_LOCK (priv);
+  for (i = 0; i < n_infos; i++) {
+    ret = gst_rtp_jitter_buffer_insert_packet (jitterbuffer, pad, &infos[i],
+        &head_changed, &percent);
+    if (G_UNLIKELY (ret != GST_FLOW_OK))
+      break;
+  }
+  for (i++; i < n_infos; i++)
+    gst_buffer_unref (infos[i].buffer);
+  /* drop the list while we still hold the lock so that the queued buffers
+   * are only referenced by the jitterbuffer when the output task pops them */
+  gst_buffer_list_unref (list);
+
+  msg = gst_rtp_jitter_buffer_finish_insert (jitterbuffer, head_changed,
+      percent);
+  JBUF_UNLOCK (priv);
+
+  g_free (infos);
+
+  if (msg)
+    gst_element_post_message (GST_ELEMENT_CAST (jitterbuffer), msg);
+
+  return ret;
+}
+
 static GstClockTime
 compute_elapsed (GstRtpJitterBuffer * jitterbuffer, RTPJitterBufferItem * item)
 {
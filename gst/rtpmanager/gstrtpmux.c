@@ -321,29 +321,26 @@ gst_rtp_mux_release_pad (GstElement * element, GstPad * pad)
   }
 }
 
-/* Put our own timestamp-offset on the buffer */
-static void
-gst_rtp_mux_readjust_rtp_timestamp_locked (GstRTPMux * rtp_mux,
-    GstRTPMuxPadPrivate * padpriv, GstRTPBuffer * rtpbuffer)
+/* The difference between our own timestamp-offset and the one of the sinkpad,
+ * computed once per buffer or buffer list */
+static guint32
+gst_rtp_mux_get_ts_adjust_locked (GstRTPMux * rtp_mux,
+    GstRTPMuxPadPrivate * padpriv)
 {
-  guint32 ts;
   guint32 sink_ts_base = 0;
 
   if (padpriv && padpriv->have_timestamp_offset)
     sink_ts_base = padpriv->timestamp_offset;
 
-  ts = gst_rtp_buffer_get_timestamp (rtpbuffer) - sink_ts_base +
-      rtp_mux->ts_base;
-  GST_LOG_OBJECT (rtp_mux, "Re-adjusting RTP ts %u to %u",
-      gst_rtp_buffer_get_timestamp (rtpbuffer), ts);
-  gst_rtp_buffer_set_timestamp (rtpbuffer, ts);
+  return rtp_mux->ts_base - sink_ts_base;
 }
 
 static gboolean
 process_buffer_locked (GstRTPMux * rtp_mux, GstRTPMuxPadPrivate * padpriv,
-    GstRTPBuffer * rtpbuffer)
+    guint32 ts_adjust, GstRTPBuffer * rtpbuffer)
 {
   GstRTPMuxClass *klass = GST_RTP_MUX_GET_CLASS (rtp_mux);
+  guint32 ts;
 
   if (klass->accept_buffer_locked)
     if (!klass->accept_buffer_locked (rtp_mux, padpriv, rtpbuffer))
@@ -353,11 +350,14 @@ process_buffer_locked (GstRTPMux * rtp_mux, GstRTPMuxPadPrivate * padpriv,
   gst_rtp_buffer_set_seq (rtpbuffer, rtp_mux->seqnum);
 
   gst_rtp_buffer_set_ssrc (rtpbuffer, rtp_mux->current_ssrc);
-  gst_rtp_mux_readjust_rtp_timestamp_locked (rtp_mux, padpriv, rtpbuffer);
+
+  /* Put our own timestamp-offset on the buffer */
+  ts = gst_rtp_buffer_get_timestamp (rtpbuffer) + ts_adjust;
+  gst_rtp_buffer_set_timestamp (rtpbuffer, ts);
+
   GST_LOG_OBJECT (rtp_mux,
       "Pushing packet size %" G_GSIZE_FORMAT ", seq=%d, ts=%u",
-      rtpbuffer->map[0].size, rtp_mux->seqnum,
-      gst_rtp_buffer_get_timestamp (rtpbuffer));
+      rtpbuffer->map[0].size, rtp_mux->seqnum, ts);
 
   if (padpriv) {
     if (padpriv->segment.format == GST_FORMAT_TIME)
@@ -369,11 +369,28 @@ process_buffer_locked (GstRTPMux * rtp_mux, GstRTPMuxPadPrivate * padpriv,
   return TRUE;
 }
 
+static gboolean
+resend_events (GstPad * pad, GstEvent ** event, gpointer user_data)
+{
+  GstRTPMux *rtp_mux = user_data;
+
+  if (GST_EVENT_TYPE (*event) == GST_EVENT_CAPS) {
+    GstCaps *caps;
+
+    gst_event_parse_caps (*event, &caps);
+    gst_rtp_mux_setcaps (pad, rtp_mux, caps);
+  } else {
+    gst_pad_push_event (rtp_mux->srcpad, gst_event_ref (*event));
+  }
+
+  return TRUE;
+}
+
 struct BufferListData
 {
   GstRTPMux *rtp_mux;
   GstRTPMuxPadPrivate *padpriv;
-  gboolean drop;
+  guint32 ts_adjust;
 };
 
 static gboolean
@@ -381,17 +398,25 @@ process_list_item (GstBuffer ** buffer, guint idx, gpointer user_data)
 {
   struct BufferListData *bd = user_data;
   GstRTPBuffer rtpbuffer = GST_RTP_BUFFER_INIT;
+  gboolean drop;
 
   *buffer = gst_buffer_make_writable (*buffer);
 
-  gst_rtp_buffer_map (*buffer, GST_MAP_READWRITE, &rtpbuffer);
-
-  bd->drop = !process_buffer_locked (bd->rtp_mux, bd->padpriv, &rtpbuffer);
-
-  gst_rtp_buffer_unmap (&rtpbuffer);
+  if (!gst_rtp_buffer_map (*buffer, GST_MAP_READWRITE, &rtpbuffer)) {
+    GST_WARNING_OBJECT (bd->rtp_mux, "Dropping invalid RTP buffer from list");
+    drop = TRUE;
+  } else {
+    drop = !process_buffer_locked (bd->rtp_mux, bd->padpriv, bd->ts_adjust,
+        &rtpbuffer);
+    gst_rtp_buffer_unmap (&rtpbuffer);
+  }
 
-  if (bd->drop)
-    return FALSE;
+  if (drop) {
+    /* removes the buffer from the list, the others are still pushed */
+    gst_buffer_unref (*buffer);
+    *buffer = NULL;
+    return TRUE;
+  }
 
   if (GST_BUFFER_DURATION_IS_VALID (*buffer) &&
       GST_BUFFER_TIMESTAMP_IS_VALID (*buffer))
@@ -403,6 +428,8 @@ process_list_item (GstBuffer ** buffer, guint idx, gpointer user_data)
   return TRUE;
 }
 
+/* Rewrites the headers of all buffers in the list with a single acquisition
+ * of the object lock and pushes the list downstream in one go */
 static GstFlowReturn
 gst_rtp_mux_chain_list (GstPad * pad, GstObject * parent,
     GstBufferList * bufferlist)
@@ -411,6 +438,7 @@ gst_rtp_mux_chain_list (GstPad * pad, GstObject * parent,
   GstFlowReturn ret;
   GstRTPMuxPadPrivate *padpriv;
   struct BufferListData bd;
+  gboolean changed = FALSE;
 
   rtp_mux = GST_RTP_MUX (parent);
 
@@ -426,14 +454,23 @@ gst_rtp_mux_chain_list (GstPad * pad, GstObject * parent,
 
   bd.rtp_mux = rtp_mux;
   bd.padpriv = padpriv;
-  bd.drop = FALSE;
+  bd.ts_adjust = gst_rtp_mux_get_ts_adjust_locked (rtp_mux, padpriv);
 
   bufferlist = gst_buffer_list_make_writable (bufferlist);
   gst_buffer_list_foreach (bufferlist, process_list_item, &bd);
 
+  if (gst_buffer_list_length (bufferlist) > 0 && pad != rtp_mux->last_pad) {
+    changed = TRUE;
+    g_clear_object (&rtp_mux->last_pad);
+    rtp_mux->last_pad = g_object_ref (pad);
+  }
+
   GST_OBJECT_UNLOCK (rtp_mux);
 
-  if (bd.drop) {
+  if (changed)
+    gst_pad_sticky_events_foreach (pad, resend_events, rtp_mux);
+
+  if (gst_buffer_list_length (bufferlist) == 0) {
     gst_buffer_list_unref (bufferlist);
     ret = GST_FLOW_OK;
   } else {
@@ -445,23 +482,6 @@ out:
   return ret;
 }
 
-static gboolean
-resend_events (GstPad * pad, GstEvent ** event, gpointer user_data)
-{
-  GstRTPMux *rtp_mux = user_data;
-
-  if (GST_EVENT_TYPE (*event) == GST_EVENT_CAPS) {
-    GstCaps *caps;
-
-    gst_event_parse_caps (*event, &caps);
-    gst_rtp_mux_setcaps (pad, rtp_mux, caps);
-  } else {
-    gst_pad_push_event (rtp_mux->srcpad, gst_event_ref (*event));
-  }
-
-  return TRUE;
-}
-
 static GstFlowReturn
 gst_rtp_mux_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
 {
@@ -492,7 +512,8 @@ gst_rtp_mux_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
     return GST_FLOW_ERROR;
   }
 
-  drop = !process_buffer_locked (rtp_mux, padpriv, &rtpbuffer);
+  drop = !process_buffer_locked (rtp_mux, padpriv,
+      gst_rtp_mux_get_ts_adjust_locked (rtp_mux, padpriv), &rtpbuffer);
 
   gst_rtp_buffer_unmap (&rtpbuffer);
 
@@ -126,11 +126,13 @@ static gboolean gst_rtp_pt_demux_sink_event (GstPad * pad, GstObject * parent,
     GstEvent * event);
 static GstFlowReturn gst_rtp_pt_demux_chain (GstPad * pad, GstObject * parent,
     GstBuffer * buf);
+static GstFlowReturn gst_rtp_pt_demux_chain_list (GstPad * pad,
+    GstObject * parent, GstBufferList * list);
 static GstStateChangeReturn gst_rtp_pt_demux_change_state (GstElement * element,
     GstStateChange transition);
 static void gst_rtp_pt_demux_clear_pt_map (GstRtpPtDemux * rtpdemux);
 
-static GstPad *find_pad_for_pt (GstRtpPtDemux * rtpdemux, guint8 pt);
+static GstPad *find_pad_for_pt (GstRtpPtDemux * rtpdemux, guint pt);
 
 static gboolean gst_rtp_pt_demux_src_event (GstPad * pad, GstObject * parent,
     GstEvent * event);
@@ -231,6 +233,7 @@ gst_rtp_pt_demux_init (GstRtpPtDemux * ptdemux)
   g_assert (ptdemux->sink != NULL);
 
   gst_pad_set_chain_function (ptdemux->sink, gst_rtp_pt_demux_chain);
+  gst_pad_set_chain_list_function (ptdemux->sink, gst_rtp_pt_demux_chain_list);
   gst_pad_set_event_function (ptdemux->sink, gst_rtp_pt_demux_sink_event);
 
   gst_element_add_pad (GST_ELEMENT (ptdemux), ptdemux->sink);
@@ -291,43 +294,6 @@ gst_rtp_pt_demux_clear_pt_map (GstRtpPtDemux * rtpdemux)
   GST_OBJECT_UNLOCK (rtpdemux);
 }
 
-static gboolean
-need_caps_for_pt (GstRtpPtDemux * rtpdemux, guint8 pt)
-{
-  GSList *walk;
-  gboolean ret = FALSE;
-
-  GST_OBJECT_LOCK (rtpdemux);
-  for (walk = rtpdemux->srcpads; walk; walk = g_slist_next (walk)) {
-    GstRtpPtDemuxPad *pad = walk->data;
-
-    if (pad->pt == pt) {
-      ret = pad->newcaps;
-    }
-  }
-  GST_OBJECT_UNLOCK (rtpdemux);
-
-  return ret;
-}
-
-
-static void
-clear_newcaps_for_pt (GstRtpPtDemux * rtpdemux, guint8 pt)
-{
-  GSList *walk;
-
-  GST_OBJECT_LOCK (rtpdemux);
-  for (walk = rtpdemux->srcpads; walk; walk = g_slist_next (walk)) {
-    GstRtpPtDemuxPad *pad = walk->data;
-
-    if (pad->pt == pt) {
-      pad->newcaps = FALSE;
-      break;
-    }
-  }
-  GST_OBJECT_UNLOCK (rtpdemux);
-}
-
 static gboolean
 forward_sticky_events (GstPad * pad, GstEvent ** event, gpointer user_data)
 {
@@ -340,37 +306,35 @@ forward_sticky_events (GstPad * pad, GstEvent ** event, gpointer user_data)
   return TRUE;
 }
 
-static GstFlowReturn
-gst_rtp_pt_demux_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
+/* Returns a new reference to the srcpad for @pt, creating it when @pt was not
+ * seen before and refreshing its caps after the pt map was cleared. Returns
+ * NULL when no caps could be found for @pt. */
+static GstPad *
+gst_rtp_pt_demux_get_srcpad (GstRtpPtDemux * rtpdemux, guint8 pt)
 {
-  GstFlowReturn ret = GST_FLOW_OK;
-  GstRtpPtDemux *rtpdemux;
-  guint8 pt;
-  GstPad *srcpad;
+  GstRtpPtDemuxPad *dpad;
+  GstPad *srcpad = NULL;
+  gboolean newcaps = FALSE;
   GstCaps *caps;
-  GstRTPBuffer rtp = { NULL };
-
-  rtpdemux = GST_RTP_PT_DEMUX (parent);
-
-  if (!gst_rtp_buffer_map (buf, GST_MAP_READ, &rtp))
-    goto invalid_buffer;
 
-  pt = gst_rtp_buffer_get_payload_type (&rtp);
-  gst_rtp_buffer_unmap (&rtp);
-
-  GST_DEBUG_OBJECT (rtpdemux, "received buffer for pt %d", pt);
+  /* fast path, a single table lookup */
+  GST_OBJECT_LOCK (rtpdemux);
+  dpad = rtpdemux->pt_table[pt];
+  if (dpad) {
+    srcpad = gst_object_ref (dpad->pad);
+    newcaps = dpad->newcaps;
+  }
+  GST_OBJECT_UNLOCK (rtpdemux);
 
-  srcpad = find_pad_for_pt (rtpdemux, pt);
   if (srcpad == NULL) {
     /* new PT, create a src pad */
-    GstRtpPtDemuxPad *rtpdemuxpad;
     GstElementClass *klass;
     GstPadTemplate *templ;
     gchar *padname;
 
     caps = gst_rtp_pt_demux_get_caps (rtpdemux, pt);
     if (!caps)
-      goto no_caps;
+      return NULL;
 
     klass = GST_ELEMENT_GET_CLASS (rtpdemux);
     templ = gst_element_class_get_pad_template (klass, "src_%u");
@@ -381,13 +345,14 @@ gst_rtp_pt_demux_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
     gst_pad_set_event_function (srcpad, gst_rtp_pt_demux_src_event);
 
     GST_DEBUG ("Adding pt=%d to the list.", pt);
-    rtpdemuxpad = g_slice_new0 (GstRtpPtDemuxPad);
-    rtpdemuxpad->pt = pt;
-    rtpdemuxpad->newcaps = FALSE;
-    rtpdemuxpad->pad = srcpad;
+    dpad = g_slice_new0 (GstRtpPtDemuxPad);
+    dpad->pt = pt;
+    dpad->newcaps = FALSE;
+    dpad->pad = srcpad;
     gst_object_ref (srcpad);
     GST_OBJECT_LOCK (rtpdemux);
-    rtpdemux->srcpads = g_slist_append (rtpdemux->srcpads, rtpdemuxpad);
+    rtpdemux->srcpads = g_slist_append (rtpdemux->srcpads, dpad);
+    rtpdemux->pt_table[pt] = dpad;
     GST_OBJECT_UNLOCK (rtpdemux);
 
     gst_pad_set_active (srcpad, TRUE);
@@ -414,6 +379,35 @@ gst_rtp_pt_demux_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
         gst_rtp_pt_demux_signals[SIGNAL_NEW_PAYLOAD_TYPE], 0, pt, srcpad);
   }
 
+  while (newcaps) {
+    GST_DEBUG ("need new caps for %d", pt);
+    caps = gst_rtp_pt_demux_get_caps (rtpdemux, pt);
+    if (!caps) {
+      gst_object_unref (srcpad);
+      return NULL;
+    }
+
+    GST_OBJECT_LOCK (rtpdemux);
+    dpad->newcaps = FALSE;
+    GST_OBJECT_UNLOCK (rtpdemux);
+
+    caps = gst_caps_make_writable (caps);
+    gst_caps_set_simple (caps, "payload", G_TYPE_INT, pt, NULL);
+    gst_pad_set_caps (srcpad, caps);
+    gst_caps_unref (caps);
+
+    /* the map could have been cleared again while we were setting caps */
+    GST_OBJECT_LOCK (rtpdemux);
+    newcaps = dpad->newcaps;
+    GST_OBJECT_UNLOCK (rtpdemux);
+  }
+
+  return srcpad;
+}
+
+static void
+gst_rtp_pt_demux_check_pt_change (GstRtpPtDemux * rtpdemux, guint8 pt)
+{
   if (pt != rtpdemux->last_pt) {
     gint emit_pt = pt;
 
@@ -423,20 +417,32 @@ gst_rtp_pt_demux_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
     g_signal_emit (G_OBJECT (rtpdemux),
         gst_rtp_pt_demux_signals[SIGNAL_PAYLOAD_TYPE_CHANGE], 0, emit_pt);
   }
+}
 
-  while (need_caps_for_pt (rtpdemux, pt)) {
-    GST_DEBUG ("need new caps for %d", pt);
-    caps = gst_rtp_pt_demux_get_caps (rtpdemux, pt);
-    if (!caps)
-      goto no_caps;
+static GstFlowReturn
+gst_rtp_pt_demux_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
+{
+  GstFlowReturn ret = GST_FLOW_OK;
+  GstRtpPtDemux *rtpdemux;
+  guint8 pt;
+  GstPad *srcpad;
+  GstRTPBuffer rtp = { NULL };
 
-    clear_newcaps_for_pt (rtpdemux, pt);
+  rtpdemux = GST_RTP_PT_DEMUX (parent);
 
-    caps = gst_caps_make_writable (caps);
-    gst_caps_set_simple (caps, "payload", G_TYPE_INT, pt, NULL);
-    gst_pad_set_caps (srcpad, caps);
-    gst_caps_unref (caps);
-  }
+  if (!gst_rtp_buffer_map (buf, GST_MAP_READ, &rtp))
+    goto invalid_buffer;
+
+  pt = gst_rtp_buffer_get_payload_type (&rtp);
+  gst_rtp_buffer_unmap (&rtp);
+
+  GST_DEBUG_OBJECT (rtpdemux, "received buffer for pt %d", pt);
+
+  srcpad = gst_rtp_pt_demux_get_srcpad (rtpdemux, pt);
+  if (srcpad == NULL)
+    goto no_caps;
+
+  gst_rtp_pt_demux_check_pt_change (rtpdemux, pt);
 
   /* push to srcpad */
   ret = gst_pad_push (srcpad, buf);
@@ -459,27 +465,104 @@ no_caps:
     GST_ELEMENT_ERROR (rtpdemux, STREAM, DECODE, (NULL),
         ("Could not get caps for payload"));
     gst_buffer_unref (buf);
-    if (srcpad)
-      gst_object_unref (srcpad);
     return GST_FLOW_ERROR;
   }
 }
 
-static GstPad *
-find_pad_for_pt (GstRtpPtDemux * rtpdemux, guint8 pt)
+/* Splits @list into one sub-list per payload type, keeping the order of the
+ * packets within each payload type, and pushes every sub-list once, in the
+ * order the payload types were first seen. */
+static GstFlowReturn
+gst_rtp_pt_demux_chain_list (GstPad * pad, GstObject * parent,
+    GstBufferList * list)
 {
-  GstPad *respad = NULL;
-  GSList *walk;
+  GstRtpPtDemux *rtpdemux;
+  GstBufferList *sublists[G_N_ELEMENTS (rtpdemux->pt_table)] = { NULL, };
+  GstPad *srcpads[G_N_ELEMENTS (rtpdemux->pt_table)] = { NULL, };
+  guint8 order[G_N_ELEMENTS (rtpdemux->pt_table)];
+  guint i, len, n_pts = 0;
+  GstFlowReturn ret;
 
-  GST_OBJECT_LOCK (rtpdemux);
-  for (walk = rtpdemux->srcpads; walk; walk = g_slist_next (walk)) {
-    GstRtpPtDemuxPad *pad = walk->data;
+  rtpdemux = GST_RTP_PT_DEMUX (parent);
 
-    if (pad->pt == pt) {
-      respad = gst_object_ref (pad->pad);
-      break;
+  len = gst_buffer_list_length (list);
+  for (i = 0; i < len; i++) {
+    GstBuffer *buf = gst_buffer_list_get (list, i);
+    GstRTPBuffer rtp = { NULL };
+    guint8 pt;
+
+    if (!gst_rtp_buffer_map (buf, GST_MAP_READ, &rtp)) {
+      /* this should not be fatal, just drop it from the list */
+      GST_ELEMENT_WARNING (rtpdemux, STREAM, DEMUX, (NULL),
+          ("Dropping invalid RTP payload"));
+      continue;
+    }
+    pt = gst_rtp_buffer_get_payload_type (&rtp);
+    gst_rtp_buffer_unmap (&rtp);
+
+    if (sublists[pt] == NULL) {
+      GST_DEBUG_OBJECT (rtpdemux, "received list with pt %d", pt);
+
+      srcpads[pt] = gst_rtp_pt_demux_get_srcpad (rtpdemux, pt);
+      if (srcpads[pt] == NULL)
+        goto no_caps;
+
+      sublists[pt] = gst_buffer_list_new ();
+      order[n_pts++] = pt;
+    }
+
+    gst_buffer_list_add (sublists[pt], gst_buffer_ref (buf));
+  }
+  gst_buffer_list_unref (list);
+
+  /* only not-linked when none of the payload types is linked */
+  ret = n_pts > 0 ? GST_FLOW_NOT_LINKED : GST_FLOW_OK;
+  for (i = 0; i < n_pts; i++) {
+    guint8 pt = order[i];
+    GstFlowReturn fret;
+
+    /* the sub-lists go out one after the other, so does the change */
+    gst_rtp_pt_demux_check_pt_change (rtpdemux, pt);
+
+    fret = gst_pad_push_list (srcpads[pt], sublists[pt]);
+    gst_object_unref (srcpads[pt]);
+
+    if (fret == GST_FLOW_OK) {
+      if (ret == GST_FLOW_NOT_LINKED)
+        ret = GST_FLOW_OK;
+    } else if (fret != GST_FLOW_NOT_LINKED
+        && (ret == GST_FLOW_OK || ret == GST_FLOW_NOT_LINKED)) {
+      ret = fret;
     }
   }
+
+  return ret;
+
+  /* ERRORS */
+no_caps:
+  {
+    GST_ELEMENT_ERROR (rtpdemux, STREAM, DECODE, (NULL),
+        ("Could not get caps for payload"));
+    for (i = 0; i < n_pts; i++) {
+      gst_buffer_list_unref (sublists[order[i]]);
+      gst_object_unref (srcpads[order[i]]);
+    }
+    gst_buffer_list_unref (list);
+    return GST_FLOW_ERROR;
+  }
+}
+
+static GstPad *
+find_pad_for_pt (GstRtpPtDemux * rtpdemux, guint pt)
+{
+  GstPad *respad = NULL;
+
+  if (pt >= G_N_ELEMENTS (rtpdemux->pt_table))
+    return NULL;
+
+  GST_OBJECT_LOCK (rtpdemux);
+  if (rtpdemux->pt_table[pt])
+    respad = gst_object_ref (rtpdemux->pt_table[pt]->pad);
   GST_OBJECT_UNLOCK (rtpdemux);
 
   return respad;
@@ -581,6 +664,7 @@ static gboolean
 gst_rtp_pt_demux_setup (GstRtpPtDemux * ptdemux)
 {
   ptdemux->srcpads = NULL;
+  memset (ptdemux->pt_table, 0, sizeof (ptdemux->pt_table));
   ptdemux->last_pt = 0xFFFF;
 
   return TRUE;
@@ -598,6 +682,7 @@ gst_rtp_pt_demux_release (GstRtpPtDemux * ptdemux)
   GST_OBJECT_LOCK (ptdemux);
   tmppads = ptdemux->srcpads;
   ptdemux->srcpads = NULL;
+  memset (ptdemux->pt_table, 0, sizeof (ptdemux->pt_table));
   GST_OBJECT_UNLOCK (ptdemux);
 
   for (walk = tmppads; walk; walk = g_slist_next (walk)) {
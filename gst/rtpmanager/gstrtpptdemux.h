@@ -39,6 +39,7 @@ struct _GstRtpPtDemux
   GstPad *sink;       /**< the sink pad */
   guint16 last_pt;    /**< pt of the last packet 0xFFFF if none */
   GSList *srcpads;    /**< a linked list of GstRtpPtDemuxPad objects */
+  GstRtpPtDemuxPad *pt_table[128]; /**< srcpads indexed by the 7 bit pt */
 };
 
 struct _GstRtpPtDemuxClass
@@ -67,6 +67,7 @@ enum
 #define DEFAULT_RTCP_MIN_INTERVAL    (RTP_STATS_MIN_INTERVAL * GST_SECOND)
 #define DEFAULT_RTCP_FEEDBACK_RETENTION_WINDOW (2 * GST_SECOND)
 #define DEFAULT_RTCP_IMMEDIATE_FEEDBACK_THRESHOLD (3)
+#define DEFAULT_RTCP_PLI_MIN_INTERVAL (0)
 #define DEFAULT_PROBATION            RTP_DEFAULT_PROBATION
 #define DEFAULT_RTP_PROFILE          GST_RTP_PROFILE_AVP
 
@@ -88,6 +89,7 @@ enum
   PROP_RTCP_MIN_INTERVAL,
   PROP_RTCP_FEEDBACK_RETENTION_WINDOW,
   PROP_RTCP_IMMEDIATE_FEEDBACK_THRESHOLD,
+  PROP_RTCP_PLI_MIN_INTERVAL,
   PROP_PROBATION,
   PROP_STATS,
   PROP_RTP_PROFILE
@@ -112,6 +114,8 @@ static void rtp_session_get_property (GObject * object, guint prop_id,
 
 static gboolean rtp_session_send_rtcp (RTPSession * sess,
     GstClockTime max_delay);
+static void rtp_session_release_deferred_plis (RTPSession * sess,
+    GstClockTime current_time);
 
 static guint rtp_session_signals[LAST_SIGNAL] = { 0 };
 
@@ -476,6 +480,19 @@ rtp_session_class_init (RTPSessionClass * klass)
           0, G_MAXUINT, DEFAULT_RTCP_IMMEDIATE_FEEDBACK_THRESHOLD,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | G_PARAM_DEPRECATED));
 
+  /**
+   * RTPSession:rtcp-pli-min-interval:
+   *
+   * Key unit requests for a source that arrive within this interval after the
+   * last PLI that was sent for it are coalesced into a single PLI, which is
+   * sent once the interval expired. 0 disables the coalescing.
+   */
+  g_object_class_install_property (gobject_class, PROP_RTCP_PLI_MIN_INTERVAL,
+      g_param_spec_uint64 ("rtcp-pli-min-interval", "Minimum PLI interval",
+          "Minimum interval between PLI packets for the same source (in ns)",
+          0, G_MAXUINT64, DEFAULT_RTCP_PLI_MIN_INTERVAL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   g_object_class_install_property (gobject_class, PROP_PROBATION,
       g_param_spec_uint ("probation", "Number of probations",
           "Consecutive packet sequence numbers to accept the source",
@@ -492,6 +509,11 @@ rtp_session_class_init (RTPSessionClass * klass)
    *      dropped (due to bandwidth constraints)
    *  "sent-nack-count" G_TYPE_UINT   Number of NACKs sent
    *  "recv-nack-count" G_TYPE_UINT   Number of NACKs received
+   *  "coalesced-nack-count" G_TYPE_UINT   Number of NACK requests that were
+   *      added to already scheduled feedback
+   *  "suppressed-pli-count" G_TYPE_UINT   Number of PLI requests that were
+   *      merged into a pending PLI for the source, or deferred because one
+   *      was sent recently
    *
    * Since: 1.4
    */
@@ -578,9 +600,11 @@ rtp_session_init (RTPSession * sess)
   sess->last_rtcp_interval = GST_CLOCK_TIME_NONE;
 
   sess->next_early_rtcp_time = GST_CLOCK_TIME_NONE;
+  sess->next_deferred_pli_time = GST_CLOCK_TIME_NONE;
   sess->rtcp_feedback_retention_window = DEFAULT_RTCP_FEEDBACK_RETENTION_WINDOW;
   sess->rtcp_immediate_feedback_threshold =
       DEFAULT_RTCP_IMMEDIATE_FEEDBACK_THRESHOLD;
+  sess->rtcp_pli_min_interval = DEFAULT_RTCP_PLI_MIN_INTERVAL;
   sess->rtp_profile = DEFAULT_RTP_PROFILE;
 
   sess->last_keyframe_request = GST_CLOCK_TIME_NONE;
@@ -650,7 +674,9 @@ rtp_session_create_stats (RTPSession * sess)
   s = gst_structure_new ("application/x-rtp-session-stats",
       "rtx-drop-count", G_TYPE_UINT, sess->stats.nacks_dropped,
       "sent-nack-count", G_TYPE_UINT, sess->stats.nacks_sent,
-      "recv-nack-count", G_TYPE_UINT, sess->stats.nacks_received, NULL);
+      "recv-nack-count", G_TYPE_UINT, sess->stats.nacks_received,
+      "coalesced-nack-count", G_TYPE_UINT, sess->stats.nacks_coalesced,
+      "suppressed-pli-count", G_TYPE_UINT, sess->stats.plis_suppressed, NULL);
 
   return s;
 }
@@ -718,6 +744,11 @@ rtp_session_set_property (GObject * object, guint prop_id,
     case PROP_RTCP_IMMEDIATE_FEEDBACK_THRESHOLD:
       sess->rtcp_immediate_feedback_threshold = g_value_get_uint (value);
       break;
+    case PROP_RTCP_PLI_MIN_INTERVAL:
+      RTP_SESSION_LOCK (sess);
+      sess->rtcp_pli_min_interval = g_value_get_uint64 (value);
+      RTP_SESSION_UNLOCK (sess);
+      break;
     case PROP_PROBATION:
       sess->probation = g_value_get_uint (value);
       break;
@@ -788,6 +819,11 @@ rtp_session_get_property (GObject * object, guint prop_id,
     case PROP_RTCP_IMMEDIATE_FEEDBACK_THRESHOLD:
       g_value_set_uint (value, sess->rtcp_immediate_feedback_threshold);
       break;
+    case PROP_RTCP_PLI_MIN_INTERVAL:
+      RTP_SESSION_LOCK (sess);
+      g_value_set_uint64 (value, sess->rtcp_pli_min_interval);
+      RTP_SESSION_UNLOCK (sess);
+      break;
     case PROP_PROBATION:
       g_value_set_uint (value, sess->probation);
       break;
@@ -3060,6 +3096,10 @@ rtp_session_next_timeout (RTPSession * sess, GstClockTime current_time)
   sess->next_rtcp_check_time = result;
 
 early_exit:
+  /* wake up in time for PLIs that were held back */
+  if (GST_CLOCK_TIME_IS_VALID (sess->next_deferred_pli_time) &&
+      (result == GST_CLOCK_TIME_NONE || sess->next_deferred_pli_time < result))
+    result = sess->next_deferred_pli_time;
 
   GST_DEBUG ("current time: %" GST_TIME_FORMAT
       ", next time: %" GST_TIME_FORMAT,
@@ -3292,6 +3332,7 @@ session_pli (const gchar * key, RTPSource * source, ReportData * data)
   gst_rtcp_packet_fb_set_media_ssrc (packet, source->ssrc);
 
   source->send_pli = FALSE;
+  source->last_sent_pli = data->current_time;
   data->may_suppress = FALSE;
 
   source->stats.sent_pli_count++;
@@ -3785,6 +3826,8 @@ rtp_session_on_timeout (RTPSession * sess, GstClockTime current_time,
       ", running-time %" GST_TIME_FORMAT, GST_TIME_ARGS (current_time),
       GST_TIME_ARGS (ntpnstime), GST_TIME_ARGS (running_time));
 
+  rtp_session_release_deferred_plis (sess, current_time);
+
   data.sess = sess;
   data.current_time = current_time;
   data.ntpnstime = ntpnstime;
@@ -4088,12 +4131,110 @@ rtp_session_send_rtcp (RTPSession * sess, GstClockTime max_delay)
   return rtp_session_request_early_rtcp (sess, now, max_delay);
 }
 
+/* check if a PLI request for @ssrc does not need a new early RTCP packet
+ * because a PLI is already scheduled, or because one was sent less than
+ * rtcp-pli-min-interval ago. In the latter case the PLI is held back and
+ * sent once the interval expired. */
+static gboolean
+rtp_session_coalesce_pli (RTPSession * sess, guint32 ssrc)
+{
+  RTPSource *src;
+  GstClockTime now = GST_CLOCK_TIME_NONE;
+  gboolean ret = FALSE, deferred = FALSE;
+
+  if (sess->rtcp_pli_min_interval > 0 && sess->callbacks.request_time)
+    now = sess->callbacks.request_time (sess, sess->request_time_user_data);
+
+  RTP_SESSION_LOCK (sess);
+  src = find_source (sess, ssrc);
+  if (src == NULL)
+    goto done;
+
+  if (src->send_pli || src->send_fir || src->pli_deferred) {
+    GST_DEBUG ("PLI for %08x already scheduled", ssrc);
+    ret = TRUE;
+  } else if (GST_CLOCK_TIME_IS_VALID (now) &&
+      GST_CLOCK_TIME_IS_VALID (src->last_sent_pli) &&
+      now < src->last_sent_pli + sess->rtcp_pli_min_interval) {
+    GstClockTime release = src->last_sent_pli + sess->rtcp_pli_min_interval;
+
+    GST_DEBUG ("PLI for %08x sent %" GST_TIME_FORMAT " ago, deferring",
+        ssrc, GST_TIME_ARGS (now - src->last_sent_pli));
+    src->pli_deferred = TRUE;
+    if (!GST_CLOCK_TIME_IS_VALID (sess->next_deferred_pli_time) ||
+        release < sess->next_deferred_pli_time) {
+      sess->next_deferred_pli_time = release;
+      deferred = TRUE;
+    }
+    ret = TRUE;
+  }
+
+  if (ret)
+    sess->stats.plis_suppressed++;
+
+done:
+  RTP_SESSION_UNLOCK (sess);
+
+  /* the RTCP thread has to wake up earlier now */
+  if (deferred && sess->callbacks.reconsider)
+    sess->callbacks.reconsider (sess, sess->reconsider_user_data);
+
+  return ret;
+}
+
+/* schedules the PLIs that were held back by rtcp-pli-min-interval and whose
+ * interval expired */
+static void
+rtp_session_release_deferred_plis (RTPSession * sess,
+    GstClockTime current_time)
+{
+  GHashTableIter iter;
+  RTPSource *src;
+  GstClockTime next = GST_CLOCK_TIME_NONE;
+  gboolean released = FALSE;
+
+  RTP_SESSION_LOCK (sess);
+  if (!GST_CLOCK_TIME_IS_VALID (sess->next_deferred_pli_time) ||
+      current_time < sess->next_deferred_pli_time) {
+    RTP_SESSION_UNLOCK (sess);
+    return;
+  }
+
+  g_hash_table_iter_init (&iter, sess->ssrcs[sess->mask_idx]);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) & src)) {
+    GstClockTime release;
+
+    if (!src->pli_deferred)
+      continue;
+
+    release = src->last_sent_pli + sess->rtcp_pli_min_interval;
+    if (release <= current_time) {
+      GST_DEBUG ("sending deferred PLI for %08x", src->ssrc);
+      src->pli_deferred = FALSE;
+      if (!src->send_fir)
+        src->send_pli = TRUE;
+      released = TRUE;
+    } else if (!GST_CLOCK_TIME_IS_VALID (next) || release < next) {
+      next = release;
+    }
+  }
+  sess->next_deferred_pli_time = next;
+  RTP_SESSION_UNLOCK (sess);
+
+  if (released)
+    rtp_session_request_early_rtcp (sess, current_time, 5 * GST_SECOND);
+}
+
 gboolean
 rtp_session_request_key_unit (RTPSession * sess, guint32 ssrc,
     gboolean fir, gint count)
 {
   RTPSource *src;
 
+  /* coalesce PLIs without asking for yet another early RTCP packet */
+  if (!fir && rtp_session_coalesce_pli (sess, ssrc))
+    return TRUE;
+
   if (!rtp_session_send_rtcp (sess, 5 * GST_SECOND)) {
     GST_DEBUG ("FIR/PLI not sent");
     return FALSE;
@@ -4106,6 +4247,7 @@ rtp_session_request_key_unit (RTPSession * sess, guint32 ssrc,
 
   if (fir) {
     src->send_pli = FALSE;
+    src->pli_deferred = FALSE;
     src->send_fir = TRUE;
 
     if (count == -1 || count != src->last_fir_count)
@@ -4133,7 +4275,8 @@ no_source:
  * @seqnum: the missing seqnum
  * @max_delay: max delay to request NACK
  *
- * Request scheduling of a NACK feedback packet for @seqnum in @ssrc.
+ * Request scheduling of a NACK feedback packet for @seqnum in @ssrc. When
+ * NACKs for @ssrc are already pending, @seqnum is added to them.
  *
  * Returns: %TRUE if the NACK feedback could be scheduled
  */
@@ -4154,6 +4297,8 @@ rtp_session_request_nack (RTPSession * sess, guint32 ssrc, guint16 seqnum,
     goto no_source;
 
   GST_DEBUG ("request NACK for %08x, #%u", ssrc, seqnum);
+  if (source->send_nack)
+    sess->stats.nacks_coalesced++;
   rtp_source_register_nack (source, seqnum);
   RTP_SESSION_UNLOCK (sess);
 
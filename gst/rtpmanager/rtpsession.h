@@ -249,6 +249,8 @@ struct _RTPSession {
   gboolean      allow_early;
 
   GstClockTime  next_early_rtcp_time;
+  /* earliest time a PLI held back by rtcp-pli-min-interval can be sent */
+  GstClockTime  next_deferred_pli_time;
 
   gboolean      scheduled_bye;
 
@@ -270,6 +272,7 @@ struct _RTPSession {
   gboolean      favor_new;
   GstClockTime  rtcp_feedback_retention_window;
   guint         rtcp_immediate_feedback_threshold;
+  GstClockTime  rtcp_pli_min_interval;
 
   GstClockTime last_keyframe_request;
   gboolean     last_keyframe_all_headers;
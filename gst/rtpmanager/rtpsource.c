@@ -262,6 +262,7 @@ rtp_source_init (RTPSource * src)
   src->last_rtptime = -1;
 
   src->retained_feedback = g_queue_new ();
+  src->last_sent_pli = GST_CLOCK_TIME_NONE;
   src->nacks = g_array_new (FALSE, FALSE, sizeof (guint32));
 
   src->reported_in_sr_of = g_hash_table_new (g_direct_hash, g_direct_equal);
@@ -1784,14 +1785,16 @@ rtp_source_has_retained (RTPSource * src, GCompareFunc func, gconstpointer data)
  * @src: The #RTPSource
  * @seqnum: a seqnum
  *
- * Register that @seqnum has not been received from @src.
+ * Register that @seqnum has not been received from @src. When possible the
+ * seqnum is merged into the bitmask of lost packets (BLP) of a nearby
+ * recorded NACK so that a generic NACK FCI covers up to 17 seqnums.
  */
 void
 rtp_source_register_nack (RTPSource * src, guint16 seqnum)
 {
   guint i, len;
   guint32 dword = seqnum << 16;
-  gint diff = 16;
+  gint diff = 17;
 
   len = src->nacks->len;
   for (i = 0; i < len; i++) {
@@ -1802,18 +1805,31 @@ rtp_source_register_nack (RTPSource * src, guint16 seqnum)
     tseq = tdword >> 16;
 
     diff = gst_rtp_buffer_compare_seqnum (tseq, seqnum);
-    if (diff < 16)
+    if (diff <= 16)
       break;
   }
   /* we already have this seqnum */
   if (diff == 0)
     return;
-  /* it comes before the recorded seqnum, FIXME, we could merge it
-   * if not to far away */
   if (diff < 0) {
-    GST_DEBUG ("insert NACK #%u at %u", seqnum, i);
-    g_array_insert_val (src->nacks, i, dword);
-  } else if (diff < 16) {
+    guint32 tdword = g_array_index (src->nacks, guint32, i);
+    guint32 blp = G_MAXUINT32;
+
+    /* it comes before the recorded seqnum, we can make it the new PID when
+     * the bitmask of the recorded seqnum still fits after shifting */
+    if (diff >= -16)
+      blp = ((tdword & 0xffff) << -diff) | (1 << (-diff - 1));
+
+    if (blp <= 0xffff) {
+      dword |= blp;
+      GST_DEBUG ("merge NACK #%u at %u with NACK #%u -> 0x%08x", seqnum, i,
+          tdword >> 16, dword);
+      g_array_index (src->nacks, guint32, i) = dword;
+    } else {
+      GST_DEBUG ("insert NACK #%u at %u", seqnum, i);
+      g_array_insert_val (src->nacks, i, dword);
+    }
+  } else if (diff <= 16) {
     /* we can merge it */
     dword = g_array_index (src->nacks, guint32, i);
     dword |= 1 << (diff - 1);
@@ -186,6 +186,8 @@ struct _RTPSource {
   GQueue        *retained_feedback;
 
   gboolean     send_pli;
+  GstClockTime last_sent_pli;
+  gboolean     pli_deferred;
   gboolean     send_fir;
   guint8       current_send_fir_seqnum;
   gint         last_fir_count;
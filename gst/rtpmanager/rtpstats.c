@@ -34,6 +34,8 @@ rtp_stats_init_defaults (RTPSessionStats * stats)
   stats->nacks_dropped = 0;
   stats->nacks_sent = 0;
   stats->nacks_received = 0;
+  stats->nacks_coalesced = 0;
+  stats->plis_suppressed = 0;
 }
 
 /**
@@ -214,6 +214,8 @@ typedef struct {
   guint         nacks_dropped;
   guint         nacks_sent;
   guint         nacks_received;
+  guint         nacks_coalesced;
+  guint         plis_suppressed;
 } RTPSessionStats;
 
 void           rtp_stats_init_defaults              (RTPSessionStats *stats);
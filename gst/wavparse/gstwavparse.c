@@ -72,6 +72,9 @@ GST_DEBUG_CATEGORY_STATIC (wavparse_debug);
  * see http://tech.ebu.ch/docs/tech/tech3306-2009.pdf */
 #define GST_RS64_TAG_DS64 GST_MAKE_FOURCC ('d','s','6','4')
 
+/* header reads in pull mode are served from blocks of this size */
+#define HEADER_BLOCK_SIZE (256 * 1024)
+
 static void gst_wavparse_dispose (GObject * object);
 
 static gboolean gst_wavparse_sink_activate (GstPad * sinkpad,
@@ -221,6 +224,7 @@ gst_wavparse_reset (GstWavParse * wav)
   wav->datastart = 0;
   wav->duration = 0;
   wav->got_fmt = FALSE;
+  wav->got_data = FALSE;
   wav->first = TRUE;
 
   if (wav->seek_event)
@@ -249,6 +253,7 @@ gst_wavparse_reset (GstWavParse * wav)
   if (wav->start_segment)
     gst_event_unref (wav->start_segment);
   wav->start_segment = NULL;
+  gst_buffer_replace (&wav->header_block, NULL);
 }
 
 static void
@@ -346,7 +351,12 @@ gst_wavparse_time_to_bytepos (GstWavParse * wav, gint64 ts, gint64 * bytepos)
     return TRUE;
   }
 
-  if (wav->bps > 0) {
+  /* one block per sample: go through the sample number, which is exact */
+  if (wav->bps > 0 && wav->bps == (guint64) wav->rate * wav->bytes_per_sample) {
+    *bytepos = gst_util_uint64_scale (ts, wav->rate, GST_SECOND) *
+        wav->bytes_per_sample;
+    return TRUE;
+  } else if (wav->bps > 0) {
     *bytepos = gst_util_uint64_scale_ceil (ts, (guint64) wav->bps, GST_SECOND);
     return TRUE;
   } else if (wav->fact) {
@@ -1060,6 +1070,76 @@ parse_ds64 (GstWavParse * wav, GstBuffer * buf)
   return TRUE;
 }
 
+/* Pull @size bytes at @offset while parsing the headers. Reads are done in
+ * large blocks that the chunk headers and small chunks are then taken from,
+ * so walking the chunks does not take a pull each. */
+static GstFlowReturn
+gst_wavparse_pull_header (GstWavParse * wav, guint64 offset, guint size,
+    GstBuffer ** buf)
+{
+  GstFlowReturn res;
+  gsize avail;
+
+  if (wav->header_block && offset >= wav->header_block_offset &&
+      offset + size <= wav->header_block_offset +
+      gst_buffer_get_size (wav->header_block)) {
+    *buf = gst_buffer_copy_region (wav->header_block, GST_BUFFER_COPY_ALL,
+        offset - wav->header_block_offset, size);
+    return GST_FLOW_OK;
+  }
+
+  if (size > HEADER_BLOCK_SIZE)
+    return gst_pad_pull_range (wav->sinkpad, offset, size, buf);
+
+  gst_buffer_replace (&wav->header_block, NULL);
+  if ((res = gst_pad_pull_range (wav->sinkpad, offset, HEADER_BLOCK_SIZE,
+              &wav->header_block)) != GST_FLOW_OK)
+    return res;
+  wav->header_block_offset = offset;
+
+  /* short read at the end of the file */
+  avail = gst_buffer_get_size (wav->header_block);
+  *buf = gst_buffer_copy_region (wav->header_block, GST_BUFFER_COPY_ALL, 0,
+      MIN (size, avail));
+
+  return GST_FLOW_OK;
+}
+
+/* like gst_riff_read_chunk(), but reading through the header blocks */
+static GstFlowReturn
+gst_wavparse_read_chunk (GstWavParse * wav, guint32 * tag, GstBuffer ** buf)
+{
+  GstFlowReturn res;
+  GstBuffer *hdr;
+  guint32 size;
+
+  if ((res = gst_wavparse_pull_header (wav, wav->offset, 8,
+              &hdr)) != GST_FLOW_OK)
+    return res;
+  if (gst_buffer_get_size (hdr) < 8) {
+    gst_buffer_unref (hdr);
+    return GST_FLOW_EOS;
+  }
+  gst_buffer_extract (hdr, 0, tag, 4);
+  *tag = GUINT32_FROM_LE (*tag);
+  gst_buffer_extract (hdr, 4, &size, 4);
+  size = GUINT32_FROM_LE (size);
+  gst_buffer_unref (hdr);
+
+  if ((res = gst_wavparse_pull_header (wav, wav->offset + 8, size,
+              buf)) != GST_FLOW_OK)
+    return res;
+  if (gst_buffer_get_size (*buf) < size) {
+    gst_buffer_unref (*buf);
+    *buf = NULL;
+    return GST_FLOW_EOS;
+  }
+
+  wav->offset += 8 + GST_ROUND_UP_2 (size);
+
+  return GST_FLOW_OK;
+}
+
 static GstFlowReturn
 gst_wavparse_stream_headers (GstWavParse * wav)
 {
@@ -1095,8 +1175,7 @@ gst_wavparse_stream_headers (GstWavParse * wav)
         buf = gst_buffer_new ();
       }
     } else {
-      if ((res = gst_riff_read_chunk (GST_ELEMENT_CAST (wav), wav->sinkpad,
-                  &wav->offset, &tag, &buf)) != GST_FLOW_OK)
+      if ((res = gst_wavparse_read_chunk (wav, &tag, &buf)) != GST_FLOW_OK)
         return res;
     }
 
@@ -1188,6 +1267,13 @@ gst_wavparse_stream_headers (GstWavParse * wav)
       case GST_RIFF_WAVE_FORMAT_PCM:
         if (wav->blockalign > wav->channels * ((wav->depth + 7) / 8))
           goto invalid_blockalign;
+        /* the byte rate follows from the format, do not let a wrong one in
+         * the header put timestamps and seeking off */
+        if (wav->av_bps != wav->blockalign * wav->rate) {
+          GST_WARNING_OBJECT (wav, "fixing av_bps from %u to %u", wav->av_bps,
+              wav->blockalign * wav->rate);
+          wav->av_bps = wav->blockalign * wav->rate;
+        }
         /* fall through */
       default:
         if (wav->av_bps > wav->blockalign * wav->rate)
@@ -1251,7 +1337,7 @@ gst_wavparse_stream_headers (GstWavParse * wav)
 
       buf = NULL;
       if ((res =
-              gst_pad_pull_range (wav->sinkpad, wav->offset, 8,
+              gst_wavparse_pull_header (wav, wav->offset, 8,
                   &buf)) != GST_FLOW_OK)
         goto header_read_error;
       gst_buffer_map (buf, &map, GST_MAP_READ);
@@ -1284,6 +1370,13 @@ gst_wavparse_stream_headers (GstWavParse * wav)
         guint64 size64;
 
         GST_DEBUG_OBJECT (wav, "Got 'data' TAG, size : %u", size);
+        if (!wav->streaming && wav->got_data) {
+          /* only the first data chunk is played */
+          GST_WARNING_OBJECT (wav, "Ignoring additional data chunk at %"
+              G_GUINT64_FORMAT, wav->offset);
+          gst_waveparse_ignore_chunk (wav, buf, tag, size);
+          break;
+        }
         size64 = size;
         if (wav->ignore_length) {
           GST_DEBUG_OBJECT (wav, "Ignoring length");
@@ -1315,6 +1408,7 @@ gst_wavparse_stream_headers (GstWavParse * wav)
         wav->dataleft = size64;
         wav->end_offset = size64 + wav->datastart;
         if (!wav->streaming) {
+          wav->got_data = TRUE;
           /* We will continue parsing tags 'till end */
           wav->offset += size64;
         }
@@ -1353,7 +1447,7 @@ gst_wavparse_stream_headers (GstWavParse * wav)
             gst_buffer_unref (buf);
             buf = NULL;
             if ((res =
-                    gst_pad_pull_range (wav->sinkpad, wav->offset + 8,
+                    gst_wavparse_pull_header (wav, wav->offset + 8,
                         data_size, &buf)) != GST_FLOW_OK)
               goto header_read_error;
             gst_buffer_extract (buf, 0, &wav->fact, 4);
@@ -1400,7 +1494,7 @@ gst_wavparse_stream_headers (GstWavParse * wav)
           gst_buffer_unref (buf);
           buf = NULL;
           if ((res =
-                  gst_pad_pull_range (wav->sinkpad, wav->offset + 8,
+                  gst_wavparse_pull_header (wav, wav->offset + 8,
                       size, &buf)) != GST_FLOW_OK)
             goto header_read_error;
           gst_buffer_map (buf, &map, GST_MAP_READ);
@@ -1440,7 +1534,7 @@ gst_wavparse_stream_headers (GstWavParse * wav)
           gst_buffer_unref (buf);
           buf = NULL;
           if ((res =
-                  gst_pad_pull_range (wav->sinkpad, wav->offset, 12,
+                  gst_wavparse_pull_header (wav, wav->offset, 12,
                       &buf)) != GST_FLOW_OK)
             goto header_read_error;
           gst_buffer_extract (buf, 8, &ltag, 4);
@@ -1469,7 +1563,7 @@ gst_wavparse_stream_headers (GstWavParse * wav)
               buf = NULL;
               if (data_size > 0) {
                 if ((res =
-                        gst_pad_pull_range (wav->sinkpad, wav->offset,
+                        gst_wavparse_pull_header (wav, wav->offset,
                             data_size, &buf)) != GST_FLOW_OK)
                   goto header_read_error;
               }
@@ -1509,7 +1603,7 @@ gst_wavparse_stream_headers (GstWavParse * wav)
               buf = NULL;
               wav->offset += 12;
               if ((res =
-                      gst_pad_pull_range (wav->sinkpad, wav->offset,
+                      gst_wavparse_pull_header (wav, wav->offset,
                           data_size, &buf)) != GST_FLOW_OK)
                 goto header_read_error;
               gst_buffer_map (buf, &map, GST_MAP_READ);
@@ -1554,7 +1648,7 @@ gst_wavparse_stream_headers (GstWavParse * wav)
           gst_buffer_unref (buf);
           buf = NULL;
           if ((res =
-                  gst_pad_pull_range (wav->sinkpad, wav->offset,
+                  gst_wavparse_pull_header (wav, wav->offset,
                       data_size, &buf)) != GST_FLOW_OK)
             goto header_read_error;
           gst_buffer_map (buf, &map, GST_MAP_READ);
@@ -1598,7 +1692,7 @@ gst_wavparse_stream_headers (GstWavParse * wav)
           gst_buffer_unref (buf);
           buf = NULL;
           if ((res =
-                  gst_pad_pull_range (wav->sinkpad, wav->offset,
+                  gst_wavparse_pull_header (wav, wav->offset,
                       data_size, &buf)) != GST_FLOW_OK)
             goto header_read_error;
           gst_buffer_map (buf, &map, GST_MAP_READ);
@@ -1634,6 +1728,7 @@ gst_wavparse_stream_headers (GstWavParse * wav)
   }
 
   GST_DEBUG_OBJECT (wav, "Finished parsing headers");
+  gst_buffer_replace (&wav->header_block, NULL);
 
   if (wav->bps <= 0 && wav->fact) {
 #if 0
@@ -108,6 +108,12 @@ struct _GstWavParse {
   /* pending seek */
   GstEvent *seek_event;
 
+  /* pull mode: block that header reads are served from */
+  GstBuffer *header_block;
+  guint64 header_block_offset;
+  /* pull mode: the data chunk was found, later ones are ignored */
+  gboolean got_data;
+
   /* For streaming */
   GstAdapter *adapter;
   gboolean got_fmt;
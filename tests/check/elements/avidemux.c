@@ -0,0 +1,299 @@
+/* GStreamer unit tests for avidemux
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+
+#include <gst/gst.h>
+#include <glib/gstdio.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#define N_FRAMES 60
+#define FRAME_DURATION (GST_SECOND / 25)
+
+/* three chunks in a row larger than the 1 MiB blocks the index scan reads,
+ * every 20 frames, small chunks of odd and even sizes in between */
+static guint
+frame_size (guint i)
+{
+  if (i % 20 >= 10 && i % 20 < 13)
+    return 3 * 1024 * 1024 / 2 + i;
+  return 101 + i;
+}
+
+static void
+append_uint32 (GByteArray * data, guint32 val)
+{
+  guint8 bytes[4];
+
+  GST_WRITE_UINT32_LE (bytes, val);
+  g_byte_array_append (data, bytes, 4);
+}
+
+static void
+append_fourcc (GByteArray * data, const gchar * fourcc)
+{
+  g_byte_array_append (data, (const guint8 *) fourcc, 4);
+}
+
+/* writes an MJPG AVI with one video stream and neither an idx1 nor an
+ * OpenDML index, so that avidemux has to scan the chunks */
+static gchar *
+write_indexless_file (void)
+{
+  GByteArray *data;
+  GError *err = NULL;
+  gchar *path;
+  guint8 *payload;
+  guint i, size, movi;
+  gint fd;
+
+  data = g_byte_array_new ();
+  append_fourcc (data, "RIFF");
+  append_uint32 (data, 0);      /* filled in at the end */
+  append_fourcc (data, "AVI ");
+
+  append_fourcc (data, "LIST");
+  append_uint32 (data, 4 + 8 + 56 + 8 + 4 + 8 + 56 + 8 + 40);
+  append_fourcc (data, "hdrl");
+
+  append_fourcc (data, "avih");
+  append_uint32 (data, 56);
+  append_uint32 (data, FRAME_DURATION / GST_USECOND);
+  append_uint32 (data, 0);      /* max_bps */
+  append_uint32 (data, 0);      /* pad_gran */
+  append_uint32 (data, 0);      /* flags, no AVIF_HASINDEX */
+  append_uint32 (data, N_FRAMES);
+  append_uint32 (data, 0);      /* init_frames */
+  append_uint32 (data, 1);      /* streams */
+  append_uint32 (data, 0);      /* bufsize */
+  append_uint32 (data, 16);     /* width */
+  append_uint32 (data, 16);     /* height */
+  append_uint32 (data, 0);      /* scale */
+  append_uint32 (data, 0);      /* rate */
+  append_uint32 (data, 0);      /* start */
+  append_uint32 (data, 0);      /* length */
+
+  append_fourcc (data, "LIST");
+  append_uint32 (data, 4 + 8 + 56 + 8 + 40);
+  append_fourcc (data, "strl");
+
+  append_fourcc (data, "strh");
+  append_uint32 (data, 56);
+  append_fourcc (data, "vids");
+  append_fourcc (data, "MJPG");
+  append_uint32 (data, 0);      /* flags */
+  append_uint32 (data, 0);      /* priority, language */
+  append_uint32 (data, 0);      /* init_frames */
+  append_uint32 (data, 1);      /* scale */
+  append_uint32 (data, 25);     /* rate */
+  append_uint32 (data, 0);      /* start */
+  append_uint32 (data, N_FRAMES);
+  append_uint32 (data, 0);      /* bufsize */
+  append_uint32 (data, 0);      /* quality */
+  append_uint32 (data, 0);      /* samplesize */
+  append_uint32 (data, 0);      /* frame rectangle */
+  append_uint32 (data, 0);
+
+  append_fourcc (data, "strf");
+  append_uint32 (data, 40);
+  append_uint32 (data, 40);     /* size */
+  append_uint32 (data, 16);     /* width */
+  append_uint32 (data, 16);     /* height */
+  append_uint32 (data, 1 | (24 << 16)); /* planes, bit_cnt */
+  append_fourcc (data, "MJPG");
+  append_uint32 (data, 16 * 16 * 3);    /* image_size */
+  append_uint32 (data, 0);      /* xpels_meter */
+  append_uint32 (data, 0);      /* ypels_meter */
+  append_uint32 (data, 0);      /* num_colors */
+  append_uint32 (data, 0);      /* imp_colors */
+
+  movi = data->len;
+  append_fourcc (data, "LIST");
+  append_uint32 (data, 0);      /* filled in at the end */
+  append_fourcc (data, "movi");
+
+  payload = g_malloc (3 * 1024 * 1024 / 2 + N_FRAMES + 1);
+  for (i = 0; i < N_FRAMES; i++) {
+    size = frame_size (i);
+
+    /* every byte of a frame is its number */
+    memset (payload, i, size);
+    payload[size] = 0;
+
+    append_fourcc (data, "00dc");
+    append_uint32 (data, size);
+    g_byte_array_append (data, payload, GST_ROUND_UP_2 (size));
+  }
+  g_free (payload);
+
+  GST_WRITE_UINT32_LE (data->data + 4, data->len - 8);
+  GST_WRITE_UINT32_LE (data->data + movi + 4, data->len - movi - 8);
+
+  fd = g_file_open_tmp ("avidemux-XXXXXX.avi", &path, &err);
+  fail_unless (fd >= 0, "%s", err ? err->message : "");
+  g_close (fd, NULL);
+  fail_unless (g_file_set_contents (path, (gchar *) data->data, data->len,
+          NULL));
+
+  g_byte_array_free (data, TRUE);
+
+  return path;
+}
+
+typedef struct
+{
+  GstClockTime pts;
+  gsize size;
+  guint8 first, last;
+} FrameInfo;
+
+static void
+handoff_frame_cb (GstElement * element, GstBuffer * buf, GstPad * pad,
+    GArray * frames)
+{
+  FrameInfo info;
+
+  info.pts = GST_BUFFER_PTS (buf);
+  info.size = gst_buffer_get_size (buf);
+  gst_buffer_extract (buf, 0, &info.first, 1);
+  gst_buffer_extract (buf, info.size - 1, &info.last, 1);
+
+  g_array_append_val (frames, info);
+}
+
+GST_START_TEST (test_scan_indexless)
+{
+  GstElement *pipeline, *sink;
+  GstMessage *msg;
+  GstBus *bus;
+  GArray *frames;
+  gchar *path, *desc;
+  gboolean started = FALSE, completed = FALSE, seen_entries = FALSE;
+  gboolean eos = FALSE;
+  guint i, n_continue = 0, percent, last_percent = 0;
+
+  path = write_indexless_file ();
+  desc = g_strdup_printf ("filesrc location=\"%s\" ! avidemux ! "
+      "fakesink name=sink sync=false signal-handoffs=true", path);
+  pipeline = gst_parse_launch (desc, NULL);
+  fail_unless (pipeline != NULL);
+  bus = gst_element_get_bus (pipeline);
+
+  frames = g_array_new (FALSE, FALSE, sizeof (FrameInfo));
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  g_signal_connect (sink, "handoff", G_CALLBACK (handoff_frame_cb), frames);
+  gst_object_unref (sink);
+
+  fail_unless (gst_element_set_state (pipeline, GST_STATE_PLAYING) !=
+      GST_STATE_CHANGE_FAILURE);
+
+  while (!eos) {
+    msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+        GST_MESSAGE_PROGRESS | GST_MESSAGE_ELEMENT | GST_MESSAGE_EOS |
+        GST_MESSAGE_ERROR);
+    fail_unless (GST_MESSAGE_TYPE (msg) != GST_MESSAGE_ERROR);
+
+    if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_EOS) {
+      eos = TRUE;
+    } else if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_PROGRESS) {
+      GstProgressType type;
+      gchar *code, *text;
+
+      gst_message_parse_progress (msg, &type, &code, &text);
+      fail_unless_equals_string (code, "scan");
+      /* the scan reports its start, its progress in steps of at least 10%
+       * and its end, in that order */
+      switch (type) {
+        case GST_PROGRESS_TYPE_START:
+          fail_if (started);
+          started = TRUE;
+          break;
+        case GST_PROGRESS_TYPE_CONTINUE:
+          fail_unless (started && !completed);
+          fail_unless (sscanf (text, "Scanned %u%%", &percent) == 1, "%s",
+              text);
+          fail_unless (percent >= last_percent + 10 && percent <= 100);
+          last_percent = percent;
+          n_continue++;
+          break;
+        case GST_PROGRESS_TYPE_COMPLETE:
+          fail_unless (started && !completed);
+          fail_unless_equals_string (text, "Index created");
+          completed = TRUE;
+          break;
+        default:
+          fail ("unexpected progress message: %s", text);
+          break;
+      }
+      g_free (code);
+      g_free (text);
+    } else if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ELEMENT &&
+        gst_message_has_name (msg, "index-memory")) {
+      guint entries;
+
+      fail_unless (gst_structure_get_uint (gst_message_get_structure (msg),
+              "entries", &entries));
+      /* one entry per chunk, none for the header chunks */
+      fail_unless_equals_int (entries, N_FRAMES);
+      seen_entries = TRUE;
+    }
+    gst_message_unref (msg);
+  }
+
+  fail_unless (completed);
+  fail_unless (n_continue > 0);
+  fail_unless (seen_entries);
+
+  /* every chunk was found, at its offset and with its size */
+  fail_unless_equals_int (frames->len, N_FRAMES);
+  for (i = 0; i < N_FRAMES; i++) {
+    FrameInfo *info = &g_array_index (frames, FrameInfo, i);
+
+    fail_unless_equals_uint64 (info->pts, i * FRAME_DURATION);
+    fail_unless_equals_uint64 (info->size, frame_size (i));
+    fail_unless_equals_int (info->first, i);
+    fail_unless_equals_int (info->last, i);
+  }
+
+  fail_unless_equals_int (gst_element_set_state (pipeline, GST_STATE_NULL),
+      GST_STATE_CHANGE_SUCCESS);
+  gst_object_unref (bus);
+  gst_object_unref (pipeline);
+  g_array_free (frames, TRUE);
+  g_unlink (path);
+  g_free (desc);
+  g_free (path);
+}
+
+GST_END_TEST;
+
+static Suite *
+avidemux_suite (void)
+{
+  Suite *s = suite_create ("avidemux");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_scan_indexless);
+
+  return s;
+}
+
+GST_CHECK_MAIN (avidemux)
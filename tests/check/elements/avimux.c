@@ -253,6 +253,97 @@ GST_START_TEST (test_audio_pad)
 GST_END_TEST;
 
 
+/* pushes @n_frames video frames, sharing their memory with @big if
+ * @use_big is set, and of a few bytes otherwise */
+static void
+push_video_frames (GstBuffer * big, guint * frame, guint n_frames,
+    gboolean use_big)
+{
+  GstBuffer *buf;
+  guint i;
+
+  for (i = 0; i < n_frames; i++) {
+    if (use_big)
+      buf = gst_buffer_copy (big);
+    else
+      buf = gst_buffer_new_and_alloc (8);
+    GST_BUFFER_TIMESTAMP (buf) = *frame * 40 * GST_MSECOND;
+    GST_BUFFER_DURATION (buf) = 40 * GST_MSECOND;
+    fail_unless (gst_pad_push (mysrcpad, buf) == GST_FLOW_OK);
+    (*frame)++;
+  }
+}
+
+/* entries in use in the superindex of the only stream, from the last header
+ * that was written */
+static guint
+get_superindex_entries (void)
+{
+  GstBuffer *header = NULL;
+  GstMapInfo map;
+  GList *l;
+  guint entries = 0;
+  gsize i;
+
+  for (l = buffers; l; l = l->next) {
+    GstBuffer *buf = l->data;
+
+    if (gst_buffer_get_size (buf) >= 12 &&
+        gst_buffer_memcmp (buf, 0, "RIFF", 4) == 0 &&
+        gst_buffer_memcmp (buf, 8, "AVI ", 4) == 0)
+      header = buf;
+  }
+  fail_unless (header != NULL);
+
+  gst_buffer_map (header, &map, GST_MAP_READ);
+  for (i = 0; i + 16 <= map.size; i++) {
+    if (memcmp (map.data + i, "indx", 4) == 0) {
+      entries = GST_READ_UINT32_LE (map.data + i + 12);
+      break;
+    }
+  }
+  gst_buffer_unmap (header, &map);
+
+  return entries;
+}
+
+GST_START_TEST (test_video_pad_odml_index)
+{
+  GstElement *avimux;
+  GstBuffer *big;
+  GstCaps *caps;
+  guint frame = 0;
+
+  avimux = setup_avimux (&srcvideotemplate, "video_%u");
+  fail_unless (gst_element_set_state (avimux,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  caps = gst_caps_from_string (VIDEO_CAPS_STRING);
+  gst_check_setup_events (mysrcpad, avimux, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+
+  /* fill the first RIFF chunk, then a quarter of an AVIX chunk, after
+   * which the standard index chunks are written */
+  big = gst_buffer_new_and_alloc (16 * 1024 * 1024);
+  push_video_frames (big, &frame, 64 + 20, TRUE);
+  gst_buffer_unref (big);
+
+  /* many small frames must not use up the superindex */
+  push_video_frames (NULL, &frame, 50000, FALSE);
+
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_eos ()));
+
+  /* the first RIFF chunk, the AVIX data up to the first 256 MiB and the rest
+   * of it */
+  fail_unless_equals_int (get_superindex_entries (), 3);
+
+  cleanup_avimux (avimux, "video_%u");
+  gst_check_drop_buffers ();
+}
+
+GST_END_TEST;
+
 static Suite *
 avimux_suite (void)
 {
@@ -262,6 +353,7 @@ avimux_suite (void)
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, test_video_pad);
   tcase_add_test (tc_chain, test_audio_pad);
+  tcase_add_test (tc_chain, test_video_pad_odml_index);
 
   return s;
 }
@@ -21,6 +21,7 @@
 #include <gst/check/gstcheck.h>
 
 #include <gst/gst.h>
+#include <glib/gstdio.h>
 
 static void
 pad_added_cb (GstElement * flvdemux, GstPad * pad, GstBin * pipeline)
@@ -166,6 +167,220 @@ GST_START_TEST (test_reuse_push)
 
 GST_END_TEST;
 
+/* pops the index-memory messages queued on @bus, returns how many there were
+ * and the fields of the last one */
+static guint
+pop_index_memory (GstBus * bus, guint * entries, gboolean * sparse)
+{
+  GstMessage *msg;
+  guint n = 0;
+
+  while ((msg = gst_bus_pop_filtered (bus, GST_MESSAGE_ELEMENT))) {
+    const GstStructure *s = gst_message_get_structure (msg);
+
+    if (gst_structure_has_name (s, "index-memory")) {
+      fail_unless (gst_structure_get (s, "entries", G_TYPE_UINT, entries,
+              "sparse", G_TYPE_BOOLEAN, sparse, NULL));
+      n++;
+    }
+    gst_message_unref (msg);
+  }
+
+  return n;
+}
+
+static void
+play_to_eos (GstElement * pipeline, GstBus * bus)
+{
+  GstMessage *msg;
+
+  fail_unless (gst_element_set_state (pipeline, GST_STATE_PLAYING) !=
+      GST_STATE_CHANGE_FAILURE);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+}
+
+GST_START_TEST (test_max_index_memory)
+{
+  GstElement *pipeline;
+  GstBus *bus;
+  gchar *path, *desc;
+  guint entries = 0, n;
+  gboolean sparse = FALSE;
+
+  /* audio only, so every one of the 129 frames is a keyframe; 256 bytes
+   * hold at most 16 index entries */
+  path = g_build_filename (GST_TEST_FILES_PATH, "pcm16sine.flv", NULL);
+  desc = g_strdup_printf ("filesrc location=\"%s\" ! "
+      "flvdemux max-index-memory=256 ! fakesink sync=false", path);
+  pipeline = gst_parse_launch (desc, NULL);
+  fail_unless (pipeline != NULL);
+  bus = gst_element_get_bus (pipeline);
+
+  play_to_eos (pipeline, bus);
+  n = pop_index_memory (bus, &entries, &sparse);
+  fail_unless (n > 0 && n <= 5, "%u index-memory messages", n);
+  fail_unless (sparse);
+  fail_unless (entries > 0 && entries <= 16, "%u entries", entries);
+
+  /* playing again passes all the keyframes left out before, the index is
+   * not thinned out any further for them */
+  fail_unless (gst_element_seek_simple (pipeline, GST_FORMAT_TIME,
+          GST_SEEK_FLAG_FLUSH, 0));
+  play_to_eos (pipeline, bus);
+  fail_unless_equals_int (pop_index_memory (bus, &entries, &sparse), 0);
+
+  fail_unless_equals_int (gst_element_set_state (pipeline, GST_STATE_NULL),
+      GST_STATE_CHANGE_SUCCESS);
+  gst_object_unref (bus);
+  gst_object_unref (pipeline);
+  g_free (desc);
+  g_free (path);
+}
+
+GST_END_TEST;
+
+/* writes an audio only FLV without any metadata, so seeking has to build
+ * the index from the tags. A tag every 250ms for 30s, every 10th of which
+ * is larger than the block read at once when scanning, returns the path */
+static gchar *
+write_unindexed_file (void)
+{
+  GByteArray *data;
+  GError *err = NULL;
+  gchar *path;
+  guint8 header[] = { 'F', 'L', 'V', 0x01, 0x04, 0, 0, 0, 0x09, 0, 0, 0, 0 };
+  guint8 tag[11] = { 8, }, prev[4];
+  guint8 *payload;
+  guint i, size, ms;
+  gint fd;
+
+  payload = g_malloc0 (70000);
+  payload[0] = 0x3e;            /* raw PCM, 44.1 kHz, 16 bit, stereo */
+
+  data = g_byte_array_new ();
+  g_byte_array_append (data, header, sizeof (header));
+  for (i = 0; i < 120; i++) {
+    size = (i % 10 == 5) ? 70000 : 257;
+    ms = i * 250;
+
+    GST_WRITE_UINT24_BE (tag + 1, size);
+    GST_WRITE_UINT24_BE (tag + 4, ms & 0xffffff);
+    tag[7] = ms >> 24;
+    GST_WRITE_UINT32_BE (prev, 11 + size);
+
+    g_byte_array_append (data, tag, sizeof (tag));
+    g_byte_array_append (data, payload, size);
+    g_byte_array_append (data, prev, sizeof (prev));
+  }
+
+  fd = g_file_open_tmp ("flvdemux-XXXXXX.flv", &path, &err);
+  fail_unless (fd >= 0, "%s", err ? err->message : "");
+  g_close (fd, NULL);
+  fail_unless (g_file_set_contents (path, (gchar *) data->data, data->len,
+          NULL));
+
+  g_byte_array_free (data, TRUE);
+  g_free (payload);
+
+  return path;
+}
+
+static void
+handoff_ts_cb (GstElement * element, GstBuffer * buf, GstPad * pad,
+    GArray * timestamps)
+{
+  GstClockTime ts = GST_BUFFER_PTS (buf);
+
+  g_array_append_val (timestamps, ts);
+}
+
+static void
+seek_and_wait (GstElement * pipeline, GstBus * bus, gdouble rate,
+    GstSeekFlags flags, GstClockTime start, GstClockTime stop)
+{
+  GstMessage *msg;
+
+  fail_unless (gst_element_seek (pipeline, rate, GST_FORMAT_TIME,
+          GST_SEEK_FLAG_FLUSH | flags, GST_SEEK_TYPE_SET, start,
+          GST_SEEK_TYPE_SET, stop));
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_ASYNC_DONE | GST_MESSAGE_ERROR);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_ASYNC_DONE);
+  gst_message_unref (msg);
+}
+
+GST_START_TEST (test_seek_unindexed)
+{
+  GstElement *pipeline, *sink;
+  GstBus *bus;
+  GstMessage *msg;
+  GArray *timestamps;
+  gchar *path, *desc;
+  GstClockTime ts;
+  gboolean seen_first = FALSE, seen_last = FALSE;
+  guint i;
+
+  path = write_unindexed_file ();
+  desc = g_strdup_printf ("filesrc location=\"%s\" ! flvdemux ! "
+      "fakesink name=sink sync=false signal-handoffs=true", path);
+  pipeline = gst_parse_launch (desc, NULL);
+  fail_unless (pipeline != NULL);
+  bus = gst_element_get_bus (pipeline);
+
+  timestamps = g_array_new (FALSE, FALSE, sizeof (GstClockTime));
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  g_signal_connect (sink, "handoff", G_CALLBACK (handoff_ts_cb), timestamps);
+  gst_object_unref (sink);
+
+  fail_unless (gst_element_set_state (pipeline, GST_STATE_PAUSED) !=
+      GST_STATE_CHANGE_FAILURE);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_ASYNC_DONE | GST_MESSAGE_ERROR);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_ASYNC_DONE);
+  gst_message_unref (msg);
+
+  /* far beyond what was parsed, so the index is built by scanning the tags
+   * up to the seek time and the offset is looked up in it */
+  g_array_set_size (timestamps, 0);
+  seek_and_wait (pipeline, bus, 1.0, GST_SEEK_FLAG_KEY_UNIT,
+      20 * GST_SECOND + 100 * GST_MSECOND, GST_CLOCK_TIME_NONE);
+  fail_unless (timestamps->len > 0);
+  fail_unless_equals_uint64 (g_array_index (timestamps, GstClockTime, 0),
+      20 * GST_SECOND);
+
+  /* backwards within the index built so far, going back section by section
+   * from the entry before the stop position */
+  g_array_set_size (timestamps, 0);
+  seek_and_wait (pipeline, bus, -1.0, 0, 5 * GST_SECOND, 10 * GST_SECOND);
+  play_to_eos (pipeline, bus);
+  fail_unless (timestamps->len > 0);
+  fail_unless (g_array_index (timestamps, GstClockTime, 0) > 5 * GST_SECOND);
+  for (i = 0; i < timestamps->len; i++) {
+    ts = g_array_index (timestamps, GstClockTime, i);
+    fail_unless (ts < 10 * GST_SECOND, "%" GST_TIME_FORMAT,
+        GST_TIME_ARGS (ts));
+    if (ts == 5 * GST_SECOND)
+      seen_first = TRUE;
+    else if (ts == 10 * GST_SECOND - 250 * GST_MSECOND)
+      seen_last = TRUE;
+  }
+  fail_unless (seen_first && seen_last);
+
+  fail_unless_equals_int (gst_element_set_state (pipeline, GST_STATE_NULL),
+      GST_STATE_CHANGE_SUCCESS);
+  gst_object_unref (bus);
+  gst_object_unref (pipeline);
+  g_array_free (timestamps, TRUE);
+  g_unlink (path);
+  g_free (desc);
+  g_free (path);
+}
+
+GST_END_TEST;
+
 static Suite *
 flvdemux_suite (void)
 {
@@ -175,6 +390,8 @@ flvdemux_suite (void)
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, test_reuse_push);
   tcase_add_test (tc_chain, test_reuse_pull);
+  tcase_add_test (tc_chain, test_max_index_memory);
+  tcase_add_test (tc_chain, test_seek_unindexed);
 
   return s;
 }
@@ -152,6 +152,94 @@ GST_START_TEST (test_index_writing)
 
 GST_END_TEST;
 
+static GstStaticPadTemplate videosrctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("video/x-flash-video"));
+
+static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("video/x-flv"));
+
+GST_START_TEST (test_tag_shares_payload)
+{
+  GstElement *flvmux;
+  GstPad *srcpad, *sinkpad, *collectpad;
+  GstBuffer *inbuf, *tag = NULL;
+  GstMemory *payload;
+  GstSegment segment;
+  GstCaps *caps;
+  GList *l;
+  guint8 header[12], trailer[4];
+  gsize size;
+
+  flvmux = gst_check_setup_element ("flvmux");
+  g_object_set (flvmux, "streamable", TRUE, NULL);
+
+  srcpad = gst_pad_new_from_static_template (&videosrctemplate, "src");
+  sinkpad = gst_element_get_request_pad (flvmux, "video");
+  fail_unless (gst_pad_link (srcpad, sinkpad) == GST_PAD_LINK_OK);
+  collectpad = gst_check_setup_sink_pad (flvmux, &sinktemplate);
+  gst_pad_set_active (srcpad, TRUE);
+  gst_pad_set_active (collectpad, TRUE);
+
+  fail_unless (gst_element_set_state (flvmux,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  gst_pad_push_event (srcpad, gst_event_new_stream_start ("test"));
+  caps = gst_caps_new_empty_simple ("video/x-flash-video");
+  gst_pad_set_caps (srcpad, caps);
+  gst_caps_unref (caps);
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  fail_unless (gst_pad_push_event (srcpad, gst_event_new_segment (&segment)));
+
+  inbuf = gst_buffer_new_and_alloc (1000);
+  gst_buffer_memset (inbuf, 0, 0xaa, 1000);
+  GST_BUFFER_PTS (inbuf) = GST_BUFFER_DTS (inbuf) = 0;
+  payload = gst_memory_ref (gst_buffer_peek_memory (inbuf, 0));
+  fail_unless_equals_int (gst_pad_push (srcpad, inbuf), GST_FLOW_OK);
+  fail_unless (gst_pad_push_event (srcpad, gst_event_new_eos ()));
+
+  for (l = buffers; l; l = l->next) {
+    guint8 type;
+
+    gst_buffer_extract (l->data, 0, &type, 1);
+    if (type == 9) {
+      tag = l->data;
+      break;
+    }
+  }
+  fail_unless (tag != NULL);
+
+  /* tag header, the input memory itself, and the previous tag size */
+  fail_unless_equals_int (gst_buffer_n_memory (tag), 3);
+  fail_unless (gst_buffer_peek_memory (tag, 1) == payload);
+
+  size = gst_buffer_get_size (tag);
+  fail_unless_equals_int (size, 11 + 1 + 1000 + 4);
+  gst_buffer_extract (tag, 0, header, 12);
+  fail_unless_equals_int (GST_READ_UINT24_BE (header + 1), 1 + 1000);
+  fail_unless_equals_int (header[11], (1 << 4) | 2);
+  gst_buffer_extract (tag, size - 4, trailer, 4);
+  fail_unless_equals_int (GST_READ_UINT32_BE (trailer), size - 4);
+
+  gst_memory_unref (payload);
+  gst_check_drop_buffers ();
+  gst_element_set_state (flvmux, GST_STATE_NULL);
+  gst_pad_set_active (srcpad, FALSE);
+  gst_pad_unlink (srcpad, sinkpad);
+  gst_element_release_request_pad (flvmux, sinkpad);
+  gst_object_unref (sinkpad);
+  gst_object_unref (srcpad);
+  gst_pad_set_active (collectpad, FALSE);
+  gst_check_teardown_sink_pad (flvmux);
+  gst_check_teardown_element (flvmux);
+}
+
+GST_END_TEST;
+
 static Suite *
 flvmux_suite (void)
 {
@@ -168,6 +256,7 @@ flvmux_suite (void)
 #endif
 
   tcase_add_loop_test (tc_chain, test_index_writing, 1, loop);
+  tcase_add_test (tc_chain, test_tag_shares_payload);
 
   return s;
 }
@@ -0,0 +1,536 @@
+/* GStreamer
+ *
+ * unit test for matroskademux
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+#include <glib/gstdio.h>
+
+#define VIDEO_CAPS_STRING "video/x-vp8, " \
+                           "width = (int) 320, " \
+                           "height = (int) 240, " \
+                           "framerate = (fraction) 25/1"
+
+#define FRAME_DURATION (40 * GST_MSECOND)
+#define KEYFRAME_DISTANCE 10
+
+/* size of the cluster index file header, followed by 24 byte entries */
+#define CLUSTER_INDEX_HEADER_SIZE 60
+
+static GstStaticPadTemplate videosrctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (VIDEO_CAPS_STRING));
+
+static GstStaticPadTemplate mkvsrctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("video/x-matroska"));
+
+static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+/* the file matroskademux pulls from in the tests without filesrc */
+static gchar *file_data;
+static gsize file_size;
+static gboolean split_reads;
+static GList *pulled_buffers;
+static gboolean have_eos;
+
+static GstPad *mysrcpad, *mysinkpad;
+
+static gchar *
+create_temp_location (const gchar * prefix)
+{
+  return g_strdup_printf ("%s/%s-%d", g_get_tmp_dir (), prefix,
+      g_random_int ());
+}
+
+/* muxes @n_frames video frames of @frame_size bytes to @location, matroskamux
+ * starts a new cluster at every keyframe. Streamable files have no Cues,
+ * others get partial Cues every @cues_interval clusters if that is set. */
+static void
+create_mkv_file (const gchar * location, guint n_frames, gsize frame_size,
+    gboolean streamable, guint cues_interval)
+{
+  GstElement *mux, *filesink;
+  GstPad *srcpad, *sinkpad;
+  GstBuffer *buf;
+  GstSegment segment;
+  GstCaps *caps;
+  guint i;
+
+  mux = gst_check_setup_element ("matroskamux");
+  g_object_set (mux, "streamable", streamable, "cues-interval", cues_interval,
+      NULL);
+  filesink = gst_element_factory_make ("filesink", NULL);
+  g_object_set (filesink, "location", location, NULL);
+  fail_unless (gst_element_link (mux, filesink));
+
+  srcpad = gst_pad_new_from_static_template (&videosrctemplate, "src");
+  sinkpad = gst_element_get_request_pad (mux, "video_%u");
+  fail_unless (gst_pad_link (srcpad, sinkpad) == GST_PAD_LINK_OK);
+  gst_pad_set_active (srcpad, TRUE);
+
+  fail_unless (gst_element_set_state (filesink,
+          GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE,
+      "could not set filesink to playing");
+  fail_unless (gst_element_set_state (mux,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  gst_pad_push_event (srcpad, gst_event_new_stream_start ("test"));
+  caps = gst_caps_from_string (VIDEO_CAPS_STRING);
+  gst_pad_set_caps (srcpad, caps);
+  gst_caps_unref (caps);
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  fail_unless (gst_pad_push_event (srcpad, gst_event_new_segment (&segment)));
+
+  for (i = 0; i < n_frames; i++) {
+    buf = gst_buffer_new_and_alloc (frame_size);
+    gst_buffer_memset (buf, 0, i & 0xff, frame_size);
+    GST_BUFFER_PTS (buf) = GST_BUFFER_DTS (buf) = i * FRAME_DURATION;
+    GST_BUFFER_DURATION (buf) = FRAME_DURATION;
+    if (i % KEYFRAME_DISTANCE)
+      GST_BUFFER_FLAG_SET (buf, GST_BUFFER_FLAG_DELTA_UNIT);
+    fail_unless (gst_pad_push (srcpad, buf) == GST_FLOW_OK);
+  }
+  fail_unless (gst_pad_push_event (srcpad, gst_event_new_eos ()));
+
+  gst_element_set_state (mux, GST_STATE_NULL);
+  gst_element_set_state (filesink, GST_STATE_NULL);
+  gst_pad_set_active (srcpad, FALSE);
+  gst_pad_unlink (srcpad, sinkpad);
+  gst_element_release_request_pad (mux, sinkpad);
+  gst_object_unref (sinkpad);
+  gst_object_unref (srcpad);
+  gst_object_unref (filesink);
+  gst_check_teardown_element (mux);
+}
+
+static void
+handoff_cb (GstElement * sink, GstBuffer * buffer, GstPad * pad,
+    GArray * timestamps)
+{
+  GstClockTime pts = GST_BUFFER_PTS (buffer);
+
+  g_array_append_val (timestamps, pts);
+}
+
+/* does a flushing keyframe seek to @target in PAUSED, plays until EOS and
+ * checks that all frames from @first_frame on came out in order */
+static void
+check_pull_seek (GstElement * pipeline, GArray * timestamps, guint n_frames,
+    GstClockTime target, guint first_frame)
+{
+  GstMessage *msg;
+  GstBus *bus;
+  guint i;
+
+  fail_unless (gst_element_seek_simple (pipeline, GST_FORMAT_TIME,
+          GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_KEY_UNIT, target));
+  fail_unless_equals_int (gst_element_get_state (pipeline, NULL, NULL,
+          GST_CLOCK_TIME_NONE), GST_STATE_CHANGE_SUCCESS);
+
+  /* nothing is rendered in PAUSED, the streaming thread does not touch the
+   * array until we go to PLAYING */
+  g_array_set_size (timestamps, 0);
+
+  fail_unless (gst_element_set_state (pipeline,
+          GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE);
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+
+  fail_unless (gst_element_set_state (pipeline,
+          GST_STATE_PAUSED) != GST_STATE_CHANGE_FAILURE);
+  fail_unless_equals_int (gst_element_get_state (pipeline, NULL, NULL,
+          GST_CLOCK_TIME_NONE), GST_STATE_CHANGE_SUCCESS);
+
+  fail_unless_equals_int (timestamps->len, n_frames - first_frame);
+  for (i = 0; i < timestamps->len; i++)
+    fail_unless_equals_uint64 (g_array_index (timestamps, GstClockTime, i),
+        (first_frame + i) * FRAME_DURATION);
+}
+
+/* plays @location in pull mode and seeks around in it, saving the clusters
+ * found to @index_location if that is set */
+static void
+run_pull_seeks (const gchar * location, guint n_frames,
+    const gchar * index_location)
+{
+  static const guint targets[] = { 0, 1505, 3, 497, 1999, 1010 };
+  GstElement *pipeline, *sink;
+  GArray *timestamps;
+  gchar *desc;
+  guint i;
+
+  desc = g_strdup_printf ("filesrc location=%s ! matroskademux name=demux "
+      "%s%s demux. ! fakesink name=sink sync=false signal-handoffs=true",
+      location, index_location ? "cluster-index-file=" : "",
+      index_location ? index_location : "");
+  pipeline = gst_parse_launch (desc, NULL);
+  fail_unless (pipeline != NULL);
+  g_free (desc);
+
+  timestamps = g_array_new (FALSE, FALSE, sizeof (GstClockTime));
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  g_signal_connect (sink, "handoff", G_CALLBACK (handoff_cb), timestamps);
+  gst_object_unref (sink);
+
+  fail_unless (gst_element_set_state (pipeline,
+          GST_STATE_PAUSED) != GST_STATE_CHANGE_FAILURE);
+  fail_unless_equals_int (gst_element_get_state (pipeline, NULL, NULL,
+          GST_CLOCK_TIME_NONE), GST_STATE_CHANGE_SUCCESS);
+
+  for (i = 0; i < G_N_ELEMENTS (targets); i++) {
+    guint target = MIN (targets[i], n_frames - 1);
+
+    check_pull_seek (pipeline, timestamps, n_frames,
+        target * FRAME_DURATION + FRAME_DURATION / 2,
+        target - target % KEYFRAME_DISTANCE);
+  }
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+  g_array_free (timestamps, TRUE);
+}
+
+/* prerolls @location with a matroskademux that has @demux_props, and returns
+ * how many index-memory messages it posted, and the number of entries and
+ * whether the index was thinned out according to the last one */
+static guint
+get_index_memory (const gchar * location, const gchar * demux_props,
+    guint * entries, gboolean * sparse)
+{
+  GstElement *pipeline;
+  GstMessage *msg;
+  GstBus *bus;
+  gchar *desc;
+  guint n_messages = 0;
+
+  desc = g_strdup_printf ("filesrc location=%s ! matroskademux name=demux "
+      "%s demux. ! fakesink", location, demux_props);
+  pipeline = gst_parse_launch (desc, NULL);
+  fail_unless (pipeline != NULL);
+  g_free (desc);
+
+  fail_unless (gst_element_set_state (pipeline,
+          GST_STATE_PAUSED) != GST_STATE_CHANGE_FAILURE);
+  fail_unless_equals_int (gst_element_get_state (pipeline, NULL, NULL,
+          GST_CLOCK_TIME_NONE), GST_STATE_CHANGE_SUCCESS);
+
+  bus = gst_element_get_bus (pipeline);
+  while ((msg = gst_bus_pop_filtered (bus, GST_MESSAGE_ELEMENT))) {
+    const GstStructure *s = gst_message_get_structure (msg);
+
+    if (gst_structure_has_name (s, "index-memory")) {
+      fail_unless (gst_structure_get_uint (s, "entries", entries));
+      fail_unless (gst_structure_get_boolean (s, "sparse", sparse));
+      n_messages++;
+    }
+    gst_message_unref (msg);
+  }
+  gst_object_unref (bus);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+  return n_messages;
+}
+
+/* hands out @length bytes of the file at @offset, in three memories if
+ * split_reads is set */
+static GstFlowReturn
+getrange_cb (GstPad * pad, GstObject * parent, guint64 offset, guint length,
+    GstBuffer ** buffer)
+{
+  GstBuffer *buf;
+  guint i, pieces, start, end;
+
+  if (offset >= file_size)
+    return GST_FLOW_EOS;
+  length = MIN (length, file_size - offset);
+
+  buf = gst_buffer_new ();
+  pieces = (split_reads && length >= 16) ? 3 : 1;
+  for (i = 0; i < pieces; i++) {
+    /* split one byte after a third, so that it is unlikely to line up with
+     * an element */
+    start = i ? i * (length / pieces) + 1 : 0;
+    end = (i + 1 < pieces) ? (i + 1) * (length / pieces) + 1 : length;
+    gst_buffer_append_memory (buf,
+        gst_memory_new_wrapped (GST_MEMORY_FLAG_READONLY,
+            file_data + offset + start, end - start, 0, end - start, NULL,
+            NULL));
+  }
+  GST_BUFFER_OFFSET (buf) = offset;
+
+  /* keep a reference, as a caching source would, so that mapping the
+   * buffer downstream can't merge its memories in place */
+  pulled_buffers = g_list_prepend (pulled_buffers, gst_buffer_ref (buf));
+
+  *buffer = buf;
+  return GST_FLOW_OK;
+}
+
+static gboolean
+src_query_cb (GstPad * pad, GstObject * parent, GstQuery * query)
+{
+  GstFormat format;
+
+  switch (GST_QUERY_TYPE (query)) {
+    case GST_QUERY_SCHEDULING:
+      gst_query_set_scheduling (query, GST_SCHEDULING_FLAG_SEEKABLE, 1, -1, 0);
+      gst_query_add_scheduling_mode (query, GST_PAD_MODE_PULL);
+      return TRUE;
+    case GST_QUERY_DURATION:
+      gst_query_parse_duration (query, &format, NULL);
+      if (format != GST_FORMAT_BYTES)
+        return FALSE;
+      gst_query_set_duration (query, format, file_size);
+      return TRUE;
+    default:
+      return gst_pad_query_default (pad, parent, query);
+  }
+}
+
+static gboolean
+sink_event_cb (GstPad * pad, GstObject * parent, GstEvent * event)
+{
+  if (GST_EVENT_TYPE (event) == GST_EVENT_EOS) {
+    g_mutex_lock (&check_mutex);
+    have_eos = TRUE;
+    g_cond_broadcast (&check_cond);
+    g_mutex_unlock (&check_mutex);
+  }
+
+  gst_event_unref (event);
+  return TRUE;
+}
+
+static void
+pad_added_cb (GstElement * demux, GstPad * pad, gpointer user_data)
+{
+  fail_unless (gst_pad_link (pad, mysinkpad) == GST_PAD_LINK_OK);
+}
+
+/* demuxes the file at @location, pulling from a pad that hands out every
+ * read in several memories if @split is set, and checks that all frames
+ * written by create_mkv_file() come out unchanged */
+static void
+demux_from_pad (const gchar * location, gboolean split, guint n_frames,
+    gsize frame_size)
+{
+  GstElement *demux;
+  GstMapInfo map;
+  GList *l;
+  guint i;
+  gsize j;
+
+  fail_unless (g_file_get_contents (location, &file_data, &file_size, NULL));
+  split_reads = split;
+  have_eos = FALSE;
+
+  demux = gst_check_setup_element ("matroskademux");
+  mysrcpad = gst_check_setup_src_pad (demux, &mkvsrctemplate);
+  gst_pad_set_getrange_function (mysrcpad, getrange_cb);
+  gst_pad_set_query_function (mysrcpad, src_query_cb);
+  mysinkpad = gst_pad_new_from_static_template (&sinktemplate, "sink");
+  gst_pad_set_chain_function (mysinkpad, gst_check_chain_func);
+  gst_pad_set_event_function (mysinkpad, sink_event_cb);
+  gst_pad_set_active (mysinkpad, TRUE);
+  g_signal_connect (demux, "pad-added", G_CALLBACK (pad_added_cb), NULL);
+
+  fail_unless (gst_element_set_state (demux,
+          GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE,
+      "could not set to playing");
+
+  g_mutex_lock (&check_mutex);
+  while (!have_eos)
+    g_cond_wait (&check_cond, &check_mutex);
+  g_mutex_unlock (&check_mutex);
+
+  fail_unless_equals_int (g_list_length (buffers), n_frames);
+  for (l = buffers, i = 0; l; l = l->next, i++) {
+    GstBuffer *buf = l->data;
+
+    fail_unless_equals_uint64 (GST_BUFFER_PTS (buf), i * FRAME_DURATION);
+    gst_buffer_map (buf, &map, GST_MAP_READ);
+    fail_unless_equals_int (map.size, frame_size);
+    for (j = 0; j < map.size && map.data[j] == (i & 0xff); j++);
+    fail_unless (j == map.size, "frame %u differs at %" G_GSIZE_FORMAT, i, j);
+    gst_buffer_unmap (buf, &map);
+  }
+
+  gst_element_set_state (demux, GST_STATE_NULL);
+  gst_check_drop_buffers ();
+  gst_pad_set_active (mysinkpad, FALSE);
+  gst_object_unref (mysinkpad);
+  gst_check_teardown_src_pad (demux);
+  gst_check_teardown_element (demux);
+
+  g_list_free_full (pulled_buffers, (GDestroyNotify) gst_buffer_unref);
+  pulled_buffers = NULL;
+  g_free (file_data);
+  file_data = NULL;
+}
+
+GST_START_TEST (test_multi_memory_reads)
+{
+  gchar *location;
+
+  location = create_temp_location ("matroskademuxtest");
+
+  /* a few MB, so that there are several read blocks and frames cross their
+   * boundaries and those of the memories in them */
+  create_mkv_file (location, 300, 10007, FALSE, 0);
+
+  /* elements are parsed in place on the pulled blocks */
+  demux_from_pad (location, FALSE, 300, 10007);
+
+  /* and copied out of blocks made of several memories */
+  demux_from_pad (location, TRUE, 300, 10007);
+
+  g_unlink (location);
+  g_free (location);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_incremental_cues)
+{
+  gchar *location;
+  guint entries = 0;
+  gboolean sparse = TRUE;
+
+  location = create_temp_location ("matroskademuxtest");
+
+  /* 200 clusters with partial Cues after every 5th */
+  create_mkv_file (location, 2000, 16, FALSE, 5);
+
+  /* all of them are found through the SeekHead chain, and the index is only
+   * put together once */
+  fail_unless_equals_int (get_index_memory (location, "", &entries, &sparse),
+      1);
+  fail_unless_equals_int (entries, 2000 / KEYFRAME_DISTANCE);
+  fail_if (sparse);
+
+  /* including the ones written first */
+  run_pull_seeks (location, 2000, NULL);
+
+  g_unlink (location);
+  g_free (location);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_max_index_memory)
+{
+  gchar *location;
+  guint entries = 0;
+  gboolean sparse = FALSE;
+
+  location = create_temp_location ("matroskademuxtest");
+  create_mkv_file (location, 2000, 16, FALSE, 5);
+
+  /* the index of all partial Cues is thinned out once, not per Cues */
+  fail_unless_equals_int (get_index_memory (location, "max-index-memory=2000",
+          &entries, &sparse), 1);
+  fail_unless (sparse);
+  fail_unless (entries > 0 && entries < 2000 / KEYFRAME_DISTANCE / 2,
+      "%u entries", entries);
+
+  /* a limit the index fits in leaves it alone */
+  fail_unless_equals_int (get_index_memory (location,
+          "max-index-memory=1048576", &entries, &sparse), 1);
+  fail_if (sparse);
+  fail_unless_equals_int (entries, 2000 / KEYFRAME_DISTANCE);
+
+  g_unlink (location);
+  g_free (location);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_cluster_index_file)
+{
+  gchar *location, *index_location, *contents;
+  gsize size, i;
+
+  location = create_temp_location ("matroskademuxtest");
+  index_location = create_temp_location ("matroskademuxtest-index");
+
+  /* without Cues, the clusters are found by scanning and then saved */
+  create_mkv_file (location, 2000, 16, TRUE, 0);
+  run_pull_seeks (location, 2000, index_location);
+  fail_unless (g_file_test (index_location, G_FILE_TEST_EXISTS));
+
+  /* and restored when the same file is played again */
+  run_pull_seeks (location, 2000, index_location);
+
+  /* another file at the same location must not use them */
+  g_unlink (location);
+  create_mkv_file (location, 2000, 24, TRUE, 0);
+  run_pull_seeks (location, 2000, index_location);
+
+  /* nor must clusters that are not where the index says, even if the index
+   * seems to belong to the file */
+  fail_unless (g_file_get_contents (index_location, &contents, &size, NULL));
+  fail_unless (size > CLUSTER_INDEX_HEADER_SIZE);
+  for (i = CLUSTER_INDEX_HEADER_SIZE; i + 24 <= size; i += 24) {
+    guint8 *entry = (guint8 *) contents + i;
+
+    /* position and position of the next cluster, the time stays */
+    GST_WRITE_UINT64_BE (entry, GST_READ_UINT64_BE (entry) + 1);
+    GST_WRITE_UINT64_BE (entry + 16, GST_READ_UINT64_BE (entry + 16) + 1);
+  }
+  fail_unless (g_file_set_contents (index_location, contents, size, NULL));
+  g_free (contents);
+
+  run_pull_seeks (location, 2000, index_location);
+
+  g_unlink (index_location);
+  g_unlink (location);
+  g_free (index_location);
+  g_free (location);
+}
+
+GST_END_TEST;
+
+static Suite *
+matroskademux_suite (void)
+{
+  Suite *s = suite_create ("matroskademux");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_cluster_index_file);
+  tcase_add_test (tc_chain, test_incremental_cues);
+  tcase_add_test (tc_chain, test_max_index_memory);
+  tcase_add_test (tc_chain, test_multi_memory_reads);
+
+  return s;
+}
+
+GST_CHECK_MAIN (matroskademux);
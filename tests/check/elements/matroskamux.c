@@ -436,6 +436,263 @@ GST_START_TEST (test_reset)
 
 GST_END_TEST;
 
+/* makes the muxer write seekable output */
+static gboolean
+seekable_sink_query (GstPad * pad, GstObject * parent, GstQuery * query)
+{
+  if (GST_QUERY_TYPE (query) == GST_QUERY_SEEKING) {
+    gst_query_set_seeking (query, GST_FORMAT_BYTES, TRUE, 0, -1);
+    return TRUE;
+  }
+
+  return gst_pad_query_default (pad, parent, query);
+}
+
+GST_START_TEST (test_cluster_batching)
+{
+  GstElement *matroskamux;
+  GstBuffer *inbuffer, *outbuffer;
+  GstCaps *caps;
+  GList *l;
+  guint64 cluster_start = 0, offset, cluster_size;
+  gsize total = 0;
+  guint8 id[4] = { 0x1f, 0x43, 0xb6, 0x75 };
+
+  matroskamux = setup_matroskamux (&srcac3template);
+  gst_pad_set_query_function (mysinkpad, seekable_sink_query);
+  g_object_set (matroskamux, "cluster-batching", TRUE, "max-cluster-size", 1,
+      NULL);
+
+  caps = gst_caps_from_string (AC3_CAPS_STRING);
+  gst_check_setup_events (mysrcpad, matroskamux, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+
+  /* only the headers come out, the first cluster is held back */
+  inbuffer = gst_buffer_new_allocate (NULL, 1, 0);
+  GST_BUFFER_TIMESTAMP (inbuffer) = 0;
+  fail_unless_equals_int (gst_pad_push (mysrcpad, inbuffer), GST_FLOW_OK);
+  fail_unless (buffers != NULL);
+  for (l = buffers; l; l = l->next)
+    cluster_start = MAX (cluster_start, GST_BUFFER_OFFSET_END (l->data));
+  gst_check_drop_buffers ();
+
+  /* the next buffer does not fit and finishes the cluster */
+  inbuffer = gst_buffer_new_allocate (NULL, 1, 0);
+  GST_BUFFER_TIMESTAMP (inbuffer) = 1000000;
+  fail_unless_equals_int (gst_pad_push (mysrcpad, inbuffer), GST_FLOW_OK);
+  fail_unless (buffers != NULL);
+
+  /* the cluster is written out in order, with its size filled in place
+   * instead of seeking back */
+  offset = cluster_start;
+  for (l = buffers; l; l = l->next) {
+    outbuffer = GST_BUFFER (l->data);
+    fail_unless_equals_uint64 (GST_BUFFER_OFFSET (outbuffer), offset);
+    fail_if (GST_BUFFER_FLAG_IS_SET (outbuffer, GST_BUFFER_FLAG_DISCONT));
+    offset = GST_BUFFER_OFFSET_END (outbuffer);
+    total += gst_buffer_get_size (outbuffer);
+  }
+
+  outbuffer = GST_BUFFER (buffers->data);
+  fail_unless (gst_buffer_get_size (outbuffer) >= 12);
+  fail_unless (gst_buffer_memcmp (outbuffer, 0, id, sizeof (id)) == 0);
+  gst_buffer_extract (outbuffer, 4, &cluster_size, 8);
+  cluster_size = GUINT64_FROM_BE (cluster_size) & G_GUINT64_CONSTANT
+      (0x00ffffffffffffff);
+  fail_unless_equals_uint64 (cluster_size, total - 12);
+
+  gst_check_drop_buffers ();
+  cleanup_matroskamux (matroskamux);
+}
+
+GST_END_TEST;
+
+static guint
+count_buffers_with_id (guint32 id)
+{
+  GList *l;
+  guint8 data[4];
+  guint count = 0;
+
+  GST_WRITE_UINT32_BE (data, id);
+  for (l = buffers; l; l = l->next) {
+    if (gst_buffer_get_size (l->data) >= sizeof (data) &&
+        gst_buffer_memcmp (l->data, 0, data, sizeof (data)) == 0)
+      count++;
+  }
+
+  return count;
+}
+
+/* puts the output buffers together at their offsets, like a file */
+static GByteArray *
+get_written_file (void)
+{
+  GByteArray *file = g_byte_array_new ();
+  GList *l;
+
+  for (l = buffers; l; l = l->next) {
+    GstBuffer *buf = GST_BUFFER (l->data);
+    guint64 offset = GST_BUFFER_OFFSET (buf);
+    gsize size = gst_buffer_get_size (buf);
+
+    fail_unless (GST_BUFFER_OFFSET_IS_VALID (buf));
+    if (offset + size > file->len)
+      g_byte_array_set_size (file, offset + size);
+    gst_buffer_extract (buf, 0, file->data + offset, size);
+  }
+
+  return file;
+}
+
+/* reads the EBML ID or (if @is_size) size at @pos, returns its length */
+static guint
+read_ebml_vint (GByteArray * file, guint64 pos, guint64 * value,
+    gboolean is_size)
+{
+  guint len = 1, i;
+  guint8 mask = 0x80;
+
+  fail_unless (pos < file->len);
+  while (len <= 8 && !(file->data[pos] & mask)) {
+    mask >>= 1;
+    len++;
+  }
+  fail_unless (len <= 8 && pos + len <= file->len);
+
+  *value = is_size ? file->data[pos] & (mask - 1) : file->data[pos];
+  for (i = 1; i < len; i++)
+    *value = (*value << 8) | file->data[pos + i];
+
+  return len;
+}
+
+/* reads the element header at @pos, returns the position of its data */
+static guint64
+read_ebml_element (GByteArray * file, guint64 pos, guint32 * id,
+    guint64 * size)
+{
+  guint64 value;
+
+  pos += read_ebml_vint (file, pos, &value, FALSE);
+  *id = value;
+  pos += read_ebml_vint (file, pos, size, TRUE);
+
+  return pos;
+}
+
+/* returns the value of the unsigned integer child @id of the element whose
+ * data is at @pos, or G_MAXUINT64 */
+static guint64
+read_ebml_child_uint (GByteArray * file, guint64 pos, guint64 size, guint32 id)
+{
+  guint64 end = pos + size;
+
+  while (pos < end) {
+    guint32 child_id;
+    guint64 child_size, data, value = 0, i;
+
+    data = read_ebml_element (file, pos, &child_id, &child_size);
+    if (child_id == id) {
+      for (i = 0; i < child_size; i++)
+        value = (value << 8) | file->data[data + i];
+      return value;
+    }
+    pos = data + child_size;
+  }
+
+  return G_MAXUINT64;
+}
+
+GST_START_TEST (test_incremental_cues)
+{
+  GstElement *matroskamux;
+  GstBuffer *inbuffer;
+  GstCaps *caps;
+  GByteArray *file;
+  GArray *clusters, *cues, *seekheads;
+  guint64 pos, size, segment_start, seekhead_pos, prev_size;
+  guint32 id;
+  guint i;
+
+  matroskamux = setup_matroskamux (&srcac3template);
+  gst_pad_set_query_function (mysinkpad, seekable_sink_query);
+  g_object_set (matroskamux, "cues-interval", 1, "max-cluster-size", 1, NULL);
+
+  caps = gst_caps_from_string (AC3_CAPS_STRING);
+  gst_check_setup_events (mysrcpad, matroskamux, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+
+  /* one cluster per buffer */
+  for (i = 0; i < 3; i++) {
+    inbuffer = gst_buffer_new_allocate (NULL, 1, 0);
+    GST_BUFFER_TIMESTAMP (inbuffer) = i * GST_MSECOND;
+    fail_unless_equals_int (gst_pad_push (mysrcpad, inbuffer), GST_FLOW_OK);
+  }
+
+  /* the index of the first two clusters is already written, the second
+   * part is linked to the first one by a SeekHead */
+  fail_unless_equals_int (count_buffers_with_id (0x1c53bb6b), 2);
+  fail_unless_equals_int (count_buffers_with_id (0x114d9b74), 1);
+
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_eos ()));
+
+  /* collect the top level elements of the finished segment */
+  file = get_written_file ();
+  pos = read_ebml_element (file, 0, &id, &size);
+  fail_unless_equals_int (id, 0x1a45dfa3);
+  segment_start = read_ebml_element (file, pos + size, &id, &size);
+  fail_unless_equals_int (id, 0x18538067);
+
+  clusters = g_array_new (FALSE, FALSE, sizeof (guint64));
+  cues = g_array_new (FALSE, FALSE, sizeof (guint64));
+  seekheads = g_array_new (FALSE, FALSE, sizeof (guint64));
+  for (pos = segment_start; pos < file->len; pos += size) {
+    guint64 element_pos = pos;
+
+    pos = read_ebml_element (file, pos, &id, &size);
+    if (id == 0x1f43b675)
+      g_array_append_val (clusters, element_pos);
+    else if (id == 0x1c53bb6b)
+      g_array_append_val (cues, element_pos);
+    else if (id == 0x114d9b74)
+      g_array_append_val (seekheads, element_pos);
+  }
+  fail_unless_equals_int (clusters->len, 3);
+  fail_unless_equals_int (cues->len, 3);
+  fail_unless_equals_int (seekheads->len, 3);
+
+  /* the SeekHead at the start has the newest Cues at +116 and the newest
+   * chained SeekHead in the entry at +152 */
+  seekhead_pos = g_array_index (seekheads, guint64, 0);
+  fail_unless_equals_uint64 (seekhead_pos, segment_start);
+  fail_unless_equals_uint64 (GST_READ_UINT64_BE (file->data + seekhead_pos +
+          116) + segment_start, g_array_index (cues, guint64, 2));
+  fail_unless_equals_int (GST_READ_UINT32_BE (file->data + seekhead_pos +
+          152 + 13), 0x114d9b74);
+  fail_unless_equals_uint64 (GST_READ_UINT64_BE (file->data + seekhead_pos +
+          172) + segment_start, g_array_index (seekheads, guint64, 2));
+
+  /* PrevSize steps back over the Cues in between */
+  for (i = 1; i < clusters->len; i++) {
+    pos = read_ebml_element (file, g_array_index (clusters, guint64, i), &id,
+        &size);
+    prev_size = read_ebml_child_uint (file, pos, size, 0xab);
+    fail_unless_equals_uint64 (prev_size, g_array_index (clusters, guint64,
+            i) - g_array_index (clusters, guint64, i - 1));
+  }
+
+  g_array_free (clusters, TRUE);
+  g_array_free (cues, TRUE);
+  g_array_free (seekheads, TRUE);
+  g_byte_array_unref (file);
+
+  gst_check_drop_buffers ();
+  cleanup_matroskamux (matroskamux);
+}
+
+GST_END_TEST;
+
 GST_START_TEST (test_link_webmmux_webm_sink)
 {
   static GstStaticPadTemplate webm_sinktemplate =
@@ -472,6 +729,8 @@ matroskamux_suite (void)
   tcase_add_test (tc_chain, test_vorbis_header);
   tcase_add_test (tc_chain, test_block_group);
   tcase_add_test (tc_chain, test_reset);
+  tcase_add_test (tc_chain, test_cluster_batching);
+  tcase_add_test (tc_chain, test_incremental_cues);
   tcase_add_test (tc_chain, test_link_webmmux_webm_sink);
 
   return s;
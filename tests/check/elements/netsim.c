@@ -0,0 +1,671 @@
+/* GStreamer
+ *
+ * unit test for netsim
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gsttestclock.h>
+#include <gst/rtp/gstrtpbuffer.h>
+
+#define RTP_PACKETS 1000
+
+/* For ease of programming we use globals to keep refs for our floating
+ * src and sink pads we create; otherwise we always have to do get_pad,
+ * get_peer, and then remove references in every test function */
+static GstPad *mysrcpad, *mysinkpad;
+
+static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+static GstElement *
+setup_netsim (GstClock * clock, guint seed)
+{
+  GstElement *netsim;
+  GstCaps *caps;
+
+  GST_DEBUG ("setup_netsim");
+
+  netsim = gst_check_setup_element ("netsim");
+  mysrcpad = gst_check_setup_src_pad (netsim, &srctemplate);
+  mysinkpad = gst_check_setup_sink_pad (netsim, &sinktemplate);
+  gst_pad_set_active (mysrcpad, TRUE);
+  gst_pad_set_active (mysinkpad, TRUE);
+
+  /* the seed is applied when going from READY to PAUSED */
+  g_object_set (netsim, "seed", seed, NULL);
+  if (clock)
+    gst_element_set_clock (netsim, clock);
+
+  fail_unless (gst_element_set_state (netsim,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  caps = gst_caps_new_empty_simple ("application/x-rtp");
+  gst_check_setup_events (mysrcpad, netsim, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+
+  return netsim;
+}
+
+static void
+cleanup_netsim (GstElement * netsim)
+{
+  GST_DEBUG ("cleanup_netsim");
+
+  gst_check_drop_buffers ();
+  gst_pad_set_active (mysrcpad, FALSE);
+  gst_pad_set_active (mysinkpad, FALSE);
+  gst_check_teardown_src_pad (netsim);
+  gst_check_teardown_sink_pad (netsim);
+  gst_check_teardown_element (netsim);
+}
+
+static GstBuffer *
+create_buffer (guint index)
+{
+  GstBuffer *buffer;
+
+  buffer = gst_buffer_new_and_alloc (16);
+  gst_buffer_memset (buffer, 0, index & 0xff, 16);
+  GST_BUFFER_OFFSET (buffer) = index;
+
+  return buffer;
+}
+
+static void
+push_buffers (guint count)
+{
+  guint i;
+
+  for (i = 0; i < count; i++)
+    fail_unless_equals_int (gst_pad_push (mysrcpad, create_buffer (i)),
+        GST_FLOW_OK);
+}
+
+static guint64
+get_stat (GstElement * netsim, const gchar * field)
+{
+  GstStructure *stats;
+  guint64 value = 0;
+
+  g_object_get (netsim, "stats", &stats, NULL);
+  fail_unless (gst_structure_get_uint64 (stats, field, &value));
+  gst_structure_free (stats);
+
+  return value;
+}
+
+static void
+wait_for_buffers (guint count)
+{
+  g_mutex_lock (&check_mutex);
+  while (g_list_length (buffers) < count)
+    g_cond_wait (&check_cond, &check_mutex);
+  g_mutex_unlock (&check_mutex);
+}
+
+/* returns the offsets of the collected buffers */
+static GArray *
+collect_offsets (void)
+{
+  GArray *offsets;
+  GList *l;
+
+  offsets = g_array_new (FALSE, FALSE, sizeof (guint64));
+  for (l = buffers; l; l = l->next) {
+    guint64 offset = GST_BUFFER_OFFSET (l->data);
+    g_array_append_val (offsets, offset);
+  }
+
+  return offsets;
+}
+
+GST_START_TEST (test_passthrough)
+{
+  GstElement *netsim;
+  GArray *offsets;
+  guint i;
+
+  netsim = setup_netsim (NULL, 0);
+
+  push_buffers (10);
+
+  fail_unless_equals_int (g_list_length (buffers), 10);
+  offsets = collect_offsets ();
+  for (i = 0; i < offsets->len; i++)
+    fail_unless_equals_uint64 (g_array_index (offsets, guint64, i), i);
+  g_array_free (offsets, TRUE);
+
+  fail_unless_equals_uint64 (get_stat (netsim, "num-in"), 10);
+  fail_unless_equals_uint64 (get_stat (netsim, "num-out"), 10);
+  fail_unless_equals_uint64 (get_stat (netsim, "num-dropped"), 0);
+
+  cleanup_netsim (netsim);
+}
+
+GST_END_TEST;
+
+static GArray *
+run_seeded_loss (guint seed)
+{
+  GstElement *netsim;
+  GArray *offsets;
+
+  netsim = setup_netsim (NULL, seed);
+  g_object_set (netsim, "loss-probability", 0.2, NULL);
+
+  push_buffers (1000);
+
+  offsets = collect_offsets ();
+  fail_unless_equals_uint64 (get_stat (netsim, "num-dropped"),
+      1000 - offsets->len);
+
+  cleanup_netsim (netsim);
+
+  return offsets;
+}
+
+GST_START_TEST (test_seeded_loss_is_reproducible)
+{
+  GArray *first, *second;
+  guint i;
+
+  first = run_seeded_loss (42);
+  second = run_seeded_loss (42);
+
+  /* roughly 20% loss */
+  fail_unless (first->len > 700 && first->len < 900);
+
+  fail_unless_equals_int (first->len, second->len);
+  for (i = 0; i < first->len; i++)
+    fail_unless_equals_uint64 (g_array_index (first, guint64, i),
+        g_array_index (second, guint64, i));
+
+  g_array_free (first, TRUE);
+  g_array_free (second, TRUE);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_gilbert_elliott_bursts)
+{
+  GstElement *netsim;
+  GArray *offsets;
+  guint64 prev = G_MAXUINT64;
+  guint i, longest_gap = 0;
+
+  netsim = setup_netsim (NULL, 0);
+  g_object_set (netsim, "loss-probability", 0.0,
+      "burst-enter-probability", 0.02, "burst-exit-probability", 0.2,
+      "burst-loss-probability", 1.0, NULL);
+
+  push_buffers (1000);
+
+  offsets = collect_offsets ();
+  fail_unless (offsets->len < 1000);
+
+  /* losses come in bursts of consecutive buffers */
+  for (i = 0; i < offsets->len; i++) {
+    guint64 offset = g_array_index (offsets, guint64, i);
+
+    if (prev != G_MAXUINT64 && offset - prev - 1 > longest_gap)
+      longest_gap = offset - prev - 1;
+    prev = offset;
+  }
+  fail_unless (longest_gap > 1);
+
+  g_array_free (offsets, TRUE);
+  cleanup_netsim (netsim);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_duplicate)
+{
+  GstElement *netsim;
+
+  netsim = setup_netsim (NULL, 0);
+  g_object_set (netsim, "duplicate-probability", 1.0, NULL);
+
+  push_buffers (10);
+
+  fail_unless_equals_int (g_list_length (buffers), 20);
+  fail_unless_equals_uint64 (get_stat (netsim, "num-duplicated"), 10);
+
+  cleanup_netsim (netsim);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_buffer_list)
+{
+  GstElement *netsim;
+  GstBufferList *list;
+  guint i;
+
+  netsim = setup_netsim (NULL, 0);
+  g_object_set (netsim, "loss-probability", 0.5, NULL);
+
+  list = gst_buffer_list_new ();
+  for (i = 0; i < 100; i++)
+    gst_buffer_list_add (list, create_buffer (i));
+  fail_unless_equals_int (gst_pad_push_list (mysrcpad, list), GST_FLOW_OK);
+
+  fail_unless_equals_uint64 (get_stat (netsim, "num-in"), 100);
+  fail_unless_equals_uint64 (get_stat (netsim, "num-out"),
+      g_list_length (buffers));
+  fail_unless_equals_uint64 (get_stat (netsim, "num-dropped"),
+      100 - g_list_length (buffers));
+
+  cleanup_netsim (netsim);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_delay)
+{
+  GstElement *netsim;
+  GstClock *clock;
+  GstClockID id, test_id;
+
+  clock = gst_test_clock_new ();
+  netsim = setup_netsim (clock, 0);
+  g_object_set (netsim, "delay", 100, NULL);
+
+  push_buffers (1);
+
+  /* the buffer is held until 100ms of running time */
+  gst_test_clock_wait_for_next_pending_id (GST_TEST_CLOCK (clock), &id);
+  fail_unless_equals_uint64 (gst_clock_id_get_time (id), 100 * GST_MSECOND);
+  fail_unless_equals_int (g_list_length (buffers), 0);
+
+  gst_test_clock_set_time (GST_TEST_CLOCK (clock), 100 * GST_MSECOND);
+  test_id = gst_test_clock_process_next_clock_id (GST_TEST_CLOCK (clock));
+  fail_unless (test_id == id);
+  gst_clock_id_unref (test_id);
+  gst_clock_id_unref (id);
+
+  wait_for_buffers (1);
+
+  fail_unless_equals_uint64 (GST_BUFFER_OFFSET (buffers->data), 0);
+
+  cleanup_netsim (netsim);
+  gst_object_unref (clock);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_reorder)
+{
+  GstElement *netsim;
+  GstClock *clock;
+  GstClockID id, test_id;
+  GArray *offsets;
+  guint i, n_reordered, n_kept, sum = 0;
+
+  clock = gst_test_clock_new ();
+  netsim = setup_netsim (clock, 7);
+  g_object_set (netsim, "reorder-probability", 0.5, "reorder-delay", 20,
+      NULL);
+
+  push_buffers (20);
+
+  n_reordered = get_stat (netsim, "num-reordered");
+  fail_unless (n_reordered > 0 && n_reordered < 20);
+  n_kept = 20 - n_reordered;
+
+  /* the buffers that are not held back go out right away */
+  wait_for_buffers (n_kept);
+
+  gst_test_clock_wait_for_next_pending_id (GST_TEST_CLOCK (clock), &id);
+  fail_unless_equals_uint64 (gst_clock_id_get_time (id), 20 * GST_MSECOND);
+  gst_test_clock_set_time (GST_TEST_CLOCK (clock), 20 * GST_MSECOND);
+  test_id = gst_test_clock_process_next_clock_id (GST_TEST_CLOCK (clock));
+  fail_unless (test_id == id);
+  gst_clock_id_unref (test_id);
+  gst_clock_id_unref (id);
+
+  wait_for_buffers (20);
+
+  /* both groups keep their own order, the held back one comes last */
+  offsets = collect_offsets ();
+  fail_unless_equals_int (offsets->len, 20);
+  for (i = 0; i < offsets->len; i++) {
+    sum += g_array_index (offsets, guint64, i);
+    if (i > 0 && i != n_kept)
+      fail_unless (g_array_index (offsets, guint64, i) >
+          g_array_index (offsets, guint64, i - 1));
+  }
+  fail_unless_equals_int (sum, 19 * 20 / 2);
+  g_array_free (offsets, TRUE);
+
+  cleanup_netsim (netsim);
+  gst_object_unref (clock);
+}
+
+GST_END_TEST;
+
+static GstPadProbeReturn
+record_order_probe (GstPad * pad, GstPadProbeInfo * info, GString * order)
+{
+  if (GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_BUFFER) {
+    g_mutex_lock (&check_mutex);
+    g_string_append_c (order, 'b');
+    g_mutex_unlock (&check_mutex);
+  } else if (GST_EVENT_TYPE (GST_PAD_PROBE_INFO_EVENT (info)) ==
+      GST_EVENT_CUSTOM_DOWNSTREAM) {
+    g_mutex_lock (&check_mutex);
+    g_string_append_c (order, 'e');
+    g_cond_broadcast (&check_cond);
+    g_mutex_unlock (&check_mutex);
+  }
+
+  return GST_PAD_PROBE_OK;
+}
+
+GST_START_TEST (test_serialized_event_order)
+{
+  GstElement *netsim;
+  GstClock *clock;
+  GstClockID id, test_id;
+  GString *order;
+
+  clock = gst_test_clock_new ();
+  netsim = setup_netsim (clock, 0);
+  g_object_set (netsim, "delay", 100, NULL);
+
+  order = g_string_new (NULL);
+  gst_pad_add_probe (mysinkpad, GST_PAD_PROBE_TYPE_BUFFER |
+      GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM,
+      (GstPadProbeCallback) record_order_probe, order, NULL);
+
+  push_buffers (1);
+  fail_unless (gst_pad_push_event (mysrcpad,
+          gst_event_new_custom (GST_EVENT_CUSTOM_DOWNSTREAM,
+              gst_structure_new_empty ("netsim-test"))));
+
+  /* the event waits behind the delayed buffer */
+  gst_test_clock_wait_for_next_pending_id (GST_TEST_CLOCK (clock), &id);
+  g_mutex_lock (&check_mutex);
+  fail_unless_equals_string (order->str, "");
+  g_mutex_unlock (&check_mutex);
+
+  gst_test_clock_set_time (GST_TEST_CLOCK (clock), 100 * GST_MSECOND);
+  test_id = gst_test_clock_process_next_clock_id (GST_TEST_CLOCK (clock));
+  fail_unless (test_id == id);
+  gst_clock_id_unref (test_id);
+  gst_clock_id_unref (id);
+
+  g_mutex_lock (&check_mutex);
+  while (order->len < 2)
+    g_cond_wait (&check_cond, &check_mutex);
+  fail_unless_equals_string (order->str, "be");
+  g_mutex_unlock (&check_mutex);
+
+  cleanup_netsim (netsim);
+  g_string_free (order, TRUE);
+  gst_object_unref (clock);
+}
+
+GST_END_TEST;
+
+typedef struct
+{
+  GArray *seqnums;
+  GArray *rtx_seqnums;
+  gboolean eos;
+} JitterBufferRun;
+
+static GstBuffer *
+create_rtp_buffer (guint16 seqnum)
+{
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  GstBuffer *buffer;
+
+  buffer = gst_rtp_buffer_new_allocate (160, 0, 0);
+  GST_BUFFER_DTS (buffer) = GST_BUFFER_PTS (buffer) =
+      seqnum * 20 * GST_MSECOND;
+
+  gst_rtp_buffer_map (buffer, GST_MAP_WRITE, &rtp);
+  gst_rtp_buffer_set_payload_type (&rtp, 0);
+  gst_rtp_buffer_set_seq (&rtp, seqnum);
+  gst_rtp_buffer_set_timestamp (&rtp, seqnum * 160);
+  gst_rtp_buffer_set_ssrc (&rtp, 0x01BADBAD);
+  gst_rtp_buffer_unmap (&rtp);
+
+  return buffer;
+}
+
+static GstFlowReturn
+jitterbuffer_run_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+{
+  JitterBufferRun *run = gst_pad_get_element_private (pad);
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  guint16 seqnum;
+
+  gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtp);
+  seqnum = gst_rtp_buffer_get_seq (&rtp);
+  gst_rtp_buffer_unmap (&rtp);
+  gst_buffer_unref (buffer);
+
+  g_array_append_val (run->seqnums, seqnum);
+
+  return GST_FLOW_OK;
+}
+
+static gboolean
+jitterbuffer_run_sink_event (GstPad * pad, GstObject * parent,
+    GstEvent * event)
+{
+  JitterBufferRun *run = gst_pad_get_element_private (pad);
+
+  if (GST_EVENT_TYPE (event) == GST_EVENT_EOS) {
+    g_mutex_lock (&check_mutex);
+    run->eos = TRUE;
+    g_cond_broadcast (&check_cond);
+    g_mutex_unlock (&check_mutex);
+  }
+  gst_event_unref (event);
+
+  return TRUE;
+}
+
+static gboolean
+jitterbuffer_run_src_event (GstPad * pad, GstObject * parent,
+    GstEvent * event)
+{
+  JitterBufferRun *run = gst_pad_get_element_private (pad);
+  const GstStructure *s = gst_event_get_structure (event);
+  guint seqnum;
+
+  if (s && gst_structure_has_name (s, "GstRTPRetransmissionRequest")
+      && gst_structure_get_uint (s, "seqnum", &seqnum)) {
+    g_mutex_lock (&check_mutex);
+    g_array_append_val (run->rtx_seqnums, seqnum);
+    g_mutex_unlock (&check_mutex);
+  }
+  gst_event_unref (event);
+
+  return TRUE;
+}
+
+/* sends RTP_PACKETS packets through netsim ! rtpjitterbuffer and returns the
+ * seqnums that came out. There is no clock, so the jitterbuffer times out
+ * its lost and retransmission timers right away. */
+static JitterBufferRun *
+run_jitterbuffer (guint seed)
+{
+  GstElement *netsim, *jitterbuffer;
+  GstPad *srcpad, *sinkpad, *netsim_src, *jb_sink;
+  JitterBufferRun *run;
+  GstStructure *stats;
+  GstCaps *caps;
+  guint64 rtx_count;
+  gint64 start;
+  guint i;
+
+  run = g_new0 (JitterBufferRun, 1);
+  run->seqnums = g_array_new (FALSE, FALSE, sizeof (guint16));
+  run->rtx_seqnums = g_array_new (FALSE, FALSE, sizeof (guint));
+
+  netsim = gst_check_setup_element ("netsim");
+  jitterbuffer = gst_check_setup_element ("rtpjitterbuffer");
+  g_object_set (netsim, "seed", seed, "loss-probability", 0.02,
+      "burst-enter-probability", 0.01, "burst-exit-probability", 0.3,
+      "duplicate-probability", 0.02, NULL);
+  g_object_set (jitterbuffer, "do-lost", TRUE, "do-retransmission", TRUE,
+      NULL);
+
+  netsim_src = gst_element_get_static_pad (netsim, "src");
+  jb_sink = gst_element_get_static_pad (jitterbuffer, "sink");
+  fail_unless (gst_pad_link (netsim_src, jb_sink) == GST_PAD_LINK_OK);
+  gst_object_unref (netsim_src);
+  gst_object_unref (jb_sink);
+
+  srcpad = gst_check_setup_src_pad (netsim, &srctemplate);
+  gst_pad_set_element_private (srcpad, run);
+  gst_pad_set_event_function (srcpad, jitterbuffer_run_src_event);
+  sinkpad = gst_check_setup_sink_pad (jitterbuffer, &sinktemplate);
+  gst_pad_set_element_private (sinkpad, run);
+  gst_pad_set_chain_function (sinkpad, jitterbuffer_run_chain);
+  gst_pad_set_event_function (sinkpad, jitterbuffer_run_sink_event);
+  gst_pad_set_active (srcpad, TRUE);
+  gst_pad_set_active (sinkpad, TRUE);
+
+  fail_unless (gst_element_set_state (jitterbuffer,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS);
+  fail_unless (gst_element_set_state (netsim,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS);
+
+  caps = gst_caps_new_simple ("application/x-rtp",
+      "media", G_TYPE_STRING, "audio", "clock-rate", G_TYPE_INT, 8000,
+      "encoding-name", G_TYPE_STRING, "PCMU", "payload", G_TYPE_INT, 0, NULL);
+  gst_check_setup_events (srcpad, netsim, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < RTP_PACKETS; i++)
+    fail_unless_equals_int (gst_pad_push (srcpad, create_rtp_buffer (i)),
+        GST_FLOW_OK);
+  fail_unless (gst_pad_push_event (srcpad, gst_event_new_eos ()));
+
+  g_mutex_lock (&check_mutex);
+  while (!run->eos)
+    g_cond_wait (&check_cond, &check_mutex);
+  g_mutex_unlock (&check_mutex);
+
+  g_object_get (jitterbuffer, "stats", &stats, NULL);
+  fail_unless (gst_structure_get_uint64 (stats, "rtx-count", &rtx_count));
+  gst_structure_free (stats);
+
+  GST_INFO ("seed %u: %u of %u packets, %" G_GUINT64_FORMAT " dropped, %"
+      G_GUINT64_FORMAT " rtx requests in %" G_GINT64_FORMAT " us", seed,
+      run->seqnums->len, RTP_PACKETS, get_stat (netsim, "num-dropped"),
+      rtx_count, g_get_monotonic_time () - start);
+  fail_unless (rtx_count > 0);
+
+  gst_element_set_state (netsim, GST_STATE_NULL);
+  gst_element_set_state (jitterbuffer, GST_STATE_NULL);
+  gst_pad_set_active (srcpad, FALSE);
+  gst_pad_set_active (sinkpad, FALSE);
+  gst_check_teardown_src_pad (netsim);
+  gst_check_teardown_sink_pad (jitterbuffer);
+  gst_check_teardown_element (netsim);
+  gst_check_teardown_element (jitterbuffer);
+
+  return run;
+}
+
+static void
+jitterbuffer_run_free (JitterBufferRun * run)
+{
+  g_array_free (run->seqnums, TRUE);
+  g_array_free (run->rtx_seqnums, TRUE);
+  g_free (run);
+}
+
+GST_START_TEST (test_jitterbuffer_is_reproducible)
+{
+  JitterBufferRun *first, *second;
+  guint16 prev, seqnum;
+  guint i, j;
+
+  first = run_jitterbuffer (42);
+  second = run_jitterbuffer (42);
+
+  /* duplicates were removed and something was lost */
+  fail_unless (first->seqnums->len > 0);
+  fail_unless (first->seqnums->len < RTP_PACKETS);
+  for (i = 1; i < first->seqnums->len; i++)
+    fail_unless (g_array_index (first->seqnums, guint16, i) >
+        g_array_index (first->seqnums, guint16, i - 1));
+
+  fail_unless_equals_int (first->seqnums->len, second->seqnums->len);
+  for (i = 0; i < first->seqnums->len; i++)
+    fail_unless_equals_int (g_array_index (first->seqnums, guint16, i),
+        g_array_index (second->seqnums, guint16, i));
+
+  /* every packet lost in between was asked for again */
+  prev = g_array_index (first->seqnums, guint16, 0);
+  for (i = 1; i < first->seqnums->len; i++) {
+    seqnum = g_array_index (first->seqnums, guint16, i);
+    for (prev++; prev < seqnum; prev++) {
+      for (j = 0; j < first->rtx_seqnums->len; j++)
+        if (g_array_index (first->rtx_seqnums, guint, j) == prev)
+          break;
+      fail_unless (j < first->rtx_seqnums->len,
+          "no retransmission requested for %u", prev);
+    }
+  }
+
+  jitterbuffer_run_free (first);
+  jitterbuffer_run_free (second);
+}
+
+GST_END_TEST;
+
+static Suite *
+netsim_suite (void)
+{
+  Suite *s = suite_create ("netsim");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_passthrough);
+  tcase_add_test (tc_chain, test_seeded_loss_is_reproducible);
+  tcase_add_test (tc_chain, test_gilbert_elliott_bursts);
+  tcase_add_test (tc_chain, test_duplicate);
+  tcase_add_test (tc_chain, test_buffer_list);
+  tcase_add_test (tc_chain, test_delay);
+  tcase_add_test (tc_chain, test_reorder);
+  tcase_add_test (tc_chain, test_serialized_event_order);
+  /* rtpjitterbuffer lives in another plugin that might not be built */
+  if (gst_registry_check_feature_version (gst_registry_get (),
+          "rtpjitterbuffer", GST_VERSION_MAJOR, GST_VERSION_MINOR, 0))
+    tcase_add_test (tc_chain, test_jitterbuffer_is_reproducible);
+
+  return s;
+}
+
+GST_CHECK_MAIN (netsim);
@@ -0,0 +1,859 @@
+/* GStreamer
+ *
+ * unit test for qtdemux
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+#include <glib/gstdio.h>
+
+#define VIDEO_CAPS_STRING "video/mpeg, " \
+                           "mpegversion = (int) 4, " \
+                           "systemstream = (boolean) false, " \
+                           "width = (int) 384, " \
+                           "height = (int) 288, " \
+                           "framerate = (fraction) 25/1"
+
+#define N_FRAGMENTS 10000
+#define FRAME_DURATION (40 * GST_MSECOND)
+#define KEYFRAME_DISTANCE 10
+/* frames per run of equal durations in files with variable frame durations */
+#define RUN_LENGTH 100
+
+#define JPEG_CAPS_STRING "image/jpeg, " \
+                          "width = (int) 384, " \
+                          "height = (int) 288, " \
+                          "framerate = (fraction) 25/1"
+
+/* For ease of programming we use globals to keep refs for our floating
+ * src and sink pads we create; otherwise we always have to do get_pad,
+ * get_peer, and then remove references in every test function */
+static GstPad *mysrcpad, *mysinkpad;
+
+/* start of the last BYTES seek qtdemux sent upstream */
+static gint64 upstream_seek_offset;
+
+static GstStaticPadTemplate qtsinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("video/quicktime"));
+
+static GstStaticPadTemplate qtsrctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("video/quicktime"));
+
+static GstStaticPadTemplate videosrctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (VIDEO_CAPS_STRING));
+
+static GstStaticPadTemplate jpegsrctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (JPEG_CAPS_STRING));
+
+static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+/* mux @n_frames keyframes into a fragmented file, one frame per fragment */
+static GstBuffer *
+create_fragmented_file (guint n_frames)
+{
+  GstElement *qtmux;
+  GstPad *srcpad, *sinkpad, *collectpad;
+  GstBuffer *file, *buf;
+  GstSegment segment;
+  GstCaps *caps;
+  GList *l;
+  guint i;
+
+  qtmux = gst_check_setup_element ("qtmux");
+  g_object_set (qtmux, "fragment-duration", 40, "streamable", TRUE, NULL);
+
+  srcpad = gst_pad_new_from_static_template (&videosrctemplate, "src");
+  sinkpad = gst_element_get_request_pad (qtmux, "video_%u");
+  fail_unless (gst_pad_link (srcpad, sinkpad) == GST_PAD_LINK_OK);
+  collectpad = gst_check_setup_sink_pad (qtmux, &qtsinktemplate);
+  gst_pad_set_active (srcpad, TRUE);
+  gst_pad_set_active (collectpad, TRUE);
+
+  fail_unless (gst_element_set_state (qtmux,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  gst_pad_push_event (srcpad, gst_event_new_stream_start ("test"));
+  caps = gst_caps_from_string (VIDEO_CAPS_STRING);
+  gst_pad_set_caps (srcpad, caps);
+  gst_caps_unref (caps);
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  fail_unless (gst_pad_push_event (srcpad, gst_event_new_segment (&segment)));
+
+  for (i = 0; i < n_frames; i++) {
+    buf = gst_buffer_new_and_alloc (16);
+    gst_buffer_memset (buf, 0, i & 0xff, 16);
+    GST_BUFFER_PTS (buf) = GST_BUFFER_DTS (buf) = i * FRAME_DURATION;
+    GST_BUFFER_DURATION (buf) = FRAME_DURATION;
+    fail_unless (gst_pad_push (srcpad, buf) == GST_FLOW_OK);
+  }
+  fail_unless (gst_pad_push_event (srcpad, gst_event_new_eos ()));
+
+  file = gst_buffer_new ();
+  for (l = buffers; l; l = l->next)
+    file = gst_buffer_append (file, gst_buffer_ref (l->data));
+  gst_check_drop_buffers ();
+
+  gst_element_set_state (qtmux, GST_STATE_NULL);
+  gst_pad_set_active (srcpad, FALSE);
+  gst_pad_unlink (srcpad, sinkpad);
+  gst_element_release_request_pad (qtmux, sinkpad);
+  gst_object_unref (sinkpad);
+  gst_object_unref (srcpad);
+  gst_pad_set_active (collectpad, FALSE);
+  gst_check_teardown_sink_pad (qtmux);
+  gst_check_teardown_element (qtmux);
+
+  return file;
+}
+
+/* offsets of the top level moof atoms in @file */
+static GArray *
+find_moof_offsets (GstBuffer * file)
+{
+  GArray *offsets;
+  GstMapInfo map;
+  guint64 offset = 0;
+
+  offsets = g_array_new (FALSE, FALSE, sizeof (guint64));
+  gst_buffer_map (file, &map, GST_MAP_READ);
+  while (offset + 8 <= map.size) {
+    guint64 size = GST_READ_UINT32_BE (map.data + offset);
+    guint32 fourcc = GST_READ_UINT32_LE (map.data + offset + 4);
+
+    if (size == 1)
+      size = GST_READ_UINT64_BE (map.data + offset + 8);
+    fail_unless (size >= 8);
+
+    if (fourcc == GST_MAKE_FOURCC ('m', 'o', 'o', 'f'))
+      g_array_append_val (offsets, offset);
+    offset += size;
+  }
+  gst_buffer_unmap (file, &map);
+
+  return offsets;
+}
+
+static gboolean
+upstream_event (GstPad * pad, GstObject * parent, GstEvent * event)
+{
+  if (GST_EVENT_TYPE (event) == GST_EVENT_SEEK) {
+    GstFormat format;
+    gint64 start;
+    gboolean res;
+
+    gst_event_parse_seek (event, NULL, &format, NULL, NULL, &start, NULL,
+        NULL);
+    /* refuse time seeks, so that qtdemux has to work out the byte offset */
+    res = (format == GST_FORMAT_BYTES);
+    if (res)
+      upstream_seek_offset = start;
+    gst_event_unref (event);
+    return res;
+  }
+
+  return gst_pad_event_default (pad, parent, event);
+}
+
+static void
+pad_added_cb (GstElement * qtdemux, GstPad * pad, gpointer user_data)
+{
+  fail_unless (gst_pad_link (pad, mysinkpad) == GST_PAD_LINK_OK);
+}
+
+static GstElement *
+setup_qtdemux (void)
+{
+  GstElement *qtdemux;
+  GstCaps *caps;
+
+  qtdemux = gst_check_setup_element ("qtdemux");
+  mysrcpad = gst_check_setup_src_pad (qtdemux, &qtsrctemplate);
+  gst_pad_set_event_function (mysrcpad, upstream_event);
+  mysinkpad = gst_pad_new_from_static_template (&sinktemplate, "sink");
+  gst_pad_set_chain_function (mysinkpad, gst_check_chain_func);
+  g_signal_connect (qtdemux, "pad-added", G_CALLBACK (pad_added_cb), NULL);
+  gst_pad_set_active (mysrcpad, TRUE);
+  gst_pad_set_active (mysinkpad, TRUE);
+
+  fail_unless (gst_element_set_state (qtdemux,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  caps = gst_caps_new_empty_simple ("video/quicktime");
+  gst_check_setup_events (mysrcpad, qtdemux, caps, GST_FORMAT_BYTES);
+  gst_caps_unref (caps);
+
+  return qtdemux;
+}
+
+static void
+cleanup_qtdemux (GstElement * qtdemux)
+{
+  gst_check_drop_buffers ();
+  gst_element_set_state (qtdemux, GST_STATE_NULL);
+  gst_pad_set_active (mysrcpad, FALSE);
+  gst_pad_set_active (mysinkpad, FALSE);
+  gst_check_teardown_src_pad (qtdemux);
+  gst_object_unref (mysinkpad);
+  gst_check_teardown_element (qtdemux);
+}
+
+GST_START_TEST (test_fragmented_push_seek)
+{
+  GstElement *qtdemux;
+  GstBuffer *file;
+  GArray *moofs;
+  GstSegment segment;
+  GstClockTime target;
+  guint64 moof_offset;
+  gsize size;
+
+  file = create_fragmented_file (N_FRAGMENTS);
+  moofs = find_moof_offsets (file);
+  fail_unless_equals_int (moofs->len, N_FRAGMENTS);
+  size = gst_buffer_get_size (file);
+
+  qtdemux = setup_qtdemux ();
+
+  /* play the whole file once, the fragment index is collected on the way */
+  fail_unless_equals_int (gst_pad_push (mysrcpad, gst_buffer_ref (file)),
+      GST_FLOW_OK);
+  fail_unless_equals_int (g_list_length (buffers), N_FRAGMENTS);
+  gst_check_drop_buffers ();
+
+  /* seeking back into the middle restarts at the fragment holding the
+   * target */
+  target = 7777 * FRAME_DURATION + FRAME_DURATION / 2;
+  upstream_seek_offset = -1;
+  fail_unless (gst_pad_push_event (mysinkpad,
+          gst_event_new_seek (1.0, GST_FORMAT_TIME,
+              GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_KEY_UNIT,
+              GST_SEEK_TYPE_SET, target, GST_SEEK_TYPE_NONE, -1)));
+  moof_offset = g_array_index (moofs, guint64, 7777);
+  fail_unless_equals_uint64 (upstream_seek_offset, moof_offset);
+
+  /* act as the upstream element performing that seek */
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_flush_start ()));
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_flush_stop (TRUE)));
+  gst_segment_init (&segment, GST_FORMAT_BYTES);
+  segment.start = segment.time = moof_offset;
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_segment (&segment)));
+  fail_unless_equals_int (gst_pad_push (mysrcpad,
+          gst_buffer_copy_region (file, GST_BUFFER_COPY_ALL, moof_offset,
+              size - moof_offset)), GST_FLOW_OK);
+
+  fail_unless_equals_int (g_list_length (buffers), N_FRAGMENTS - 7777);
+  fail_unless_equals_uint64 (GST_BUFFER_PTS (buffers->data),
+      7777 * FRAME_DURATION);
+
+  cleanup_qtdemux (qtdemux);
+  g_array_free (moofs, TRUE);
+  gst_buffer_unref (file);
+}
+
+GST_END_TEST;
+
+/* duration of frame @i, with @variable durations every other run of
+ * RUN_LENGTH frames is played twice as fast */
+static GstClockTime
+frame_duration (guint i, gboolean variable)
+{
+  if (variable && (i / RUN_LENGTH) % 2)
+    return FRAME_DURATION / 2;
+  return FRAME_DURATION;
+}
+
+static GstClockTime
+frame_timestamp (guint i, gboolean variable)
+{
+  GstClockTime ts = 0;
+  guint j;
+
+  if (!variable)
+    return i * FRAME_DURATION;
+
+  for (j = 0; j < i; j++)
+    ts += frame_duration (j, variable);
+  return ts;
+}
+
+/* mux @n_frames frames with a keyframe every @keyframe_distance frames into
+ * a file, a fragmented one has one GOP per fragment. JPEG frames are all
+ * keyframes, which leaves out the stss table. Returns the location of the
+ * file. */
+static gchar *
+create_movie_file_full (guint n_frames, gboolean fragmented,
+    guint keyframe_distance, gboolean variable, gboolean jpeg)
+{
+  GstElement *qtmux, *filesink;
+  GstPad *srcpad, *sinkpad;
+  GstBuffer *buf;
+  GstSegment segment;
+  GstCaps *caps;
+  gchar *location;
+  GstClockTime ts;
+  guint i;
+
+  location = g_strdup_printf ("%s/%s-%d", g_get_tmp_dir (), "qtdemuxtest",
+      g_random_int ());
+
+  qtmux = gst_check_setup_element ("qtmux");
+  if (fragmented)
+    g_object_set (qtmux, "fragment-duration",
+        (guint) (keyframe_distance * FRAME_DURATION / GST_MSECOND), NULL);
+  filesink = gst_element_factory_make ("filesink", NULL);
+  g_object_set (filesink, "location", location, NULL);
+  fail_unless (gst_element_link (qtmux, filesink));
+
+  srcpad = gst_pad_new_from_static_template (jpeg ? &jpegsrctemplate :
+      &videosrctemplate, "src");
+  sinkpad = gst_element_get_request_pad (qtmux, "video_%u");
+  fail_unless (gst_pad_link (srcpad, sinkpad) == GST_PAD_LINK_OK);
+  gst_pad_set_active (srcpad, TRUE);
+
+  fail_unless (gst_element_set_state (filesink,
+          GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE,
+      "could not set filesink to playing");
+  fail_unless (gst_element_set_state (qtmux,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  gst_pad_push_event (srcpad, gst_event_new_stream_start ("test"));
+  caps = gst_caps_from_string (jpeg ? JPEG_CAPS_STRING : VIDEO_CAPS_STRING);
+  gst_pad_set_caps (srcpad, caps);
+  gst_caps_unref (caps);
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  fail_unless (gst_pad_push_event (srcpad, gst_event_new_segment (&segment)));
+
+  for (i = 0, ts = 0; i < n_frames; i++) {
+    buf = gst_buffer_new_and_alloc (16);
+    gst_buffer_memset (buf, 0, i & 0xff, 16);
+    GST_BUFFER_PTS (buf) = GST_BUFFER_DTS (buf) = ts;
+    GST_BUFFER_DURATION (buf) = frame_duration (i, variable);
+    ts += GST_BUFFER_DURATION (buf);
+    if (i % keyframe_distance)
+      GST_BUFFER_FLAG_SET (buf, GST_BUFFER_FLAG_DELTA_UNIT);
+    fail_unless (gst_pad_push (srcpad, buf) == GST_FLOW_OK);
+  }
+  fail_unless (gst_pad_push_event (srcpad, gst_event_new_eos ()));
+
+  gst_element_set_state (qtmux, GST_STATE_NULL);
+  gst_element_set_state (filesink, GST_STATE_NULL);
+  gst_pad_set_active (srcpad, FALSE);
+  gst_pad_unlink (srcpad, sinkpad);
+  gst_element_release_request_pad (qtmux, sinkpad);
+  gst_object_unref (sinkpad);
+  gst_object_unref (srcpad);
+  gst_object_unref (filesink);
+  gst_check_teardown_element (qtmux);
+
+  return location;
+}
+
+/* mux @n_frames frames with a keyframe every KEYFRAME_DISTANCE frames into
+ * a file, a fragmented one has one GOP per fragment. Returns the location
+ * of the file. */
+static gchar *
+create_movie_file (guint n_frames, gboolean fragmented)
+{
+  return create_movie_file_full (n_frames, fragmented, KEYFRAME_DISTANCE,
+      FALSE, FALSE);
+}
+
+static void
+handoff_cb (GstElement * sink, GstBuffer * buffer, GstPad * pad,
+    GArray * timestamps)
+{
+  GstClockTime pts = GST_BUFFER_PTS (buffer);
+
+  g_array_append_val (timestamps, pts);
+}
+
+static void
+handoff_duration_cb (GstElement * sink, GstBuffer * buffer, GstPad * pad,
+    GArray * durations)
+{
+  GstClockTime duration = GST_BUFFER_DURATION (buffer);
+
+  g_array_append_val (durations, duration);
+}
+
+/* does a flushing keyframe seek to @target in PAUSED, plays until EOS and
+ * checks that all frames from @first_frame on came out in order, with their
+ * durations if @durations are collected too */
+static void
+check_pull_seek_full (GstElement * pipeline, GArray * timestamps,
+    GArray * durations, guint n_frames, GstClockTime target,
+    guint first_frame, gboolean variable)
+{
+  GstMessage *msg;
+  GstBus *bus;
+  guint i;
+
+  fail_unless (gst_element_seek_simple (pipeline, GST_FORMAT_TIME,
+          GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_KEY_UNIT, target));
+  fail_unless_equals_int (gst_element_get_state (pipeline, NULL, NULL,
+          GST_CLOCK_TIME_NONE), GST_STATE_CHANGE_SUCCESS);
+
+  /* nothing is rendered in PAUSED, the streaming thread does not touch the
+   * array until we go to PLAYING */
+  g_array_set_size (timestamps, 0);
+  if (durations)
+    g_array_set_size (durations, 0);
+
+  fail_unless (gst_element_set_state (pipeline,
+          GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE);
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+
+  fail_unless (gst_element_set_state (pipeline,
+          GST_STATE_PAUSED) != GST_STATE_CHANGE_FAILURE);
+  fail_unless_equals_int (gst_element_get_state (pipeline, NULL, NULL,
+          GST_CLOCK_TIME_NONE), GST_STATE_CHANGE_SUCCESS);
+
+  fail_unless_equals_int (timestamps->len, n_frames - first_frame);
+  for (i = 0; i < timestamps->len; i++)
+    fail_unless_equals_uint64 (g_array_index (timestamps, GstClockTime, i),
+        frame_timestamp (first_frame + i, variable));
+
+  if (durations) {
+    fail_unless_equals_int (durations->len, n_frames - first_frame);
+    for (i = 0; i < durations->len; i++)
+      fail_unless_equals_uint64 (g_array_index (durations, GstClockTime, i),
+          frame_duration (first_frame + i, variable));
+  }
+}
+
+static void
+check_pull_seek (GstElement * pipeline, GArray * timestamps, guint n_frames,
+    GstClockTime target, guint first_frame)
+{
+  check_pull_seek_full (pipeline, timestamps, NULL, n_frames, target,
+      first_frame, FALSE);
+}
+
+/* plays @location in pull mode and seeks around in it, landing before and
+ * after the boundaries of the 4096 sample chunks the tables are expanded
+ * in */
+static void
+run_pull_seeks (const gchar * location, guint n_frames, gboolean prefetch)
+{
+  static const guint targets[] = { 0, 15005, 3, 4097, 8191, 19999 };
+  GstElement *pipeline, *sink;
+  GArray *timestamps;
+  gchar *desc;
+  guint i;
+
+  desc = g_strdup_printf ("filesrc location=%s ! qtdemux name=demux "
+      "prefetch-samples=%s demux. ! fakesink name=sink sync=false "
+      "signal-handoffs=true", location, prefetch ? "true" : "false");
+  pipeline = gst_parse_launch (desc, NULL);
+  fail_unless (pipeline != NULL);
+  g_free (desc);
+
+  timestamps = g_array_new (FALSE, FALSE, sizeof (GstClockTime));
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  g_signal_connect (sink, "handoff", G_CALLBACK (handoff_cb), timestamps);
+  gst_object_unref (sink);
+
+  fail_unless (gst_element_set_state (pipeline,
+          GST_STATE_PAUSED) != GST_STATE_CHANGE_FAILURE);
+  fail_unless_equals_int (gst_element_get_state (pipeline, NULL, NULL,
+          GST_CLOCK_TIME_NONE), GST_STATE_CHANGE_SUCCESS);
+
+  for (i = 0; i < G_N_ELEMENTS (targets); i++) {
+    guint target = MIN (targets[i], n_frames - 1);
+
+    check_pull_seek (pipeline, timestamps, n_frames,
+        target * FRAME_DURATION + FRAME_DURATION / 2,
+        target - target % KEYFRAME_DISTANCE);
+  }
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+  g_array_free (timestamps, TRUE);
+}
+
+GST_START_TEST (test_pull_prefetch_samples)
+{
+  gchar *location;
+
+  location = create_movie_file (20000, FALSE);
+
+  /* the prefetch thread expands the tables while the streaming thread
+   * looks up samples and keyframes, the result must be the same */
+  run_pull_seeks (location, 20000, FALSE);
+  run_pull_seeks (location, 20000, TRUE);
+
+  g_unlink (location);
+  g_free (location);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_pull_prefetch_fragmented_seek)
+{
+  gchar *location;
+
+  location = create_movie_file (2000, TRUE);
+
+  /* fragmented seeks throw the sample tables away, the prefetch thread
+   * has to be stopped for that and started again */
+  run_pull_seeks (location, 2000, TRUE);
+
+  g_unlink (location);
+  g_free (location);
+}
+
+GST_END_TEST;
+
+/* seeks around in @location in pull mode, jumping back and forth over the
+ * runs of equal frame durations so that the runs are searched for rather
+ * than followed sequentially */
+static void
+run_time_run_seeks (const gchar * location, guint n_frames,
+    guint keyframe_distance, gboolean variable, gboolean prefetch)
+{
+  static const guint targets[] = { 0, 950, 105, 520, 299, 300, 999, 1 };
+  GstElement *pipeline, *sink;
+  GArray *timestamps, *durations;
+  gchar *desc;
+  guint i;
+
+  desc = g_strdup_printf ("filesrc location=%s ! qtdemux name=demux "
+      "prefetch-samples=%s demux. ! fakesink name=sink sync=false "
+      "signal-handoffs=true", location, prefetch ? "true" : "false");
+  pipeline = gst_parse_launch (desc, NULL);
+  fail_unless (pipeline != NULL);
+  g_free (desc);
+
+  timestamps = g_array_new (FALSE, FALSE, sizeof (GstClockTime));
+  durations = g_array_new (FALSE, FALSE, sizeof (GstClockTime));
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  g_signal_connect (sink, "handoff", G_CALLBACK (handoff_cb), timestamps);
+  g_signal_connect (sink, "handoff", G_CALLBACK (handoff_duration_cb),
+      durations);
+  gst_object_unref (sink);
+
+  fail_unless (gst_element_set_state (pipeline,
+          GST_STATE_PAUSED) != GST_STATE_CHANGE_FAILURE);
+  fail_unless_equals_int (gst_element_get_state (pipeline, NULL, NULL,
+          GST_CLOCK_TIME_NONE), GST_STATE_CHANGE_SUCCESS);
+
+  for (i = 0; i < G_N_ELEMENTS (targets); i++) {
+    guint target = MIN (targets[i], n_frames - 1);
+
+    check_pull_seek_full (pipeline, timestamps, durations, n_frames,
+        frame_timestamp (target, variable) + frame_duration (target,
+            variable) / 2, target - target % keyframe_distance, variable);
+  }
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+  g_array_free (timestamps, TRUE);
+  g_array_free (durations, TRUE);
+}
+
+GST_START_TEST (test_pull_time_runs)
+{
+  gchar *location;
+
+  /* the durations change every RUN_LENGTH frames, so the stts table has
+   * a run for each of them. Keyframes are further apart than the 32 bits a
+   * word of the keyframe bitmap holds. */
+  location = create_movie_file_full (1000, FALSE, 37, TRUE, FALSE);
+
+  run_time_run_seeks (location, 1000, 37, TRUE, FALSE);
+  run_time_run_seeks (location, 1000, 37, TRUE, TRUE);
+
+  g_unlink (location);
+  g_free (location);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_pull_all_keyframes)
+{
+  gchar *location;
+
+  /* without stss every sample is a keyframe, seeks land on the frame that
+   * holds the target */
+  location = create_movie_file_full (1000, FALSE, 1, TRUE, TRUE);
+
+  run_time_run_seeks (location, 1000, 1, TRUE, FALSE);
+  run_time_run_seeks (location, 1000, 1, TRUE, TRUE);
+
+  g_unlink (location);
+  g_free (location);
+}
+
+GST_END_TEST;
+
+static void
+handoff_stream_time_cb (GstElement * sink, GstBuffer * buffer, GstPad * pad,
+    GArray * stream_times)
+{
+  GstEvent *event;
+  const GstSegment *segment;
+  GstClockTime stream_time;
+
+  event = gst_pad_get_sticky_event (pad, GST_EVENT_SEGMENT, 0);
+  fail_unless (event != NULL);
+  gst_event_parse_segment (event, &segment);
+  /* also for the frame starting before the segment that a seek lands in,
+   * which gst_segment_to_stream_time() refuses */
+  stream_time = segment->time + GST_BUFFER_PTS (buffer) - segment->start;
+  gst_event_unref (event);
+
+  g_array_append_val (stream_times, stream_time);
+}
+
+/* checks that @n frames came out, the first of them at @first */
+static void
+check_stream_times (GArray * stream_times, guint n, GstClockTime first)
+{
+  guint i;
+
+  fail_unless_equals_int (stream_times->len, n);
+  for (i = 0; i < n; i++)
+    fail_unless_equals_uint64 (g_array_index (stream_times, GstClockTime, i),
+        first + i * FRAME_DURATION);
+}
+
+#define EDIT_DELAY GST_SECOND
+
+GST_START_TEST (test_pull_edit_list)
+{
+  GstElement *pipeline, *sink;
+  GArray *times[2];
+  GstMessage *msg;
+  GstBus *bus;
+  gchar *location, *desc;
+  guint i;
+
+  /* the second track starts a second later, qtmux writes an empty edit for
+   * that in front of it */
+  location = g_strdup_printf ("%s/%s-%d", g_get_tmp_dir (), "qtdemuxtest",
+      g_random_int ());
+  desc = g_strdup_printf ("qtmux name=mux ! filesink location=%s "
+      "videotestsrc num-buffers=100 ! " "video/x-raw, format=(string)RGB, "
+      "width=(int)16, height=(int)16, framerate=(fraction)25/1 ! mux. "
+      "videotestsrc num-buffers=100 timestamp-offset=%" G_GUINT64_FORMAT " ! "
+      "video/x-raw, format=(string)RGB, width=(int)16, height=(int)16, "
+      "framerate=(fraction)25/1 ! mux.", location, EDIT_DELAY);
+  pipeline = gst_parse_launch (desc, NULL);
+  fail_unless (pipeline != NULL);
+  g_free (desc);
+  bus = gst_element_get_bus (pipeline);
+  fail_unless (gst_element_set_state (pipeline,
+          GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+  desc = g_strdup_printf ("filesrc location=%s ! qtdemux name=demux "
+      "demux.video_0 ! fakesink name=sink0 sync=false signal-handoffs=true "
+      "demux.video_1 ! fakesink name=sink1 sync=false signal-handoffs=true",
+      location);
+  pipeline = gst_parse_launch (desc, NULL);
+  fail_unless (pipeline != NULL);
+  g_free (desc);
+
+  for (i = 0; i < 2; i++) {
+    gchar *name = g_strdup_printf ("sink%u", i);
+
+    times[i] = g_array_new (FALSE, FALSE, sizeof (GstClockTime));
+    sink = gst_bin_get_by_name (GST_BIN (pipeline), name);
+    g_signal_connect (sink, "handoff", G_CALLBACK (handoff_stream_time_cb),
+        times[i]);
+    gst_object_unref (sink);
+    g_free (name);
+  }
+
+  fail_unless (gst_element_set_state (pipeline,
+          GST_STATE_PAUSED) != GST_STATE_CHANGE_FAILURE);
+  fail_unless_equals_int (gst_element_get_state (pipeline, NULL, NULL,
+          GST_CLOCK_TIME_NONE), GST_STATE_CHANGE_SUCCESS);
+
+  /* the samples of the second track are mapped through its edit list, an
+   * empty edit followed by the media. Nothing is rendered in PAUSED. */
+  fail_unless (gst_element_set_state (pipeline,
+          GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE);
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+  check_stream_times (times[0], 100, 0);
+  check_stream_times (times[1], 100, EDIT_DELAY);
+
+  /* seeking into the second track looks up the sample at the media time
+   * the edit list maps the target to */
+  fail_unless (gst_element_set_state (pipeline,
+          GST_STATE_PAUSED) != GST_STATE_CHANGE_FAILURE);
+  fail_unless_equals_int (gst_element_get_state (pipeline, NULL, NULL,
+          GST_CLOCK_TIME_NONE), GST_STATE_CHANGE_SUCCESS);
+  fail_unless (gst_element_seek_simple (pipeline, GST_FORMAT_TIME,
+          GST_SEEK_FLAG_FLUSH, EDIT_DELAY + 37 * FRAME_DURATION +
+          FRAME_DURATION / 2));
+  fail_unless_equals_int (gst_element_get_state (pipeline, NULL, NULL,
+          GST_CLOCK_TIME_NONE), GST_STATE_CHANGE_SUCCESS);
+  g_array_set_size (times[0], 0);
+  g_array_set_size (times[1], 0);
+  fail_unless (gst_element_set_state (pipeline,
+          GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+  check_stream_times (times[0], 100 - 62, 62 * FRAME_DURATION);
+  check_stream_times (times[1], 100 - 37, EDIT_DELAY + 37 * FRAME_DURATION);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+  g_array_free (times[0], TRUE);
+  g_array_free (times[1], TRUE);
+  g_unlink (location);
+  g_free (location);
+}
+
+GST_END_TEST;
+
+/* pops the index-memory messages queued on the bus of @pipeline, returns
+ * how many there were and whether the last one had a sparse index, how many
+ * fragments it kept and at which stride */
+static guint
+pop_index_memory (GstElement * pipeline, gboolean * sparse, guint * fragments,
+    guint * stride)
+{
+  GstMessage *msg;
+  GstBus *bus;
+  guint n = 0;
+
+  bus = gst_element_get_bus (pipeline);
+  while ((msg = gst_bus_pop_filtered (bus, GST_MESSAGE_ELEMENT))) {
+    const GstStructure *s = gst_message_get_structure (msg);
+
+    if (gst_structure_has_name (s, "index-memory")) {
+      fail_unless (gst_structure_get (s, "sparse", G_TYPE_BOOLEAN, sparse,
+              "fragments", G_TYPE_UINT, fragments, "fragment-stride",
+              G_TYPE_UINT, stride, NULL));
+      n++;
+    }
+    gst_message_unref (msg);
+  }
+  gst_object_unref (bus);
+
+  return n;
+}
+
+GST_START_TEST (test_max_index_memory)
+{
+  GstElement *pipeline, *sink;
+  GArray *timestamps;
+  gchar *location, *desc;
+  gboolean sparse = FALSE;
+  guint fragments = 0, stride = 0;
+
+  /* 200 fragments, of which the fragment index keeps about 50 */
+  location = create_movie_file (2000, TRUE);
+  desc = g_strdup_printf ("filesrc location=%s ! qtdemux name=demux "
+      "max-index-memory=1200 demux. ! fakesink name=sink sync=false "
+      "signal-handoffs=true", location);
+  pipeline = gst_parse_launch (desc, NULL);
+  fail_unless (pipeline != NULL);
+  g_free (desc);
+
+  timestamps = g_array_new (FALSE, FALSE, sizeof (GstClockTime));
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  g_signal_connect (sink, "handoff", G_CALLBACK (handoff_cb), timestamps);
+  gst_object_unref (sink);
+
+  fail_unless (gst_element_set_state (pipeline,
+          GST_STATE_PAUSED) != GST_STATE_CHANGE_FAILURE);
+  fail_unless_equals_int (gst_element_get_state (pipeline, NULL, NULL,
+          GST_CLOCK_TIME_NONE), GST_STATE_CHANGE_SUCCESS);
+  fail_unless (pop_index_memory (pipeline, &sparse, &fragments, &stride) > 0);
+
+  /* all fragments are known from the mfra index, and are kept at one stride,
+   * the first one included */
+  fail_unless (sparse);
+  fail_unless (stride > 1);
+  fail_unless_equals_int (fragments, 199 / stride + 1);
+
+  /* seeking in the thinned out index still lands on the right fragment */
+  check_pull_seek (pipeline, timestamps, 2000,
+      1505 * FRAME_DURATION + FRAME_DURATION / 2, 1500);
+  check_pull_seek (pipeline, timestamps, 2000, 0, 0);
+  fail_unless_equals_int (pop_index_memory (pipeline, &sparse, &fragments,
+          &stride), 0);
+
+  /* playing again passes the fragments that were dropped from the index,
+   * they are not added back to have it thinned out again */
+  check_pull_seek (pipeline, timestamps, 2000, 0, 0);
+  fail_unless_equals_int (pop_index_memory (pipeline, &sparse, &fragments,
+          &stride), 0);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+  g_array_free (timestamps, TRUE);
+  g_unlink (location);
+  g_free (location);
+}
+
+GST_END_TEST;
+
+static Suite *
+qtdemux_suite (void)
+{
+  Suite *s = suite_create ("qtdemux");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_fragmented_push_seek);
+  tcase_add_test (tc_chain, test_pull_prefetch_samples);
+  tcase_add_test (tc_chain, test_pull_prefetch_fragmented_seek);
+  tcase_add_test (tc_chain, test_pull_time_runs);
+  tcase_add_test (tc_chain, test_pull_all_keyframes);
+  tcase_add_test (tc_chain, test_pull_edit_list);
+  tcase_add_test (tc_chain, test_max_index_memory);
+
+  return s;
+}
+
+GST_CHECK_MAIN (qtdemux);
@@ -542,6 +542,762 @@ GST_START_TEST (test_audio_pad_frag_asc_streamable)
 
 GST_END_TEST;
 
+GST_START_TEST (test_video_pad_reserved_moov)
+{
+  GstElement *qtmux;
+  GstBuffer *inbuffer, *outbuffer;
+  GstCaps *caps;
+  GstSegment segment;
+  gsize reserved = 0, moov_size = 0;
+  int num_buffers;
+  int i;
+  guint8 data_free[4] = "free";
+  guint8 data_mdat[8] = "\000\000\000\001mdat";
+  guint8 data_moov[4] = "moov";
+
+  qtmux = setup_qtmux (&srcvideotemplate, "video_%u", TRUE);
+  g_object_set (qtmux, "reserved-max-duration", 10 * GST_SECOND, NULL);
+  fail_unless (gst_element_set_state (qtmux,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  gst_pad_push_event (mysrcpad, gst_event_new_stream_start ("test"));
+
+  caps = gst_pad_get_pad_template_caps (mysrcpad);
+  gst_pad_set_caps (mysrcpad, caps);
+  gst_caps_unref (caps);
+
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_segment (&segment)));
+
+  inbuffer = gst_buffer_new_and_alloc (1);
+  gst_buffer_memset (inbuffer, 0, 0, 1);
+  GST_BUFFER_TIMESTAMP (inbuffer) = 0;
+  GST_BUFFER_DURATION (inbuffer) = 40 * GST_MSECOND;
+  fail_unless (gst_pad_push (mysrcpad, inbuffer) == GST_FLOW_OK);
+
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_eos ()) == TRUE);
+
+  /* ftyp, reserved space, mdat header, buffer, mdat header update,
+   * moov and the free atom padding the reserved space */
+  num_buffers = g_list_length (buffers);
+  fail_unless_equals_int (num_buffers, 7);
+
+  cleanup_qtmux (qtmux, "video_%u");
+
+  for (i = 0; i < num_buffers; ++i) {
+    outbuffer = GST_BUFFER (buffers->data);
+    buffers = g_list_remove (buffers, outbuffer);
+
+    switch (i) {
+      case 1:                  /* reserved space */
+        reserved = gst_buffer_get_size (outbuffer);
+        fail_unless (reserved > 8);
+        fail_unless (gst_buffer_memcmp (outbuffer, 4, data_free,
+                sizeof (data_free)) == 0);
+        break;
+      case 2:                  /* mdat header */
+        fail_unless (gst_buffer_get_size (outbuffer) == 16);
+        fail_unless (gst_buffer_memcmp (outbuffer, 0, data_mdat,
+                sizeof (data_mdat)) == 0);
+        break;
+      case 5:                  /* moov, written into the reserved space */
+        moov_size = gst_buffer_get_size (outbuffer);
+        fail_unless (gst_buffer_memcmp (outbuffer, 4, data_moov,
+                sizeof (data_moov)) == 0);
+        break;
+      case 6:                  /* free atom covering the rest */
+      {
+        GstMapInfo map;
+
+        fail_unless (gst_buffer_get_size (outbuffer) == 8);
+        gst_buffer_map (outbuffer, &map, GST_MAP_READ);
+        fail_unless_equals_int (GST_READ_UINT32_BE (map.data),
+            reserved - moov_size);
+        fail_unless (memcmp (map.data + 4, data_free, 4) == 0);
+        gst_buffer_unmap (outbuffer, &map);
+        break;
+      }
+      default:
+        break;
+    }
+
+    gst_buffer_unref (outbuffer);
+  }
+
+  g_list_free (buffers);
+  buffers = NULL;
+}
+
+GST_END_TEST;
+
+typedef struct
+{
+  guint32 fourcc;
+  guint64 offset;
+  guint64 size;
+} TopLevelAtom;
+
+/* lists the top level atoms of the file at @location, up to and including
+ * the first @last atom, or all of them when @last is 0 */
+static GArray *
+read_top_level_atoms (const gchar * location, guint32 last)
+{
+  GArray *atoms;
+  gchar *data;
+  gsize len;
+  guint64 offset = 0;
+
+  fail_unless (g_file_get_contents (location, &data, &len, NULL));
+
+  atoms = g_array_new (FALSE, FALSE, sizeof (TopLevelAtom));
+  while (offset + 8 <= len) {
+    TopLevelAtom atom;
+
+    atom.offset = offset;
+    atom.size = GST_READ_UINT32_BE (data + offset);
+    atom.fourcc = GST_READ_UINT32_LE (data + offset + 4);
+    if (atom.size == 1) {
+      fail_unless (offset + 16 <= len);
+      atom.size = GST_READ_UINT64_BE (data + offset + 8);
+    } else if (atom.size == 0) {
+      atom.size = len - offset;
+    }
+    fail_unless (atom.size >= 8);
+    g_array_append_val (atoms, atom);
+
+    offset += atom.size;
+    if (atom.fourcc == last)
+      break;
+  }
+  if (last == 0)
+    fail_unless_equals_uint64 (offset, len);
+
+  g_free (data);
+
+  return atoms;
+}
+
+#define TOP_LEVEL_ATOM(atoms,i) (&g_array_index ((atoms), TopLevelAtom, (i)))
+
+static GstPadProbeReturn
+max_buffer_size_probe (GstPad * pad, GstPadProbeInfo * info, gsize * max_size)
+{
+  *max_size = MAX (*max_size, gst_buffer_get_size (GST_PAD_PROBE_INFO_BUFFER
+          (info)));
+
+  return GST_PAD_PROBE_OK;
+}
+
+/* starts recording into a file at @location with robust recording set up
+ * for @max_duration and @bytes_per_sec */
+static GstElement *
+start_reserved_moov_recording (const gchar * location,
+    GstClockTime max_duration, guint bytes_per_sec, GstElement ** filesink,
+    GstPad ** srcpad, gsize * max_size)
+{
+  GstElement *qtmux;
+  GstSegment segment;
+  GstCaps *caps;
+  GstPad *pad;
+
+  qtmux = gst_check_setup_element ("qtmux");
+  g_object_set (qtmux, "reserved-max-duration", max_duration,
+      "reserved-bytes-per-sec", bytes_per_sec,
+      "reserved-moov-update-period", GST_SECOND, NULL);
+  *filesink = gst_element_factory_make ("filesink", NULL);
+  /* unbuffered, so that the file can be inspected while recording */
+  g_object_set (*filesink, "location", location, "buffer-mode", 2, NULL);
+  fail_unless (gst_element_link (qtmux, *filesink));
+
+  pad = gst_element_get_static_pad (qtmux, "src");
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER,
+      (GstPadProbeCallback) max_buffer_size_probe, max_size, NULL);
+  gst_object_unref (pad);
+
+  *srcpad = setup_src_pad (qtmux, &srcvideotemplate, "video_%u");
+  gst_pad_set_active (*srcpad, TRUE);
+
+  fail_unless (gst_element_set_state (*filesink,
+          GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE,
+      "could not set filesink to playing");
+  fail_unless (gst_element_set_state (qtmux,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  gst_pad_push_event (*srcpad, gst_event_new_stream_start ("test"));
+  caps = gst_pad_get_pad_template_caps (*srcpad);
+  gst_pad_set_caps (*srcpad, caps);
+  gst_caps_unref (caps);
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  fail_unless (gst_pad_push_event (*srcpad, gst_event_new_segment (&segment)));
+
+  return qtmux;
+}
+
+static void
+stop_reserved_moov_recording (GstElement * qtmux, GstElement * filesink,
+    GstPad * srcpad)
+{
+  gst_element_set_state (qtmux, GST_STATE_NULL);
+  gst_element_set_state (filesink, GST_STATE_NULL);
+  gst_pad_set_active (srcpad, FALSE);
+  teardown_src_pad (srcpad);
+  gst_object_unref (filesink);
+  gst_check_teardown_element (qtmux);
+}
+
+static void
+push_video_buffers (GstPad * srcpad, gint first, gint count)
+{
+  GstBuffer *inbuffer;
+  gint i;
+
+  for (i = first; i < first + count; i++) {
+    /* varying sizes, so that every sample gets a stsz entry */
+    inbuffer = gst_buffer_new_and_alloc (1 + i % 13);
+    gst_buffer_memset (inbuffer, 0, 0, 1 + i % 13);
+    GST_BUFFER_TIMESTAMP (inbuffer) = i * 40 * GST_MSECOND;
+    GST_BUFFER_DURATION (inbuffer) = 40 * GST_MSECOND;
+    fail_unless (gst_pad_push (srcpad, inbuffer) == GST_FLOW_OK);
+  }
+}
+
+GST_START_TEST (test_video_pad_reserved_moov_update)
+{
+  GstElement *qtmux, *filesink;
+  GstPad *srcpad;
+  GArray *atoms;
+  gchar *location;
+  guint64 reserved;
+  gsize max_size = 0;
+
+  location = g_strdup_printf ("%s/%s-%d", g_get_tmp_dir (), "qtmuxreserved",
+      g_random_int ());
+  /* large enough for the free atom to go out in several pieces */
+  qtmux = start_reserved_moov_recording (location, 1000 * GST_SECOND, 550,
+      &filesink, &srcpad, &max_size);
+
+  /* 2.4 seconds, the moov is rewritten every second */
+  push_video_buffers (srcpad, 0, 60);
+
+  /* while recording, the file already starts with a usable moov:
+   * ftyp, moov, free padding the reserved space, mdat */
+  atoms = read_top_level_atoms (location, GST_MAKE_FOURCC ('m', 'd', 'a',
+          't'));
+  fail_unless_equals_int (atoms->len, 4);
+  fail_unless (TOP_LEVEL_ATOM (atoms, 0)->fourcc == GST_MAKE_FOURCC ('f',
+          't', 'y', 'p'));
+  fail_unless (TOP_LEVEL_ATOM (atoms, 1)->fourcc == GST_MAKE_FOURCC ('m',
+          'o', 'o', 'v'));
+  fail_unless (TOP_LEVEL_ATOM (atoms, 2)->fourcc == GST_MAKE_FOURCC ('f',
+          'r', 'e', 'e'));
+  fail_unless (TOP_LEVEL_ATOM (atoms, 3)->fourcc == GST_MAKE_FOURCC ('m',
+          'd', 'a', 't'));
+  reserved = TOP_LEVEL_ATOM (atoms, 1)->size + TOP_LEVEL_ATOM (atoms, 2)->size;
+  g_array_free (atoms, TRUE);
+
+  fail_unless (gst_pad_push_event (srcpad, gst_event_new_eos ()) == TRUE);
+
+  /* the final moov went to the same place */
+  atoms = read_top_level_atoms (location, 0);
+  fail_unless_equals_int (atoms->len, 4);
+  fail_unless (TOP_LEVEL_ATOM (atoms, 1)->fourcc == GST_MAKE_FOURCC ('m',
+          'o', 'o', 'v'));
+  fail_unless (TOP_LEVEL_ATOM (atoms, 2)->fourcc == GST_MAKE_FOURCC ('f',
+          'r', 'e', 'e'));
+  fail_unless (TOP_LEVEL_ATOM (atoms, 3)->fourcc == GST_MAKE_FOURCC ('m',
+          'd', 'a', 't'));
+  fail_unless_equals_uint64 (TOP_LEVEL_ATOM (atoms, 1)->size +
+      TOP_LEVEL_ATOM (atoms, 2)->size, reserved);
+  g_array_free (atoms, TRUE);
+
+  /* the reserved space was not written out in one piece */
+  fail_unless (max_size < reserved);
+
+  stop_reserved_moov_recording (qtmux, filesink, srcpad);
+  g_unlink (location);
+  g_free (location);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_video_pad_reserved_moov_overflow)
+{
+  GstElement *qtmux, *filesink;
+  GstPad *srcpad;
+  GArray *atoms;
+  gchar *location;
+  gsize max_size = 0;
+
+  location = g_strdup_printf ("%s/%s-%d", g_get_tmp_dir (), "qtmuxreserved",
+      g_random_int ());
+  /* only the slack is reserved on top of the empty moov */
+  qtmux = start_reserved_moov_recording (location, GST_SECOND, 0,
+      &filesink, &srcpad, &max_size);
+
+  /* a sample table well beyond the slack */
+  push_video_buffers (srcpad, 0, 2000);
+  fail_unless (gst_pad_push_event (srcpad, gst_event_new_eos ()) == TRUE);
+
+  /* the moov did not fit and went to the end of the file, the reserved
+   * space is a single free atom again: ftyp, free, mdat, moov */
+  atoms = read_top_level_atoms (location, 0);
+  fail_unless_equals_int (atoms->len, 4);
+  fail_unless (TOP_LEVEL_ATOM (atoms, 1)->fourcc == GST_MAKE_FOURCC ('f',
+          'r', 'e', 'e'));
+  fail_unless (TOP_LEVEL_ATOM (atoms, 2)->fourcc == GST_MAKE_FOURCC ('m',
+          'd', 'a', 't'));
+  fail_unless (TOP_LEVEL_ATOM (atoms, 3)->fourcc == GST_MAKE_FOURCC ('m',
+          'o', 'o', 'v'));
+  fail_unless (TOP_LEVEL_ATOM (atoms, 3)->size >
+      TOP_LEVEL_ATOM (atoms, 1)->size);
+  g_array_free (atoms, TRUE);
+
+  stop_reserved_moov_recording (qtmux, filesink, srcpad);
+  g_unlink (location);
+  g_free (location);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_video_pad_frag_chunked)
+{
+  GstElement *qtmux;
+  GstBuffer *inbuffer, *file;
+  GstCaps *caps;
+  GstSegment segment;
+  GstMapInfo map;
+  GList *l;
+  guint32 prev = 0;
+  guint64 offset;
+  guint n_styp = 0, n_prft = 0, n_moof = 0, n_mdat = 0;
+  gint i;
+
+  qtmux = setup_qtmux (&srcvideotemplate, "video_%u", FALSE);
+  g_object_set (qtmux, "fragment-duration", 1000, "chunk-duration", 100,
+      "streamable", TRUE, NULL);
+  fail_unless (gst_element_set_state (qtmux,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  gst_pad_push_event (mysrcpad, gst_event_new_stream_start ("test"));
+
+  caps = gst_pad_get_pad_template_caps (mysrcpad);
+  gst_pad_set_caps (mysrcpad, caps);
+  gst_caps_unref (caps);
+
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_segment (&segment)));
+
+  /* a single GOP, so a single fragment made of several chunks */
+  for (i = 0; i < 10; i++) {
+    inbuffer = gst_buffer_new_and_alloc (1);
+    gst_buffer_memset (inbuffer, 0, 0, 1);
+    GST_BUFFER_TIMESTAMP (inbuffer) = i * 40 * GST_MSECOND;
+    GST_BUFFER_DURATION (inbuffer) = 40 * GST_MSECOND;
+    if (i > 0)
+      GST_BUFFER_FLAG_SET (inbuffer, GST_BUFFER_FLAG_DELTA_UNIT);
+    fail_unless (gst_pad_push (mysrcpad, inbuffer) == GST_FLOW_OK);
+  }
+
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_eos ()) == TRUE);
+
+  file = gst_buffer_new ();
+  for (l = buffers; l; l = l->next)
+    file = gst_buffer_append (file, gst_buffer_ref (l->data));
+
+  /* every moof comes with its prft, only the first one with a styp */
+  gst_buffer_map (file, &map, GST_MAP_READ);
+  offset = 0;
+  while (offset + 8 <= map.size) {
+    guint32 size = GST_READ_UINT32_BE (map.data + offset);
+    guint32 fourcc = GST_READ_UINT32_LE (map.data + offset + 4);
+
+    fail_unless (size >= 8);
+    if (fourcc == GST_MAKE_FOURCC ('s', 't', 'y', 'p')) {
+      n_styp++;
+      fail_unless_equals_int (n_moof, 0);
+    } else if (fourcc == GST_MAKE_FOURCC ('p', 'r', 'f', 't')) {
+      n_prft++;
+    } else if (fourcc == GST_MAKE_FOURCC ('m', 'o', 'o', 'f')) {
+      fail_unless (prev == GST_MAKE_FOURCC ('p', 'r', 'f', 't'));
+      n_moof++;
+    } else if (fourcc == GST_MAKE_FOURCC ('m', 'd', 'a', 't')) {
+      fail_unless (prev == GST_MAKE_FOURCC ('m', 'o', 'o', 'f'));
+      n_mdat++;
+    }
+    prev = fourcc;
+    offset += size;
+  }
+  fail_unless_equals_uint64 (offset, map.size);
+  gst_buffer_unmap (file, &map);
+  gst_buffer_unref (file);
+
+  fail_unless_equals_int (n_styp, 1);
+  fail_unless (n_moof > 1);
+  fail_unless_equals_int (n_prft, n_moof);
+  fail_unless_equals_int (n_mdat, n_moof);
+
+  cleanup_qtmux (qtmux, "video_%u");
+  gst_check_drop_buffers ();
+}
+
+GST_END_TEST;
+
+/* size of a sample record in the moov recovery file */
+#define MOOV_RECOV_RECORD_SIZE 34
+
+static goffset
+get_file_size (const gchar * location)
+{
+  GStatBuf st;
+
+  fail_unless (g_stat (location, &st) == 0);
+  return st.st_size;
+}
+
+/* muxes @num_buffers buffers with a moov recovery file flushed every
+ * @flush_interval, and returns how many bytes of sample records were on disk
+ * before EOS */
+static goffset
+run_moov_recovery (GstClockTime flush_interval, gint num_buffers)
+{
+  GstElement *qtmux;
+  GstBuffer *inbuffer;
+  GstCaps *caps;
+  GstSegment segment;
+  gchar *location;
+  goffset header_size, size;
+  gint i;
+
+  location = g_strdup_printf ("%s/%s-%d", g_get_tmp_dir (), "qtmuxrecov",
+      g_random_int ());
+
+  qtmux = setup_qtmux (&srcvideotemplate, "video_%u", TRUE);
+  g_object_set (qtmux, "moov-recovery-file", location,
+      "moov-recovery-flush-interval", flush_interval, NULL);
+  fail_unless (gst_element_set_state (qtmux,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  gst_pad_push_event (mysrcpad, gst_event_new_stream_start ("test"));
+
+  caps = gst_pad_get_pad_template_caps (mysrcpad);
+  gst_pad_set_caps (mysrcpad, caps);
+  gst_caps_unref (caps);
+
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_segment (&segment)));
+
+  header_size = 0;
+  for (i = 0; i < num_buffers; i++) {
+    inbuffer = gst_buffer_new_and_alloc (1);
+    gst_buffer_memset (inbuffer, 0, 0, 1);
+    GST_BUFFER_TIMESTAMP (inbuffer) = i * 40 * GST_MSECOND;
+    GST_BUFFER_DURATION (inbuffer) = 40 * GST_MSECOND;
+    fail_unless (gst_pad_push (mysrcpad, inbuffer) == GST_FLOW_OK);
+
+    /* the headers are written out as soon as the file is started */
+    if (i == 0) {
+      header_size = get_file_size (location);
+      fail_unless (header_size > 0);
+    }
+  }
+  size = get_file_size (location) - header_size;
+  fail_unless (size % MOOV_RECOV_RECORD_SIZE == 0);
+
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_eos ()) == TRUE);
+
+  cleanup_qtmux (qtmux, "video_%u");
+  gst_check_drop_buffers ();
+  g_unlink (location);
+  g_free (location);
+
+  return size;
+}
+
+GST_START_TEST (test_video_pad_moov_recovery)
+{
+  /* flushing after every sample, all but the sample still held by the
+   * muxer are on disk */
+  fail_unless (run_moov_recovery (0, 10) >= 8 * MOOV_RECOV_RECORD_SIZE);
+
+  /* only flushing when the buffer is full, nothing reached the disk yet */
+  fail_unless_equals_int (run_moov_recovery (GST_CLOCK_TIME_NONE, 10), 0);
+}
+
+GST_END_TEST;
+
+static void
+start_video_pad (GstElement * qtmux)
+{
+  GstCaps *caps;
+  GstSegment segment;
+
+  fail_unless (gst_element_set_state (qtmux,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  gst_pad_push_event (mysrcpad, gst_event_new_stream_start ("test"));
+
+  caps = gst_pad_get_pad_template_caps (mysrcpad);
+  gst_pad_set_caps (mysrcpad, caps);
+  gst_caps_unref (caps);
+
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_segment (&segment)));
+}
+
+/* muxes a faststart file, with the temporary data read back in blocks of
+ * @buffer_size or the default size if 0, and returns what qtmux pushed */
+static GstBuffer *
+mux_faststart (guint buffer_size, const gchar * temp_location, GstBus * bus)
+{
+  GstElement *qtmux;
+  GstBuffer *file;
+  GList *l;
+
+  qtmux = setup_qtmux (&srcvideotemplate, "video_%u", TRUE);
+  g_object_set (qtmux, "faststart", TRUE, NULL);
+  if (buffer_size)
+    g_object_set (qtmux, "faststart-buffer-size", buffer_size, NULL);
+  if (temp_location)
+    g_object_set (qtmux, "faststart-file", temp_location, NULL);
+  if (bus)
+    gst_element_set_bus (qtmux, bus);
+  start_video_pad (qtmux);
+
+  /* about 21 kB of media data */
+  push_video_buffers (mysrcpad, 0, 3000);
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_eos ()) == TRUE);
+
+  file = gst_buffer_new ();
+  for (l = buffers; l; l = l->next)
+    file = gst_buffer_append (file, gst_buffer_ref (l->data));
+
+  if (bus)
+    gst_element_set_bus (qtmux, NULL);
+  cleanup_qtmux (qtmux, "video_%u");
+  gst_check_drop_buffers ();
+
+  return file;
+}
+
+/* returns the offset of the first top level @fourcc atom in @map and its
+ * size in @size */
+static gsize
+find_top_level_atom (GstMapInfo * map, guint32 fourcc, gsize * size)
+{
+  gsize offset = 0;
+
+  while (offset + 8 <= map->size) {
+    *size = GST_READ_UINT32_BE (map->data + offset);
+    fail_unless (*size >= 8);
+    if (GST_READ_UINT32_LE (map->data + offset + 4) == fourcc)
+      return offset;
+    offset += *size;
+  }
+  fail ("no %" GST_FOURCC_FORMAT " atom", GST_FOURCC_ARGS (fourcc));
+
+  return 0;
+}
+
+GST_START_TEST (test_video_pad_faststart_buffer_size)
+{
+  GstBuffer *ref_file, *file;
+  GstMapInfo ref_map, map;
+  gsize ref_moov, ref_moov_size, ref_mdat, ref_mdat_size;
+  gsize moov, moov_size, mdat, mdat_size;
+
+  ref_file = mux_faststart (0, NULL, NULL);
+  /* the smallest block size, so that the temporary data is read back in
+   * several blocks with a short one at the end */
+  file = mux_faststart (4096, NULL, NULL);
+
+  gst_buffer_map (ref_file, &ref_map, GST_MAP_READ);
+  gst_buffer_map (file, &map, GST_MAP_READ);
+
+  /* the headers come first in both */
+  ref_moov = find_top_level_atom (&ref_map, GST_MAKE_FOURCC ('m', 'o', 'o',
+          'v'), &ref_moov_size);
+  ref_mdat = find_top_level_atom (&ref_map, GST_MAKE_FOURCC ('m', 'd', 'a',
+          't'), &ref_mdat_size);
+  moov = find_top_level_atom (&map, GST_MAKE_FOURCC ('m', 'o', 'o', 'v'),
+      &moov_size);
+  mdat = find_top_level_atom (&map, GST_MAKE_FOURCC ('m', 'd', 'a', 't'),
+      &mdat_size);
+  fail_unless (ref_moov < ref_mdat);
+  fail_unless (moov < mdat);
+  fail_unless (ref_mdat_size > 4 * 4096);
+
+  /* the moov only differs in the creation times, the media data read back
+   * from the temporary file is the same byte for byte */
+  fail_unless_equals_uint64 (moov, ref_moov);
+  fail_unless_equals_uint64 (moov_size, ref_moov_size);
+  fail_unless_equals_uint64 (mdat, ref_mdat);
+  fail_unless_equals_uint64 (map.size, ref_map.size);
+  fail_unless_equals_uint64 (mdat + mdat_size, map.size);
+  fail_unless (memcmp (map.data + mdat, ref_map.data + ref_mdat,
+          mdat_size) == 0);
+
+  gst_buffer_unmap (file, &map);
+  gst_buffer_unmap (ref_file, &ref_map);
+  gst_buffer_unref (file);
+  gst_buffer_unref (ref_file);
+}
+
+GST_END_TEST;
+
+/* checks that every @fourcc atom qtmux pushed came in a buffer of exactly
+ * the size in its header, which is the size computed before serializing it,
+ * and that it has a @child atom somewhere inside. Returns how many there
+ * were. */
+static guint
+check_serialized_atoms (guint32 fourcc, guint32 child)
+{
+  GstMapInfo map;
+  GList *l;
+  guint n = 0;
+
+  for (l = buffers; l; l = l->next) {
+    GstBuffer *buf = l->data;
+    guint8 header[8];
+    gboolean found = FALSE;
+    gsize i;
+
+    /* only map what is an atom of interest, media data may be huge */
+    if (gst_buffer_extract (buf, 0, header, 8) < 8 ||
+        GST_READ_UINT32_LE (header + 4) != fourcc)
+      continue;
+
+    gst_buffer_map (buf, &map, GST_MAP_READ);
+    fail_unless_equals_uint64 (GST_READ_UINT32_BE (map.data), map.size);
+    for (i = 8; i + 4 <= map.size && !found; i++)
+      found = (GST_READ_UINT32_LE (map.data + i) == child);
+    fail_unless (found, "no %" GST_FOURCC_FORMAT " in %" GST_FOURCC_FORMAT,
+        GST_FOURCC_ARGS (child), GST_FOURCC_ARGS (fourcc));
+    gst_buffer_unmap (buf, &map);
+    n++;
+  }
+
+  return n;
+}
+
+GST_START_TEST (test_video_pad_serialized_moov_size)
+{
+  GstElement *qtmux;
+
+  qtmux = setup_qtmux (&srcvideotemplate, "video_%u", TRUE);
+  start_video_pad (qtmux);
+  push_video_buffers (mysrcpad, 0, 1000);
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_eos ()) == TRUE);
+
+  fail_unless_equals_int (check_serialized_atoms (GST_MAKE_FOURCC ('m', 'o',
+              'o', 'v'), GST_MAKE_FOURCC ('s', 't', 'c', 'o')), 1);
+
+  cleanup_qtmux (qtmux, "video_%u");
+  gst_check_drop_buffers ();
+}
+
+GST_END_TEST;
+
+/* only the first bytes are ever read, qtmux passes the sample data on as
+ * it is */
+static guint8 unmapped_sample_data[8];
+
+GST_START_TEST (test_video_pad_serialized_moov_size_co64)
+{
+  GstElement *qtmux;
+  GstBuffer *inbuffer;
+  const gsize sample_size = G_GUINT64_CONSTANT (3) * 1024 * 1024 * 1024;
+  gint i;
+
+  qtmux = setup_qtmux (&srcvideotemplate, "video_%u", TRUE);
+  start_video_pad (qtmux);
+
+  /* two samples of 3 GB push the chunk offsets of the following ones past
+   * 32 bits, so that the moov has a co64 table */
+  for (i = 0; i < 2; i++) {
+    inbuffer = gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY,
+        unmapped_sample_data, sample_size, 0, sample_size, NULL, NULL);
+    GST_BUFFER_TIMESTAMP (inbuffer) = i * 40 * GST_MSECOND;
+    GST_BUFFER_DURATION (inbuffer) = 40 * GST_MSECOND;
+    fail_unless (gst_pad_push (mysrcpad, inbuffer) == GST_FLOW_OK);
+  }
+  push_video_buffers (mysrcpad, 2, 100);
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_eos ()) == TRUE);
+
+  fail_unless_equals_int (check_serialized_atoms (GST_MAKE_FOURCC ('m', 'o',
+              'o', 'v'), GST_MAKE_FOURCC ('c', 'o', '6', '4')), 1);
+
+  cleanup_qtmux (qtmux, "video_%u");
+  gst_check_drop_buffers ();
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_video_pad_serialized_moof_mfra_size)
+{
+  GstElement *qtmux;
+
+  qtmux = setup_qtmux (&srcvideotemplate, "video_%u", TRUE);
+  g_object_set (qtmux, "fragment-duration", 200, NULL);
+  start_video_pad (qtmux);
+  push_video_buffers (mysrcpad, 0, 100);
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_eos ()) == TRUE);
+
+  /* the moov is written again at the end with the fragment duration */
+  fail_unless_equals_int (check_serialized_atoms (GST_MAKE_FOURCC ('m', 'o',
+              'o', 'v'), GST_MAKE_FOURCC ('m', 'v', 'e', 'x')), 2);
+  fail_unless (check_serialized_atoms (GST_MAKE_FOURCC ('m', 'o', 'o', 'f'),
+          GST_MAKE_FOURCC ('t', 'r', 'u', 'n')) > 1);
+  fail_unless_equals_int (check_serialized_atoms (GST_MAKE_FOURCC ('m', 'f',
+              'r', 'a'), GST_MAKE_FOURCC ('t', 'f', 'r', 'a')), 1);
+
+  cleanup_qtmux (qtmux, "video_%u");
+  gst_check_drop_buffers ();
+}
+
+GST_END_TEST;
+
+#ifdef G_OS_UNIX
+GST_START_TEST (test_video_pad_faststart_read_failed)
+{
+  GstBuffer *file;
+  GstMessage *msg;
+  GError *err = NULL;
+  GstBus *bus;
+  gchar *location;
+
+  /* everything written to the temporary file is lost, so less than the size
+   * in the mdat header comes back. The link makes sure qtmux only ever
+   * removes the link when it cleans up. */
+  location = g_strdup_printf ("%s/%s-%d", g_get_tmp_dir (), "qtmuxfaststart",
+      g_random_int ());
+  fail_unless (symlink ("/dev/null", location) == 0);
+
+  bus = gst_bus_new ();
+  file = mux_faststart (4096, location, bus);
+
+  msg = gst_bus_pop_filtered (bus, GST_MESSAGE_ERROR);
+  fail_unless (msg != NULL);
+  gst_message_parse_error (msg, &err, NULL);
+  fail_unless (g_error_matches (err, GST_RESOURCE_ERROR,
+          GST_RESOURCE_ERROR_READ), "%s", err->message);
+  g_error_free (err);
+  gst_message_unref (msg);
+
+  gst_bus_set_flushing (bus, TRUE);
+  gst_object_unref (bus);
+  gst_buffer_unref (file);
+  g_unlink (location);
+  g_free (location);
+}
+
+GST_END_TEST;
+#endif
+
 GST_START_TEST (test_reuse)
 {
   GstElement *qtmux = setup_qtmux (&srcvideotemplate, "video_%u", TRUE);
@@ -1413,6 +2169,19 @@ qtmux_suite (void)
 
   tcase_add_test (tc_chain, test_average_bitrate);
 
+  tcase_add_test (tc_chain, test_video_pad_frag_chunked);
+  tcase_add_test (tc_chain, test_video_pad_reserved_moov);
+  tcase_add_test (tc_chain, test_video_pad_reserved_moov_update);
+  tcase_add_test (tc_chain, test_video_pad_reserved_moov_overflow);
+  tcase_add_test (tc_chain, test_video_pad_moov_recovery);
+  tcase_add_test (tc_chain, test_video_pad_faststart_buffer_size);
+  tcase_add_test (tc_chain, test_video_pad_serialized_moov_size);
+  tcase_add_test (tc_chain, test_video_pad_serialized_moov_size_co64);
+  tcase_add_test (tc_chain, test_video_pad_serialized_moof_mfra_size);
+#ifdef G_OS_UNIX
+  tcase_add_test (tc_chain, test_video_pad_faststart_read_failed);
+#endif
+
   tcase_add_test (tc_chain, test_reuse);
   tcase_add_test (tc_chain, test_encodebin_qtmux);
   tcase_add_test (tc_chain, test_encodebin_mp4mux);
@@ -236,6 +236,64 @@ GST_START_TEST (test_push_forward_seq)
 
 GST_END_TEST;
 
+GST_START_TEST (test_push_forward_seq_list)
+{
+  GstElement *jitterbuffer;
+  const guint num_buffers = 5;
+  GstBufferList *list;
+  GList *node;
+
+  jitterbuffer = setup_jitterbuffer (num_buffers);
+  fail_unless (start_jitterbuffer (jitterbuffer)
+      == GST_STATE_CHANGE_SUCCESS, "could not set to playing");
+
+  /* push buffers 0,1,2,3,4 as one list */
+  list = gst_buffer_list_new ();
+  for (node = inbuffers; node; node = g_list_next (node))
+    gst_buffer_list_add (list, (GstBuffer *) node->data);
+  fail_unless (gst_pad_push_list (mysrcpad, list) == GST_FLOW_OK);
+
+  /* check the buffer list */
+  check_jitterbuffer_results (jitterbuffer, num_buffers);
+
+  /* cleanup */
+  cleanup_jitterbuffer (jitterbuffer);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_push_duplicate_list)
+{
+  GstElement *jitterbuffer;
+  const guint num_buffers = 4;
+  GstBufferList *list;
+  GstBuffer *buffer;
+  GList *node;
+
+  jitterbuffer = setup_jitterbuffer (num_buffers);
+  fail_unless (start_jitterbuffer (jitterbuffer)
+      == GST_STATE_CHANGE_SUCCESS, "could not set to playing");
+
+  /* push buffers 0,1,1,2,3,3 as one list, the second 1 and 3 are duplicates
+   * found while the list is inserted */
+  list = gst_buffer_list_new ();
+  for (node = inbuffers; node; node = g_list_next (node)) {
+    buffer = (GstBuffer *) node->data;
+    gst_buffer_list_add (list, buffer);
+    if (node == inbuffers->next || node->next == NULL)
+      gst_buffer_list_add (list, gst_buffer_ref (buffer));
+  }
+  fail_unless (gst_pad_push_list (mysrcpad, list) == GST_FLOW_OK);
+
+  /* check the buffer list, each buffer came out once */
+  check_jitterbuffer_results (jitterbuffer, num_buffers);
+
+  /* cleanup */
+  cleanup_jitterbuffer (jitterbuffer);
+}
+
+GST_END_TEST;
+
 GST_START_TEST (test_push_backward_seq)
 {
   GstElement *jitterbuffer;
@@ -1641,6 +1699,194 @@ GST_START_TEST (test_deadline_ts_offset)
 
 GST_END_TEST;
 
+GST_START_TEST (test_list_gap_makes_lost_event)
+{
+  TestData data;
+  GstClockID id, test_id;
+  GstBufferList *list;
+  GstBuffer *in_buf, *out_buf;
+  GstEvent *out_event;
+  gint jb_latency_ms = 10;
+  gint b;
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+
+  setup_testharness (&data);
+
+  g_object_set (data.jitter_buffer, "latency", jb_latency_ms, NULL);
+
+  gst_test_clock_set_time (GST_TEST_CLOCK (data.clock), 10 * GST_SECOND);
+
+  /* push the first buffer in */
+  in_buf = generate_test_buffer (0 * GST_MSECOND, TRUE, 0, 0);
+  g_assert_cmpint (gst_pad_push (data.test_src_pad, in_buf), ==, GST_FLOW_OK);
+
+  gst_test_clock_wait_for_next_pending_id (GST_TEST_CLOCK (data.clock), &id);
+  test_id = gst_test_clock_process_next_clock_id (GST_TEST_CLOCK (data.clock));
+  g_assert (test_id == id);
+  gst_clock_id_unref (id);
+  gst_clock_id_unref (test_id);
+  out_buf = g_async_queue_pop (data.buf_queue);
+  g_assert (out_buf != NULL);
+  gst_buffer_unref (out_buf);
+
+  /* push 1, 2 and 5 in one list, the gap of 2 is inside the list */
+  list = gst_buffer_list_new ();
+  for (b = 1; b < 6; b++) {
+    if (b == 3 || b == 4)
+      continue;
+    gst_buffer_list_add (list, generate_test_buffer (b * GST_MSECOND * 20,
+            TRUE, b, b * 160));
+  }
+  g_assert_cmpint (gst_pad_push_list (data.test_src_pad, list), ==,
+      GST_FLOW_OK);
+
+  /* we should now receive a packet-lost-event for buffer 3 and 4 */
+  out_event = g_async_queue_pop (data.sink_event_queue);
+  g_assert (out_event != NULL);
+  g_assert_cmpint (data.lost_event_count, ==, 1);
+  verify_lost_event (out_event, 3, 3 * GST_MSECOND * 20, GST_MSECOND * 20 * 2,
+      TRUE);
+
+  /* verify that 1, 2 and 5 made it through, in order */
+  for (b = 1; b < 6; b++) {
+    if (b == 3 || b == 4)
+      continue;
+    out_buf = g_async_queue_pop (data.buf_queue);
+    g_assert (out_buf != NULL);
+    g_assert (GST_BUFFER_FLAG_IS_SET (out_buf, GST_BUFFER_FLAG_DISCONT) ==
+        (b == 5));
+    gst_rtp_buffer_map (out_buf, GST_MAP_READ, &rtp);
+    g_assert_cmpint (gst_rtp_buffer_get_seq (&rtp), ==, b);
+    gst_rtp_buffer_unmap (&rtp);
+    gst_buffer_unref (out_buf);
+  }
+
+  /* should still have only seen 1 packet lost event */
+  g_assert_cmpint (data.lost_event_count, ==, 1);
+
+  destroy_testharness (&data);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_list_rtx_expected_next)
+{
+  TestData data;
+  GstClockID id, tid;
+  GstBufferList *list;
+  GstEvent *out_event;
+  gint jb_latency_ms = 200;
+
+  setup_testharness (&data);
+  g_object_set (data.jitter_buffer, "do-retransmission", TRUE, NULL);
+  g_object_set (data.jitter_buffer, "latency", jb_latency_ms, NULL);
+  g_object_set (data.jitter_buffer, "rtx-retry-period", 120, NULL);
+
+  gst_test_clock_set_time (GST_TEST_CLOCK (data.clock), 20 * GST_MSECOND);
+
+  /* push the first two buffers in one list, the packet spacing of 20ms is
+   * estimated from them like from separately pushed buffers, so the
+   * retransmission of seqnum 2 is asked for in 20ms+10ms */
+  list = gst_buffer_list_new ();
+  gst_buffer_list_add (list, generate_test_buffer (0 * GST_MSECOND, TRUE, 0,
+          0));
+  gst_buffer_list_add (list, generate_test_buffer (20 * GST_MSECOND, TRUE, 1,
+          160));
+  g_assert_cmpint (gst_pad_push_list (data.test_src_pad, list), ==,
+      GST_FLOW_OK);
+
+  gst_test_clock_wait_for_next_pending_id (GST_TEST_CLOCK (data.clock), &id);
+  gst_test_clock_set_time (GST_TEST_CLOCK (data.clock), 50 * GST_MSECOND);
+  tid = gst_test_clock_process_next_clock_id (GST_TEST_CLOCK (data.clock));
+  g_assert (tid == id);
+  gst_clock_id_unref (tid);
+  gst_clock_id_unref (id);
+
+  out_event = g_async_queue_pop (data.src_event_queue);
+  g_assert (out_event != NULL);
+  verify_rtx_event (out_event, 2, 40 * GST_MSECOND, 10, 20 * GST_MSECOND);
+  g_assert_cmpint (data.rtx_event_count, ==, 1);
+
+  destroy_testharness (&data);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_list_big_gap_resets)
+{
+  TestData data;
+  GstClockID id, test_id;
+  GstBufferList *list;
+  GstBuffer *in_buf, *out_buf;
+  gint jb_latency_ms = 200;
+  gint b;
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+
+  setup_testharness (&data);
+
+  g_object_set (data.jitter_buffer, "latency", jb_latency_ms, NULL);
+
+  /* push the first buffer in and let it out */
+  in_buf = generate_test_buffer (0 * GST_MSECOND, TRUE, 0, 0);
+  gst_test_clock_set_time (GST_TEST_CLOCK (data.clock), 0);
+  g_assert_cmpint (gst_pad_push (data.test_src_pad, in_buf), ==, GST_FLOW_OK);
+
+  gst_test_clock_wait_for_next_pending_id (GST_TEST_CLOCK (data.clock), &id);
+  gst_test_clock_set_time (GST_TEST_CLOCK (data.clock),
+      jb_latency_ms * GST_MSECOND);
+  test_id = gst_test_clock_process_next_clock_id (GST_TEST_CLOCK (data.clock));
+  g_assert (test_id == id);
+  gst_clock_id_unref (test_id);
+  gst_clock_id_unref (id);
+
+  out_buf = g_async_queue_pop (data.buf_queue);
+  g_assert (out_buf != NULL);
+  gst_buffer_unref (out_buf);
+
+  /* five consecutive packets far beyond the max dropout in one list, the
+   * fifth resets the jitterbuffer and the collected ones are inserted again
+   * while the list is handled */
+  gst_test_clock_set_time (GST_TEST_CLOCK (data.clock), 10 * GST_SECOND);
+  list = gst_buffer_list_new ();
+  for (b = 5000; b < 5005; b++)
+    gst_buffer_list_add (list, generate_test_buffer (10 * GST_SECOND +
+            (b - 5000) * GST_MSECOND * 20, TRUE, b, b * 160));
+  g_assert_cmpint (gst_pad_push_list (data.test_src_pad, list), ==,
+      GST_FLOW_OK);
+
+  /* churn through sync_times until all of them got pushed out */
+  while (g_async_queue_length (data.buf_queue) < 5) {
+    if (gst_test_clock_peek_next_pending_id (GST_TEST_CLOCK (data.clock), &id)) {
+      GstClockTime t = gst_clock_id_get_time (id);
+      if (t > gst_clock_get_time (data.clock)) {
+        gst_test_clock_set_time (GST_TEST_CLOCK (data.clock), t);
+      }
+      test_id =
+          gst_test_clock_process_next_clock_id (GST_TEST_CLOCK (data.clock));
+      gst_clock_id_unref (test_id);
+      gst_clock_id_unref (id);
+    }
+  }
+
+  for (b = 5000; b < 5005; b++) {
+    out_buf = g_async_queue_pop (data.buf_queue);
+    g_assert (out_buf != NULL);
+    if (b == 5000)
+      g_assert (GST_BUFFER_FLAG_IS_SET (out_buf, GST_BUFFER_FLAG_DISCONT));
+    gst_rtp_buffer_map (out_buf, GST_MAP_READ, &rtp);
+    g_assert_cmpint (gst_rtp_buffer_get_seq (&rtp), ==, b);
+    gst_rtp_buffer_unmap (&rtp);
+    gst_buffer_unref (out_buf);
+  }
+
+  /* the reset started over, nothing in between was lost */
+  g_assert_cmpint (data.lost_event_count, ==, 0);
+
+  destroy_testharness (&data);
+}
+
+GST_END_TEST;
+
 
 static Suite *
 rtpjitterbuffer_suite (void)
@@ -1650,6 +1896,8 @@ rtpjitterbuffer_suite (void)
 
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, test_push_forward_seq);
+  tcase_add_test (tc_chain, test_push_forward_seq_list);
+  tcase_add_test (tc_chain, test_push_duplicate_list);
   tcase_add_test (tc_chain, test_push_backward_seq);
   tcase_add_test (tc_chain, test_push_unordered);
   tcase_add_test (tc_chain, test_basetime);
@@ -1663,6 +1911,9 @@ rtpjitterbuffer_suite (void)
   tcase_add_test (tc_chain, test_rtx_packet_delay);
   tcase_add_test (tc_chain, test_gap_exceeds_latency);
   tcase_add_test (tc_chain, test_deadline_ts_offset);
+  tcase_add_test (tc_chain, test_list_gap_makes_lost_event);
+  tcase_add_test (tc_chain, test_list_rtx_expected_next);
+  tcase_add_test (tc_chain, test_list_big_gap_resets);
 
   return s;
 }
@@ -252,6 +252,56 @@ GST_START_TEST (test_rtpdtmfmux_basic)
 
 GST_END_TEST;
 
+static void
+list_check_cb (GstPad * pad, int i)
+{
+  GstRTPBuffer rtpbuffer = GST_RTP_BUFFER_INIT;
+  GstBufferList *list;
+  GList *l;
+  int j;
+
+  fail_unless (buffers && g_list_length (buffers) == 1);
+  gst_rtp_buffer_map (buffers->data, GST_MAP_READ, &rtpbuffer);
+  fail_unless (gst_rtp_buffer_get_seq (&rtpbuffer) == 100 + 1 + 4 * i);
+  gst_rtp_buffer_unmap (&rtpbuffer);
+
+  list = gst_buffer_list_new ();
+  for (j = 0; j < 3; j++) {
+    GstBuffer *inbuf;
+
+    inbuf = gst_rtp_buffer_new_allocate (10, 0, 0);
+    GST_BUFFER_PTS (inbuf) = i * 1000 + 500;
+    GST_BUFFER_DURATION (inbuf) = 1000;
+    gst_rtp_buffer_map (inbuf, GST_MAP_WRITE, &rtpbuffer);
+    gst_rtp_buffer_set_version (&rtpbuffer, 2);
+    gst_rtp_buffer_set_payload_type (&rtpbuffer, 98);
+    gst_rtp_buffer_set_ssrc (&rtpbuffer, 44);
+    gst_rtp_buffer_set_timestamp (&rtpbuffer, 300 + j);
+    gst_rtp_buffer_set_seq (&rtpbuffer, 3000 + j);
+    gst_rtp_buffer_unmap (&rtpbuffer);
+    gst_buffer_list_add (list, inbuf);
+  }
+  fail_unless (gst_pad_push_list (pad, list) == GST_FLOW_OK);
+
+  /* the whole list is rewritten and forwarded after the first buffer */
+  fail_unless (g_list_length (buffers) == 4);
+  for (l = buffers->next, j = 0; l; l = l->next, j++) {
+    gst_rtp_buffer_map (l->data, GST_MAP_READ, &rtpbuffer);
+    fail_unless (gst_rtp_buffer_get_ssrc (&rtpbuffer) == 66);
+    /* no timestamp-offset in the caps of the second pad */
+    fail_unless (gst_rtp_buffer_get_timestamp (&rtpbuffer) == 300 + 1000 + j);
+    fail_unless (gst_rtp_buffer_get_seq (&rtpbuffer) == 100 + 2 + 4 * i + j);
+    gst_rtp_buffer_unmap (&rtpbuffer);
+  }
+}
+
+GST_START_TEST (test_rtpmux_buffer_list)
+{
+  test_basic ("rtpmux", "sink_2", 10, list_check_cb);
+}
+
+GST_END_TEST;
+
 static void
 lock_check_cb (GstPad * pad, int i)
 {
@@ -306,6 +356,10 @@ rtpmux_suite (void)
   tcase_add_test (tc_chain, test_rtpmux_basic);
   suite_add_tcase (s, tc_chain);
 
+  tc_chain = tcase_create ("rtpmux_buffer_list");
+  tcase_add_test (tc_chain, test_rtpmux_buffer_list);
+  suite_add_tcase (s, tc_chain);
+
   tc_chain = tcase_create ("rtpdtmfmux_basic");
   tcase_add_test (tc_chain, test_rtpdtmfmux_basic);
   suite_add_tcase (s, tc_chain);
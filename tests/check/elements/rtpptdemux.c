@@ -0,0 +1,353 @@
+/* GStreamer
+ *
+ * unit test for rtpptdemux
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+#include <gst/rtp/gstrtpbuffer.h>
+
+static GstPad *mysrcpad;
+static GList *sinkpads = NULL;
+
+/* what came out of the demuxer, in order */
+typedef struct
+{
+  guint pt;
+  GstBufferList *list;
+} PushedList;
+
+static GList *pushed = NULL;
+static GList *pt_changes = NULL;
+static guint clock_rate = 8000;
+static guint n_pt_map_requests = 0;
+
+static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("application/x-rtp")
+    );
+
+static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("application/x-rtp")
+    );
+
+/* pt 96 and 97 are mapped, any other one is unknown */
+static GstCaps *
+request_pt_map (GstElement * demux, guint pt, gpointer user_data)
+{
+  n_pt_map_requests++;
+
+  if (pt != 96 && pt != 97)
+    return NULL;
+
+  return gst_caps_new_simple ("application/x-rtp",
+      "media", G_TYPE_STRING, "audio",
+      "clock-rate", G_TYPE_INT, clock_rate, NULL);
+}
+
+static void
+payload_type_change (GstElement * demux, guint pt, gpointer user_data)
+{
+  pt_changes = g_list_append (pt_changes, GUINT_TO_POINTER (pt));
+}
+
+static GstFlowReturn
+sink_chain_list (GstPad * pad, GstObject * parent, GstBufferList * list)
+{
+  PushedList *p = g_new0 (PushedList, 1);
+
+  p->pt = GPOINTER_TO_UINT (g_object_get_data (G_OBJECT (pad), "pt"));
+  p->list = list;
+  pushed = g_list_append (pushed, p);
+
+  return GST_FLOW_OK;
+}
+
+static GstFlowReturn
+sink_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+{
+  GstBufferList *list = gst_buffer_list_new ();
+
+  gst_buffer_list_add (list, buffer);
+  return sink_chain_list (pad, parent, list);
+}
+
+static void
+new_payload_type (GstElement * demux, guint pt, GstPad * pad,
+    gpointer user_data)
+{
+  GstPad *sinkpad;
+
+  sinkpad = gst_pad_new_from_static_template (&sinktemplate, "sink");
+  g_object_set_data (G_OBJECT (sinkpad), "pt", GUINT_TO_POINTER (pt));
+  gst_pad_set_chain_function (sinkpad, sink_chain);
+  gst_pad_set_chain_list_function (sinkpad, sink_chain_list);
+  gst_pad_set_active (sinkpad, TRUE);
+  fail_unless_equals_int (gst_pad_link (pad, sinkpad), GST_PAD_LINK_OK);
+  sinkpads = g_list_append (sinkpads, sinkpad);
+}
+
+static GstElement *
+setup_rtpptdemux (void)
+{
+  GstElement *demux;
+  GstSegment segment;
+
+  demux = gst_check_setup_element ("rtpptdemux");
+  g_signal_connect (demux, "request-pt-map", G_CALLBACK (request_pt_map),
+      NULL);
+  g_signal_connect (demux, "new-payload-type", G_CALLBACK (new_payload_type),
+      NULL);
+  g_signal_connect (demux, "payload-type-change",
+      G_CALLBACK (payload_type_change), NULL);
+  mysrcpad = gst_check_setup_src_pad (demux, &srctemplate);
+  gst_pad_set_active (mysrcpad, TRUE);
+  fail_unless_equals_int (gst_element_set_state (demux, GST_STATE_PLAYING),
+      GST_STATE_CHANGE_SUCCESS);
+
+  /* no caps upstream, so only the pt map decides them */
+  fail_unless (gst_pad_push_event (mysrcpad,
+          gst_event_new_stream_start ("test")));
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_segment (&segment)));
+
+  clock_rate = 8000;
+  n_pt_map_requests = 0;
+
+  return demux;
+}
+
+static void
+cleanup_rtpptdemux (GstElement * demux)
+{
+  GList *l;
+
+  for (l = pushed; l; l = l->next) {
+    PushedList *p = l->data;
+
+    gst_buffer_list_unref (p->list);
+    g_free (p);
+  }
+  g_list_free (pushed);
+  pushed = NULL;
+  g_list_free (pt_changes);
+  pt_changes = NULL;
+
+  gst_element_set_state (demux, GST_STATE_NULL);
+  for (l = sinkpads; l; l = l->next) {
+    gst_pad_set_active (GST_PAD (l->data), FALSE);
+    gst_object_unref (l->data);
+  }
+  g_list_free (sinkpads);
+  sinkpads = NULL;
+
+  gst_pad_set_active (mysrcpad, FALSE);
+  gst_check_teardown_src_pad (demux);
+  gst_check_teardown_element (demux);
+}
+
+static GstBuffer *
+create_rtp_buffer (guint8 pt, guint16 seqnum)
+{
+  GstBuffer *buf;
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+
+  buf = gst_rtp_buffer_new_allocate (10, 0, 0);
+  gst_rtp_buffer_map (buf, GST_MAP_WRITE, &rtp);
+  gst_rtp_buffer_set_payload_type (&rtp, pt);
+  gst_rtp_buffer_set_seq (&rtp, seqnum);
+  gst_rtp_buffer_unmap (&rtp);
+
+  return buf;
+}
+
+static guint16
+get_seqnum (GstBuffer * buf)
+{
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  guint16 seqnum;
+
+  fail_unless (gst_rtp_buffer_map (buf, GST_MAP_READ, &rtp));
+  seqnum = gst_rtp_buffer_get_seq (&rtp);
+  gst_rtp_buffer_unmap (&rtp);
+
+  return seqnum;
+}
+
+/* checks that the @n-th pushed list went to the pad of @pt, with the
+ * packets of @seqnums */
+static void
+check_pushed (guint n, guint pt, const guint16 * seqnums, guint n_seqnums)
+{
+  PushedList *p = g_list_nth_data (pushed, n);
+  guint i;
+
+  fail_unless (p != NULL);
+  fail_unless_equals_int (p->pt, pt);
+  fail_unless_equals_int (gst_buffer_list_length (p->list), n_seqnums);
+  for (i = 0; i < n_seqnums; i++)
+    fail_unless_equals_int (get_seqnum (gst_buffer_list_get (p->list, i)),
+        seqnums[i]);
+}
+
+GST_START_TEST (test_list_split_by_pt)
+{
+  static const guint16 seqnums_96[] = { 0, 2, 4 };
+  static const guint16 seqnums_97[] = { 1, 3 };
+  GstElement *demux;
+  GstBufferList *list;
+  guint i;
+
+  demux = setup_rtpptdemux ();
+
+  list = gst_buffer_list_new ();
+  for (i = 0; i < 5; i++)
+    gst_buffer_list_add (list, create_rtp_buffer (i % 2 ? 97 : 96, i));
+  fail_unless_equals_int (gst_pad_push_list (mysrcpad, list), GST_FLOW_OK);
+
+  /* one sub-list per payload type, in the order they were first seen */
+  fail_unless_equals_int (g_list_length (pushed), 2);
+  check_pushed (0, 96, seqnums_96, G_N_ELEMENTS (seqnums_96));
+  check_pushed (1, 97, seqnums_97, G_N_ELEMENTS (seqnums_97));
+
+  /* and one change for every sub-list, not for every packet */
+  fail_unless_equals_int (g_list_length (pt_changes), 2);
+  fail_unless_equals_int (GPOINTER_TO_UINT (g_list_nth_data (pt_changes, 0)),
+      96);
+  fail_unless_equals_int (GPOINTER_TO_UINT (g_list_nth_data (pt_changes, 1)),
+      97);
+
+  /* the table is only filled once per payload type */
+  fail_unless_equals_int (n_pt_map_requests, 2);
+
+  cleanup_rtpptdemux (demux);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_list_invalid_packet)
+{
+  static const guint16 seqnums[] = { 0, 2 };
+  GstElement *demux;
+  GstBufferList *list;
+
+  demux = setup_rtpptdemux ();
+
+  list = gst_buffer_list_new ();
+  gst_buffer_list_add (list, create_rtp_buffer (96, 0));
+  /* too short to be RTP */
+  gst_buffer_list_add (list, gst_buffer_new_allocate (NULL, 4, NULL));
+  gst_buffer_list_add (list, create_rtp_buffer (96, 2));
+  fail_unless_equals_int (gst_pad_push_list (mysrcpad, list), GST_FLOW_OK);
+
+  /* only the invalid packet is dropped */
+  fail_unless_equals_int (g_list_length (pushed), 1);
+  check_pushed (0, 96, seqnums, G_N_ELEMENTS (seqnums));
+
+  cleanup_rtpptdemux (demux);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_list_caps_change)
+{
+  static const guint16 seqnums[] = { 1, 2 };
+  GstElement *demux;
+  GstBufferList *list;
+  GstStructure *s;
+  GstCaps *caps;
+  GstPad *srcpad;
+  gint rate = 0;
+
+  demux = setup_rtpptdemux ();
+
+  fail_unless_equals_int (gst_pad_push (mysrcpad, create_rtp_buffer (96, 0)),
+      GST_FLOW_OK);
+  fail_unless_equals_int (n_pt_map_requests, 1);
+
+  /* the map changes, the pad keeps its caps until the next packet */
+  clock_rate = 16000;
+  g_signal_emit_by_name (demux, "clear-pt-map", NULL);
+
+  list = gst_buffer_list_new ();
+  gst_buffer_list_add (list, create_rtp_buffer (96, 1));
+  gst_buffer_list_add (list, create_rtp_buffer (96, 2));
+  fail_unless_equals_int (gst_pad_push_list (mysrcpad, list), GST_FLOW_OK);
+
+  /* looked up again once for the list, and the same pad is used */
+  fail_unless_equals_int (n_pt_map_requests, 2);
+  fail_unless_equals_int (g_list_length (sinkpads), 1);
+  fail_unless_equals_int (g_list_length (pushed), 2);
+  check_pushed (1, 96, seqnums, G_N_ELEMENTS (seqnums));
+
+  srcpad = gst_element_get_static_pad (demux, "src_96");
+  fail_unless (srcpad != NULL);
+  caps = gst_pad_get_current_caps (srcpad);
+  s = gst_caps_get_structure (caps, 0);
+  fail_unless (gst_structure_get_int (s, "clock-rate", &rate));
+  fail_unless_equals_int (rate, 16000);
+  gst_caps_unref (caps);
+  gst_object_unref (srcpad);
+
+  cleanup_rtpptdemux (demux);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_list_no_caps)
+{
+  GstElement *demux;
+  GstBufferList *list;
+
+  demux = setup_rtpptdemux ();
+
+  list = gst_buffer_list_new ();
+  gst_buffer_list_add (list, create_rtp_buffer (96, 0));
+  gst_buffer_list_add (list, create_rtp_buffer (99, 1));
+  gst_buffer_list_add (list, create_rtp_buffer (96, 2));
+
+  /* pt 99 is not in the map and there are no upstream caps to fall back to,
+   * nothing is pushed */
+  fail_unless_equals_int (gst_pad_push_list (mysrcpad, list), GST_FLOW_ERROR);
+  fail_unless (pushed == NULL);
+  fail_unless (pt_changes == NULL);
+  fail_unless_equals_int (g_list_length (sinkpads), 1);
+
+  cleanup_rtpptdemux (demux);
+}
+
+GST_END_TEST;
+
+static Suite *
+rtpptdemux_suite (void)
+{
+  Suite *s = suite_create ("rtpptdemux");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_list_split_by_pt);
+  tcase_add_test (tc_chain, test_list_invalid_packet);
+  tcase_add_test (tc_chain, test_list_caps_change);
+  tcase_add_test (tc_chain, test_list_no_caps);
+
+  return s;
+}
+
+GST_CHECK_MAIN (rtpptdemux);
@@ -44,7 +44,8 @@ generate_caps (void)
 {
   return gst_caps_new_simple ("application/x-rtp",
       "clock-rate", G_TYPE_INT, clock_rate,
-      "payload-type", G_TYPE_INT, payload_type, NULL);
+      "payload-type", G_TYPE_INT, payload_type,
+      "rtcp-fb-nack-pli", G_TYPE_BOOLEAN, TRUE, NULL);
 }
 
 static GstBuffer *
@@ -565,6 +566,217 @@ GST_START_TEST (test_internal_sources_timeout)
 
 GST_END_TEST;
 
+static void
+push_rtp_packets (TestData * data, guint32 ssrc, gint count)
+{
+  GstFlowReturn res;
+  GstBuffer *buf;
+  gint i;
+
+  for (i = 0; i < count; i++) {
+    buf = generate_test_buffer (i * 20 * GST_MSECOND, FALSE, i, i * 160, ssrc);
+    res = gst_pad_push (data->src, buf);
+    fail_unless (res == GST_FLOW_OK || res == GST_FLOW_FLUSHING);
+  }
+}
+
+static guint
+get_session_stat (GObject * internal_session, const gchar * field)
+{
+  GstStructure *stats;
+  guint val = 0;
+
+  g_object_get (internal_session, "stats", &stats, NULL);
+  fail_unless (gst_structure_get_uint (stats, field, &val));
+  gst_structure_free (stats);
+
+  return val;
+}
+
+/* pops the RTCP packets that were output and returns how many PLIs
+ * they carried for @media_ssrc */
+static gint
+count_rtcp_plis (TestData * data, guint32 media_ssrc)
+{
+  GstBuffer *buf;
+  GstRTCPBuffer rtcp = GST_RTCP_BUFFER_INIT;
+  GstRTCPPacket rtcp_packet;
+  gint count = 0;
+
+  while ((buf = g_async_queue_try_pop (data->rtcp_queue))) {
+    g_assert (gst_rtcp_buffer_validate (buf));
+    gst_rtcp_buffer_map (buf, GST_MAP_READ, &rtcp);
+    g_assert (gst_rtcp_buffer_get_first_packet (&rtcp, &rtcp_packet));
+    do {
+      if (gst_rtcp_packet_get_type (&rtcp_packet) == GST_RTCP_TYPE_PSFB &&
+          gst_rtcp_packet_fb_get_type (&rtcp_packet) ==
+          GST_RTCP_PSFB_TYPE_PLI &&
+          gst_rtcp_packet_fb_get_media_ssrc (&rtcp_packet) == media_ssrc)
+        count++;
+    } while (gst_rtcp_packet_move_to_next (&rtcp_packet));
+    gst_rtcp_buffer_unmap (&rtcp);
+    gst_buffer_unref (buf);
+  }
+
+  return count;
+}
+
+static void
+send_rtx_request (TestData * data, guint32 ssrc, guint seqnum)
+{
+  gst_pad_push_event (data->rtpsrc,
+      gst_event_new_custom (GST_EVENT_CUSTOM_UPSTREAM,
+          gst_structure_new ("GstRTPRetransmissionRequest",
+              "ssrc", G_TYPE_UINT, (guint) ssrc,
+              "seqnum", G_TYPE_UINT, seqnum,
+              "deadline", G_TYPE_UINT, 10000, NULL)));
+}
+
+static void
+send_force_key_unit (TestData * data, guint32 ssrc)
+{
+  gst_pad_push_event (data->rtpsrc,
+      gst_event_new_custom (GST_EVENT_CUSTOM_UPSTREAM,
+          gst_structure_new ("GstForceKeyUnit",
+              "ssrc", G_TYPE_UINT, (guint) ssrc,
+              "payload", G_TYPE_UINT, payload_type, NULL)));
+}
+
+/* This verifies that NACKs for the same source are merged into the
+ * bitmask of lost packets following an earlier PID when they fit, and
+ * that a seqnum preceding the PID becomes the new PID */
+GST_START_TEST (test_nack_blp_merge)
+{
+  TestData data;
+  GstClockID id;
+  GstClockTime time;
+  GObject *internal_session;
+  GstBuffer *buf;
+  GstRTCPBuffer rtcp = GST_RTCP_BUFFER_INIT;
+  GstRTCPPacket rtcp_packet;
+  guint8 *fci = NULL;
+  guint fci_len = 0;
+
+  setup_testharness (&data, FALSE);
+  g_object_get (data.session, "internal-session", &internal_session, NULL);
+
+  gst_test_clock_wait_for_next_pending_id (GST_TEST_CLOCK (data.clock), &id);
+  crank_rtcp_thread (&data, &time, &id);
+  while ((buf = g_async_queue_try_pop (data.rtcp_queue)))
+    gst_buffer_unref (buf);
+
+  push_rtp_packets (&data, 0x01BADBAD, 5);
+  g_assert (gst_pad_set_active (data.rtpsrc, TRUE));
+
+  /* 18 precedes 20 by two: PID 18 with bit 1 set for 20. 34 is 16 after
+   * 18 and takes the last bit of its BLP, 35 no longer fits */
+  send_rtx_request (&data, 0x01BADBAD, 20);
+  send_rtx_request (&data, 0x01BADBAD, 18);
+  send_rtx_request (&data, 0x01BADBAD, 34);
+  send_rtx_request (&data, 0x01BADBAD, 35);
+  g_assert_cmpint (get_session_stat (internal_session,
+          "coalesced-nack-count"), ==, 3);
+
+  /* the request may have rescheduled the RTCP thread */
+  gst_clock_id_unref (id);
+  gst_test_clock_wait_for_next_pending_id (GST_TEST_CLOCK (data.clock), &id);
+
+  crank_rtcp_thread (&data, &time, &id);
+  gst_clock_id_unref (id);
+
+  buf = g_async_queue_pop (data.rtcp_queue);
+  g_assert (gst_rtcp_buffer_validate (buf));
+  gst_rtcp_buffer_map (buf, GST_MAP_READ, &rtcp);
+  g_assert (gst_rtcp_buffer_get_first_packet (&rtcp, &rtcp_packet));
+  do {
+    if (gst_rtcp_packet_get_type (&rtcp_packet) == GST_RTCP_TYPE_RTPFB &&
+        gst_rtcp_packet_fb_get_type (&rtcp_packet) ==
+        GST_RTCP_RTPFB_TYPE_NACK) {
+      g_assert_cmpint (gst_rtcp_packet_fb_get_media_ssrc (&rtcp_packet), ==,
+          0x01BADBAD);
+      fci = gst_rtcp_packet_fb_get_fci (&rtcp_packet);
+      fci_len = gst_rtcp_packet_fb_get_fci_length (&rtcp_packet);
+      break;
+    }
+  } while (gst_rtcp_packet_move_to_next (&rtcp_packet));
+
+  g_assert (fci != NULL);
+  g_assert_cmpint (fci_len, ==, 2);
+  g_assert_cmphex (GST_READ_UINT32_BE (fci), ==, (18 << 16) | 0x8002);
+  g_assert_cmphex (GST_READ_UINT32_BE (fci + 4), ==, (35 << 16) | 0x0000);
+
+  gst_rtcp_buffer_unmap (&rtcp);
+  gst_buffer_unref (buf);
+
+  g_object_unref (internal_session);
+  destroy_testharness (&data);
+}
+
+GST_END_TEST;
+
+/* This verifies that PLIs requested within rtcp-pli-min-interval of the
+ * last PLI are held back, coalesced and sent once the interval expired */
+GST_START_TEST (test_pli_min_interval)
+{
+  TestData data;
+  GstClockID id;
+  GstClockTime time, pli_time;
+  GObject *internal_session;
+  GstBuffer *buf;
+  gint i;
+
+  setup_testharness (&data, FALSE);
+  g_object_get (data.session, "internal-session", &internal_session, NULL);
+  g_object_set (internal_session, "rtcp-pli-min-interval", GST_SECOND, NULL);
+
+  gst_test_clock_wait_for_next_pending_id (GST_TEST_CLOCK (data.clock), &id);
+  crank_rtcp_thread (&data, &time, &id);
+  while ((buf = g_async_queue_try_pop (data.rtcp_queue)))
+    gst_buffer_unref (buf);
+
+  push_rtp_packets (&data, 0x01BADBAD, 5);
+  g_assert (gst_pad_set_active (data.rtpsrc, TRUE));
+
+  /* the first PLI goes out with the next RTCP packet */
+  send_force_key_unit (&data, 0x01BADBAD);
+  gst_clock_id_unref (id);
+  gst_test_clock_wait_for_next_pending_id (GST_TEST_CLOCK (data.clock), &id);
+  crank_rtcp_thread (&data, &time, &id);
+  g_assert_cmpint (count_rtcp_plis (&data, 0x01BADBAD), ==, 1);
+  pli_time = time;
+
+  /* both requests are within the interval, they become one deferred PLI */
+  send_force_key_unit (&data, 0x01BADBAD);
+  send_force_key_unit (&data, 0x01BADBAD);
+  g_assert_cmpint (get_session_stat (internal_session,
+          "suppressed-pli-count"), ==, 2);
+
+  /* the request may have rescheduled the RTCP thread */
+  gst_clock_id_unref (id);
+  gst_test_clock_wait_for_next_pending_id (GST_TEST_CLOCK (data.clock), &id);
+
+  for (i = 0; i < 10; i++) {
+    gint plis;
+
+    crank_rtcp_thread (&data, &time, &id);
+    plis = count_rtcp_plis (&data, 0x01BADBAD);
+    if (plis == 0) {
+      g_assert_cmpuint (time, <, pli_time + GST_SECOND);
+      continue;
+    }
+    g_assert_cmpint (plis, ==, 1);
+    g_assert_cmpuint (time, >=, pli_time + GST_SECOND);
+    break;
+  }
+  g_assert_cmpint (i, <, 10);
+  gst_clock_id_unref (id);
+
+  g_object_unref (internal_session);
+  destroy_testharness (&data);
+}
+
+GST_END_TEST;
+
 static Suite *
 rtpsession_suite (void)
 {
@@ -575,6 +787,8 @@ rtpsession_suite (void)
   tcase_add_test (tc_chain, test_multiple_ssrc_rr);
   tcase_add_test (tc_chain, test_multiple_senders_roundrobin_rbs);
   tcase_add_test (tc_chain, test_internal_sources_timeout);
+  tcase_add_test (tc_chain, test_nack_blp_merge);
+  tcase_add_test (tc_chain, test_pli_min_interval);
 
   return s;
 }
@@ -19,6 +19,9 @@
 #include "config.h"
 #endif
 
+#include <unistd.h>
+
+#include <glib/gstdio.h>
 #include <gst/check/gstcheck.h>
 
 static void
@@ -72,6 +75,105 @@ GST_START_TEST (test_empty_file_push)
 
 GST_END_TEST;
 
+#define RATE 8000
+
+/* one second of mono 16 bit audio at RATE, in a file with a wrong byte rate
+ * in its header, a chunk before the data and a second, bogus data chunk */
+static gchar *
+create_wav_file (void)
+{
+  GByteArray *data;
+  gchar *filename;
+  guint8 hdr[8];
+  guint16 sample;
+  gint fd, i;
+
+  data = g_byte_array_new ();
+  g_byte_array_append (data, (const guint8 *) "RIFF\0\0\0\0WAVE", 12);
+
+  g_byte_array_append (data, (const guint8 *) "fmt \20\0\0\0", 8);
+  GST_WRITE_UINT16_LE (hdr, 1);         /* PCM */
+  GST_WRITE_UINT16_LE (hdr + 2, 1);     /* channels */
+  GST_WRITE_UINT32_LE (hdr + 4, RATE);
+  g_byte_array_append (data, hdr, 8);
+  GST_WRITE_UINT32_LE (hdr, 1000);      /* av_bps, should be 2 * RATE */
+  GST_WRITE_UINT16_LE (hdr + 4, 2);     /* blockalign */
+  GST_WRITE_UINT16_LE (hdr + 6, 16);    /* bits per sample */
+  g_byte_array_append (data, hdr, 8);
+
+  g_byte_array_append (data, (const guint8 *) "JUNK\6\0\0\0\0\0\0\0\0\0",
+      14);
+
+  g_byte_array_append (data, (const guint8 *) "data", 4);
+  GST_WRITE_UINT32_LE (hdr, 2 * RATE);
+  g_byte_array_append (data, hdr, 4);
+  for (i = 0; i < RATE; i++) {
+    GST_WRITE_UINT16_LE (&sample, i);
+    g_byte_array_append (data, (const guint8 *) &sample, 2);
+  }
+
+  g_byte_array_append (data, (const guint8 *) "data\4\0\0\0\0\0\0\0", 12);
+
+  GST_WRITE_UINT32_LE (data->data + 4, data->len - 8);
+
+  fd = g_file_open_tmp (NULL, &filename, NULL);
+  fail_unless (fd >= 0);
+  fail_unless_equals_int (write (fd, data->data, data->len), data->len);
+  close (fd);
+  g_byte_array_free (data, TRUE);
+
+  return filename;
+}
+
+GST_START_TEST (test_seek_pull)
+{
+  GstElement *pipeline, *sink;
+  GstSample *sample;
+  GstBuffer *buf;
+  gchar *filename, *desc;
+  gint64 duration;
+
+  filename = create_wav_file ();
+  desc = g_strdup_printf ("filesrc location=%s ! wavparse ! fakesink "
+      "name=sink", filename);
+  pipeline = gst_parse_launch (desc, NULL);
+  g_free (desc);
+  fail_unless (pipeline != NULL);
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+
+  fail_if (gst_element_set_state (pipeline,
+          GST_STATE_PAUSED) == GST_STATE_CHANGE_FAILURE);
+  fail_unless_equals_int (gst_element_get_state (pipeline, NULL, NULL,
+          GST_CLOCK_TIME_NONE), GST_STATE_CHANGE_SUCCESS);
+
+  /* the length comes from the first data chunk and the real byte rate */
+  fail_unless (gst_element_query_duration (pipeline, GST_FORMAT_TIME,
+          &duration));
+  fail_unless_equals_uint64 (duration, GST_SECOND);
+
+  /* seeking lands on the exact sample */
+  fail_unless (gst_element_seek_simple (pipeline, GST_FORMAT_TIME,
+          GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_ACCURATE, GST_SECOND / 2));
+  fail_unless_equals_int (gst_element_get_state (pipeline, NULL, NULL,
+          GST_CLOCK_TIME_NONE), GST_STATE_CHANGE_SUCCESS);
+
+  g_object_get (sink, "last-sample", &sample, NULL);
+  fail_unless (sample != NULL);
+  buf = gst_sample_get_buffer (sample);
+  fail_unless_equals_uint64 (GST_BUFFER_OFFSET (buf), RATE / 2);
+  fail_unless_equals_uint64 (GST_BUFFER_PTS (buf), GST_SECOND / 2);
+  fail_unless (gst_buffer_memcmp (buf, 0, "\xa0\x0f", 2) == 0);
+  gst_sample_unref (sample);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (sink);
+  gst_object_unref (pipeline);
+  g_remove (filename);
+  g_free (filename);
+}
+
+GST_END_TEST;
+
 static Suite *
 wavparse_suite (void)
 {
@@ -81,6 +183,7 @@ wavparse_suite (void)
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, test_empty_file_pull);
   tcase_add_test (tc_chain, test_empty_file_push);
+  tcase_add_test (tc_chain, test_seek_pull);
   return s;
 }
 
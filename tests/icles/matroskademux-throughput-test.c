@@ -0,0 +1,128 @@
+/* GStreamer interactive test for matroskademux throughput
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ *
+ */
+
+/* Demuxes the provided Matroska/WebM file into fakesinks as fast as
+ * possible, a number of times, and prints the throughput of each run.
+ * The first run usually pulls the file into the page cache, so use a
+ * big file (several GB) and look at the later runs to measure the demuxer
+ * rather than the disk.
+ */
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdlib.h>
+
+#include <glib/gstdio.h>
+#include <gst/gst.h>
+
+#define DEFAULT_RUNS 3
+
+static void
+pad_added_cb (GstElement * demux, GstPad * pad, GstElement * pipeline)
+{
+  GstElement *sink;
+  GstPad *sinkpad;
+
+  sink = gst_element_factory_make ("fakesink", NULL);
+  g_object_set (sink, "sync", FALSE, "async", FALSE, NULL);
+  gst_bin_add (GST_BIN (pipeline), sink);
+  gst_element_sync_state_with_parent (sink);
+
+  sinkpad = gst_element_get_static_pad (sink, "sink");
+  if (gst_pad_link (pad, sinkpad) != GST_PAD_LINK_OK)
+    g_printerr ("could not link %s\n", GST_PAD_NAME (pad));
+  gst_object_unref (sinkpad);
+}
+
+static gboolean
+run (const gchar * location, gdouble * seconds)
+{
+  GstElement *pipeline, *src, *demux;
+  GstMessage *msg;
+  gint64 start;
+  gboolean res;
+
+  pipeline = gst_pipeline_new (NULL);
+  src = gst_element_factory_make ("filesrc", NULL);
+  demux = gst_element_factory_make ("matroskademux", NULL);
+  g_assert (src && demux);
+
+  g_object_set (src, "location", location, NULL);
+  gst_bin_add_many (GST_BIN (pipeline), src, demux, NULL);
+  gst_element_link (src, demux);
+  g_signal_connect (demux, "pad-added", G_CALLBACK (pad_added_cb), pipeline);
+
+  start = g_get_monotonic_time ();
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+
+  msg = gst_bus_timed_pop_filtered (GST_ELEMENT_BUS (pipeline),
+      GST_CLOCK_TIME_NONE, GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  *seconds = (g_get_monotonic_time () - start) / (gdouble) G_USEC_PER_SEC;
+
+  res = (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_EOS);
+  if (!res) {
+    GError *err = NULL;
+
+    gst_message_parse_error (msg, &err, NULL);
+    g_printerr ("error: %s\n", err->message);
+    g_clear_error (&err);
+  }
+  gst_message_unref (msg);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+  return res;
+}
+
+int
+main (int argc, char **argv)
+{
+  GStatBuf st;
+  gint i, runs = DEFAULT_RUNS;
+
+  if (argc < 2) {
+    g_printerr ("Usage: %s FILENAME [RUNS]\n", argv[0]);
+    return -1;
+  }
+
+  gst_init (&argc, &argv);
+
+  if (argc > 2)
+    runs = MAX (atoi (argv[2]), 1);
+
+  if (g_stat (argv[1], &st) != 0) {
+    g_printerr ("could not stat %s\n", argv[1]);
+    return -1;
+  }
+
+  for (i = 0; i < runs; i++) {
+    gdouble seconds;
+
+    if (!run (argv[1], &seconds))
+      return -1;
+
+    g_print ("run %d: %" G_GINT64_FORMAT " bytes in %.3f s, %.1f MB/s\n",
+        i + 1, (gint64) st.st_size, seconds,
+        st.st_size / seconds / (1024 * 1024));
+  }
+
+  return 0;
+}
@@ -0,0 +1,155 @@
+/* GStreamer interactive test for MP4 <-> Matroska remuxing throughput
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ *
+ */
+
+/* Remuxes the provided file into a fakesink as fast as possible, a number
+ * of times, and prints the number of samples per second of each run.
+ * Matroska/WebM files (by extension) go through matroskademux and qtmux,
+ * anything else through qtdemux and matroskamux, so running it on a file
+ * of each kind measures both directions.
+ */
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdlib.h>
+
+#include <gst/gst.h>
+
+#define DEFAULT_RUNS 3
+
+static volatile gint n_samples;
+
+static GstPadProbeReturn
+count_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  g_atomic_int_inc (&n_samples);
+
+  return GST_PAD_PROBE_OK;
+}
+
+static void
+pad_added_cb (GstElement * demux, GstPad * pad, GstElement * mux)
+{
+  GstElement *pipeline, *queue;
+  GstPad *sinkpad, *srcpad, *muxpad;
+
+  pipeline = GST_ELEMENT (gst_element_get_parent (mux));
+  queue = gst_element_factory_make ("queue", NULL);
+  gst_bin_add (GST_BIN (pipeline), queue);
+  gst_element_sync_state_with_parent (queue);
+
+  sinkpad = gst_element_get_static_pad (queue, "sink");
+  srcpad = gst_element_get_static_pad (queue, "src");
+  gst_pad_link (pad, sinkpad);
+
+  /* streams the muxer does not take are left unlinked */
+  muxpad = gst_element_get_compatible_pad (mux, pad, NULL);
+  if (muxpad && gst_pad_link (srcpad, muxpad) == GST_PAD_LINK_OK)
+    gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER, count_probe, NULL,
+        NULL);
+  else
+    g_printerr ("could not link %s, not remuxing it\n", GST_PAD_NAME (pad));
+
+  if (muxpad)
+    gst_object_unref (muxpad);
+  gst_object_unref (srcpad);
+  gst_object_unref (sinkpad);
+  gst_object_unref (pipeline);
+}
+
+static gboolean
+run (const gchar * location, gboolean from_matroska, gdouble * seconds)
+{
+  GstElement *pipeline, *src, *demux, *mux, *sink;
+  GstMessage *msg;
+  gint64 start;
+  gboolean res;
+
+  pipeline = gst_pipeline_new (NULL);
+  src = gst_element_factory_make ("filesrc", NULL);
+  demux = gst_element_factory_make (from_matroska ? "matroskademux" :
+      "qtdemux", NULL);
+  mux = gst_element_factory_make (from_matroska ? "qtmux" : "matroskamux",
+      NULL);
+  sink = gst_element_factory_make ("fakesink", NULL);
+  g_assert (src && demux && mux && sink);
+
+  g_object_set (src, "location", location, NULL);
+  g_object_set (sink, "sync", FALSE, NULL);
+  gst_bin_add_many (GST_BIN (pipeline), src, demux, mux, sink, NULL);
+  gst_element_link (src, demux);
+  gst_element_link (mux, sink);
+  g_signal_connect (demux, "pad-added", G_CALLBACK (pad_added_cb), mux);
+
+  n_samples = 0;
+  start = g_get_monotonic_time ();
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+
+  msg = gst_bus_timed_pop_filtered (GST_ELEMENT_BUS (pipeline),
+      GST_CLOCK_TIME_NONE, GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  *seconds = (g_get_monotonic_time () - start) / (gdouble) G_USEC_PER_SEC;
+
+  res = (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_EOS);
+  if (!res) {
+    GError *err = NULL;
+
+    gst_message_parse_error (msg, &err, NULL);
+    g_printerr ("error: %s\n", err->message);
+    g_clear_error (&err);
+  }
+  gst_message_unref (msg);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+  return res;
+}
+
+int
+main (int argc, char **argv)
+{
+  gboolean from_matroska;
+  gint i, runs = DEFAULT_RUNS;
+
+  if (argc < 2) {
+    g_printerr ("Usage: %s FILENAME [RUNS]\n", argv[0]);
+    return -1;
+  }
+
+  gst_init (&argc, &argv);
+
+  if (argc > 2)
+    runs = MAX (atoi (argv[2]), 1);
+
+  from_matroska = g_str_has_suffix (argv[1], ".mkv") ||
+      g_str_has_suffix (argv[1], ".mka") || g_str_has_suffix (argv[1], ".webm");
+
+  for (i = 0; i < runs; i++) {
+    gdouble seconds;
+
+    if (!run (argv[1], from_matroska, &seconds))
+      return -1;
+
+    g_print ("run %d (%s): %d samples in %.3f s, %.0f samples/s\n", i + 1,
+        from_matroska ? "matroska -> mp4" : "mp4 -> matroska", n_samples,
+        seconds, n_samples / seconds);
+  }
+
+  return 0;
+}